@@ -28,10 +28,41 @@ call glslangValidator -DLINE_VERTEX_SHADER=1 -S vert -e main -g -V -o %DataDir%\
 call glslangValidator -DLINE_2_VERTEX_SHADER=1 -S vert -e main -g -V -o %DataDir%\shader_line_2_vert.spv %CodeDir%\graph_shaders.cpp
 call glslangValidator -DLINE_FRAGMENT_SHADER=1 -S frag -e main -g -V -o %DataDir%\shader_line_frag.spv %CodeDir%\graph_shaders.cpp
 
+call glslangValidator -DGRAPH_ATTRACTION_EDGES=1 -S comp -e main -g -V -o %DataDir%\shader_graph_attraction_edges.spv %CodeDir%\graph_shaders.cpp
 call glslangValidator -DGRAPH_MOVE_CONNECTIONS=1 -S comp -e main -g -V -o %DataDir%\shader_graph_move_connections.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_MOVE_CONNECTIONS=1 -DGRAPH_ACTIVE_SET=1 -S comp -e main -g -V -o %DataDir%\shader_graph_move_connections_active.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_ATTRACTION_EDGES=1 -DGRAPH_SHARD=1 -S comp -e main -g -V -o %DataDir%\shader_graph_attraction_edges_shard.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_MOVE_CONNECTIONS=1 -DGRAPH_SHARD=1 -S comp -e main -g -V -o %DataDir%\shader_graph_move_connections_shard.spv %CodeDir%\graph_shaders.cpp
 call glslangValidator -DGRAPH_REPULSION=1 -S comp -e main -g -V -o %DataDir%\shader_graph_repulsion.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_REPULSION=1 -DGRAPH_ACTIVE_SET=1 -S comp -e main -g -V -o %DataDir%\shader_graph_repulsion_active.spv %CodeDir%\graph_shaders.cpp
 call glslangValidator -DGRAPH_CALC_GLOBAL_SPEED=1 -S comp --target-env spirv1.3 -e main -g -V -o %DataDir%\shader_graph_calc_global_speed.spv %CodeDir%\graph_shaders.cpp
 call glslangValidator -DGRAPH_UPDATE_NODES=1 -S comp -e main -g -V -o %DataDir%\shader_graph_update_nodes.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_UPDATE_NODES=1 -DGRAPH_ACTIVE_SET=1 -S comp -e main -g -V -o %DataDir%\shader_graph_update_nodes_active.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_ACTIVE_COMPACT=1 -S comp -e main -g -V -o %DataDir%\shader_graph_active_compact.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_ACTIVE_DISPATCH_ARGS=1 -S comp -e main -g -V -o %DataDir%\shader_graph_active_dispatch_args.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_PROLONG=1 -S comp -e main -g -V -o %DataDir%\shader_graph_prolong.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_APPEND_SEED=1 -S comp -e main -g -V -o %DataDir%\shader_graph_append_seed.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_PACK_NODE_STATE=1 -S comp -e main -g -V -o %DataDir%\shader_graph_pack_node_state.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_ATTRACTION_CACHE=1 -S comp -e main -g -V -o %DataDir%\shader_graph_attraction_cache.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_FUSED_LAYOUT=1 -S comp --target-env spirv1.3 -e main -g -V -o %DataDir%\shader_graph_fused_layout.spv %CodeDir%\graph_shaders.cpp
+call glslangValidator -DGRAPH_FUSED_RESOLVE=1 -S comp -e main -g -V -o %DataDir%\shader_graph_fused_resolve.spv %CodeDir%\graph_shaders.cpp
+
+REM Grid Shaders
+call glslangValidator -DGRID_BOUNDS=1 -S comp --target-env spirv1.3 -e main -g -V -o %DataDir%\shader_grid_bounds.spv %CodeDir%\graph_grid_shaders.cpp
+call glslangValidator -DGRID_CELL_IDS=1 -S comp -e main -g -V -o %DataDir%\shader_grid_cell_ids.spv %CodeDir%\graph_grid_shaders.cpp
+call glslangValidator -DGRID_SCAN=1 -S comp -e main -g -V -o %DataDir%\shader_grid_scan.spv %CodeDir%\graph_grid_shaders.cpp
+call glslangValidator -DGRID_SCATTER=1 -S comp -e main -g -V -o %DataDir%\shader_grid_scatter.spv %CodeDir%\graph_grid_shaders.cpp
+call glslangValidator -DGRID_SUMMARY=1 -S comp -e main -g -V -o %DataDir%\shader_grid_summary.spv %CodeDir%\graph_grid_shaders.cpp
+call glslangValidator -DGRID_PYRAMID=1 -S comp -e main -g -V -o %DataDir%\shader_grid_pyramid.spv %CodeDir%\graph_grid_shaders.cpp
+call glslangValidator -DGRID_REPULSION=1 -S comp -e main -g -V -o %DataDir%\shader_grid_repulsion.spv %CodeDir%\graph_grid_shaders.cpp
+call glslangValidator -DGRID_REPULSION=1 -DGRAPH_ACTIVE_SET=1 -S comp -e main -g -V -o %DataDir%\shader_grid_repulsion_active.spv %CodeDir%\graph_grid_shaders.cpp
+
+REM Edge Sort Shaders
+call glslangValidator -DEDGE_SORT_THREAD=1 -S comp -e main -g -V -o %DataDir%\shader_edge_sort_thread.spv %CodeDir%\edge_sort_shaders.cpp
+call glslangValidator -DEDGE_SORT_BLOCK=1 -S comp -e main -g -V -o %DataDir%\shader_edge_sort_block.spv %CodeDir%\edge_sort_shaders.cpp
+call glslangValidator -DEDGE_SORT_GATHER_KEYS=1 -S comp -e main -g -V -o %DataDir%\shader_edge_sort_gather_keys.spv %CodeDir%\edge_sort_shaders.cpp
+call glslangValidator -DEDGE_SORT_GATHER_SEGMENTS=1 -S comp -e main -g -V -o %DataDir%\shader_edge_sort_gather_segments.spv %CodeDir%\edge_sort_shaders.cpp
+call glslangValidator -DEDGE_SORT_SCATTER=1 -S comp -e main -g -V -o %DataDir%\shader_edge_sort_scatter.spv %CodeDir%\edge_sort_shaders.cpp
 
 REM Sort Shaders
 call glslangValidator -DBITONIC_GLOBAL_FLIP=1 -S comp -e main -g -V -o %DataDir%\shader_merge_global_flip.spv %CodeDir%\sort_shaders.cpp
@@ -39,13 +70,31 @@ call glslangValidator -DBITONIC_LOCAL_DISPERSE=1 -S comp -e main -g -V -o %DataD
 call glslangValidator -DBITONIC_GLOBAL_DISPERSE=1 -S comp -e main -g -V -o %DataDir%\shader_merge_global_disperse.spv %CodeDir%\sort_shaders.cpp
 call glslangValidator -DBITONIC_LOCAL_FD=1 -S comp -e main -g -V -o %DataDir%\shader_merge_local_fd.spv %CodeDir%\sort_shaders.cpp
 call glslangValidator -S comp -e main -g -V -o %DataDir%\shader_atomic_merge_sort.spv %CodeDir%\sort_shaders_atomic.cpp
+call glslangValidator -DSORT64_LOW_WORD=1 -S comp -e main -g -V -o %DataDir%\shader_sort64_low_word.spv %CodeDir%\sort_shaders_64.cpp
+call glslangValidator -DSORT64_HIGH_WORD=1 -S comp -e main -g -V -o %DataDir%\shader_sort64_high_word.spv %CodeDir%\sort_shaders_64.cpp
+call glslangValidator -DSORT64_PERMUTE=1 -S comp -e main -g -V -o %DataDir%\shader_sort64_permute.spv %CodeDir%\sort_shaders_64.cpp
 
 REM RadixTree Shaders
 call glslangValidator -DGENERATE_MORTON_KEYS=1 -S comp --target-env spirv1.3 -e main -g -V -o %DataDir%\shader_generate_morton_keys.spv %CodeDir%\radixtree_shaders.cpp
+call glslangValidator -DMORTON_KEYS_GATHER=1 -S comp --target-env spirv1.3 -e main -g -V -o %DataDir%\shader_morton_keys_gather.spv %CodeDir%\radixtree_shaders.cpp
+call glslangValidator -DMORTON_LOCAL_SORT=1 -S comp -e main -g -V -o %DataDir%\shader_morton_local_sort.spv %CodeDir%\radixtree_shaders.cpp
+call glslangValidator -DMORTON_CHECK=1 -S comp -e main -g -V -o %DataDir%\shader_morton_check.spv %CodeDir%\radixtree_shaders.cpp
+call glslangValidator -DMORTON_CLAMP=1 -S comp -e main -g -V -o %DataDir%\shader_morton_clamp.spv %CodeDir%\radixtree_shaders.cpp
 call glslangValidator -DCALC_WORLD_BOUNDS=1 -S comp --target-env spirv1.3 -e main -g -V -o %DataDir%\shader_calc_world_bounds.spv %CodeDir%\radixtree_shaders.cpp
 call glslangValidator -DRADIX_TREE_BUILD=1 -S comp -e main -g -V -o %DataDir%\shader_radix_tree_build.spv %CodeDir%\radixtree_shaders.cpp
 call glslangValidator -DRADIX_TREE_SUMMARIZE=1 -S comp -e main -g -V -o %DataDir%\shader_radix_tree_summarize.spv %CodeDir%\radixtree_shaders.cpp
 call glslangValidator -DRADIX_TREE_REPULSION=1 -S comp --target-env spirv1.3 -e main -g -V -o %DataDir%\shader_radix_tree_repulsion.spv %CodeDir%\radixtree_shaders.cpp
+call glslangValidator -DRADIX_TREE_REPULSION=1 -DGRAPH_ACTIVE_SET=1 -S comp --target-env spirv1.3 -e main -g -V -o %DataDir%\shader_radix_tree_repulsion_active.spv %CodeDir%\radixtree_shaders.cpp
+
+REM FMM Shaders
+call glslangValidator -DFMM_UPWARD=1 -S comp -e main -g -V -o %DataDir%\shader_fmm_upward.spv %CodeDir%\fmm_shaders.cpp
+call glslangValidator -DFMM_DEPTH=1 -S comp -e main -g -V -o %DataDir%\shader_fmm_depth.spv %CodeDir%\fmm_shaders.cpp
+call glslangValidator -DFMM_LEVEL_SCAN=1 -S comp -e main -g -V -o %DataDir%\shader_fmm_level_scan.spv %CodeDir%\fmm_shaders.cpp
+call glslangValidator -DFMM_LEVEL_SCATTER=1 -S comp -e main -g -V -o %DataDir%\shader_fmm_level_scatter.spv %CodeDir%\fmm_shaders.cpp
+call glslangValidator -DFMM_WALK=1 -S comp -e main -g -V -o %DataDir%\shader_fmm_walk.spv %CodeDir%\fmm_shaders.cpp
+call glslangValidator -DFMM_DOWNWARD=1 -S comp -e main -g -V -o %DataDir%\shader_fmm_downward.spv %CodeDir%\fmm_shaders.cpp
+call glslangValidator -DFMM_EVALUATE=1 -S comp -e main -g -V -o %DataDir%\shader_fmm_evaluate.spv %CodeDir%\fmm_shaders.cpp
+call glslangValidator -DFMM_EVALUATE=1 -DGRAPH_ACTIVE_SET=1 -S comp -e main -g -V -o %DataDir%\shader_fmm_evaluate_active.spv %CodeDir%\fmm_shaders.cpp
 
 REM Parallel Sort Shaders (HLSL in VK using DXC)
 set DxcDir=D:\Tools\dxc_2020_10-22\bin\x64
@@ -54,8 +103,13 @@ set DxcDir=D:\Tools\dxc_2020_10-22\bin\x64
 %DxcDir%\dxc.exe -spirv -DPARALLEL_SORT_SCAN=1 -T cs_6_0 -E main -fspv-target-env=vulkan1.1 -Wno-for-redefinition -Fo %DataDir%\shader_parallel_sort_scan.spv %CodeDir%\parallel_sort_shaders.cpp
 %DxcDir%\dxc.exe -spirv -DPARALLEL_SORT_SCAN_ADD=1 -T cs_6_0 -E main -fspv-target-env=vulkan1.1 -Wno-for-redefinition -Fo %DataDir%\shader_parallel_sort_scan_add.spv %CodeDir%\parallel_sort_shaders.cpp
 %DxcDir%\dxc.exe -spirv -DPARALLEL_SORT_SCATTER=1 -T cs_6_0 -E main -fspv-target-env=vulkan1.1 -Wno-for-redefinition -Fo %DataDir%\shader_parallel_sort_scatter.spv %CodeDir%\parallel_sort_shaders.cpp
+%DxcDir%\dxc.exe -spirv -DONESWEEP_GLOBAL_HISTOGRAM=1 -T cs_6_0 -E main -fspv-target-env=vulkan1.1 -Wno-for-redefinition -Fo %DataDir%\shader_onesweep_global_histogram.spv %CodeDir%\parallel_sort_shaders.cpp
+%DxcDir%\dxc.exe -spirv -DONESWEEP_GLOBAL_SCAN=1 -T cs_6_0 -E main -fspv-target-env=vulkan1.1 -Wno-for-redefinition -Fo %DataDir%\shader_onesweep_global_scan.spv %CodeDir%\parallel_sort_shaders.cpp
+%DxcDir%\dxc.exe -spirv -DONESWEEP_DIGIT_PASS=1 -T cs_6_0 -E main -fspv-target-env=vulkan1.1 -Wno-for-redefinition -Fo %DataDir%\shader_onesweep_digit_pass.spv %CodeDir%\parallel_sort_shaders.cpp
+%DxcDir%\dxc.exe -spirv -DONESWEEP_COPY=1 -T cs_6_0 -E main -fspv-target-env=vulkan1.1 -Wno-for-redefinition -Fo %DataDir%\shader_onesweep_copy.spv %CodeDir%\parallel_sort_shaders.cpp
 
 call cl %CommonCompilerFlags% -Fepreprocess.exe %CodeDir%\preprocess.cpp -Fmpreprocess.map /link %CommonLinkerFlags%
+call cl %CommonCompilerFlags% -Fesort_bench.exe %CodeDir%\huge_graphs_sort_bench.cpp -Fmsort_bench.map /link %CommonLinkerFlags%
 
 REM 64-bit build
 echo WAITING FOR PDB > lock.tmp
@@ -0,0 +1,285 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+/*
+  NOTE: Segmented sort of every node's edges, the segments are the StartConnections/EndConnections ranges of NodeEdgeArray. The host
+        buckets the segments by size into EdgeSortSegmentArray:
+
+        - EDGE_SORT_THREAD sorts a segment of up to EDGE_SORT_THREAD_SIZE edges per thread, with an odd even transposition sort over
+          a fixed size array so that it stays in registers.
+        - EDGE_SORT_BLOCK sorts a segment of up to EDGE_SORT_BLOCK_SIZE edges per work group, with a bitonic sort in shared memory.
+        - Bigger segments go through the global radix sort in batches. EDGE_SORT_GATHER_KEYS writes the keys of a batch with their
+          position as the payload, and after sorting them EDGE_SORT_GATHER_SEGMENTS replaces the keys with the segment of every
+          payload. The sort is stable, so sorting again leaves every segment contiguous and sorted by key. EDGE_SORT_SCATTER then
+          writes the edges in that order to EdgeSortScratchEdgeArray and the host copies every segment back.
+
+        Ties keep the order the edges had, in every path.
+ */
+
+#include "graph_shaders.h"
+#include "edge_sort_shaders.h"
+
+EDGE_SORT_DESCRIPTOR_LAYOUT(0)
+GRAPH_DESCRIPTOR_LAYOUT(1)
+
+layout(push_constant) uniform push_constants
+{
+    uint SortKey;
+    uint FirstSegment;
+    uint NumSegments;
+    uint NumBatchEdges;
+} PushConstants;
+
+uint EdgeSortKey(edge Edge)
+{
+    uint Result = Edge.OtherNodeId;
+    if (PushConstants.SortKey == EdgeSortKey_Weight)
+    {
+        // NOTE: Order preserving uint of the weight, flipped so that the heaviest edges come first
+        uint Bits = floatBitsToUint(Edge.Weight);
+        uint OrderedBits = (Bits & 0x80000000) != 0 ? ~Bits : (Bits | 0x80000000);
+        Result = ~OrderedBits;
+    }
+
+    return Result;
+}
+
+uint EdgeSortWorkGroupId()
+{
+    uint Result = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    return Result;
+}
+
+//=========================================================================================================================================
+// NOTE: Edge Sort Thread Pipeline
+//=========================================================================================================================================
+
+#if EDGE_SORT_THREAD
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint SegmentId = EdgeSortWorkGroupId() * 32 + gl_LocalInvocationIndex;
+    if (SegmentId >= PushConstants.NumSegments)
+    {
+        return;
+    }
+
+    uint NodeId = EdgeSortSegmentArray[PushConstants.FirstSegment + SegmentId];
+    graph_node_edges Range = NodeEdgeArray[NodeId];
+    uint NumEdges = Range.EndConnections - Range.StartConnections;
+
+    // NOTE: Slots past the end get the max key, we only swap on greater so they stay behind real edges with the max key
+    uint Keys[EDGE_SORT_THREAD_SIZE];
+    edge Edges[EDGE_SORT_THREAD_SIZE];
+    for (uint EdgeId = 0; EdgeId < EDGE_SORT_THREAD_SIZE; ++EdgeId)
+    {
+        Keys[EdgeId] = 0xFFFFFFFF;
+        Edges[EdgeId] = edge(0, 0.0f);
+        if (EdgeId < NumEdges)
+        {
+            Edges[EdgeId] = EdgeArray[Range.StartConnections + EdgeId];
+            Keys[EdgeId] = EdgeSortKey(Edges[EdgeId]);
+        }
+    }
+
+    // NOTE: Every round only compares neighbours, so this is stable and all the indices are known once the loops get unrolled
+    for (uint Round = 0; Round < EDGE_SORT_THREAD_SIZE; ++Round)
+    {
+        for (uint EdgeId = Round & 1; EdgeId + 1 < EDGE_SORT_THREAD_SIZE; EdgeId += 2)
+        {
+            if (Keys[EdgeId] > Keys[EdgeId + 1])
+            {
+                uint TempKey = Keys[EdgeId];
+                Keys[EdgeId] = Keys[EdgeId + 1];
+                Keys[EdgeId + 1] = TempKey;
+
+                edge TempEdge = Edges[EdgeId];
+                Edges[EdgeId] = Edges[EdgeId + 1];
+                Edges[EdgeId + 1] = TempEdge;
+            }
+        }
+    }
+
+    for (uint EdgeId = 0; EdgeId < EDGE_SORT_THREAD_SIZE; ++EdgeId)
+    {
+        if (EdgeId < NumEdges)
+        {
+            EdgeArray[Range.StartConnections + EdgeId] = Edges[EdgeId];
+        }
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Edge Sort Block Pipeline
+//=========================================================================================================================================
+
+#if EDGE_SORT_BLOCK
+
+shared uint SharedKeys[EDGE_SORT_BLOCK_SIZE];
+shared uint SharedIds[EDGE_SORT_BLOCK_SIZE];
+shared edge SharedEdges[EDGE_SORT_BLOCK_SIZE];
+
+void SharedCompareAndSwap(uint Id0, uint Id1)
+{
+    // NOTE: Ties are broken by the edge's position in the segment, which makes the bitonic sort stable
+    uint Key0 = SharedKeys[Id0];
+    uint Key1 = SharedKeys[Id1];
+    if (Key0 > Key1 || (Key0 == Key1 && SharedIds[Id0] > SharedIds[Id1]))
+    {
+        SharedKeys[Id0] = Key1;
+        SharedKeys[Id1] = Key0;
+
+        uint TempId = SharedIds[Id0];
+        SharedIds[Id0] = SharedIds[Id1];
+        SharedIds[Id1] = TempId;
+    }
+}
+
+layout(local_size_x = EDGE_SORT_BLOCK_THREADS, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint SegmentId = EdgeSortWorkGroupId();
+    if (SegmentId >= PushConstants.NumSegments)
+    {
+        return;
+    }
+
+    uint NodeId = EdgeSortSegmentArray[PushConstants.FirstSegment + SegmentId];
+    graph_node_edges Range = NodeEdgeArray[NodeId];
+    uint NumEdges = Range.EndConnections - Range.StartConnections;
+
+    // NOTE: We only sort the next power of 2 up from the segment size, padded with max keys
+    uint NumSortedLog2 = uint(findMSB(max(NumEdges, 2) - 1)) + 1;
+    uint NumSorted = 1 << NumSortedLog2;
+    for (uint EdgeId = gl_LocalInvocationIndex; EdgeId < NumSorted; EdgeId += EDGE_SORT_BLOCK_THREADS)
+    {
+        SharedKeys[EdgeId] = 0xFFFFFFFF;
+        SharedIds[EdgeId] = EdgeId;
+        if (EdgeId < NumEdges)
+        {
+            edge Edge = EdgeArray[Range.StartConnections + EdgeId];
+            SharedEdges[EdgeId] = Edge;
+            SharedKeys[EdgeId] = EdgeSortKey(Edge);
+        }
+    }
+
+    uint NumPairs = NumSorted / 2;
+    for (uint FlipSize = 1, PassId = 0; FlipSize < NumSorted; PassId += 1, FlipSize *= 2)
+    {
+        barrier();
+
+        // NOTE: Do Flip
+        for (uint PairId = gl_LocalInvocationIndex; PairId < NumPairs; PairId += EDGE_SORT_BLOCK_THREADS)
+        {
+            uint LowerHeightBits = FlipSize - 1;
+            uint FlipId1 = 2*FlipSize * (PairId >> PassId) + (PairId & LowerHeightBits);
+            uint FlipId2 = FlipId1 + 2*FlipSize - 2 * (PairId & LowerHeightBits) - 1;
+
+            SharedCompareAndSwap(FlipId1, FlipId2);
+        }
+
+        barrier();
+
+        // NOTE: Do Disperse
+        for (uint N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
+        {
+            for (uint PairId = gl_LocalInvocationIndex; PairId < NumPairs; PairId += EDGE_SORT_BLOCK_THREADS)
+            {
+                uint DoubleHeight = N * 2;
+                uint LowerBits = N - 1;
+                uint DisperseId1 = DoubleHeight * ((PairId & (~LowerBits)) >> NPassId) + (PairId & LowerBits);
+                uint DisperseId2 = DisperseId1 + N;
+
+                SharedCompareAndSwap(DisperseId1, DisperseId2);
+            }
+
+            barrier();
+        }
+    }
+
+    barrier();
+
+    for (uint EdgeId = gl_LocalInvocationIndex; EdgeId < NumEdges; EdgeId += EDGE_SORT_BLOCK_THREADS)
+    {
+        EdgeArray[Range.StartConnections + EdgeId] = SharedEdges[SharedIds[EdgeId]];
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Edge Sort Gather Keys Pipeline
+//=========================================================================================================================================
+
+#if EDGE_SORT_GATHER_KEYS
+
+// NOTE: 1 work group per segment of the batch
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint SegmentId = EdgeSortWorkGroupId();
+    if (SegmentId >= PushConstants.NumSegments)
+    {
+        return;
+    }
+
+    uint NodeId = EdgeSortSegmentArray[PushConstants.FirstSegment + SegmentId];
+    uint BatchOffset = EdgeSortBatchOffsetArray[PushConstants.FirstSegment + SegmentId];
+    graph_node_edges Range = NodeEdgeArray[NodeId];
+    uint NumEdges = Range.EndConnections - Range.StartConnections;
+    for (uint EdgeId = gl_LocalInvocationIndex; EdgeId < NumEdges; EdgeId += 256)
+    {
+        uint BatchId = BatchOffset + EdgeId;
+        EdgeSortKeyArray[BatchId] = EdgeSortKey(EdgeArray[Range.StartConnections + EdgeId]);
+        EdgeSortPayloadArray[BatchId] = BatchId;
+        EdgeSortBatchSegmentArray[BatchId] = SegmentId;
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Edge Sort Gather Segments Pipeline
+//=========================================================================================================================================
+
+#if EDGE_SORT_GATHER_SEGMENTS
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint BatchId = EdgeSortWorkGroupId() * 32 + gl_LocalInvocationIndex;
+    if (BatchId < PushConstants.NumBatchEdges)
+    {
+        EdgeSortKeyArray[BatchId] = EdgeSortBatchSegmentArray[EdgeSortPayloadArray[BatchId]];
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Edge Sort Scatter Pipeline
+//=========================================================================================================================================
+
+#if EDGE_SORT_SCATTER
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint BatchId = EdgeSortWorkGroupId() * 32 + gl_LocalInvocationIndex;
+    if (BatchId < PushConstants.NumBatchEdges)
+    {
+        // NOTE: The payload is the batch position the edge was gathered from, which gives us its segment and its place in it
+        uint SrcBatchId = EdgeSortPayloadArray[BatchId];
+        uint SegmentId = EdgeSortBatchSegmentArray[SrcBatchId];
+        uint NodeId = EdgeSortSegmentArray[PushConstants.FirstSegment + SegmentId];
+        uint SrcEdgeId = NodeEdgeArray[NodeId].StartConnections + SrcBatchId - EdgeSortBatchOffsetArray[PushConstants.FirstSegment + SegmentId];
+        EdgeSortScratchEdgeArray[BatchId] = EdgeArray[SrcEdgeId];
+    }
+}
+
+#endif
@@ -0,0 +1,42 @@
+/*
+  NOTE: Segments with up to EDGE_SORT_THREAD_SIZE edges get sorted by 1 thread in registers, segments with up to EDGE_SORT_BLOCK_SIZE
+        edges by 1 work group in shared memory. These have to match the defines in huge_graphs_demo.h.
+ */
+#define EDGE_SORT_THREAD_SIZE 16
+#define EDGE_SORT_BLOCK_SIZE 1024
+#define EDGE_SORT_BLOCK_THREADS 256
+
+#define EdgeSortKey_OtherNodeId 0
+#define EdgeSortKey_Weight 1
+
+#define EDGE_SORT_DESCRIPTOR_LAYOUT(set_id)                             \
+                                                                        \
+    layout(set = set_id, binding = 0) buffer edge_sort_segment_array    \
+    {                                                                   \
+        uint EdgeSortSegmentArray[];                                    \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 1) buffer edge_sort_batch_offset_array \
+    {                                                                   \
+        uint EdgeSortBatchOffsetArray[];                                \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 2) buffer edge_sort_key_array        \
+    {                                                                   \
+        uint EdgeSortKeyArray[];                                        \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 3) buffer edge_sort_payload_array    \
+    {                                                                   \
+        uint EdgeSortPayloadArray[];                                    \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 4) buffer edge_sort_batch_segment_array \
+    {                                                                   \
+        uint EdgeSortBatchSegmentArray[];                               \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 5) buffer edge_sort_scratch_edge_array \
+    {                                                                   \
+        edge EdgeSortScratchEdgeArray[];                                \
+    };                                                                  \
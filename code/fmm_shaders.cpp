@@ -0,0 +1,780 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+/*
+  NOTE: Fast multipole repulsion on top of the LBVH that radixtree_shaders.cpp builds. Repulsion between 2 nodes is
+        k * d_i * d_j * (x_i - x_j) / |x_i - x_j|^2, which in complex numbers is k * d_i * conj(d_j / (z_i - z_j)). That is the field of a
+        2D log potential, so we use the complex expansions from Greengard and Rokhlin:
+
+        - Multipole of a box about its centre c: Q * log(z - c) + sum_k a_k / (z - c)^k
+        - Local expansion of a box about its centre c: sum_k b_k * (z - c)^k, we drop b_0 since we only need the field
+
+        FMM_UPWARD builds the box and multipole of every internal node bottom up (P2M + M2M). FMM_WALK then builds the interaction lists
+        of every node once with a dual tree walk, so every pair of nodes ends up counted exactly once. FMM_DOWNWARD runs once per tree
+        depth, top down, and every node shifts its parent's local expansion to itself (L2L) and adds the M2L of its interaction list.
+        FMM_EVALUATE does the same for each leaf, evaluates the parent's local expansion (L2P), expands its own interaction list directly
+        (M2P) and sums its near list exactly (P2P).
+
+        The tree has no levels so FMM_DEPTH, FMM_LEVEL_SCAN and FMM_LEVEL_SCATTER bucket the internal nodes by depth first.
+
+        See huge_graphs_fmm.cpp for the CPU reference of all of these steps.
+ */
+
+#include "graph_shaders.h"
+#include "radixtree_shaders.h"
+#include "fmm_shaders.h"
+
+FMM_DESCRIPTOR_LAYOUT(0)
+RADIX_DESCRIPTOR_LAYOUT(1)
+GRAPH_DESCRIPTOR_LAYOUT(2)
+
+//=========================================================================================================================================
+// NOTE: FMM Helpers
+//=========================================================================================================================================
+
+uint FmmThreadId()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint Result = WorkGroupId * gl_WorkGroupSize.x + gl_LocalInvocationIndex;
+    return Result;
+}
+
+vec2 ComplexMul(vec2 A, vec2 B)
+{
+    vec2 Result = vec2(A.x * B.x - A.y * B.y, A.x * B.y + A.y * B.x);
+    return Result;
+}
+
+vec2 ComplexInverse(vec2 A)
+{
+    vec2 Result = vec2(A.x, -A.y) / dot(A, A);
+    return Result;
+}
+
+float Binomial(uint N, uint K)
+{
+    // NOTE: Every partial product is itself a binomial so this stays exact in floats for our orders
+    float Result = 1.0f;
+    for (uint Id = 1; Id <= K; ++Id)
+    {
+        Result = Result * float(N - K + Id) / float(Id);
+    }
+    return Result;
+}
+
+bool FmmIsLeaf(int TreeNodeId)
+{
+    bool Result = (TreeNodeId & int(1 << 31)) != 0;
+    return Result;
+}
+
+uint FmmLeafId(int TreeNodeId)
+{
+    uint Result = uint(TreeNodeId & (~int(1 << 31)));
+    return Result;
+}
+
+float FmmBoxDiagSq(vec4 Box)
+{
+    vec2 Diag = Box.zw - Box.xy;
+    float Result = dot(Diag, Diag);
+    return Result;
+}
+
+vec4 FmmLoadBox(int TreeNodeId)
+{
+    vec4 Result;
+    if (FmmIsLeaf(TreeNodeId))
+    {
+        vec2 Pos = NodeLoadPos(ElementReMapping[FmmLeafId(TreeNodeId)]);
+        Result = vec4(Pos, Pos);
+    }
+    else
+    {
+        Result = FmmNodeBoxArray[TreeNodeId];
+    }
+
+    return Result;
+}
+
+vec2 FmmBoxCenter(vec4 Box)
+{
+    vec2 Result = 0.5f * (Box.xy + Box.zw);
+    return Result;
+}
+
+bool FmmWellSeparated(vec4 BoxA, vec4 BoxB)
+{
+    // NOTE: Expansions drop the softner, so we also need the gap to be big next to it
+    vec2 Gap = max(max(BoxA.xy - BoxB.zw, BoxB.xy - BoxA.zw), vec2(0));
+    vec2 DiagA = BoxA.zw - BoxA.xy;
+    vec2 DiagB = BoxB.zw - BoxB.xy;
+    float MaxDiagSq = max(dot(DiagA, DiagA), dot(DiagB, DiagB));
+    float GapSq = dot(Gap, Gap);
+    bool Result = FMM_THETA * FMM_THETA * GapSq > MaxDiagSq && GapSq > FMM_SOFTNER_SCALE * GraphGlobals.RepulsionSoftner;
+    return Result;
+}
+
+// NOTE: Loads the multipole of a tree node, a leaf is a single charge of its degree at its position so all of its a_k are 0
+void FmmLoadMultipole(int TreeNodeId, out vec2 Center, out vec2 Multipole[FMM_ORDER + 1])
+{
+    if (FmmIsLeaf(TreeNodeId))
+    {
+        uint GraphNodeId = ElementReMapping[FmmLeafId(TreeNodeId)];
+        Center = NodeLoadPos(GraphNodeId);
+        Multipole[0] = vec2(NodeLoadDegree(GraphNodeId), 0);
+        for (uint TermId = 1; TermId <= FMM_ORDER; ++TermId)
+        {
+            Multipole[TermId] = vec2(0);
+        }
+    }
+    else
+    {
+        Center = FmmBoxCenter(FmmNodeBoxArray[TreeNodeId]);
+        uint Offset = uint(TreeNodeId) * (FMM_ORDER + 1);
+        for (uint TermId = 0; TermId <= FMM_ORDER; ++TermId)
+        {
+            Multipole[TermId] = FmmMultipoleArray[Offset + TermId];
+        }
+    }
+}
+
+//=========================================================================================================================================
+// NOTE: FMM Upward Pass
+//=========================================================================================================================================
+
+#if FMM_UPWARD
+
+// NOTE: M2M, shifts a child multipole to our centre and adds it to ours
+void FmmAddChildMultipole(int ChildId, vec2 Center, inout vec2 Multipole[FMM_ORDER + 1])
+{
+    vec2 ChildCenter;
+    vec2 ChildMultipole[FMM_ORDER + 1];
+    FmmLoadMultipole(ChildId, ChildCenter, ChildMultipole);
+
+    vec2 Z0 = ChildCenter - Center;
+    vec2 Z0Pow[FMM_ORDER + 1];
+    Z0Pow[0] = vec2(1, 0);
+    for (uint PowerId = 1; PowerId <= FMM_ORDER; ++PowerId)
+    {
+        Z0Pow[PowerId] = ComplexMul(Z0Pow[PowerId - 1], Z0);
+    }
+
+    float Charge = ChildMultipole[0].x;
+    Multipole[0].x += Charge;
+    for (uint L = 1; L <= FMM_ORDER; ++L)
+    {
+        vec2 Term = -Charge * Z0Pow[L] / float(L);
+        for (uint K = 1; K <= L; ++K)
+        {
+            Term += Binomial(L - 1, K - 1) * ComplexMul(ChildMultipole[K], Z0Pow[L - K]);
+        }
+        Multipole[L] += Term;
+    }
+}
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint ThreadId = FmmThreadId();
+    if (ThreadId < RadixTreeUniforms.NumNodes)
+    {
+        // NOTE: The active set evaluates graph nodes, so it needs to find their leaf
+        FmmGraphNodeLeafArray[ElementReMapping[ThreadId]] = ThreadId;
+
+        // NOTE: FMM_WALK fills the lists again for this tree
+        FmmExpandHeadArray[ThreadId + RadixTreeUniforms.NumNodes - 1] = FMM_LIST_END;
+        FmmNearHeadArray[ThreadId] = FMM_LIST_END;
+
+        // NOTE: Same walk as RADIX_TREE_SUMMARIZE, the second child to finish builds the parent
+        uint NodeId = ThreadId + RadixTreeUniforms.NumNodes - 1;
+        while (NodeId != 0)
+        {
+            uint ParentId = RadixNodeParents[NodeId];
+            memoryBarrierBuffer();
+            uint AtomicResult = atomicAdd(RadixTreeAtomics[ParentId], 1);
+            if (AtomicResult == 1)
+            {
+                ivec2 Children = RadixNodeChildren[ParentId];
+                vec4 LeftBox = FmmLoadBox(Children.x);
+                vec4 RightBox = FmmLoadBox(Children.y);
+                vec4 Box = vec4(min(LeftBox.xy, RightBox.xy), max(LeftBox.zw, RightBox.zw));
+                vec2 Center = FmmBoxCenter(Box);
+
+                vec2 Multipole[FMM_ORDER + 1];
+                for (uint TermId = 0; TermId <= FMM_ORDER; ++TermId)
+                {
+                    Multipole[TermId] = vec2(0);
+                }
+                FmmAddChildMultipole(Children.x, Center, Multipole);
+                FmmAddChildMultipole(Children.y, Center, Multipole);
+
+                FmmNodeBoxArray[ParentId] = Box;
+                uint Offset = ParentId * (FMM_ORDER + 1);
+                for (uint TermId = 0; TermId <= FMM_ORDER; ++TermId)
+                {
+                    FmmMultipoleArray[Offset + TermId] = Multipole[TermId];
+                }
+
+                NodeId = ParentId;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: FMM Depth Buckets
+//=========================================================================================================================================
+
+#if FMM_DEPTH
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint NodeId = FmmThreadId();
+    if (NodeId < RadixTreeUniforms.NumNodes - 1)
+    {
+        uint Depth = 0;
+        for (uint CurrNodeId = NodeId; CurrNodeId != 0; CurrNodeId = RadixNodeParents[CurrNodeId])
+        {
+            Depth += 1;
+        }
+
+        uint Rank = atomicAdd(FmmLevelCountArray[Depth], 1);
+        FmmNodeLevelArray[NodeId] = uvec2(Depth, Rank);
+        FmmExpandHeadArray[NodeId] = FMM_LIST_END;
+    }
+}
+
+#endif
+
+#if FMM_LEVEL_SCAN
+
+/*
+  NOTE: There are only FMM_MAX_DEPTH levels so 1 thread scans them and writes the indirect dispatch of every FMM_DOWNWARD pass. The
+        CPU reads the stats next frame to only record as many FMM_DOWNWARD passes as the tree has depths.
+ */
+layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint LevelStart = 0;
+    uint MaxDepth = 0;
+    for (uint Depth = 0; Depth < FMM_MAX_DEPTH; ++Depth)
+    {
+        uint LevelCount = FmmLevelCountArray[Depth];
+        FmmLevelStartArray[Depth] = LevelStart;
+        LevelStart += LevelCount;
+        MaxDepth = LevelCount > 0 ? Depth : MaxDepth;
+
+        uint NumGroups = (LevelCount + 31) / 32;
+        if (NumGroups > FMM_MAX_GROUPS_X)
+        {
+            FmmLevelDispatchArray[Depth] = uvec4(64, (NumGroups + 63) / 64, 1, 0);
+        }
+        else
+        {
+            FmmLevelDispatchArray[Depth] = uvec4(NumGroups, 1, 1, 0);
+        }
+    }
+
+    FmmStatsMaxDepth = MaxDepth;
+    FmmStatsNumListEntries = FmmNumListEntries;
+    FmmStatsListOverflow = FmmListOverflow;
+}
+
+#endif
+
+#if FMM_LEVEL_SCATTER
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint NodeId = FmmThreadId();
+    if (NodeId < RadixTreeUniforms.NumNodes - 1)
+    {
+        uvec2 NodeLevel = FmmNodeLevelArray[NodeId];
+        FmmLevelNodeArray[FmmLevelStartArray[NodeLevel.x] + NodeLevel.y] = NodeId;
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: FMM Interaction List Walk
+//=========================================================================================================================================
+
+#if FMM_WALK
+
+/*
+  NOTE: The interaction lists are the pairs of a dual tree walk from (root, root): a well separated pair gets expanded, 2 leaves
+        interact directly, and otherwise we split the bigger box. Every list is a linked list of (source, next entry) from 1 shared
+        pool, so appending is 1 atomic on the pool and 1 on the target's head.
+
+        The walk is a global work queue. Every round expands the pairs of the last round by 1 step and appends the pairs they split
+        into to the other half of FmmWalkPairArray. A pair splits into 2 at most, so round r has at most 2^r pairs and the CPU stops
+        once the next round could overflow a half, then every pair left finishes its own part of the walk depth first.
+
+        If the pool runs out we flag it, and FMM_DOWNWARD and FMM_EVALUATE replay the walk for each target instead.
+ */
+
+layout(push_constant) uniform push_constants
+{
+    uint Round;
+    uint Final;
+} PushConstants;
+
+uint FmmListAllocate()
+{
+    uint Result = atomicAdd(FmmNumListEntries, 1);
+    if (Result >= uint(FmmListEntryArray.length()))
+    {
+        FmmListOverflow = 1;
+        Result = FMM_LIST_END;
+    }
+    return Result;
+}
+
+void FmmListAppendExpand(int TargetId, int SourceId)
+{
+    uint EntryId = FmmListAllocate();
+    if (EntryId != FMM_LIST_END)
+    {
+        uint HeadId = FmmIsLeaf(TargetId) ? FmmLeafId(TargetId) + RadixTreeUniforms.NumNodes - 1 : uint(TargetId);
+        uint NextEntryId = atomicExchange(FmmExpandHeadArray[HeadId], EntryId);
+        FmmListEntryArray[EntryId] = uvec2(uint(SourceId), NextEntryId);
+    }
+}
+
+void FmmListAppendNear(int TargetId, int SourceId)
+{
+    uint EntryId = FmmListAllocate();
+    if (EntryId != FMM_LIST_END)
+    {
+        uint NextEntryId = atomicExchange(FmmNearHeadArray[FmmLeafId(TargetId)], EntryId);
+        FmmListEntryArray[EntryId] = uvec2(uint(SourceId), NextEntryId);
+    }
+}
+
+// NOTE: A pair is (target, source), returns true if it split into ChildPairs
+bool FmmWalkStep(uvec2 Pair, out uvec2 ChildPairs[2])
+{
+    int TargetId = int(Pair.x);
+    int SourceId = int(Pair.y);
+    vec4 TargetBox = FmmLoadBox(TargetId);
+    vec4 SourceBox = FmmLoadBox(SourceId);
+
+    bool Result = false;
+    bool TargetLeaf = FmmIsLeaf(TargetId);
+    bool SourceLeaf = FmmIsLeaf(SourceId);
+    if (FmmWellSeparated(TargetBox, SourceBox))
+    {
+        FmmListAppendExpand(TargetId, SourceId);
+    }
+    else if (TargetLeaf && SourceLeaf)
+    {
+        FmmListAppendNear(TargetId, SourceId);
+    }
+    else if (!TargetLeaf && (SourceLeaf || FmmBoxDiagSq(TargetBox) >= FmmBoxDiagSq(SourceBox)))
+    {
+        ivec2 Children = RadixNodeChildren[TargetId];
+        ChildPairs[0] = uvec2(uint(Children.x), Pair.y);
+        ChildPairs[1] = uvec2(uint(Children.y), Pair.y);
+        Result = true;
+    }
+    else
+    {
+        ivec2 Children = RadixNodeChildren[SourceId];
+        ChildPairs[0] = uvec2(Pair.x, uint(Children.x));
+        ChildPairs[1] = uvec2(Pair.x, uint(Children.y));
+        Result = true;
+    }
+
+    return Result;
+}
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint ThreadId = FmmThreadId();
+    uint Round = PushConstants.Round;
+    uint NumPairs = Round == 0 ? 1 : FmmWalkRoundCounts[Round];
+    if (ThreadId < NumPairs && RadixTreeUniforms.NumNodes > 1)
+    {
+        uint HalfSize = uint(FmmWalkPairArray.length()) / 2;
+        uvec2 Pair = Round == 0 ? uvec2(0, 0) : FmmWalkPairArray[(Round & 1) * HalfSize + ThreadId];
+
+        uvec2 ChildPairs[2];
+        if (PushConstants.Final == 0)
+        {
+            if (FmmWalkStep(Pair, ChildPairs))
+            {
+                uint OutPairId = ((Round + 1) & 1) * HalfSize + atomicAdd(FmmWalkRoundCounts[Round + 1], 2);
+                FmmWalkPairArray[OutPairId + 0] = ChildPairs[0];
+                FmmWalkPairArray[OutPairId + 1] = ChildPairs[1];
+            }
+        }
+        else
+        {
+            // NOTE: Every step goes 1 level down on either side, so the stack grows by at most 1 pair per level of both subtrees
+            uint StackPointer = 0;
+            uvec2 StackPairs[FMM_WALK_STACK_SIZE];
+            StackPairs[StackPointer++] = Pair;
+            while (StackPointer > 0)
+            {
+                StackPointer -= 1;
+                if (FmmWalkStep(StackPairs[StackPointer], ChildPairs))
+                {
+                    StackPairs[StackPointer++] = ChildPairs[1];
+                    StackPairs[StackPointer++] = ChildPairs[0];
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: FMM Interaction Lists
+//=========================================================================================================================================
+
+#if FMM_DOWNWARD || FMM_EVALUATE
+
+/*
+  NOTE: FmmInteract goes over the lists FMM_WALK built for a target. If the list pool overflowed, we fall back to FmmTraverse, which
+        replays the same walk for 1 target but only follows the pairs whose target side is on its path to the root. Pairs where the
+        target side is us go in our lists, pairs that stop at an ancestor are in our parent's local expansion already, and pairs that
+        split us belong to our children. Each replay touches O(depth) pairs, and the stack grows by at most 1 pair per source level so
+        FMM_STACK_SIZE always has room.
+
+        FmmExpand and FmmNear are defined by the kernel that includes this.
+ */
+
+void FmmExpand(int SourceId);
+void FmmNear(int SourceId);
+
+uint FmmPathNodes[FMM_MAX_DEPTH + 1];
+int StackPointer;
+uvec2 StackPairs[FMM_STACK_SIZE];
+
+void FmmTraverse(int TargetId)
+{
+    // NOTE: FmmPathNodes[i] is our ancestor i steps up
+    uint NumAncestors = 0;
+    FmmPathNodes[0] = uint(TargetId);
+    for (int CurrId = TargetId; CurrId != 0;)
+    {
+        CurrId = FmmIsLeaf(CurrId) ? RadixNodeParents[FmmLeafId(CurrId) + RadixTreeUniforms.NumNodes - 1] : RadixNodeParents[CurrId];
+        NumAncestors += 1;
+        FmmPathNodes[NumAncestors] = uint(CurrId);
+    }
+
+    // NOTE: A pair is (steps up from us to the target side, source node)
+    StackPointer = 0;
+    StackPairs[StackPointer++] = uvec2(NumAncestors, 0);
+    while (StackPointer > 0)
+    {
+        StackPointer -= 1;
+        uvec2 Pair = StackPairs[StackPointer];
+        int CurrTargetId = int(FmmPathNodes[Pair.x]);
+        int SourceId = int(Pair.y);
+        vec4 TargetBox = FmmLoadBox(CurrTargetId);
+        vec4 SourceBox = FmmLoadBox(SourceId);
+
+        bool TargetLeaf = FmmIsLeaf(CurrTargetId);
+        bool SourceLeaf = FmmIsLeaf(SourceId);
+        if (FmmWellSeparated(TargetBox, SourceBox))
+        {
+            if (Pair.x == 0)
+            {
+                FmmExpand(SourceId);
+            }
+        }
+        else if (TargetLeaf && SourceLeaf)
+        {
+            // NOTE: Only we can be a leaf on our path
+            FmmNear(SourceId);
+        }
+        else if (!TargetLeaf && (SourceLeaf || FmmBoxDiagSq(TargetBox) >= FmmBoxDiagSq(SourceBox)))
+        {
+            if (Pair.x > 0)
+            {
+                StackPairs[StackPointer++] = uvec2(Pair.x - 1, SourceId);
+            }
+        }
+        else
+        {
+            ivec2 Children = RadixNodeChildren[SourceId];
+            StackPairs[StackPointer++] = uvec2(Pair.x, Children.y);
+            StackPairs[StackPointer++] = uvec2(Pair.x, Children.x);
+        }
+    }
+}
+
+void FmmInteract(int TargetId)
+{
+    if (FmmListOverflow != 0)
+    {
+        FmmTraverse(TargetId);
+    }
+    else if (FmmIsLeaf(TargetId))
+    {
+        uint LeafId = FmmLeafId(TargetId);
+        for (uint EntryId = FmmExpandHeadArray[LeafId + RadixTreeUniforms.NumNodes - 1]; EntryId != FMM_LIST_END;)
+        {
+            uvec2 Entry = FmmListEntryArray[EntryId];
+            FmmExpand(int(Entry.x));
+            EntryId = Entry.y;
+        }
+        for (uint EntryId = FmmNearHeadArray[LeafId]; EntryId != FMM_LIST_END;)
+        {
+            uvec2 Entry = FmmListEntryArray[EntryId];
+            FmmNear(int(Entry.x));
+            EntryId = Entry.y;
+        }
+    }
+    else
+    {
+        for (uint EntryId = FmmExpandHeadArray[TargetId]; EntryId != FMM_LIST_END;)
+        {
+            uvec2 Entry = FmmListEntryArray[EntryId];
+            FmmExpand(int(Entry.x));
+            EntryId = Entry.y;
+        }
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: FMM Downward Pass
+//=========================================================================================================================================
+
+#if FMM_DOWNWARD
+
+layout(push_constant) uniform push_constants
+{
+    uint Depth;
+    uint LastPass;
+} PushConstants;
+
+// NOTE: Local[L - 1] holds b_L
+vec2 Center;
+vec2 Local[FMM_ORDER];
+
+void FmmExpand(int SourceId)
+{
+    // NOTE: M2L, b_l = 1/z0^l * (-Q/l + sum_k (-1)^k * C(l + k - 1, k - 1) * a_k / z0^k)
+    vec2 SourceCenter;
+    vec2 Multipole[FMM_ORDER + 1];
+    FmmLoadMultipole(SourceId, SourceCenter, Multipole);
+
+    vec2 InvZ0 = ComplexInverse(SourceCenter - Center);
+    vec2 InvZ0Pow[FMM_ORDER + 1];
+    InvZ0Pow[0] = vec2(1, 0);
+    for (uint PowerId = 1; PowerId <= FMM_ORDER; ++PowerId)
+    {
+        InvZ0Pow[PowerId] = ComplexMul(InvZ0Pow[PowerId - 1], InvZ0);
+    }
+
+    for (uint L = 1; L <= FMM_ORDER; ++L)
+    {
+        vec2 Sum = vec2(-Multipole[0].x / float(L), 0);
+        for (uint K = 1; K <= FMM_ORDER; ++K)
+        {
+            float Sign = (K & 1) != 0 ? -1.0f : 1.0f;
+            Sum += Sign * Binomial(L + K - 1, K - 1) * ComplexMul(Multipole[K], InvZ0Pow[K]);
+        }
+        Local[L - 1] += ComplexMul(InvZ0Pow[L], Sum);
+    }
+}
+
+void FmmNear(int SourceId)
+{
+    // NOTE: Internal targets never have a near field
+}
+
+// NOTE: Builds and stores the local expansion of 1 node, its parent's has to be in memory already
+void FmmDownwardNode(uint NodeId)
+{
+    Center = FmmBoxCenter(FmmNodeBoxArray[NodeId]);
+    for (uint TermId = 0; TermId < FMM_ORDER; ++TermId)
+    {
+        Local[TermId] = vec2(0);
+    }
+
+    // NOTE: Nothing is well separated from the root so it keeps an empty expansion
+    if (NodeId != 0)
+    {
+        uint ParentId = RadixNodeParents[NodeId];
+
+        // NOTE: L2L, b'_l = sum_{k >= l} b_k * C(k, l) * w^(k - l)
+        {
+            vec2 ParentLocal[FMM_ORDER];
+            for (uint TermId = 0; TermId < FMM_ORDER; ++TermId)
+            {
+                ParentLocal[TermId] = FmmLocalArray[ParentId * FMM_ORDER + TermId];
+            }
+
+            vec2 W = Center - FmmBoxCenter(FmmNodeBoxArray[ParentId]);
+            vec2 WPow[FMM_ORDER];
+            WPow[0] = vec2(1, 0);
+            for (uint PowerId = 1; PowerId < FMM_ORDER; ++PowerId)
+            {
+                WPow[PowerId] = ComplexMul(WPow[PowerId - 1], W);
+            }
+
+            for (uint L = 1; L <= FMM_ORDER; ++L)
+            {
+                for (uint K = L; K <= FMM_ORDER; ++K)
+                {
+                    Local[L - 1] += Binomial(K, L) * ComplexMul(ParentLocal[K - 1], WPow[K - L]);
+                }
+            }
+        }
+
+        FmmInteract(int(NodeId));
+    }
+
+    for (uint TermId = 0; TermId < FMM_ORDER; ++TermId)
+    {
+        FmmLocalArray[NodeId * FMM_ORDER + TermId] = Local[TermId];
+    }
+}
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint ThreadId = FmmThreadId();
+    if (ThreadId < FmmLevelCountArray[PushConstants.Depth])
+    {
+        uint NodeId = FmmLevelNodeArray[FmmLevelStartArray[PushConstants.Depth] + ThreadId];
+        FmmDownwardNode(NodeId);
+
+        /*
+          NOTE: The CPU records passes for the depth of last frame's tree, so if this tree got deeper the last pass finishes the
+                subtrees below it depth first. We wrote every parent before we push its children so the L2L reads what we wrote.
+         */
+        if (PushConstants.LastPass != 0)
+        {
+            uint SubTreePointer = 0;
+            uint SubTreeStack[FMM_STACK_SIZE];
+            SubTreeStack[SubTreePointer++] = NodeId;
+            while (SubTreePointer > 0)
+            {
+                SubTreePointer -= 1;
+                ivec2 Children = RadixNodeChildren[SubTreeStack[SubTreePointer]];
+                if (!FmmIsLeaf(Children.x))
+                {
+                    FmmDownwardNode(uint(Children.x));
+                    SubTreeStack[SubTreePointer++] = uint(Children.x);
+                }
+                if (!FmmIsLeaf(Children.y))
+                {
+                    FmmDownwardNode(uint(Children.y));
+                    SubTreeStack[SubTreePointer++] = uint(Children.y);
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: FMM Evaluate
+//=========================================================================================================================================
+
+#if FMM_EVALUATE
+
+uint GraphNodeId;
+vec2 GraphNodePos;
+float GraphNodeDegree;
+vec2 GraphNodeForce;
+vec2 Field;
+
+void FmmExpand(int SourceId)
+{
+    // NOTE: M2P, the field is Q / (z - c) - sum_k k * a_k / (z - c)^(k + 1)
+    vec2 SourceCenter;
+    vec2 Multipole[FMM_ORDER + 1];
+    FmmLoadMultipole(SourceId, SourceCenter, Multipole);
+
+    vec2 InvZ = ComplexInverse(GraphNodePos - SourceCenter);
+    vec2 InvZPow = InvZ;
+    Field += Multipole[0].x * InvZ;
+    for (uint K = 1; K <= FMM_ORDER; ++K)
+    {
+        InvZPow = ComplexMul(InvZPow, InvZ);
+        Field -= float(K) * ComplexMul(Multipole[K], InvZPow);
+    }
+}
+
+void FmmNear(int SourceId)
+{
+    // NOTE: P2P, exact and softened like the other repulsion kernels
+    uint OtherGraphNodeId = ElementReMapping[FmmLeafId(SourceId)];
+    if (OtherGraphNodeId != GraphNodeId)
+    {
+        vec2 DistanceVec = GraphNodePos - NodeLoadPos(OtherGraphNodeId);
+        float DistanceSq = DistanceVec.x * DistanceVec.x + DistanceVec.y * DistanceVec.y + GraphGlobals.RepulsionSoftner;
+        float RepulsionMultiplier = GraphGlobals.RepulsionMultiplier * GraphNodeDegree * NodeLoadDegree(OtherGraphNodeId);
+        GraphNodeForce += RepulsionMultiplier * DistanceVec / DistanceSq;
+    }
+}
+
+/*
+  NOTE: With GRAPH_ACTIVE_SET we only evaluate the leaves of the nodes in the active list. The upward and downward passes still cover the
+        whole tree since the inactive nodes keep repulsing the active ones. Returns 0xFFFFFFFF for threads past the end.
+ */
+uint FmmThreadLeafId(uint ThreadId)
+{
+#if GRAPH_ACTIVE_SET
+    uint Result = ThreadId < ActiveSet.NumActiveNodes ? FmmGraphNodeLeafArray[ActiveNodeArray[ThreadId]] : 0xFFFFFFFF;
+#else
+    uint Result = ThreadId < RadixTreeUniforms.NumNodes ? ThreadId : 0xFFFFFFFF;
+#endif
+    return Result;
+}
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint LeafId = FmmThreadLeafId(FmmThreadId());
+    if (LeafId != 0xFFFFFFFF && RadixTreeUniforms.NumNodes > 1)
+    {
+        GraphNodeId = ElementReMapping[LeafId];
+        GraphNodePos = NodeLoadPos(GraphNodeId);
+        GraphNodeDegree = NodeLoadDegree(GraphNodeId);
+        GraphNodeForce = NodeForceArray[GraphNodeId];
+
+        // NOTE: L2P of our parent's expansion, the field is sum_l l * b_l * (z - c)^(l - 1)
+        uint ParentId = RadixNodeParents[LeafId + RadixTreeUniforms.NumNodes - 1];
+        Field = vec2(0);
+        {
+            vec2 Z = GraphNodePos - FmmBoxCenter(FmmNodeBoxArray[ParentId]);
+            vec2 ZPow = vec2(1, 0);
+            for (uint L = 1; L <= FMM_ORDER; ++L)
+            {
+                Field += float(L) * ComplexMul(FmmLocalArray[ParentId * FMM_ORDER + L - 1], ZPow);
+                ZPow = ComplexMul(ZPow, Z);
+            }
+        }
+
+        FmmInteract(int(LeafId | (1u << 31)));
+
+        // NOTE: The force is k * d_i * conj(field)
+        GraphNodeForce += GraphGlobals.RepulsionMultiplier * GraphNodeDegree * vec2(Field.x, -Field.y);
+        NodeForceArray[GraphNodeId] = GraphNodeForce;
+    }
+}
+
+#endif
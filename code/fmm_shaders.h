@@ -0,0 +1,106 @@
+
+/*
+  NOTE: FMM_ORDER is the number of terms we keep in the multipole and local expansions. Two boxes are well separated once the gap
+        between them is bigger than the diagonal of the bigger box divided by FMM_THETA, which bounds the expansion error by roughly
+        FMM_THETA^FMM_ORDER. These have to match the defines in huge_graphs_demo.h.
+ */
+#define FMM_ORDER 8
+#define FMM_THETA 0.5f
+
+// NOTE: Expansions ignore the softner, so boxes also need a gap of at least 10x its square root before we expand them
+#define FMM_SOFTNER_SCALE 100.0f
+
+// NOTE: The FMM runs on the radix tree, so it has the same depth bound
+#define FMM_MAX_DEPTH RADIX_TREE_MAX_DEPTH
+#define FMM_STACK_SIZE RADIX_TREE_STACK_SIZE
+#define FMM_MAX_GROUPS_X 65535
+
+/*
+  NOTE: FMM_WALK builds the interaction lists breadth first for FMM_MAX_WALK_ROUNDS rounds at most, then every pair left finishes its
+        own walk depth first. That walk splits either side once per step, so its stack needs room for both depths.
+ */
+#define FMM_MAX_WALK_ROUNDS 32
+#define FMM_WALK_STACK_SIZE (2 * FMM_STACK_SIZE)
+#define FMM_LIST_END 0xFFFFFFFF
+
+#define FMM_DESCRIPTOR_LAYOUT(set_id)                                   \
+                                                                        \
+    layout(set = set_id, binding = 0) coherent buffer fmm_node_box_array \
+    {                                                                   \
+        vec4 FmmNodeBoxArray[];                                         \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 1) coherent buffer fmm_multipole_array \
+    {                                                                   \
+        vec2 FmmMultipoleArray[];                                       \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 2) buffer fmm_local_array            \
+    {                                                                   \
+        vec2 FmmLocalArray[];                                           \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 3) buffer fmm_node_level_array       \
+    {                                                                   \
+        uvec2 FmmNodeLevelArray[];                                      \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 4) buffer fmm_level_count_array      \
+    {                                                                   \
+        uint FmmLevelCountArray[];                                      \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 5) buffer fmm_level_start_array      \
+    {                                                                   \
+        uint FmmLevelStartArray[];                                      \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 6) buffer fmm_level_dispatch_array   \
+    {                                                                   \
+        uvec4 FmmLevelDispatchArray[];                                  \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 7) buffer fmm_level_node_array       \
+    {                                                                   \
+        uint FmmLevelNodeArray[];                                       \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 8) buffer fmm_graph_node_leaf_array  \
+    {                                                                   \
+        uint FmmGraphNodeLeafArray[];                                   \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 9) buffer fmm_expand_head_array      \
+    {                                                                   \
+        uint FmmExpandHeadArray[];                                      \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 10) buffer fmm_near_head_array       \
+    {                                                                   \
+        uint FmmNearHeadArray[];                                        \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 11) buffer fmm_list_entry_array      \
+    {                                                                   \
+        uvec2 FmmListEntryArray[];                                      \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 12) buffer fmm_walk_state            \
+    {                                                                   \
+        uint FmmNumListEntries;                                         \
+        uint FmmListOverflow;                                           \
+        uint FmmWalkRoundCounts[FMM_MAX_WALK_ROUNDS + 1];               \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 13) buffer fmm_walk_pair_array       \
+    {                                                                   \
+        uvec2 FmmWalkPairArray[];                                       \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 14) buffer fmm_stats                 \
+    {                                                                   \
+        uint FmmStatsMaxDepth;                                          \
+        uint FmmStatsNumListEntries;                                    \
+        uint FmmStatsListOverflow;                                      \
+    };                                                                  \
+
@@ -1,249 +1,354 @@
+#version 450
 
-//
-// NOTE: Grid Cell Data
-//
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
 
-struct grid_cell_block
+/*
+  NOTE: Cell list repulsion. Every iteration we rebuild a uniform grid over the bounds of the nodes in linear time:
+
+        - GRID_BOUNDS reduces the node bounds with atomics on order preserving uints.
+        - GRID_CELL_IDS bins every node and counts the nodes per cell, the atomic gives every node its rank inside its cell.
+        - GRID_SCAN turns the counts into cell start offsets.
+        - GRID_SCATTER writes the nodes sorted by cell, so a cell is a contiguous range of GridCellNodeArray.
+        - GRID_SUMMARY and GRID_PYRAMID build the centre of mass of every cell on every level of a pyramid of grids.
+
+        GRID_REPULSION then sums exact repulsion from the 3 x 3 neighbouring cells and approximates everything else with the centres
+        of mass. On every level we only visit the cells that are children of our parent's neighbours but not our own neighbours, so
+        every node gets counted exactly once and a node visits at most 27 cells per level.
+ */
+
+#include "graph_shaders.h"
+#include "graph_grid_shaders.h"
+
+GRID_DESCRIPTOR_LAYOUT(0)
+GRAPH_DESCRIPTOR_LAYOUT(1)
+
+//=========================================================================================================================================
+// NOTE: Grid Helpers
+//=========================================================================================================================================
+
+uint GridThreadId()
 {
-    uint NextBlockOffset;
-    uint NumElements;
-    uint ElementIds[1024];
-};
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint Result = WorkGroupId * gl_WorkGroupSize.x + gl_LocalInvocationIndex;
+    return Result;
+}
 
-struct grid_cell_header
+// NOTE: Flips the bits of a float so that comparing the uints gives the same order as comparing the floats
+uint FloatToOrderedUint(float Value)
 {
-    uint StartGridCellBlock;
-};
+    uint Bits = floatBitsToUint(Value);
+    uint Result = (Bits & 0x80000000) != 0 ? ~Bits : Bits | 0x80000000;
+    return Result;
+}
+
+float OrderedUintToFloat(uint Value)
+{
+    uint Bits = (Value & 0x80000000) != 0 ? Value & 0x7FFFFFFF : ~Value;
+    float Result = uintBitsToFloat(Bits);
+    return Result;
+}
 
-layout(set = 0, binding = 11) buffer grid_cell_block_array
+// NOTE: Returns the min corner of the grid in xy and the dim of a finest level cell in z
+vec3 GridFrame()
 {
-    grid_cell_block GridCellBlocks[];
-};
+    vec2 Min = vec2(OrderedUintToFloat(GridBounds.GridBoundsMin.x), OrderedUintToFloat(GridBounds.GridBoundsMin.y));
+    vec2 Max = vec2(OrderedUintToFloat(GridBounds.GridBoundsMax.x), OrderedUintToFloat(GridBounds.GridBoundsMax.y));
 
-layout(set = 0, binding = 12) buffer grid_cell_header_array
+    // NOTE: Cells are square and we pad the extent a little so that the max node lands inside the last cell
+    float Extent = max(max(Max.x - Min.x, Max.y - Min.y), 1e-3f) * 1.001f;
+    vec3 Result = vec3(Min, Extent / float(GRID_CELLS_AXIS));
+    return Result;
+}
+
+uint GridLevelOffset(uint Level)
 {
-    grid_cell_header GridCellHeaders[];
-};
+    // NOTE: Level l has 4^(GRID_CELLS_AXIS_LOG2 - l) cells, summed up as a geometric series
+    uint Result = 0;
+    for (uint PrevLevel = 0; PrevLevel < Level; ++PrevLevel)
+    {
+        uint LevelAxis = GRID_CELLS_AXIS >> PrevLevel;
+        Result += LevelAxis * LevelAxis;
+    }
+    return Result;
+}
 
-layout(set = 0, binding = 13) buffer grid_cell_block_counter
+#if GRID_REPULSION
+uint GraphThreadNodeId(uint ThreadId)
 {
-    uint GlobalGridCellBlockCounter;
-    // TODO: REMOVE DEBUG DATA
-    uint DebugCellId;
-    uint DebugCellX;
-    uint DebugCellY;
-};
+#if GRAPH_ACTIVE_SET
+    uint Result = 0xFFFFFFFF;
+    if (ThreadId < ActiveSet.NumActiveNodes)
+    {
+        Result = ActiveNodeArray[ThreadId];
+    }
+#else
+    uint Result = ThreadId < GraphGlobals.NumNodes ? ThreadId : 0xFFFFFFFF;
+#endif
+
+    return Result;
+}
+#endif
 
 //=========================================================================================================================================
-// NOTE: Graph Init Grid Shader
+// NOTE: Grid Bounds Shader
 //=========================================================================================================================================
 
-#if GRAPH_INIT_GRID
+#if GRID_BOUNDS
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint NodeId = GridThreadId();
+
+    // NOTE: Inactive lanes don't take part in the subgroup ops, so they can't pollute the bounds
+    if (NodeId < GraphGlobals.NumNodes)
+    {
+        vec2 NodePos = NodeLoadPos(NodeId);
+        uvec2 MinValue = subgroupMin(uvec2(FloatToOrderedUint(NodePos.x), FloatToOrderedUint(NodePos.y)));
+        uvec2 MaxValue = subgroupMax(uvec2(FloatToOrderedUint(NodePos.x), FloatToOrderedUint(NodePos.y)));
+        if (subgroupElect())
+        {
+            atomicMin(GridBounds.GridBoundsMin.x, MinValue.x);
+            atomicMin(GridBounds.GridBoundsMin.y, MinValue.y);
+            atomicMax(GridBounds.GridBoundsMax.x, MaxValue.x);
+            atomicMax(GridBounds.GridBoundsMax.y, MaxValue.y);
+        }
+    }
+}
+
+#endif
 
-shared uint NodeBlockOffset;
-shared uint NodeBlock[2048];
+//=========================================================================================================================================
+// NOTE: Grid Cell Ids Shader
+//=========================================================================================================================================
 
-shared uint PrevGlobalNodeBlockId;
-shared uint CurrGlobalNodeBlockId;
+#if GRID_CELL_IDS
 
-void WriteNodeBlockToMemory(uint LdsOffset)
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
 {
-    // NOTE: Get our block id and link the linked list
-    if (gl_LocalInvocationIndex == 0)
+    uint NodeId = GridThreadId();
+    if (NodeId < GraphGlobals.NumNodes)
     {
-        CurrGlobalNodeBlockId = atomicAdd(GlobalGridCellBlockCounter, 1);
-        GridCellBlocks[CurrGlobalNodeBlockId].NextBlockOffset = PrevGlobalNodeBlockId;
-        GridCellBlocks[CurrGlobalNodeBlockId].NumElements = NodeBlockOffset - LdsOffset;
-        PrevGlobalNodeBlockId = CurrGlobalNodeBlockId;
+        vec3 Frame = GridFrame();
+        ivec2 Cell = clamp(ivec2((NodeLoadPos(NodeId) - Frame.xy) / Frame.z), ivec2(0), ivec2(GRID_CELLS_AXIS - 1));
+        uint CellId = uint(Cell.y) * GRID_CELLS_AXIS + uint(Cell.x);
+
+        NodeCellIdArray[NodeId] = CellId;
+        GridNodeRankArray[NodeId] = atomicAdd(GridCellCountArray[CellId], 1);
     }
+}
 
-    barrier();
+#endif
 
-    GridCellBlocks[CurrGlobalNodeBlockId].ElementIds[gl_LocalInvocationIndex] = NodeBlock[LdsOffset + gl_LocalInvocationIndex];
-}
+//=========================================================================================================================================
+// NOTE: Grid Scan Shader
+//=========================================================================================================================================
 
-layout(local_size_x = 1024, local_size_y = 1, local_size_z = 1) in;
+#if GRID_SCAN
+
+shared uint SharedThreadSums[GRID_SCAN_THREADS];
+
+layout(local_size_x = GRID_SCAN_THREADS, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
-    uint CurrCellId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint FirstCell = gl_LocalInvocationIndex * GRID_SCAN_ITEMS_PER_THREAD;
 
-    vec2 CellMin = GraphGlobals.CellDim * gl_WorkGroupID.xy;
-    vec2 CellMax = GraphGlobals.CellDim * (gl_WorkGroupID.xy + vec2(1));
+    uint ThreadSum = 0;
+    for (uint ItemId = 0; ItemId < GRID_SCAN_ITEMS_PER_THREAD; ++ItemId)
+    {
+        ThreadSum += GridCellCountArray[FirstCell + ItemId];
+    }
+    SharedThreadSums[gl_LocalInvocationIndex] = ThreadSum;
+    barrier();
 
-    // NOTE: Renormalize the cell min/max to be centered in the world
-    CellMin -= vec2(GraphGlobals.WorldRadius);
-    CellMax -= vec2(GraphGlobals.WorldRadius);
-    
-    if (gl_LocalInvocationIndex == 0)
+    // NOTE: Inclusive scan of the thread sums
+    for (uint Stride = 1; Stride < GRID_SCAN_THREADS; Stride *= 2)
     {
-        NodeBlockOffset = 0;
-        PrevGlobalNodeBlockId = 0xFFFFFFFF;
-        CurrGlobalNodeBlockId = 0xFFFFFFFF;
+        uint Value = SharedThreadSums[gl_LocalInvocationIndex];
+        if (gl_LocalInvocationIndex >= Stride)
+        {
+            Value += SharedThreadSums[gl_LocalInvocationIndex - Stride];
+        }
+        barrier();
+        SharedThreadSums[gl_LocalInvocationIndex] = Value;
+        barrier();
     }
 
-    barrier();
-    
-    for (uint NodeId = gl_LocalInvocationIndex; NodeId < GraphGlobals.NumNodes; NodeId += 1024)
+    uint RunningSum = SharedThreadSums[gl_LocalInvocationIndex] - ThreadSum;
+    for (uint ItemId = 0; ItemId < GRID_SCAN_ITEMS_PER_THREAD; ++ItemId)
     {
-        vec2 CurrNodePos = NodePositionArray[NodeId];
+        GridCellStartArray[FirstCell + ItemId] = RunningSum;
+        RunningSum += GridCellCountArray[FirstCell + ItemId];
+    }
 
-        bool NodeBlockLess1024 = NodeBlockOffset < 1024;
-        if (CellMin.x <= CurrNodePos.x && CellMax.x >= CurrNodePos.x &&
-            CellMin.y <= CurrNodePos.y && CellMax.y >= CurrNodePos.y)
-        {
-            // NOTE: Set the node cell id in struct
-            NodeCellIdArray[NodeId] = CurrCellId;
-            
-            uint OffsetId = atomicAdd(NodeBlockOffset, 1);
-            if (OffsetId >= 2048)
-            {
-                OffsetId -= 2048;
-            }
+    if (gl_LocalInvocationIndex == GRID_SCAN_THREADS - 1)
+    {
+        GridCellStartArray[GRID_NUM_CELLS] = RunningSum;
+    }
+}
 
-            NodeBlock[OffsetId] = NodeId;
-        }
+#endif
 
-        barrier();
-        
-        if (NodeBlockLess1024 && NodeBlockOffset >= 1024)
-        {
-            // NOTE: First 1024 elements are full, we can write to memory
-            WriteNodeBlockToMemory(0);
-        }
-        else if (!NodeBlockLess1024 && NodeBlockOffset >= 2048)
-        {
-            // NOTE: Second 1024 elements are full, we can write to memory
-            WriteNodeBlockToMemory(1024);
-        }
+//=========================================================================================================================================
+// NOTE: Grid Scatter Shader
+//=========================================================================================================================================
 
-        if (gl_LocalInvocationIndex == 0 && NodeBlockOffset >= 2048)
-        {
-            // NOTE: Wrap the LDS index
-            NodeBlockOffset -= 2048;
-        }
+#if GRID_SCATTER
 
-        barrier();
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint NodeId = GridThreadId();
+    if (NodeId < GraphGlobals.NumNodes)
+    {
+        uint CellId = NodeCellIdArray[NodeId];
+        uint SortedId = GridCellStartArray[CellId] + GridNodeRankArray[NodeId];
+        GridCellNodeArray[SortedId] = vec4(NodeLoadPos(NodeId), NodeLoadDegree(NodeId), uintBitsToFloat(NodeId));
     }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Grid Summary Shader
+//=========================================================================================================================================
+
+#if GRID_SUMMARY
 
-    if (NodeBlockOffset != 0 && NodeBlockOffset != 1024)
+// NOTE: Builds the centre of mass (xy) and mass (z) of every finest level cell
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint CellId = GridThreadId();
+    if (CellId < GRID_NUM_CELLS)
     {
-        // NOTE: We have some remaining nodes to write
-        if (NodeBlockOffset < 1024)
+        vec3 Summary = vec3(0);
+        uint CellEnd = GridCellStartArray[CellId + 1];
+        for (uint SortedId = GridCellStartArray[CellId]; SortedId < CellEnd; ++SortedId)
         {
-            WriteNodeBlockToMemory(0);
+            vec4 Node = GridCellNodeArray[SortedId];
+            Summary += vec3(Node.z * Node.xy, Node.z);
         }
-        else if (NodeBlockOffset >= 1024)
-        {
-            WriteNodeBlockToMemory(1024);
-        }
-    }
-    
-    // NOTE: Write out the grid cell header
-    if (gl_LocalInvocationIndex == 0)
-    {
-        GridCellHeaders[CurrCellId].StartGridCellBlock = PrevGlobalNodeBlockId;
+
+        GridCellSummaryArray[CellId] = Summary.z > 0.0f ? vec4(Summary.xy / Summary.z, Summary.z, 0) : vec4(0);
     }
 }
 
 #endif
 
-#if 0
+//=========================================================================================================================================
+// NOTE: Grid Pyramid Shader
+//=========================================================================================================================================
+
+#if GRID_PYRAMID
+
+layout(push_constant) uniform push_constants
+{
+    uint Level;
+} PushConstants;
+
+// NOTE: Merges the 4 children of every cell of PushConstants.Level
 layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
-    uint CurrNodeId = gl_GlobalInvocationID.x;
-    if (CurrNodeId < GraphGlobals.NumNodes)
-    {    
-        // NOTE: Every thread processes one graph node, so we may have different cells iterated in one thread group
-        // TODO: Try rearranging in memory like for my CPU code
-        graph_node_pos CurrNodePos = NodePositionArray[CurrNodeId];
-        int CurrCellId = int(CurrNodePos.GridCellId);
-        int CellY = CurrCellId / int(GraphGlobals.NumCellsDim);
-        int CellX = CurrCellId - CellY * int(GraphGlobals.NumCellsDim);
-
-        if (CurrNodeId == 0)
+    uint LevelAxis = GRID_CELLS_AXIS >> PushConstants.Level;
+    uint CellId = GridThreadId();
+    if (CellId < LevelAxis * LevelAxis)
+    {
+        uvec2 Cell = uvec2(CellId % LevelAxis, CellId / LevelAxis);
+        uint ChildAxis = 2 * LevelAxis;
+        uint ChildOffset = GridLevelOffset(PushConstants.Level - 1);
+
+        vec3 Summary = vec3(0);
+        for (uint ChildId = 0; ChildId < 4; ++ChildId)
         {
-            DebugCellX = CellX;
-            DebugCellY = CellY;
-            DebugCellId = CurrCellId;
+            uvec2 Child = 2 * Cell + uvec2(ChildId & 1, ChildId >> 1);
+            vec4 ChildSummary = GridCellSummaryArray[ChildOffset + Child.y * ChildAxis + Child.x];
+            Summary += vec3(ChildSummary.z * ChildSummary.xy, ChildSummary.z);
         }
-        
-        // NOTE: Calculate how many cells we need to iterate over
-        float CheckRadius = max(max(GraphGlobals.LayoutAvoidSameRadius, GraphGlobals.LayoutAvoidDiffRadius), GraphGlobals.LayoutPullSameRadius);
-        /// TODO: I Think theres a mistake here
-        int CheckCellRadius = int(ceil((CheckRadius + GraphGlobals.CellDim) / GraphGlobals.CellDim));
-        if (CheckRadius == 0)
+
+        uint CellOffset = GridLevelOffset(PushConstants.Level);
+        GridCellSummaryArray[CellOffset + CellId] = Summary.z > 0.0f ? vec4(Summary.xy / Summary.z, Summary.z, 0) : vec4(0);
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Grid Repulsion Shader
+//=========================================================================================================================================
+
+#if GRID_REPULSION
+
+vec2 GridRepulsion(vec2 CurrNodePos, float CurrNodeDegree, vec2 OtherPos, float OtherMass)
+{
+    vec2 DistanceVec = CurrNodePos - OtherPos;
+    float DistanceSq = DistanceVec.x * DistanceVec.x + DistanceVec.y * DistanceVec.y + GraphGlobals.RepulsionSoftner;
+    vec2 Result = GraphGlobals.RepulsionMultiplier * CurrNodeDegree * OtherMass * DistanceVec / DistanceSq;
+    return Result;
+}
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint CurrNodeId = GraphThreadNodeId(GridThreadId());
+    if (CurrNodeId != 0xFFFFFFFF)
+    {
+        float CurrNodeDegree = NodeLoadDegree(CurrNodeId);
+        vec2 CurrNodePos = NodeLoadPos(CurrNodeId);
+        vec2 CurrNodeForce = NodeForceArray[CurrNodeId];
+
+        uint CurrCellId = NodeCellIdArray[CurrNodeId];
+        ivec2 CurrCell = ivec2(CurrCellId % GRID_CELLS_AXIS, CurrCellId / GRID_CELLS_AXIS);
+
+        // NOTE: Exact repulsion from the nodes in our cell and the cells around it
+        for (int Y = max(CurrCell.y - 1, 0); Y <= min(CurrCell.y + 1, GRID_CELLS_AXIS - 1); ++Y)
         {
-            CheckCellRadius = 0;
+            for (int X = max(CurrCell.x - 1, 0); X <= min(CurrCell.x + 1, GRID_CELLS_AXIS - 1); ++X)
+            {
+                uint CellId = uint(Y) * GRID_CELLS_AXIS + uint(X);
+                uint CellEnd = GridCellStartArray[CellId + 1];
+                for (uint SortedId = GridCellStartArray[CellId]; SortedId < CellEnd; ++SortedId)
+                {
+                    vec4 OtherNode = GridCellNodeArray[SortedId];
+                    if (floatBitsToUint(OtherNode.w) != CurrNodeId)
+                    {
+                        CurrNodeForce += GridRepulsion(CurrNodePos, CurrNodeDegree, OtherNode.xy, OtherNode.z);
+                    }
+                }
+            }
         }
-     
-        // NOTE: Loop through neighboring cells to find nearby elements
-        for (int Y = CellY - CheckCellRadius;
-             Y <= (CellY + CheckCellRadius) && Y >= 0 && Y < GraphGlobals.NumCellsDim;
-             ++Y)
+
+        // NOTE: Far field from the cells that are children of our parent's neighbours, but not our neighbours
+        for (uint Level = 0; Level < GRID_NUM_LEVELS - 1; ++Level)
         {
-            for (int X = CellX - CheckCellRadius;
-                 X <= (CellX + CheckCellRadius) && X >= 0 && X < GraphGlobals.NumCellsDim;
-                 ++X)
-            {
-                int OtherCellId = Y * int(GraphGlobals.NumCellsDim) + X;
-                grid_cell_header OtherCellHeader = GridCellHeaders[OtherCellId];
+            int LevelAxis = GRID_CELLS_AXIS >> Level;
+            uint LevelOffset = GridLevelOffset(Level);
+            ivec2 LevelCell = CurrCell >> Level;
+            ivec2 ParentCell = LevelCell >> 1;
 
-                // NOTE: Loop through all the blocks of elements in this cell
-                uint OtherBlockId = OtherCellHeader.StartGridCellBlock;
-                while (OtherBlockId != 0xFFFFFFFF)
+            for (int Y = max(2 * (ParentCell.y - 1), 0); Y <= min(2 * (ParentCell.y + 1) + 1, LevelAxis - 1); ++Y)
+            {
+                for (int X = max(2 * (ParentCell.x - 1), 0); X <= min(2 * (ParentCell.x + 1) + 1, LevelAxis - 1); ++X)
                 {
-                    // TODO: Does it make sense to store some of this stuff to LDS to load after? I guess it would fit in L0 cache
-                    // NOTE: Update the block header pointer
-                    uint OtherNumElements = GridCellBlocks[OtherBlockId].NumElements;
-
-                    // NOTE: Get the elements in the block
-                    for (int ElementId = 0; ElementId < OtherNumElements; ++ElementId)
+                    if (abs(X - LevelCell.x) > 1 || abs(Y - LevelCell.y) > 1)
                     {
-                        uint OtherNodeId = GridCellBlocks[OtherBlockId].ElementIds[ElementId];
-
-                        if (CurrNodeId != OtherNodeId)
+                        vec4 Summary = GridCellSummaryArray[LevelOffset + uint(Y * LevelAxis + X)];
+                        if (Summary.z > 0.0f)
                         {
-                            graph_node_pos OtherNodePos = NodePositionArray[OtherNodeId];
-                            
-                            bool SameFamily = CurrNodePos.FamilyId == OtherNodePos.FamilyId;
-                            float AvoidRadius = SameFamily ? GraphGlobals.LayoutAvoidSameRadius : GraphGlobals.LayoutAvoidDiffRadius;
-                            float AvoidVel = SameFamily ? GraphGlobals.LayoutAvoidSameAccel : GraphGlobals.LayoutAvoidDiffAccel;
-
-                            vec2 DistanceVec = CurrNodePos.Pos - OtherNodePos.Pos;
-                            float Distance = length(DistanceVec);
-                            if (Distance < AvoidRadius)
-                            {
-                                float T = Distance / AvoidRadius;
-                                float AvoidVelMag = mix(AvoidVel, 0, T);
-
-                                vec2 Dir = vec2(0);
-                                if (Distance == 0)
-                                {
-                                    vec2 Input1 = fract(CurrNodePos.Pos + 0.9123953f * vec2(CurrNodeId));
-                                    vec2 Input2 = fract(CurrNodePos.Pos + 0.9123953f * vec2(OtherNodeId));
-                                    Dir = normalize(2.0f * vec2(RandomFloat(Input1), RandomFloat(Input2)) - vec2(1));
-                                }
-                                else
-                                {
-                                    Dir = DistanceVec / Distance;
-                                }
-
-                                NodeVelocityArray[CurrNodeId] += AvoidVelMag * Dir;
-                            }
-                            else if (SameFamily && Distance < GraphGlobals.LayoutPullSameRadius)
-                            {
-                                vec2 NormalVec = DistanceVec / Distance;
-                                vec2 Vel = GraphGlobals.LayoutPullSameAccel * NormalVec;
-                                NodeVelocityArray[CurrNodeId] -= Vel;
-                            }
+                            CurrNodeForce += GridRepulsion(CurrNodePos, CurrNodeDegree, Summary.xy, Summary.z);
                         }
                     }
-                            
-                    OtherBlockId = GridCellBlocks[OtherBlockId].NextBlockOffset;
                 }
             }
         }
+
+        NodeForceArray[CurrNodeId] = CurrNodeForce;
     }
 }
+
 #endif
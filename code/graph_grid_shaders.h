@@ -0,0 +1,46 @@
+
+/*
+  NOTE: The finest grid level has GRID_CELLS_AXIS x GRID_CELLS_AXIS cells, every coarser level halves the axis down to 2 x 2 cells.
+        These have to match the defines in huge_graphs_demo.h.
+ */
+#define GRID_CELLS_AXIS_LOG2 8
+#define GRID_CELLS_AXIS (1 << GRID_CELLS_AXIS_LOG2)
+#define GRID_NUM_CELLS (GRID_CELLS_AXIS * GRID_CELLS_AXIS)
+#define GRID_NUM_LEVELS GRID_CELLS_AXIS_LOG2
+
+// NOTE: The cell scan runs in 1 work group, every thread scans this many cells in registers
+#define GRID_SCAN_THREADS 1024
+#define GRID_SCAN_ITEMS_PER_THREAD (GRID_NUM_CELLS / GRID_SCAN_THREADS)
+
+#define GRID_DESCRIPTOR_LAYOUT(set_id)                                  \
+                                                                        \
+    layout(set = set_id, binding = 0) buffer grid_bounds_buffer         \
+    {                                                                   \
+        uvec2 GridBoundsMin;                                            \
+        uvec2 GridBoundsMax;                                            \
+    } GridBounds;                                                       \
+                                                                        \
+    layout(set = set_id, binding = 1) buffer grid_cell_count_array      \
+    {                                                                   \
+        uint GridCellCountArray[];                                      \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 2) buffer grid_cell_start_array      \
+    {                                                                   \
+        uint GridCellStartArray[];                                      \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 3) buffer grid_node_rank_array       \
+    {                                                                   \
+        uint GridNodeRankArray[];                                       \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 4) buffer grid_cell_node_array       \
+    {                                                                   \
+        vec4 GridCellNodeArray[];                                       \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 5) buffer grid_cell_summary_array    \
+    {                                                                   \
+        vec4 GridCellSummaryArray[];                                    \
+    };                                                                  \
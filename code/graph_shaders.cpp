@@ -2,12 +2,219 @@
 
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_GOOGLE_include_directive : enable
+#extension GL_KHR_shader_subgroup_basic : enable
 #extension GL_KHR_shader_subgroup_arithmetic : enable
 
 #include "graph_shaders.h"
 
 GRAPH_DESCRIPTOR_LAYOUT(0)
 
+//=========================================================================================================================================
+// NOTE: Out Of Core Shard Helpers
+//=========================================================================================================================================
+
+/*
+  NOTE: Kernels compiled with GRAPH_SHARD run over 1 shard of level 0, a run of nodes whose edges the CPU copied into the window
+        buffers of SHARD_DESCRIPTOR_LAYOUT. Edge ids stay global, so edge FirstEdge + i of the graph sits at i in the window. The
+        attraction numbers its work groups and carry slots from the start of the window.
+ */
+
+#if GRAPH_SHARD
+
+SHARD_DESCRIPTOR_LAYOUT(1)
+
+layout(push_constant) uniform push_constants
+{
+    uint FirstNode;
+    uint NumNodes;
+    uint FirstEdge;
+    uint NumEdges;
+} PushConstants;
+
+#define AttractionFirstEdge PushConstants.FirstEdge
+#define AttractionEndEdge (PushConstants.FirstEdge + PushConstants.NumEdges)
+#define AttractionLoadSource(EdgeId) ShardEdgeSourceArray[(EdgeId) - PushConstants.FirstEdge]
+#define AttractionLoadEdge(EdgeId) ShardEdgeArray[(EdgeId) - PushConstants.FirstEdge]
+// NOTE: A coefficient cache would be as big as the edges we don't keep resident, so we pay for the pow here
+#define AttractionLoadCoefficient(EdgeId) (pow(AttractionLoadEdge(EdgeId).Weight, GraphGlobals.AttractionWeightPower) * GraphGlobals.AttractionMultiplier)
+#define AttractionCarryArray ShardCarryArray
+
+#else
+
+#define AttractionFirstEdge 0
+#define AttractionEndEdge GraphGlobals.NumEdges
+#define AttractionLoadSource(EdgeId) EdgeSourceArray[EdgeId]
+#define AttractionLoadEdge(EdgeId) EdgeArray[EdgeId]
+#define AttractionLoadCoefficient(EdgeId) EdgeCoefficientArray[EdgeId]
+
+#endif
+
+#define AttractionGroup(EdgeId) (((EdgeId) - AttractionFirstEdge) / ATTRACTION_EDGES_PER_GROUP)
+
+//=========================================================================================================================================
+// NOTE: Active Set Helpers
+//=========================================================================================================================================
+
+/*
+  NOTE: Kernels compiled with GRAPH_ACTIVE_SET run through vkCmdDispatchIndirect over the list that GRAPH_ACTIVE_COMPACT built, so
+        thread i works on the i'th active node instead of node i. Returns 0xFFFFFFFF for threads past the end of the list.
+ */
+
+uint GraphThreadNodeId(uint ThreadId)
+{
+#if GRAPH_ACTIVE_SET
+    uint Result = 0xFFFFFFFF;
+    if (ThreadId < ActiveSet.NumActiveNodes)
+    {
+        Result = ActiveNodeArray[ThreadId];
+    }
+#elif GRAPH_SHARD
+    uint Result = ThreadId < PushConstants.NumNodes ? PushConstants.FirstNode + ThreadId : 0xFFFFFFFF;
+#else
+    uint Result = ThreadId < GraphGlobals.NumNodes ? ThreadId : 0xFFFFFFFF;
+#endif
+    
+    return Result;
+}
+
+//=========================================================================================================================================
+// NOTE: Graph Attraction Edges Shader
+//=========================================================================================================================================
+
+#if GRAPH_ATTRACTION_EDGES
+
+/*
+  NOTE: Attraction is computed edge parallel so that high degree nodes (hashtags with 10k+ edges) don't stall their whole subgroup.
+        Each thread processes ATTRACTION_ITEMS_PER_THREAD consecutive edges and each work group ATTRACTION_EDGES_PER_GROUP edges.
+        Edges of a node are contiguous in EdgeArray so summing the forces per node is a segmented reduction:
+
+        - Runs that start and end inside a thread are summed in registers.
+        - Runs that cross threads are summed by the thread that holds the start of the run (the head) through shared memory.
+        - Runs that cross work groups write a partial sum into AttractionCarryArray. Slot 0 of a group holds the run that started in an
+          earlier group, slot 1 holds the run that continues into a later group. GRAPH_MOVE_CONNECTIONS adds those up afterwards.
+
+        Nodes whose edges all live in 1 work group get their attraction written straight into NodeForceArray. We never need float
+        atomics since every node has exactly 1 writer. Slots that GraphAppend left without an owner have a source of 0xFFFFFFFF and
+        get skipped, they only ever sit between the ranges of 2 nodes.
+ */
+
+shared uint SharedFirstNode[32];
+shared vec2 SharedFirstForce[32];
+shared uint SharedLastNode[32];
+shared vec2 SharedLastForce[32];
+
+void AttractionWrite(uint WorkGroupId, uint NodeId, vec2 Force)
+{
+    graph_node_edges Edges = NodeEdgeArray[NodeId];
+    uint StartGroup = AttractionGroup(Edges.StartConnections);
+    uint EndGroup = AttractionGroup(Edges.EndConnections - 1);
+
+    if (StartGroup == EndGroup)
+    {
+        NodeForceArray[NodeId] = Force;
+    }
+    else if (StartGroup == WorkGroupId)
+    {
+        AttractionCarryArray[2*WorkGroupId + 1] = Force;
+    }
+    else
+    {
+        AttractionCarryArray[2*WorkGroupId + 0] = Force;
+    }
+}
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint ThreadId = gl_LocalInvocationIndex;
+    uint EdgeStart = AttractionFirstEdge + WorkGroupId * ATTRACTION_EDGES_PER_GROUP + ThreadId * ATTRACTION_ITEMS_PER_THREAD;
+    uint EdgeEnd = min(EdgeStart + ATTRACTION_ITEMS_PER_THREAD, AttractionEndEdge);
+
+    // NOTE: Sum up the runs in our edge range. Only the first and last run can be shared with other threads
+    uint FirstNode = 0xFFFFFFFF;
+    vec2 FirstForce = vec2(0);
+    uint CurrNode = 0xFFFFFFFF;
+    vec2 CurrForce = vec2(0);
+    vec2 CurrNodePos = vec2(0);
+    for (uint EdgeId = EdgeStart; EdgeId < EdgeEnd; ++EdgeId)
+    {
+        uint SourceNodeId = AttractionLoadSource(EdgeId);
+        if (SourceNodeId == 0xFFFFFFFF)
+        {
+            continue;
+        }
+        
+        if (SourceNodeId != CurrNode)
+        {
+            if (CurrNode != 0xFFFFFFFF)
+            {
+                if (FirstNode == 0xFFFFFFFF)
+                {
+                    FirstNode = CurrNode;
+                    FirstForce = CurrForce;
+                }
+                else
+                {
+                    // NOTE: This run starts and ends inside our thread so we own the whole node
+                    AttractionWrite(WorkGroupId, CurrNode, CurrForce);
+                }
+            }
+
+            CurrNode = SourceNodeId;
+            CurrForce = vec2(0);
+            CurrNodePos = NodeLoadPos(SourceNodeId);
+        }
+
+        uint OtherNodeId = AttractionLoadEdge(EdgeId).OtherNodeId;
+        vec2 OtherNodePos = NodeLoadPos(OtherNodeId);
+        CurrForce += AttractionLoadCoefficient(EdgeId) * (OtherNodePos - CurrNodePos);
+    }
+
+    // NOTE: FirstNode only gets set once a second run starts, so threads that saw 1 run copy it over here
+    if (FirstNode == 0xFFFFFFFF)
+    {
+        FirstNode = CurrNode;
+        FirstForce = CurrForce;
+    }
+
+    SharedFirstNode[ThreadId] = FirstNode;
+    SharedFirstForce[ThreadId] = FirstForce;
+    SharedLastNode[ThreadId] = CurrNode;
+    SharedLastForce[ThreadId] = CurrForce;
+    barrier();
+
+    if (CurrNode != 0xFFFFFFFF)
+    {
+        bool SingleRun = FirstNode == CurrNode;
+        bool FirstIsHead = ThreadId == 0 || SharedLastNode[ThreadId - 1] != FirstNode;
+
+        // NOTE: Our first run ends inside our thread, write it out if we also started it
+        if (!SingleRun && FirstIsHead)
+        {
+            AttractionWrite(WorkGroupId, FirstNode, FirstForce);
+        }
+
+        // NOTE: Our last run might continue into the next threads so we add up their first runs
+        if (!SingleRun || FirstIsHead)
+        {
+            vec2 TotalForce = CurrForce;
+            for (uint OtherThreadId = ThreadId + 1; OtherThreadId < 32 && SharedFirstNode[OtherThreadId] == CurrNode; ++OtherThreadId)
+            {
+                TotalForce += SharedFirstForce[OtherThreadId];
+                if (SharedLastNode[OtherThreadId] != CurrNode)
+                {
+                    break;
+                }
+            }
+
+            AttractionWrite(WorkGroupId, CurrNode, TotalForce);
+        }
+    }
+}
+
+#endif
+
 //=========================================================================================================================================
 // NOTE: Graph Move Connections Shader
 //=========================================================================================================================================
@@ -18,26 +225,46 @@ layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
     uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
-    uint CurrNodeId = WorkGroupId * 32 + gl_LocalInvocationIndex;
-    if (CurrNodeId < GraphGlobals.NumNodes)
+    uint CurrNodeId = GraphThreadNodeId(WorkGroupId * 32 + gl_LocalInvocationIndex);
+    if (CurrNodeId != 0xFFFFFFFF)
     {
-        vec2 CurrNodePos = NodePositionArray[CurrNodeId];
+        vec2 CurrNodePos = NodeLoadPos(CurrNodeId);
         vec2 CurrNodeForce = vec2(0);
-        
+
         graph_node_edges Edges = NodeEdgeArray[CurrNodeId];
+#if GRAPH_ACTIVE_SET
+        // NOTE: GRAPH_ATTRACTION_EDGES runs over every edge, so with only a few active nodes we are better off gathering our own edges
         for (uint EdgeId = Edges.StartConnections; EdgeId < Edges.EndConnections; ++EdgeId)
         {
-            uint OtherNodeId = EdgeArray[EdgeId].OtherNodeId;
-            float EdgeWeight = EdgeArray[EdgeId].Weight;
-            vec2 OtherNodePos = NodePositionArray[OtherNodeId];
-            CurrNodeForce += pow(EdgeWeight, GraphGlobals.AttractionWeightPower) * GraphGlobals.AttractionMultiplier * (OtherNodePos - CurrNodePos);
+            vec2 OtherNodePos = NodeLoadPos(EdgeArray[EdgeId].OtherNodeId);
+            CurrNodeForce += EdgeCoefficientArray[EdgeId] * (OtherNodePos - CurrNodePos);
+        }
+#else
+        // NOTE: Gather the attraction that GRAPH_ATTRACTION_EDGES calculated for us
+        if (Edges.StartConnections < Edges.EndConnections)
+        {
+            uint StartGroup = AttractionGroup(Edges.StartConnections);
+            uint EndGroup = AttractionGroup(Edges.EndConnections - 1);
+            if (StartGroup == EndGroup)
+            {
+                CurrNodeForce = NodeForceArray[CurrNodeId];
+            }
+            else
+            {
+                // NOTE: We only loop over work groups here, not edges, so even the biggest hashtag is cheap
+                CurrNodeForce = AttractionCarryArray[2*StartGroup + 1];
+                for (uint GroupId = StartGroup + 1; GroupId <= EndGroup; ++GroupId)
+                {
+                    CurrNodeForce += AttractionCarryArray[2*GroupId + 0];
+                }
+            }
         }
+#endif
 
         // NOTE: Apply gravity towards center (0, 0)
         {
-            float CurrNodeDegree = NodeDegreeArray[CurrNodeId];
             float DistToCenter = length(CurrNodePos);
-            float GravityFactor = CurrNodeDegree * GraphGlobals.GravityMultiplier;
+            float GravityFactor = NodeGravityArray[CurrNodeId];
             if (CurrNodePos.x == 0 && CurrNodePos.y == 0)
             {
                 GravityFactor = 0.0f;
@@ -77,19 +304,19 @@ layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
     uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
-    uint CurrNodeId = WorkGroupId * 32 + gl_LocalInvocationIndex;
-    if (CurrNodeId < GraphGlobals.NumNodes)
+    uint CurrNodeId = GraphThreadNodeId(WorkGroupId * 32 + gl_LocalInvocationIndex);
+    if (CurrNodeId != 0xFFFFFFFF)
     {
-        float CurrNodeDegree = NodeDegreeArray[CurrNodeId];
-        vec2 CurrNodePos = NodePositionArray[CurrNodeId];
+        float CurrNodeDegree = NodeLoadDegree(CurrNodeId);
+        vec2 CurrNodePos = NodeLoadPos(CurrNodeId);
         vec2 CurrNodeForce = NodeForceArray[CurrNodeId];
      
         for (uint OtherNodeId = 0; OtherNodeId < GraphGlobals.NumNodes; ++OtherNodeId)
         {
             if (CurrNodeId != OtherNodeId)
             {
-                vec2 OtherNodePos = NodePositionArray[OtherNodeId];
-                float OtherNodeDegree = NodeDegreeArray[OtherNodeId];
+                vec2 OtherNodePos = NodeLoadPos(OtherNodeId);
+                float OtherNodeDegree = NodeLoadDegree(OtherNodeId);
 
                 vec2 DistanceVec = CurrNodePos - OtherNodePos;
                 float DistanceSq = DistanceVec.x * DistanceVec.x + DistanceVec.y * DistanceVec.y + GraphGlobals.RepulsionSoftner;
@@ -119,278 +346,648 @@ void main()
 // NOTE: Graph Calculate Global Speed Shader
 //=========================================================================================================================================
 
-#if GRAPH_CALC_GLOBAL_SPEED
+#if GRAPH_CALC_GLOBAL_SPEED || GRAPH_FUSED_LAYOUT
+
+/*
+  NOTE: References:
+    - https://github.com/govertb/GPUGraphLayout/blob/master/src/RPFA2Kernels.cu
+    - https://github.com/bhargavchippada/forceatlas2/blob/master/fa2/fa2util.py
+    - https://journals.plos.org/plosone/article?id=10.1371/journal.pone.0098679
+
+  NOTE: Each work group reduces REDUCTION_NODES_PER_GROUP nodes and writes out 1 partial sum, then bumps a done counter once. The
+        group that bumps the counter last sums up all the partials and calculates the global speed. No group ever waits on another
+        group so we don't depend on forward progress guarantees that Vulkan doesn't give us. The last group also resets the counter
+        so we don't have to clear anything between frames.
+ */
+
+#define NUM_THREADS 32
 
-#if 1
-shared uint WorkCounterId;
-shared uint PassId;
-shared uint DoneCounterToWaitOn;
-shared uint NumGroupsInPrevPass;
-shared uint NumGroupsInPrevPrevPass;
-shared uint NumThreadsInGroup;
+shared global_move_reduction SharedReduction[NUM_THREADS];
+shared bool IsLastGroup;
 
-// TODO: Port math lib to shader code as well?
-uint CeilU32(float Val)
+global_move_reduction WorkGroupReduce(global_move_reduction Value)
 {
-    uint Result = uint(ceil(Val));
+    // NOTE: Subgroups can be smaller than the work group (lavapipe, intel) so we combine the subgroup sums through shared memory
+    Value.Swing = subgroupAdd(Value.Swing);
+    Value.Traction = subgroupAdd(Value.Traction);
+    Value.Displacement = subgroupAdd(Value.Displacement);
+    if (subgroupElect())
+    {
+        SharedReduction[gl_SubgroupID] = Value;
+    }
+    barrier();
+
+    global_move_reduction Result = SharedReduction[0];
+    for (uint SubgroupId = 1; SubgroupId < gl_NumSubgroups; ++SubgroupId)
+    {
+        Result.Swing += SharedReduction[SubgroupId].Swing;
+        Result.Traction += SharedReduction[SubgroupId].Traction;
+        Result.Displacement += SharedReduction[SubgroupId].Displacement;
+    }
+    barrier();
+
     return Result;
 }
 
-#define NUM_THREADS 32
-layout(local_size_x = NUM_THREADS, local_size_y = 1, local_size_z = 1) in;
-void main()
+void GlobalMoveUpdateSpeed(global_move_reduction MoveReduction)
 {
-/*
+    // NOTE: Remove bad behavior at 0
+    MoveReduction.Swing += 0.001f;
+    MoveReduction.Traction += 0.001f;
 
-  NOTE: First n threads will load 1 value, and do parallel add using wave ops to get 32 wide swing/traction sum.
-        They then write it to buffer and exit.
-        Next n/32 threads will scoop those values, do the same reduction and exit. We continue until 1 thread writes out the final
-        values.
-  
- */
+    // NOTE: Calculate jitter tolerance
+    float EstimatedOptimalJitterTolerance = 0.05f * sqrt(GraphGlobals.NumNodes);
+    float MinJitterTolerance = sqrt(EstimatedOptimalJitterTolerance);
+    float JitterTolerance = max(MinJitterTolerance,
+                                min(GlobalMove.MaxJitterTolerance, EstimatedOptimalJitterTolerance * MoveReduction.Traction / float(GraphGlobals.NumNodes * GraphGlobals.NumNodes)));
+    JitterTolerance *= GlobalMove.JitterToleranceConstant;
 
-    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
-    if (WorkGroupId >= GraphGlobals.NumThreadGroupsGlobalSpeed)
+    // NOTE: Protect against erratic behavior
+    float MinSpeedEfficiency = 0.05f;
+    if (MoveReduction.Swing / MoveReduction.Traction > 2.0f)
     {
-        return;
+        if (GlobalMove.SpeedEfficiency > MinSpeedEfficiency)
+        {
+            GlobalMove.SpeedEfficiency *= 0.5f;
+        }
+        JitterTolerance = max(JitterTolerance, GlobalMove.JitterToleranceConstant);
     }
-    
-    if (gl_LocalInvocationID.x == 0)
+
+    float TargetSpeed = JitterTolerance * GlobalMove.SpeedEfficiency * MoveReduction.Traction / MoveReduction.Swing;
+
+    if (MoveReduction.Swing > JitterTolerance * MoveReduction.Traction)
     {
-        // TODO: I think a lot of this garbage can be simplified
-        WorkCounterId = atomicAdd(GlobalMoveWorkCounter, 1);
-        PassId = 0;
-        DoneCounterToWaitOn = 0;
-        NumGroupsInPrevPass = GraphGlobals.NumNodes;
-        NumGroupsInPrevPrevPass = GraphGlobals.NumNodes;
+        if (GlobalMove.SpeedEfficiency > MinSpeedEfficiency)
+        {
+            GlobalMove.SpeedEfficiency *= 0.7f;
+        }
+    }
+    else if (GlobalMove.Speed < 1000.0f)
+    {
+        GlobalMove.SpeedEfficiency *= 1.3f;
+    }
+
+    // NOTE: Prevent speed from rising to quickly
+    float MaxRise = 0.5f;
+    GlobalMove.Speed += min(TargetSpeed - GlobalMove.Speed, MaxRise * GlobalMove.Speed);
+}
+
+void GlobalMoveFinish(uint WorkGroupId, uint NumGroups, global_move_reduction MoveReduction)
+{
+    // NOTE: Write out our partial sum and check if we are the last group to finish
+    if (gl_LocalInvocationIndex == 0)
+    {
+        GlobalMoveReductionArray[WorkGroupId] = MoveReduction;
+        memoryBarrierBuffer();
+        uint NumGroupsDone = atomicAdd(GlobalMoveDoneCounter, 1);
+        IsLastGroup = NumGroupsDone == (NumGroups - 1);
+    }
+    barrier();
 
-        uint NumGroupsInPass = CeilU32(float(GraphGlobals.NumNodes) / 32.0f);
-        while (!(WorkCounterId < (DoneCounterToWaitOn + NumGroupsInPass)))
+    if (IsLastGroup)
+    {
+        // NOTE: All other groups have written their partial sums so reduce them and calculate the global speed
+        memoryBarrierBuffer();
+
+        global_move_reduction FinalReduction;
+        FinalReduction.Swing = 0;
+        FinalReduction.Traction = 0;
+        FinalReduction.Displacement = 0;
+        for (uint GroupId = gl_LocalInvocationIndex; GroupId < NumGroups; GroupId += NUM_THREADS)
         {
-            DoneCounterToWaitOn += NumGroupsInPass;
-            NumGroupsInPrevPrevPass = NumGroupsInPrevPass;
-            NumGroupsInPrevPass = NumGroupsInPass;
-            NumGroupsInPass = CeilU32(float(NumGroupsInPass) / 32.0f);
-            PassId += 1;
+            global_move_reduction GroupReduction = GlobalMoveReductionArray[GroupId];
+            FinalReduction.Swing += GroupReduction.Swing;
+            FinalReduction.Traction += GroupReduction.Traction;
+            FinalReduction.Displacement += GroupReduction.Displacement;
         }
+        FinalReduction = WorkGroupReduce(FinalReduction);
 
-        // NOTE: Calculate how many threads in this thread group need to be active (last thread group in each pass might have too
-        // extra threads that do nothing)
+        if (gl_LocalInvocationIndex == 0)
         {
-            bool LastGroupInPass = (WorkCounterId - DoneCounterToWaitOn) == (NumGroupsInPass - 1);
-            NumThreadsInGroup = (LastGroupInPass ?
-                                 NUM_THREADS - (NUM_THREADS * CeilU32(float(NumGroupsInPrevPass) / 32.0f) - NumGroupsInPrevPass) :
-                                 NUM_THREADS);
+            GlobalMoveDoneCounter = 0;
+            GlobalMoveUpdateSpeed(FinalReduction);
+
+            // NOTE: The CPU reads these back to decide if the layout has converged
+            GlobalMoveStats.TotalSwing = FinalReduction.Swing;
+            GlobalMoveStats.TotalTraction = FinalReduction.Traction;
+            GlobalMoveStats.MeanDisplacement = FinalReduction.Displacement / float(GraphGlobals.NumNodes);
+            GlobalMoveStats.Speed = GlobalMove.Speed;
         }
     }
+}
 
-    barrier();
-    
-    // NOTE: Wait for Done Counter to match (only happens if last pass hasn't finished). We have to do this atomically to not read
-    // garbage
-    // TODO: We can choose a more exact counter to wait on
-    while (atomicAdd(GlobalMoveDoneCounter, 0) < DoneCounterToWaitOn)
+#endif
+
+#if GRAPH_CALC_GLOBAL_SPEED
+
+layout(local_size_x = NUM_THREADS, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    if (WorkGroupId >= GraphGlobals.NumThreadGroupsGlobalSpeed)
     {
+        return;
     }
+
+    // NOTE: Displacement uses the speed from the last iteration since we are still calculating the new one. The speed can only rise by
+    // 50% per iteration so this is a good enough estimate of how much GRAPH_UPDATE_NODES will move the nodes
+    float PrevSpeed = GlobalMove.Speed;
     
-    // NOTE: x = Swing, y = Traction
+    // NOTE: Reduce our nodes
     global_move_reduction MoveReduction;
     MoveReduction.Swing = 0;
     MoveReduction.Traction = 0;
-
-    // TODO: Move back in
-    uint LoadIndex = 0;
-    if (gl_LocalInvocationID.x < NumThreadsInGroup)
+    MoveReduction.Displacement = 0;
+    for (uint ItemId = 0; ItemId < REDUCTION_ITEMS_PER_THREAD; ++ItemId)
     {
-        if (PassId == 0)
+        uint NodeId = WorkGroupId * REDUCTION_NODES_PER_GROUP + ItemId * NUM_THREADS + gl_LocalInvocationIndex;
+        if (NodeId < GraphGlobals.NumNodes)
         {
-            // NOTE: First set of downsample reads directly from required buffers
-            uint NodeId = NUM_THREADS * (WorkCounterId - DoneCounterToWaitOn) + gl_LocalInvocationIndex;
-            if (NodeId < GraphGlobals.NumNodes)
-            {
-                vec2 PrevForce = NodePrevForceArray[NodeId];
-                vec2 CurrForce = NodeForceArray[NodeId];
-                MoveReduction.Swing += (1.0f + NodeDegreeArray[NodeId]) * length(CurrForce - PrevForce);
-                MoveReduction.Traction += 0.5f * length(CurrForce + PrevForce);
-            }
+            vec2 PrevForce = NodeLoadPrevForce(NodeId);
+            vec2 CurrForce = NodeForceArray[NodeId];
+            float NodeDegree = NodeLoadDegree(NodeId);
+            MoveReduction.Swing += (1.0f + NodeDegree) * length(CurrForce - PrevForce);
+            MoveReduction.Traction += 0.5f * length(CurrForce + PrevForce);
+
+            float NodeSpeed = PrevSpeed / (1 + PrevSpeed * NodeDegree * length(CurrForce - PrevForce));
+            MoveReduction.Displacement += NodeSpeed * length(CurrForce);
         }
-        else
-        {
-            LoadIndex = NUM_THREADS * (WorkCounterId - DoneCounterToWaitOn) + gl_LocalInvocationIndex;
-            if ((PassId & 0x1) == 0)
-            {
-                // NOTE: We have a odd number pass id so we don't start from the beginning of the buffer
-                LoadIndex += NumGroupsInPrevPrevPass;
-            }
+    }
+    MoveReduction = WorkGroupReduce(MoveReduction);
+
+    GlobalMoveFinish(WorkGroupId, GraphGlobals.NumThreadGroupsGlobalSpeed, MoveReduction);
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Graph Update Nodes Shader
+//=========================================================================================================================================
+
+#if GRAPH_UPDATE_NODES
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint CurrNodeId = GraphThreadNodeId(WorkGroupId * 32 + gl_LocalInvocationIndex);
+    if (CurrNodeId != 0xFFFFFFFF)
+    {
+        // NOTE: The degree of a node is its mass
+        vec2 CurrNodePos = NodeLoadPos(CurrNodeId);
+        float CurrNodeDegree = NodeLoadDegree(CurrNodeId);        
+        vec2 CurrNodeForce = NodeForceArray[CurrNodeId];
+        vec2 PrevNodeForce = NodeLoadPrevForce(CurrNodeId);
+
+        //float Swing = (1.0f + CurrNodeDegree) * length(CurrNodeForce - PrevNodeForce);
+        float Swing = CurrNodeDegree * length(CurrNodeForce - PrevNodeForce);
+        float NodeSpeed = GlobalMove.Speed / (1 + GlobalMove.Speed * Swing);
+
+        // NOTE: Update position
+        vec2 NewPos = CurrNodePos + NodeSpeed * CurrNodeForce;
+        //NewPos = max(min(NewPos, GraphGlobals.WorldRadius), -GraphGlobals.WorldRadius);
+
+        // NOTE: A node stays active while it still moves or while its force keeps changing
+        float Displacement = NodeSpeed * length(CurrNodeForce);
+        float ForceChange = NodeSpeed * length(CurrNodeForce - PrevNodeForce);
         
-            MoveReduction = GlobalMoveReductionArray[LoadIndex];
+        // NOTE: Write out to required buffers
+        NodeStorePos(CurrNodeId, NewPos);
+        NodeStorePrevForce(CurrNodeId, CurrNodeForce);
+        NodeActiveArray[CurrNodeId] = uint(max(Displacement, ForceChange) > GraphGlobals.ActiveThreshold);
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Graph Active Compact Shader
+//=========================================================================================================================================
+
+#if GRAPH_ACTIVE_COMPACT
+
+/*
+  NOTE: Builds the list of nodes the next iteration simulates. A frozen node still gets simulated if one of its neighbours is active,
+        since its attraction changes when they move. Order in the list doesn't matter, so each group reserves its range with 1 atomic.
+ */
+
+shared uint SharedNumActive;
+shared uint SharedActiveOffset;
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint CurrNodeId = WorkGroupId * 32 + gl_LocalInvocationIndex;
+
+    bool Active = false;
+    if (CurrNodeId < GraphGlobals.NumNodes)
+    {
+        Active = NodeActiveArray[CurrNodeId] != 0;
+
+        graph_node_edges Edges = NodeEdgeArray[CurrNodeId];
+        for (uint EdgeId = Edges.StartConnections; !Active && EdgeId < Edges.EndConnections; ++EdgeId)
+        {
+            Active = NodeActiveArray[EdgeArray[EdgeId].OtherNodeId] != 0;
         }
     }
-    
-    MoveReduction.Swing = subgroupAdd(MoveReduction.Swing);
-    MoveReduction.Traction = subgroupAdd(MoveReduction.Traction);
+
+    if (gl_LocalInvocationIndex == 0)
+    {
+        SharedNumActive = 0;
+    }
     barrier();
 
-    if (gl_LocalInvocationID.x == 0)
+    uint LocalOffset = 0;
+    if (Active)
     {
-        if (WorkCounterId != GraphGlobals.NumThreadGroupsGlobalSpeed - 1)
-        {
-            // NOTE: Write out the summed values
-            uint WriteIndex = WorkCounterId - DoneCounterToWaitOn;
-            if ((PassId & 0x1) != 0)
-            {
-                // NOTE: We have a even number pass id so we have to write offsetted
-                WriteIndex += NumGroupsInPrevPass;
-            }
+        LocalOffset = atomicAdd(SharedNumActive, 1);
+    }
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0)
+    {
+        SharedActiveOffset = atomicAdd(ActiveSet.ActiveCounter, SharedNumActive);
+    }
+    barrier();
 
-            GlobalMoveReductionArray[WriteIndex] = MoveReduction;
+    if (Active)
+    {
+        ActiveNodeArray[SharedActiveOffset + LocalOffset] = CurrNodeId;
+    }
+}
 
-            memoryBarrier();
-            atomicAdd(GlobalMoveDoneCounter, 1);
+#endif
+
+//=========================================================================================================================================
+// NOTE: Graph Active Dispatch Args Shader
+//=========================================================================================================================================
+
+#if GRAPH_ACTIVE_DISPATCH_ARGS
+
+layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint NumActiveNodes = ActiveSet.ActiveCounter;
+    ActiveSet.NumActiveNodes = NumActiveNodes;
+    ActiveSet.ActiveCounter = 0;
+
+    // NOTE: Same split as MAX_THREAD_GROUPS on the CPU
+    uint DispatchX = (NumActiveNodes + 31) / 32;
+    uint DispatchY = 1;
+    if (DispatchX > 65535)
+    {
+        DispatchX = 64;
+        DispatchY = (NumActiveNodes + 32 * 64 - 1) / (32 * 64);
+    }
+
+    // NOTE: An empty dispatch is valid, the kernels just don't run
+    ActiveSet.DispatchX = DispatchX;
+    ActiveSet.DispatchY = DispatchY;
+    ActiveSet.DispatchZ = 1;
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Graph Fused Layout Shader
+//=========================================================================================================================================
+
+#if GRAPH_FUSED_LAYOUT || GRAPH_FUSED_RESOLVE
+
+/*
+  NOTE: The fused path runs a whole layout iteration in 1 dispatch. Attraction, gravity and repulsion are summed in registers and
+        reduced into the global speed with the same last group reduction as GRAPH_CALC_GLOBAL_SPEED. The position update needs the new
+        global speed, which only exists once every group finished, so we defer it to the next iteration: each node stores its
+        position, force and swing, and whoever reads a node applies the pending move on the fly. Other groups are still reading the
+        state of the last iteration while we write ours, so the state ping pongs between the 2 sets of FUSED_DESCRIPTOR_LAYOUT.
+
+        State 0 is the node state of the level, so it's the packed state when GRAPH_PACKED_NODE_STATE is on, and state 1 uses the
+        same formats. GRAPH_FUSED_RESOLVE applies the last pending move and writes it to state 0 so that rendering, prolongation and
+        the unfused path see final positions.
+ */
+
+FUSED_DESCRIPTOR_LAYOUT(1)
+
+layout(push_constant) uniform push_constants
+{
+    uint ApplyPendingMove;
+} PushConstants;
+
+vec2 FusedNodePos(uint NodeId, float Speed)
+{
+    vec2 Result = FusedLoadPos(FusedInPosArray, NodeId);
+    if (PushConstants.ApplyPendingMove != 0)
+    {
+        float NodeSpeed = Speed / (1 + Speed * FusedInSwingArray[NodeId]);
+        Result += NodeSpeed * FusedLoadForce(FusedInForceArray, NodeId);
+    }
+
+    return Result;
+}
+
+#endif
+
+#if GRAPH_FUSED_LAYOUT
+
+shared vec2 SharedTilePos[NUM_THREADS];
+shared float SharedTileDegree[NUM_THREADS];
+
+layout(local_size_x = NUM_THREADS, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint NumGroups = gl_NumWorkGroups.x * gl_NumWorkGroups.y;
+    uint CurrNodeId = WorkGroupId * NUM_THREADS + gl_LocalInvocationIndex;
+    bool ValidNode = CurrNodeId < GraphGlobals.NumNodes;
+
+    // NOTE: Speed of the pending move, the last group overwrites it only after every group read it
+    float PrevSpeed = GlobalMove.Speed;
+    
+    vec2 CurrNodePos = vec2(0);
+    float CurrNodeDegree = 0;
+    vec2 PrevNodeForce = vec2(0);
+    vec2 CurrNodeForce = vec2(0);
+    if (ValidNode)
+    {
+        CurrNodePos = FusedNodePos(CurrNodeId, PrevSpeed);
+        CurrNodeDegree = NodeLoadDegree(CurrNodeId);
+        PrevNodeForce = FusedLoadForce(FusedInForceArray, CurrNodeId);
+
+        // NOTE: Attraction
+        graph_node_edges Edges = NodeEdgeArray[CurrNodeId];
+        for (uint EdgeId = Edges.StartConnections; EdgeId < Edges.EndConnections; ++EdgeId)
+        {
+            uint OtherNodeId = EdgeArray[EdgeId].OtherNodeId;
+            vec2 OtherNodePos = FusedNodePos(OtherNodeId, PrevSpeed);
+            CurrNodeForce += EdgeCoefficientArray[EdgeId] * (OtherNodePos - CurrNodePos);
         }
-        else
+
+        // NOTE: Apply gravity towards center (0, 0)
         {
-            // NOTE: We are the last job so calculate global speed
-            // NOTE: Remove bad behavior at 0
-            MoveReduction.Swing += 0.001f;
-            MoveReduction.Traction += 0.001f;
-
-            // NOTE: Calculate jitter tolerance
-            float EstimatedOptimalJitterTolerance = 0.05f * sqrt(GraphGlobals.NumNodes);
-            float MinJitterTolerance = sqrt(EstimatedOptimalJitterTolerance);
-            float JitterTolerance = max(MinJitterTolerance,
-                                        min(GlobalMove.MaxJitterTolerance, EstimatedOptimalJitterTolerance * MoveReduction.Traction / float(GraphGlobals.NumNodes * GraphGlobals.NumNodes)));
-            JitterTolerance *= GlobalMove.JitterToleranceConstant;
-
-            // NOTE: Protect against erratic behavior
-            float MinSpeedEfficiency = 0.05f;
-            if (MoveReduction.Swing / MoveReduction.Traction > 2.0f)
+            float DistToCenter = length(CurrNodePos);
+            float GravityFactor = NodeGravityArray[CurrNodeId];
+            if (CurrNodePos.x == 0 && CurrNodePos.y == 0)
             {
-                if (GlobalMove.SpeedEfficiency > MinSpeedEfficiency)
-                {
-                    GlobalMove.SpeedEfficiency *= 0.5f;
-                }
-                JitterTolerance = max(JitterTolerance, GlobalMove.JitterToleranceConstant);
+                GravityFactor = 0.0f;
+            }
+            if (GraphGlobals.StrongGravityEnabled == 0)
+            {
+                GravityFactor /= DistToCenter;
             }
+            
+            CurrNodeForce += -CurrNodePos * GravityFactor;
+        }
+    }
 
-            float TargetSpeed = JitterTolerance * GlobalMove.SpeedEfficiency * MoveReduction.Traction / MoveReduction.Swing;
+    // NOTE: Repulsion. We walk the other nodes in tiles through shared memory so each group applies the pending move of a node once
+    for (uint TileStart = 0; TileStart < GraphGlobals.NumNodes; TileStart += NUM_THREADS)
+    {
+        uint LoadNodeId = TileStart + gl_LocalInvocationIndex;
+        if (LoadNodeId < GraphGlobals.NumNodes)
+        {
+            SharedTilePos[gl_LocalInvocationIndex] = FusedNodePos(LoadNodeId, PrevSpeed);
+            SharedTileDegree[gl_LocalInvocationIndex] = NodeLoadDegree(LoadNodeId);
+        }
+        barrier();
 
-            if (MoveReduction.Swing > JitterTolerance * MoveReduction.Traction)
+        if (ValidNode)
+        {
+            uint TileSize = min(uint(NUM_THREADS), GraphGlobals.NumNodes - TileStart);
+            for (uint TileNodeId = 0; TileNodeId < TileSize; ++TileNodeId)
             {
-                if (GlobalMove.SpeedEfficiency > MinSpeedEfficiency)
+                if (TileStart + TileNodeId != CurrNodeId)
                 {
-                    GlobalMove.SpeedEfficiency *= 0.7f;
+                    vec2 DistanceVec = CurrNodePos - SharedTilePos[TileNodeId];
+                    float DistanceSq = DistanceVec.x * DistanceVec.x + DistanceVec.y * DistanceVec.y + GraphGlobals.RepulsionSoftner;
+                    float RepulsionMultiplier = GraphGlobals.RepulsionMultiplier * CurrNodeDegree * SharedTileDegree[TileNodeId];
+                    CurrNodeForce += RepulsionMultiplier * DistanceVec / DistanceSq;
                 }
             }
-            else if (GlobalMove.Speed < 1000.0f)
-            {
-                GlobalMove.SpeedEfficiency *= 1.3f;
-            }
-
-            // NOTE: Prevent speed from rising to quickly
-            float MaxRise = 0.5f;
-            GlobalMove.Speed += min(TargetSpeed - GlobalMove.Speed, MaxRise * GlobalMove.Speed);
         }
+        barrier();
+    }
+
+    // NOTE: Write out our state for the next iteration and reduce the global speed
+    global_move_reduction MoveReduction;
+    MoveReduction.Swing = 0;
+    MoveReduction.Traction = 0;
+    MoveReduction.Displacement = 0;
+    if (ValidNode)
+    {
+        float SwingLength = length(CurrNodeForce - PrevNodeForce);
+        MoveReduction.Swing = (1.0f + CurrNodeDegree) * SwingLength;
+        MoveReduction.Traction = 0.5f * length(CurrNodeForce + PrevNodeForce);
+
+        float NodeSpeed = PrevSpeed / (1 + PrevSpeed * CurrNodeDegree * SwingLength);
+        MoveReduction.Displacement = NodeSpeed * length(CurrNodeForce);
+        
+        FusedStorePos(FusedOutPosArray, CurrNodeId, CurrNodePos);
+        FusedStoreForce(FusedOutForceArray, CurrNodeId, CurrNodeForce);
+        FusedOutSwingArray[CurrNodeId] = CurrNodeDegree * SwingLength;
     }
+    MoveReduction = WorkGroupReduce(MoveReduction);
+
+    GlobalMoveFinish(WorkGroupId, NumGroups, MoveReduction);
 }
+
 #endif
 
-#if 0
-layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+#if GRAPH_FUSED_RESOLVE
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
-    // TODO: Super inefficient now but it iz what it iz
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint CurrNodeId = WorkGroupId * 32 + gl_LocalInvocationIndex;
+    if (CurrNodeId < GraphGlobals.NumNodes)
+    {
+        // NOTE: When we ended in state 0 this writes in place, the force copy then rewrites the same value
+        NodeStorePos(CurrNodeId, FusedNodePos(CurrNodeId, GlobalMove.Speed));
+        NodeStorePrevForce(CurrNodeId, FusedLoadForce(FusedInForceArray, CurrNodeId));
+    }
+}
 
-    /* NOTE: References:
-       - https://github.com/govertb/GPUGraphLayout/blob/master/src/RPFA2Kernels.cu
-       - https://github.com/bhargavchippada/forceatlas2/blob/master/fa2/fa2util.py
-       - https://journals.plos.org/plosone/article?id=10.1371/journal.pone.0098679
-    */
+#endif
 
-    float GlobalSwing = 0.001f;
-    float GlobalTraction = 0.001f;
-    
-    for (uint NodeId = 0; NodeId < GraphGlobals.NumNodes; ++NodeId)
+//=========================================================================================================================================
+// NOTE: Graph Prolong Shader
+//=========================================================================================================================================
+
+#if GRAPH_PROLONG || GRAPH_APPEND_SEED
+
+uint Hash(uint Value)
+{
+    // NOTE: https://www.reedbeta.com/blog/hash-functions-for-gpu-rendering/
+    uint State = Value * 747796405u + 2891336453u;
+    uint Word = ((State >> ((State >> 28u) + 4u)) ^ State) * 277803737u;
+    return (Word >> 22u) ^ Word;
+}
+
+#endif
+
+#if GRAPH_PROLONG
+
+/*
+  NOTE: Copies positions from the next coarser level down to this level. All nodes that got merged into the same coarse node would land
+        on the same spot and repulsion can't push apart 2 nodes with a 0 distance vector, so we scatter them around it by a hash of
+        their id. The hash is stable so prolonging the same level twice gives the same result.
+ */
+
+layout(push_constant) uniform push_constants
+{
+    uint NumNodes;
+    float JitterRadius;
+} PushConstants;
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint CurrNodeId = WorkGroupId * 32 + gl_LocalInvocationIndex;
+    if (CurrNodeId < PushConstants.NumNodes)
     {
-        vec2 PrevForce = NodePrevForceArray[NodeId];
-        vec2 CurrForce = NodeForceArray[NodeId];
-        GlobalSwing += (1.0f + NodeDegreeArray[NodeId]) * length(CurrForce - PrevForce);
-        GlobalTraction += 0.5f * length(CurrForce + PrevForce);
+        vec2 CoarsePos = CoarseNodeLoadPos(CoarseNodeArray[CurrNodeId]);
+
+        uint Random = Hash(CurrNodeId);
+        float Angle = 6.28318530718f * float(Random & 0xFFFF) / 65536.0f;
+        float Radius = PushConstants.JitterRadius * (0.5f + 0.5f * float(Random >> 16) / 65536.0f);
+
+        NodeStorePos(CurrNodeId, CoarsePos + Radius * vec2(cos(Angle), sin(Angle)));
     }
+}
 
-    GlobalMove.Swing = GlobalSwing;
-    GlobalMove.Traction = GlobalTraction;
-    
-    // NOTE: Calculate jitter tolerance
-    float EstimatedOptimalJitterTolerance = 0.05f * sqrt(GraphGlobals.NumNodes);
-    float MinJitterTolerance = sqrt(EstimatedOptimalJitterTolerance);
-    float JitterTolerance = max(MinJitterTolerance,
-                                min(GlobalMove.MaxJitterTolerance, EstimatedOptimalJitterTolerance * GlobalTraction / float(GraphGlobals.NumNodes * GraphGlobals.NumNodes)));
-    JitterTolerance *= GlobalMove.JitterToleranceConstant;
+#endif
 
-    // NOTE: Protect against erratic behavior
-    float MinSpeedEfficiency = 0.05f;
-    if (GlobalSwing / GlobalTraction > 2.0f)
+//=========================================================================================================================================
+// NOTE: Graph Append Seed Shader
+//=========================================================================================================================================
+
+#if GRAPH_APPEND_SEED
+
+/*
+  NOTE: Places the nodes GraphAppend added at the barycentre of their neighbours that already had a position. New nodes that share
+        their neighbours would land on the same spot, so we scatter them by a hash of their id like GRAPH_PROLONG does. Nodes with no
+        placed neighbour get a random spot in the spawn area.
+ */
+
+layout(push_constant) uniform push_constants
+{
+    uint FirstNewNode;
+    uint NumNewNodes;
+    float JitterRadius;
+    float SpawnRadius;
+} PushConstants;
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint ThreadId = WorkGroupId * 32 + gl_LocalInvocationIndex;
+    if (ThreadId < PushConstants.NumNewNodes)
     {
-        if (GlobalMove.SpeedEfficiency > MinSpeedEfficiency)
+        uint CurrNodeId = PushConstants.FirstNewNode + ThreadId;
+
+        vec2 Barycentre = vec2(0);
+        uint NumPlacedNeighbours = 0;
+        graph_node_edges Edges = NodeEdgeArray[CurrNodeId];
+        for (uint EdgeId = Edges.StartConnections; EdgeId < Edges.EndConnections; ++EdgeId)
         {
-            GlobalMove.SpeedEfficiency *= 0.5f;
+            uint OtherNodeId = EdgeArray[EdgeId].OtherNodeId;
+            if (OtherNodeId < PushConstants.FirstNewNode)
+            {
+                Barycentre += NodeLoadPos(OtherNodeId);
+                NumPlacedNeighbours += 1;
+            }
         }
-        JitterTolerance = max(JitterTolerance, GlobalMove.JitterToleranceConstant);
-    }
 
-    float TargetSpeed = JitterTolerance * GlobalMove.SpeedEfficiency * GlobalTraction / GlobalSwing;
+        uint Random = Hash(CurrNodeId);
+        float Angle = 6.28318530718f * float(Random & 0xFFFF) / 65536.0f;
+        float RandomRadius = float(Random >> 16) / 65536.0f;
+        vec2 Direction = vec2(cos(Angle), sin(Angle));
 
-    if (GlobalSwing > JitterTolerance * GlobalTraction)
-    {
-        if (GlobalMove.SpeedEfficiency > MinSpeedEfficiency)
+        vec2 NewPos;
+        if (NumPlacedNeighbours > 0)
         {
-            GlobalMove.SpeedEfficiency *= 0.7f;
+            NewPos = Barycentre / float(NumPlacedNeighbours) + PushConstants.JitterRadius * (0.5f + 0.5f * RandomRadius) * Direction;
+        }
+        else
+        {
+            NewPos = PushConstants.SpawnRadius * sqrt(RandomRadius) * Direction;
         }
-    }
-    else if (GlobalMove.Speed < 1000.0f)
-    {
-        GlobalMove.SpeedEfficiency *= 1.3f;
-    }
 
-    // NOTE: Prevent speed from rising to quickly
-    float MaxRise = 0.5f;
-    GlobalMove.Speed += min(TargetSpeed - GlobalMove.Speed, MaxRise * GlobalMove.Speed);
-}
+        NodeStorePos(CurrNodeId, NewPos);
+#if GRAPH_PACKED_NODE_STATE
+        // NOTE: GraphAppend only uploads the degree in the unpacked format
+        NodeStateArray[GRAPH_NODE_STATE_FLOATS*CurrNodeId + 2] = NodeDegreeArray[CurrNodeId];
 #endif
+    }
+}
 
 #endif
 
 //=========================================================================================================================================
-// NOTE: Graph Update Nodes Shader
+// NOTE: Graph Pack Node State Shader
 //=========================================================================================================================================
 
-#if GRAPH_UPDATE_NODES
+#if GRAPH_PACK_NODE_STATE
+
+/*
+  NOTE: The CPU uploads positions and degrees as separate arrays, this interleaves them into the packed node state of a level and
+        clears its previous forces.
+ */
+
+layout(push_constant) uniform push_constants
+{
+    uint NumNodes;
+} PushConstants;
 
 layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
     uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
     uint CurrNodeId = WorkGroupId * 32 + gl_LocalInvocationIndex;
-    if (CurrNodeId < GraphGlobals.NumNodes)
+    if (CurrNodeId < PushConstants.NumNodes)
     {
-        // NOTE: The degree of a node is its mass
-        vec2 CurrNodePos = NodePositionArray[CurrNodeId];
-        float CurrNodeDegree = NodeDegreeArray[CurrNodeId];        
-        vec2 CurrNodeForce = NodeForceArray[CurrNodeId];
-        vec2 PrevNodeForce = NodePrevForceArray[CurrNodeId];
+        vec2 Pos = NodePositionArray[CurrNodeId];
+        NodeStateArray[GRAPH_NODE_STATE_FLOATS*CurrNodeId + 0] = Pos.x;
+        NodeStateArray[GRAPH_NODE_STATE_FLOATS*CurrNodeId + 1] = Pos.y;
+        NodeStateArray[GRAPH_NODE_STATE_FLOATS*CurrNodeId + 2] = NodeDegreeArray[CurrNodeId];
+        NodePrevForceHalfArray[CurrNodeId] = 0;
+    }
+}
 
-        //float Swing = (1.0f + CurrNodeDegree) * length(CurrNodeForce - PrevNodeForce);
-        float Swing = CurrNodeDegree * length(CurrNodeForce - PrevNodeForce);
-        float NodeSpeed = GlobalMove.Speed / (1 + GlobalMove.Speed * Swing);
+#endif
 
-        // NOTE: Update position
-        vec2 NewPos = CurrNodePos + NodeSpeed * CurrNodeForce;
-        //NewPos = max(min(NewPos, GraphGlobals.WorldRadius), -GraphGlobals.WorldRadius);
+//=========================================================================================================================================
+// NOTE: Graph Attraction Cache Shader
+//=========================================================================================================================================
 
-        // NOTE: Write out to required buffers
-        NodePositionArray[CurrNodeId] = NewPos;
-        NodePrevForceArray[CurrNodeId] = CurrNodeForce;
+#if GRAPH_ATTRACTION_CACHE
+
+/*
+  NOTE: The attraction of an edge and the gravity of a node only depend on the layout params and the graph, so we only rebuild them
+        when one of those changes instead of calling pow for every edge in every iteration.
+ */
+
+layout(push_constant) uniform push_constants
+{
+    uint NumNodes;
+    uint NumEdges;
+} PushConstants;
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint ThreadId = WorkGroupId * 32 + gl_LocalInvocationIndex;
+    if (ThreadId < PushConstants.NumEdges)
+    {
+        EdgeCoefficientArray[ThreadId] = pow(EdgeArray[ThreadId].Weight, GraphGlobals.AttractionWeightPower) * GraphGlobals.AttractionMultiplier;
+    }
+    if (ThreadId < PushConstants.NumNodes)
+    {
+        NodeGravityArray[ThreadId] = NodeLoadDegree(ThreadId) * GraphGlobals.GravityMultiplier;
     }
 }
 
@@ -410,7 +1007,7 @@ layout(location = 1) out vec2 OutUv;
 
 void main()
 {
-    vec2 PosEntry = NodePositionArray[gl_InstanceIndex];
+    vec2 PosEntry = NodeLoadPos(gl_InstanceIndex);
     graph_node_draw DrawEntry = NodeDrawArray[gl_InstanceIndex];
     gl_Position = GraphGlobals.VPTransform * vec4(vec3(PosEntry, 0) + DrawEntry.Scale * InPos, 1);
     OutColor = vec4(DrawEntry.Color, 1);
@@ -525,8 +1122,8 @@ void main()
     // NOTE: https://twitter.com/m_schuetz/status/1423275869825503232/photo/2
     uint LineId = gl_InstanceIndex;
     uint VertexIndex = gl_VertexIndex;
-    vec2 Start = NodePositionArray[DrawEdgeIndexArray[2*LineId + 0]];
-    vec2 End = NodePositionArray[DrawEdgeIndexArray[2*LineId + 1]];
+    vec2 Start = NodeLoadPos(DrawEdgeIndexArray[2*LineId + 0]);
+    vec2 End = NodeLoadPos(DrawEdgeIndexArray[2*LineId + 1]);
 
     vec2 Position;
     if (InPos.x == -0.5f)
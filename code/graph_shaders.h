@@ -21,8 +21,72 @@ struct global_move_reduction
 {
     float Swing;
     float Traction;
+    float Displacement;
 };
 
+// NOTE: Each thread in a reduction loads this many elements before we reduce across the work group
+#define REDUCTION_ITEMS_PER_THREAD 16
+#define REDUCTION_NODES_PER_GROUP (32 * REDUCTION_ITEMS_PER_THREAD)
+
+// NOTE: Each thread in the edge parallel attraction processes this many edges
+#define ATTRACTION_ITEMS_PER_THREAD 16
+#define ATTRACTION_EDGES_PER_GROUP (32 * ATTRACTION_ITEMS_PER_THREAD)
+
+/*
+  NOTE: With the packed node state, every node stores x, y and degree next to each other in NodeStateArray so a neighbour gather
+        touches 1 stream instead of 2, and the previous force (only read by the node itself) is stored as 2 halfs. The separate
+        position and degree buffers are then only the upload format that GRAPH_PACK_NODE_STATE converts from. This has to match
+        the define in huge_graphs_demo.h.
+ */
+#define GRAPH_PACKED_NODE_STATE 1
+#define GRAPH_NODE_STATE_FLOATS 3
+
+// NOTE: Larger forces get clamped when we store them as halfs, this only makes the swing of those nodes less precise
+#define GRAPH_MAX_HALF_FORCE 65000.0f
+
+#if GRAPH_PACKED_NODE_STATE
+
+#define NodeLoadPos(NodeId) vec2(NodeStateArray[GRAPH_NODE_STATE_FLOATS*(NodeId) + 0], NodeStateArray[GRAPH_NODE_STATE_FLOATS*(NodeId) + 1])
+#define NodeLoadDegree(NodeId) NodeStateArray[GRAPH_NODE_STATE_FLOATS*(NodeId) + 2]
+#define NodeStorePos(NodeId, Pos)                                       \
+    {                                                                   \
+        NodeStateArray[GRAPH_NODE_STATE_FLOATS*(NodeId) + 0] = (Pos).x; \
+        NodeStateArray[GRAPH_NODE_STATE_FLOATS*(NodeId) + 1] = (Pos).y; \
+    }
+#define NodeLoadPrevForce(NodeId) unpackHalf2x16(NodePrevForceHalfArray[NodeId])
+#define NodeStorePrevForce(NodeId, Force) NodePrevForceHalfArray[NodeId] = packHalf2x16(clamp(Force, vec2(-GRAPH_MAX_HALF_FORCE), vec2(GRAPH_MAX_HALF_FORCE)))
+#define CoarseNodeLoadPos(NodeId) vec2(CoarseNodeStateArray[GRAPH_NODE_STATE_FLOATS*(NodeId) + 0], CoarseNodeStateArray[GRAPH_NODE_STATE_FLOATS*(NodeId) + 1])
+
+// NOTE: The fused states use the same formats so that state 0 can live in the packed node state and the half prev forces
+#define FUSED_POS_TYPE float
+#define FUSED_FORCE_TYPE uint
+#define FusedLoadPos(Array, NodeId) vec2(Array[GRAPH_NODE_STATE_FLOATS*(NodeId) + 0], Array[GRAPH_NODE_STATE_FLOATS*(NodeId) + 1])
+#define FusedStorePos(Array, NodeId, Pos)                      \
+    {                                                          \
+        Array[GRAPH_NODE_STATE_FLOATS*(NodeId) + 0] = (Pos).x; \
+        Array[GRAPH_NODE_STATE_FLOATS*(NodeId) + 1] = (Pos).y; \
+    }
+#define FusedLoadForce(Array, NodeId) unpackHalf2x16(Array[NodeId])
+#define FusedStoreForce(Array, NodeId, Force) Array[NodeId] = packHalf2x16(clamp(Force, vec2(-GRAPH_MAX_HALF_FORCE), vec2(GRAPH_MAX_HALF_FORCE)))
+
+#else
+
+#define NodeLoadPos(NodeId) NodePositionArray[NodeId]
+#define NodeLoadDegree(NodeId) NodeDegreeArray[NodeId]
+#define NodeStorePos(NodeId, Pos) NodePositionArray[NodeId] = (Pos)
+#define NodeLoadPrevForce(NodeId) NodePrevForceArray[NodeId]
+#define NodeStorePrevForce(NodeId, Force) NodePrevForceArray[NodeId] = (Force)
+#define CoarseNodeLoadPos(NodeId) CoarseNodePositionArray[NodeId]
+
+#define FUSED_POS_TYPE vec2
+#define FUSED_FORCE_TYPE vec2
+#define FusedLoadPos(Array, NodeId) Array[NodeId]
+#define FusedStorePos(Array, NodeId, Pos) Array[NodeId] = (Pos)
+#define FusedLoadForce(Array, NodeId) Array[NodeId]
+#define FusedStoreForce(Array, NodeId, Force) Array[NodeId] = (Force)
+
+#endif
+
 #define GRAPH_DESCRIPTOR_LAYOUT(set_id)                                 \
                                                                         \
     layout(set = set_id, binding = 0) uniform graph_globals             \
@@ -31,6 +95,7 @@ struct global_move_reduction
         vec2 ViewPort;                                                  \
         float FrameTime;                                                \
         uint NumNodes;                                                  \
+        uint NumEdges;                                                  \
                                                                         \
         float AttractionMultiplier;                                     \
         float AttractionWeightPower;                                    \
@@ -45,6 +110,8 @@ struct global_move_reduction
                                                                         \
         uint NumThreadGroupsCalcNodeBounds;                             \
         uint NumThreadGroupsGlobalSpeed;                                \
+                                                                        \
+        float ActiveThreshold;                                          \
     } GraphGlobals;                                                     \
                                                                         \
     layout(set = set_id, binding = 1) buffer graph_node_position_array  \
@@ -118,7 +185,139 @@ struct global_move_reduction
                                                                         \
     layout(set = set_id, binding = 13) buffer global_move_counter_buffer \
     {                                                                   \
-        uint GlobalMoveWorkCounter;                                     \
         uint GlobalMoveDoneCounter;                                     \
     };                                                                  \
+                                                                        \
+                                                                        \
+                                                                        \
+    layout(set = set_id, binding = 14) buffer graph_edge_source_array   \
+    {                                                                   \
+        uint EdgeSourceArray[];                                         \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 15) buffer graph_attraction_carry_array \
+    {                                                                   \
+        vec2 AttractionCarryArray[];                                    \
+    };                                                                  \
+                                                                        \
+                                                                        \
+                                                                        \
+    layout(set = set_id, binding = 16) buffer graph_coarse_node_array   \
+    {                                                                   \
+        uint CoarseNodeArray[];                                         \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 17) buffer graph_coarse_node_position_array \
+    {                                                                   \
+        vec2 CoarseNodePositionArray[];                                 \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 18) buffer global_move_stats_buffer  \
+    {                                                                   \
+        float TotalSwing;                                               \
+        float TotalTraction;                                            \
+        float MeanDisplacement;                                         \
+        float Speed;                                                    \
+    } GlobalMoveStats;                                                  \
+                                                                        \
+                                                                        \
+                                                                        \
+    layout(set = set_id, binding = 19) buffer graph_node_active_array   \
+    {                                                                   \
+        uint NodeActiveArray[];                                         \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 20) buffer graph_active_node_array   \
+    {                                                                   \
+        uint ActiveNodeArray[];                                         \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 21) buffer graph_active_set_buffer   \
+    {                                                                   \
+        uint DispatchX;                                                 \
+        uint DispatchY;                                                 \
+        uint DispatchZ;                                                 \
+        uint NumActiveNodes;                                            \
+        uint ActiveCounter;                                             \
+    } ActiveSet;                                                        \
+                                                                        \
+                                                                        \
+                                                                        \
+    layout(set = set_id, binding = 22) buffer graph_node_state_array    \
+    {                                                                   \
+        float NodeStateArray[];                                         \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 23) buffer graph_node_prev_force_half_array \
+    {                                                                   \
+        uint NodePrevForceHalfArray[];                                  \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 24) buffer graph_coarse_node_state_array \
+    {                                                                   \
+        float CoarseNodeStateArray[];                                   \
+    };                                                                  \
+                                                                        \
+                                                                        \
+                                                                        \
+    layout(set = set_id, binding = 25) buffer graph_edge_coefficient_array \
+    {                                                                   \
+        float EdgeCoefficientArray[];                                   \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 26) buffer graph_node_gravity_array  \
+    {                                                                   \
+        float NodeGravityArray[];                                       \
+    };                                                                  \
+
+// NOTE: 2 of these sets ping pong the state of the fused layout kernel between iterations
+#define FUSED_DESCRIPTOR_LAYOUT(set_id)                                 \
+                                                                        \
+    layout(set = set_id, binding = 0) buffer fused_in_position_array    \
+    {                                                                   \
+        FUSED_POS_TYPE FusedInPosArray[];                               \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 1) buffer fused_in_force_array       \
+    {                                                                   \
+        FUSED_FORCE_TYPE FusedInForceArray[];                           \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 2) buffer fused_in_swing_array       \
+    {                                                                   \
+        float FusedInSwingArray[];                                      \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 3) buffer fused_out_position_array   \
+    {                                                                   \
+        FUSED_POS_TYPE FusedOutPosArray[];                              \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 4) buffer fused_out_force_array      \
+    {                                                                   \
+        FUSED_FORCE_TYPE FusedOutForceArray[];                          \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 5) buffer fused_out_swing_array      \
+    {                                                                   \
+        float FusedOutSwingArray[];                                     \
+    };                                                                  \
+
+// NOTE: 2 of these sets hold the edge windows that the out of core mode streams the shards of level 0 through
+#define SHARD_DESCRIPTOR_LAYOUT(set_id)                                 \
+                                                                        \
+    layout(set = set_id, binding = 0) buffer shard_edge_array           \
+    {                                                                   \
+        edge ShardEdgeArray[];                                          \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 1) buffer shard_edge_source_array    \
+    {                                                                   \
+        uint ShardEdgeSourceArray[];                                    \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 2) buffer shard_carry_array          \
+    {                                                                   \
+        vec2 ShardCarryArray[];                                         \
+    };                                                                  \
 
@@ -0,0 +1,275 @@
+//
+// NOTE: Cpu Radix Sort
+//
+
+#include <emmintrin.h>
+
+inline void CpuSortIdentityPayload(u32 NumKeys, u32* Payload)
+{
+    for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+    {
+        Payload[KeyId] = KeyId;
+    }
+}
+
+inline void CpuSortBarrier(cpu_sort_job* Job)
+{
+    if (Job->NumThreads > 1)
+    {
+        EnterSynchronizationBarrier(&Job->Barrier, 0);
+    }
+}
+
+// NOTE: Every key bumps 1 of 4 histograms, so runs of the same digit don't serialize on one counter
+inline void CpuSortCount32(u32* Keys, u32 StartId, u32 EndId, u32 Shift, u32* Counts)
+{
+    u32 SubCounts[4][CPU_SORT_RADIX] = {};
+    __m128i ShiftVec = _mm_cvtsi32_si128(Shift);
+    __m128i Mask = _mm_set1_epi32(CPU_SORT_RADIX - 1);
+
+    u32 KeyId = StartId;
+    for (; KeyId + 4 <= EndId; KeyId += 4)
+    {
+        __m128i Digits = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((__m128i*)(Keys + KeyId)), ShiftVec), Mask);
+        SubCounts[0][_mm_extract_epi16(Digits, 0)] += 1;
+        SubCounts[1][_mm_extract_epi16(Digits, 2)] += 1;
+        SubCounts[2][_mm_extract_epi16(Digits, 4)] += 1;
+        SubCounts[3][_mm_extract_epi16(Digits, 6)] += 1;
+    }
+    for (; KeyId < EndId; ++KeyId)
+    {
+        SubCounts[0][(Keys[KeyId] >> Shift) & (CPU_SORT_RADIX - 1)] += 1;
+    }
+
+    for (u32 DigitId = 0; DigitId < CPU_SORT_RADIX; ++DigitId)
+    {
+        Counts[DigitId] = SubCounts[0][DigitId] + SubCounts[1][DigitId] + SubCounts[2][DigitId] + SubCounts[3][DigitId];
+    }
+}
+
+inline void CpuSortCount64(u64* Keys, u32 StartId, u32 EndId, u32 Shift, u32* Counts)
+{
+    u32 SubCounts[4][CPU_SORT_RADIX] = {};
+    __m128i ShiftVec = _mm_cvtsi32_si128(Shift);
+    __m128i Mask = _mm_set1_epi64x(CPU_SORT_RADIX - 1);
+
+    u32 KeyId = StartId;
+    for (; KeyId + 4 <= EndId; KeyId += 4)
+    {
+        __m128i Digits0 = _mm_and_si128(_mm_srl_epi64(_mm_loadu_si128((__m128i*)(Keys + KeyId + 0)), ShiftVec), Mask);
+        __m128i Digits1 = _mm_and_si128(_mm_srl_epi64(_mm_loadu_si128((__m128i*)(Keys + KeyId + 2)), ShiftVec), Mask);
+        SubCounts[0][_mm_extract_epi16(Digits0, 0)] += 1;
+        SubCounts[1][_mm_extract_epi16(Digits0, 4)] += 1;
+        SubCounts[2][_mm_extract_epi16(Digits1, 0)] += 1;
+        SubCounts[3][_mm_extract_epi16(Digits1, 4)] += 1;
+    }
+    for (; KeyId < EndId; ++KeyId)
+    {
+        SubCounts[0][(Keys[KeyId] >> Shift) & (CPU_SORT_RADIX - 1)] += 1;
+    }
+
+    for (u32 DigitId = 0; DigitId < CPU_SORT_RADIX; ++DigitId)
+    {
+        Counts[DigitId] = SubCounts[0][DigitId] + SubCounts[1][DigitId] + SubCounts[2][DigitId] + SubCounts[3][DigitId];
+    }
+}
+
+inline void CpuSortScatter32(u32* SrcKeys, u32* SrcPayload, u32* DstKeys, u32* DstPayload, u32 StartId, u32 EndId, u32 Shift,
+                             u32* Offsets)
+{
+    u32 BufferKeys[CPU_SORT_RADIX][CPU_SORT_WC_SIZE];
+    u32 BufferPayload[CPU_SORT_RADIX][CPU_SORT_WC_SIZE];
+    u32 BufferCounts[CPU_SORT_RADIX] = {};
+
+    for (u32 KeyId = StartId; KeyId < EndId; ++KeyId)
+    {
+        u32 Key = SrcKeys[KeyId];
+        u32 Digit = (Key >> Shift) & (CPU_SORT_RADIX - 1);
+        u32 SlotId = BufferCounts[Digit]++;
+        BufferKeys[Digit][SlotId] = Key;
+        BufferPayload[Digit][SlotId] = SrcPayload[KeyId];
+
+        if (SlotId + 1 == CPU_SORT_WC_SIZE)
+        {
+            Copy(BufferKeys[Digit], DstKeys + Offsets[Digit], sizeof(u32) * CPU_SORT_WC_SIZE);
+            Copy(BufferPayload[Digit], DstPayload + Offsets[Digit], sizeof(u32) * CPU_SORT_WC_SIZE);
+            Offsets[Digit] += CPU_SORT_WC_SIZE;
+            BufferCounts[Digit] = 0;
+        }
+    }
+
+    for (u32 DigitId = 0; DigitId < CPU_SORT_RADIX; ++DigitId)
+    {
+        Copy(BufferKeys[DigitId], DstKeys + Offsets[DigitId], sizeof(u32) * BufferCounts[DigitId]);
+        Copy(BufferPayload[DigitId], DstPayload + Offsets[DigitId], sizeof(u32) * BufferCounts[DigitId]);
+    }
+}
+
+inline void CpuSortScatter64(u64* SrcKeys, u32* SrcPayload, u64* DstKeys, u32* DstPayload, u32 StartId, u32 EndId, u32 Shift,
+                             u32* Offsets)
+{
+    u64 BufferKeys[CPU_SORT_RADIX][CPU_SORT_WC_SIZE];
+    u32 BufferPayload[CPU_SORT_RADIX][CPU_SORT_WC_SIZE];
+    u32 BufferCounts[CPU_SORT_RADIX] = {};
+
+    for (u32 KeyId = StartId; KeyId < EndId; ++KeyId)
+    {
+        u64 Key = SrcKeys[KeyId];
+        u32 Digit = u32(Key >> Shift) & (CPU_SORT_RADIX - 1);
+        u32 SlotId = BufferCounts[Digit]++;
+        BufferKeys[Digit][SlotId] = Key;
+        BufferPayload[Digit][SlotId] = SrcPayload[KeyId];
+
+        if (SlotId + 1 == CPU_SORT_WC_SIZE)
+        {
+            Copy(BufferKeys[Digit], DstKeys + Offsets[Digit], sizeof(u64) * CPU_SORT_WC_SIZE);
+            Copy(BufferPayload[Digit], DstPayload + Offsets[Digit], sizeof(u32) * CPU_SORT_WC_SIZE);
+            Offsets[Digit] += CPU_SORT_WC_SIZE;
+            BufferCounts[Digit] = 0;
+        }
+    }
+
+    for (u32 DigitId = 0; DigitId < CPU_SORT_RADIX; ++DigitId)
+    {
+        Copy(BufferKeys[DigitId], DstKeys + Offsets[DigitId], sizeof(u64) * BufferCounts[DigitId]);
+        Copy(BufferPayload[DigitId], DstPayload + Offsets[DigitId], sizeof(u32) * BufferCounts[DigitId]);
+    }
+}
+
+inline void CpuSortWorker(cpu_sort_job* Job, u32 ThreadId)
+{
+    u32 StartId = u32(u64(Job->NumKeys) * ThreadId / Job->NumThreads);
+    u32 EndId = u32(u64(Job->NumKeys) * (ThreadId + 1) / Job->NumThreads);
+
+    void* SrcKeys = Job->Keys;
+    u32* SrcPayload = Job->Payload;
+    void* DstKeys = Job->ScratchKeys;
+    u32* DstPayload = Job->ScratchPayload;
+
+    for (u32 Shift = 0; Shift < 8 * Job->KeySize; Shift += CPU_SORT_RADIX_BITS)
+    {
+        if (Job->KeySize == sizeof(u64))
+        {
+            CpuSortCount64((u64*)SrcKeys, StartId, EndId, Shift, Job->Counts[ThreadId]);
+        }
+        else
+        {
+            CpuSortCount32((u32*)SrcKeys, StartId, EndId, Shift, Job->Counts[ThreadId]);
+        }
+
+        CpuSortBarrier(Job);
+
+        // NOTE: Digits are laid out one after the other and every digit is split by thread in chunk order, which keeps the sort
+        // stable. Each thread only needs its own offsets so they all scan the counts on their own
+        u32 Offsets[CPU_SORT_RADIX];
+        b32 SkipPass = false;
+        {
+            u32 Sum = 0;
+            for (u32 DigitId = 0; DigitId < CPU_SORT_RADIX; ++DigitId)
+            {
+                u32 DigitCount = 0;
+                for (u32 CountThreadId = 0; CountThreadId < Job->NumThreads; ++CountThreadId)
+                {
+                    if (CountThreadId == ThreadId)
+                    {
+                        Offsets[DigitId] = Sum + DigitCount;
+                    }
+                    DigitCount += Job->Counts[CountThreadId][DigitId];
+                }
+
+                SkipPass = SkipPass || DigitCount == Job->NumKeys;
+                Sum += DigitCount;
+            }
+        }
+
+        if (!SkipPass)
+        {
+            if (Job->KeySize == sizeof(u64))
+            {
+                CpuSortScatter64((u64*)SrcKeys, SrcPayload, (u64*)DstKeys, DstPayload, StartId, EndId, Shift, Offsets);
+            }
+            else
+            {
+                CpuSortScatter32((u32*)SrcKeys, SrcPayload, (u32*)DstKeys, DstPayload, StartId, EndId, Shift, Offsets);
+            }
+
+            std::swap(SrcKeys, DstKeys);
+            std::swap(SrcPayload, DstPayload);
+        }
+
+        // NOTE: The next pass reads the scattered keys and overwrites the counts
+        CpuSortBarrier(Job);
+    }
+
+    // NOTE: Skipped passes can leave the result in the scratch arrays
+    if (SrcKeys != Job->Keys)
+    {
+        Copy((u8*)SrcKeys + Job->KeySize * StartId, (u8*)Job->Keys + Job->KeySize * StartId, Job->KeySize * (EndId - StartId));
+        Copy(SrcPayload + StartId, Job->Payload + StartId, sizeof(u32) * (EndId - StartId));
+    }
+}
+
+DWORD WINAPI CpuSortThreadEntry(LPVOID Param)
+{
+    cpu_sort_thread* Thread = (cpu_sort_thread*)Param;
+    CpuSortWorker(Thread->Job, Thread->ThreadId);
+    return 0;
+}
+
+inline void CpuRadixSortRun(u32 KeySize, u32 NumKeys, void* Keys, u32* Payload, void* ScratchKeys, u32* ScratchPayload)
+{
+    if (NumKeys <= 1)
+    {
+        return;
+    }
+
+    SYSTEM_INFO SystemInfo = {};
+    GetSystemInfo(&SystemInfo);
+    u32 NumThreads = Min(u32(SystemInfo.dwNumberOfProcessors), u32(CPU_SORT_MAX_THREADS));
+    NumThreads = Max(1u, Min(NumThreads, NumKeys / CPU_SORT_MIN_KEYS_PER_THREAD));
+
+    cpu_sort_job Job = {};
+    Job.NumKeys = NumKeys;
+    Job.NumThreads = NumThreads;
+    Job.KeySize = KeySize;
+    Job.Keys = Keys;
+    Job.Payload = Payload;
+    Job.ScratchKeys = ScratchKeys;
+    Job.ScratchPayload = ScratchPayload;
+
+    // NOTE: The calling thread sorts the first chunk
+    cpu_sort_thread Threads[CPU_SORT_MAX_THREADS];
+    HANDLE ThreadHandles[CPU_SORT_MAX_THREADS];
+    if (NumThreads > 1)
+    {
+        InitializeSynchronizationBarrier(&Job.Barrier, NumThreads, -1);
+        for (u32 ThreadId = 1; ThreadId < NumThreads; ++ThreadId)
+        {
+            Threads[ThreadId].Job = &Job;
+            Threads[ThreadId].ThreadId = ThreadId;
+            ThreadHandles[ThreadId - 1] = CreateThread(0, 0, CpuSortThreadEntry, &Threads[ThreadId], 0, 0);
+        }
+    }
+
+    CpuSortWorker(&Job, 0);
+
+    if (NumThreads > 1)
+    {
+        WaitForMultipleObjects(NumThreads - 1, ThreadHandles, TRUE, INFINITE);
+        for (u32 ThreadId = 1; ThreadId < NumThreads; ++ThreadId)
+        {
+            CloseHandle(ThreadHandles[ThreadId - 1]);
+        }
+        DeleteSynchronizationBarrier(&Job.Barrier);
+    }
+}
+
+inline void CpuRadixSort(u32 NumKeys, u32* Keys, u32* Payload, u32* ScratchKeys, u32* ScratchPayload)
+{
+    CpuRadixSortRun(sizeof(u32), NumKeys, Keys, Payload, ScratchKeys, ScratchPayload);
+}
+
+inline void CpuRadixSort64(u32 NumKeys, u64* Keys, u32* Payload, u64* ScratchKeys, u32* ScratchPayload)
+{
+    CpuRadixSortRun(sizeof(u64), NumKeys, Keys, Payload, ScratchKeys, ScratchPayload);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+//
+// NOTE: Cpu Radix Sort
+//
+
+/*
+  NOTE: Multi threaded LSD radix sort for u32 or u64 keys with u32 payloads, for host side code that has to sort at scale. The sort
+        is stable, so filling the payload with CpuSortIdentityPayload first gives the same ElementReMapping the GPU sorts produce, the
+        original index of every sorted key. Only needs windows.h and the base types so tools outside the demo can include it too.
+
+        Every pass, each thread counts the digits of its own chunk of keys into its own histogram, 4 keys at a time with SSE. Each
+        thread then builds its own scatter offsets from all the histograms, so the prefix has no serial step, and scatters its chunk
+        through small per digit write combining buffers that get written out a cache line at a time. Passes where every key has the
+        same digit get skipped.
+ */
+
+#define CPU_SORT_RADIX_BITS 8
+#define CPU_SORT_RADIX (1 << CPU_SORT_RADIX_BITS)
+#define CPU_SORT_MAX_THREADS 32
+// NOTE: Below this many keys per thread, starting the threads costs more than they save
+#define CPU_SORT_MIN_KEYS_PER_THREAD 65536
+// NOTE: Keys per digit we buffer before writing them out, 16 u32 keys fill a 64 byte cache line
+#define CPU_SORT_WC_SIZE 16
+
+struct cpu_sort_job
+{
+    u32 NumKeys;
+    u32 NumThreads;
+    u32 KeySize;
+    void* Keys;
+    u32* Payload;
+    void* ScratchKeys;
+    u32* ScratchPayload;
+
+    SYNCHRONIZATION_BARRIER Barrier;
+    // NOTE: Digit counts of every thread's chunk for the current pass
+    u32 Counts[CPU_SORT_MAX_THREADS][CPU_SORT_RADIX];
+};
+
+struct cpu_sort_thread
+{
+    cpu_sort_job* Job;
+    u32 ThreadId;
+};
@@ -1,8 +1,9 @@
 
 #include "huge_graphs_demo.h"
 
-#define FFX_CPP
-#include "FFX_ParallelSort.h"
+#include "huge_graphs_cpu_sort.cpp"
+#include "huge_graphs_fmm.cpp"
+#include "huge_graphs_sort.cpp"
 
 /*
 
@@ -130,44 +131,170 @@ inline void GraphNodeInit(f32 Degree, v3 Color, f32 Scale, v2* NodePos, f32* Nod
     NodeDraw->Scale = Scale;
 }
 
+inline void GraphLevelFusedDescriptorsCreate(graph_level* Level)
+{
+    // NOTE: State 0 lives in the level's positions and the prev forces, so it matches what the unfused path leaves behind. State 1
+    // lives in scratch buffers that all levels share
+#if GRAPH_PACKED_NODE_STATE
+    VkBuffer PosBuffers[2] = { Level->NodeStateBuffer, DemoState->FusedPosBuffer };
+    VkBuffer ForceBuffers[2] = { DemoState->NodePrevForceHalfBuffer, DemoState->NodeForceBuffer };
+#else
+    VkBuffer PosBuffers[2] = { Level->NodePosBuffer, DemoState->FusedPosBuffer };
+    VkBuffer ForceBuffers[2] = { DemoState->NodePrevForceBuffer, DemoState->NodeForceBuffer };
+#endif
+    for (u32 StateId = 0; StateId < 2; ++StateId)
+    {
+        u32 OtherStateId = 1 - StateId;
+        VkDescriptorSet Descriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->FusedDescLayout);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, PosBuffers[StateId]);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, ForceBuffers[StateId]);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FusedSwingBuffers[StateId]);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, PosBuffers[OtherStateId]);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, ForceBuffers[OtherStateId]);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FusedSwingBuffers[OtherStateId]);
+        Level->FusedDescriptors[StateId] = Descriptor;
+    }
+}
+
+inline u32 GraphAppendCapacity(u32 Count, u32 MinSpare)
+{
+    u32 Result = Count + Max(MinSpare, u32(GRAPH_APPEND_SPARE_FRACTION * f32(Count)));
+    return Result;
+}
+
+// NOTE: Without the packed node state we still bind these buffers, so give them a minimal size
+inline u64 GraphNodeStateSize(u32 NumNodes)
+{
+    u64 Result = GRAPH_PACKED_NODE_STATE ? GRAPH_NODE_STATE_FLOATS * sizeof(f32) * NumNodes : sizeof(v4);
+    return Result;
+}
+
+inline u64 GraphNodePrevForceHalfSize(u32 NumNodes)
+{
+    u64 Result = GRAPH_PACKED_NODE_STATE ? sizeof(u32) * NumNodes : sizeof(v4);
+    return Result;
+}
+
 inline void GraphCreateBuffers(u32 NumNodes, u32 NumEdges)
 {
+    // NOTE: Leave room for GraphAppend in every node and edge sized buffer
+    u32 MaxNumNodes = GraphAppendCapacity(NumNodes, GRAPH_APPEND_MIN_SPARE_NODES);
+    u32 MaxNumEdges = GraphAppendCapacity(NumEdges * 2, GRAPH_APPEND_MIN_SPARE_EDGES);
+
+    // NOTE: Out of core we can't append, and the edge sized buffers only keep a minimal size since we still bind them
+    u64 ResidentEdgeSize = u64(MaxNumEdges) * (sizeof(graph_edge) + sizeof(u32) + sizeof(f32));
+    DemoState->OutOfCoreEnabled = GRAPH_FORCE_OUT_OF_CORE || ResidentEdgeSize > GRAPH_RESIDENT_EDGE_BUDGET;
+    if (DemoState->OutOfCoreEnabled)
+    {
+        MaxNumEdges = NumEdges * 2;
+    }
+    u32 NumResidentEdges = DemoState->OutOfCoreEnabled ? 1 : MaxNumEdges;
+    
+    DemoState->MaxNumGraphNodes = MaxNumNodes;
+    DemoState->MaxNumGraphEdges = MaxNumEdges;
+    
     DemoState->GraphGlobalsBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                                    sizeof(graph_globals));
+    // NOTE: FmmGpuReferenceTest reads the positions and degrees back
     DemoState->NodePosBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                              sizeof(v2) * DemoState->NumGraphNodes);
+                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                              VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                              sizeof(v2) * MaxNumNodes);
     DemoState->NodeDegreeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                 sizeof(f32) * DemoState->NumGraphNodes);
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                 sizeof(f32) * MaxNumNodes);
     DemoState->NodeCellIdBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                 sizeof(u32) * DemoState->NumGraphNodes);
+                                                 sizeof(u32) * MaxNumNodes);
     DemoState->NodeForceBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                sizeof(v2) * DemoState->NumGraphNodes);
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                sizeof(v2) * MaxNumNodes);
     DemoState->NodePrevForceBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                    sizeof(v2) * DemoState->NumGraphNodes);
+                                                    sizeof(v2) * MaxNumNodes);
+    DemoState->NodeStateBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                GraphNodeStateSize(MaxNumNodes));
+    DemoState->NodePrevForceHalfBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                        GraphNodePrevForceHalfSize(MaxNumNodes));
     DemoState->NodeEdgeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                               sizeof(graph_node_edges) * DemoState->NumGraphNodes);
+                                               sizeof(graph_node_edges) * MaxNumNodes);
     DemoState->EdgeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                           sizeof(graph_edge) * NumEdges * 2);
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           sizeof(graph_edge) * NumResidentEdges);
+    DemoState->EdgeSourceBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                 sizeof(u32) * NumResidentEdges);
+    VkBuffer EdgeCoefficientBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                    sizeof(f32) * NumResidentEdges);
+    VkBuffer NodeGravityBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                sizeof(f32) * MaxNumNodes);
+    DemoState->AttractionCarryBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                      2 * sizeof(v2) * DispatchSize(NumResidentEdges, ATTRACTION_EDGES_PER_GROUP));
     DemoState->NodeDrawBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                               sizeof(graph_node_draw) * DemoState->NumGraphNodes);
+                                               sizeof(graph_node_draw) * MaxNumNodes);
     DemoState->GlobalMoveBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                                  sizeof(global_move));
+    // NOTE: The fused layout kernel writes 1 partial per 32 nodes, plus the padding groups of a 64 x Y dispatch
     DemoState->GlobalMoveReductionBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                          (NumNodes + CeilU32(f32(NumNodes) / 32.0f)) * sizeof(v2));
+                                                          (DispatchSize(MaxNumNodes, 32) + 64) * sizeof(global_move_reduction));
     DemoState->GlobalMoveCounterBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                                         sizeof(global_move_counters));
+    DemoState->NodeActiveBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(u32) * MaxNumNodes);
+    DemoState->ActiveNodeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(u32) * MaxNumNodes);
+    DemoState->ActiveSetBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                sizeof(graph_active_set));
+    // NOTE: Has the same layout as the positions of state 0, see GraphLevelFusedDescriptorsCreate
+    DemoState->FusedPosBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                               (GRAPH_PACKED_NODE_STATE ? GRAPH_NODE_STATE_FLOATS * sizeof(f32) : sizeof(v2)) * MaxNumNodes);
+    for (u32 StateId = 0; StateId < ArrayCount(DemoState->FusedSwingBuffers); ++StateId)
+    {
+        DemoState->FusedSwingBuffers[StateId] = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(f32) * MaxNumNodes);
+    }
+
+    // NOTE: The CPU reads the stats of the last iteration to detect convergence, so keep them in host visible memory
+    {
+        VkDeviceMemory GpuMemory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, sizeof(global_move_stats));
+        DemoState->GlobalMoveStatsBuffer = VkBufferCreate(RenderState->Device, GpuMemory, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                          sizeof(global_move_stats));
+        VkCheckResult(vkMapMemory(RenderState->Device, GpuMemory, 0, sizeof(global_move_stats), 0, (void**)&DemoState->GlobalMoveStatsCpu));
+        *DemoState->GlobalMoveStatsCpu = {};
+    }
+
+    // NOTE: GraphAppend writes its data into a persistent staging buffer and copies it to offsets inside the graph buffers
+    {
+        VkDeviceMemory GpuMemory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, GRAPH_APPEND_STAGING_SIZE);
+        DemoState->AppendStagingBuffer = VkBufferCreate(RenderState->Device, GpuMemory, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                        GRAPH_APPEND_STAGING_SIZE);
+        VkCheckResult(vkMapMemory(RenderState->Device, GpuMemory, 0, GRAPH_APPEND_STAGING_SIZE, 0, (void**)&DemoState->AppendStagingCpu));
+    }
+    // NOTE: Out of core, level 0's edges and their sources live in host visible memory that we copy the shards out of
+    if (DemoState->OutOfCoreEnabled)
+    {
+        u64 EdgeStoreSize = sizeof(graph_edge) * u64(MaxNumEdges);
+        VkDeviceMemory EdgeMemory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, EdgeStoreSize);
+        DemoState->EdgeStoreBuffer = VkBufferCreate(RenderState->Device, EdgeMemory, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, EdgeStoreSize);
+        VkCheckResult(vkMapMemory(RenderState->Device, EdgeMemory, 0, EdgeStoreSize, 0, (void**)&DemoState->EdgeStoreCpu));
+
+        u64 EdgeSourceStoreSize = sizeof(u32) * u64(MaxNumEdges);
+        VkDeviceMemory EdgeSourceMemory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, EdgeSourceStoreSize);
+        DemoState->EdgeSourceStoreBuffer = VkBufferCreate(RenderState->Device, EdgeSourceMemory, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, EdgeSourceStoreSize);
+        VkCheckResult(vkMapMemory(RenderState->Device, EdgeSourceMemory, 0, EdgeSourceStoreSize, 0, (void**)&DemoState->EdgeSourceStoreCpu));
+    }
+    DemoState->NodeEdgesCpu = PushArray(&DemoState->Arena, graph_node_edges, MaxNumNodes);
+    DemoState->NodeEdgeReserveCpu = PushArray(&DemoState->Arena, u32, MaxNumNodes);
                 
     DemoState->GraphDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->GraphDescLayout);
     VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, DemoState->GraphGlobalsBuffer);
@@ -182,6 +309,546 @@ inline void GraphCreateBuffers(u32 NumNodes, u32 NumEdges)
     VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 11, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GlobalMoveBuffer);
     VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GlobalMoveReductionBuffer);
     VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 13, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GlobalMoveCounterBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 14, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeSourceBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 15, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->AttractionCarryBuffer);
+
+    // NOTE: We only have 1 level until GraphLevelsInit coarsens the graph, so the prolong bindings point at our own buffers
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 16, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodeCellIdBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 17, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodePosBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 18, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GlobalMoveStatsBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 19, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodeActiveBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 20, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ActiveNodeBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 21, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ActiveSetBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 22, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodeStateBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 23, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodePrevForceHalfBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 24, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodeStateBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 25, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, EdgeCoefficientBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 26, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NodeGravityBuffer);
+
+    graph_level* Level = DemoState->GraphLevels + 0;
+    *Level = {};
+    Level->NumNodes = NumNodes;
+    Level->Descriptor = DemoState->GraphDescriptor;
+    Level->NodePosBuffer = DemoState->NodePosBuffer;
+    Level->NodeDegreeBuffer = DemoState->NodeDegreeBuffer;
+    Level->NodeStateBuffer = DemoState->NodeStateBuffer;
+    Level->NodeEdgeBuffer = DemoState->NodeEdgeBuffer;
+    Level->EdgeBuffer = DemoState->EdgeBuffer;
+    Level->EdgeSourceBuffer = DemoState->EdgeSourceBuffer;
+    Level->EdgeCoefficientBuffer = EdgeCoefficientBuffer;
+    Level->NodeGravityBuffer = NodeGravityBuffer;
+    GraphLevelFusedDescriptorsCreate(Level);
+    DemoState->NumGraphLevels = 1;
+    DemoState->CurrGraphLevel = 0;
+    DemoState->CurrLevelIterations = 0;
+}
+
+inline void GraphDrawEdgesCreate(u32 NumDrawEdges)
+{
+    DemoState->NumGraphDrawEdges = NumDrawEdges;
+    DemoState->MaxNumGraphDrawEdges = GraphAppendCapacity(NumDrawEdges, GRAPH_APPEND_MIN_SPARE_EDGES);
+    if (DemoState->OutOfCoreEnabled)
+    {
+        // NOTE: Loaders stop writing draw edges once they reach this count
+        DemoState->NumGraphDrawEdges = Min(NumDrawEdges, u32(GRAPH_OUT_OF_CORE_DRAW_EDGES));
+        DemoState->MaxNumGraphDrawEdges = Max(DemoState->NumGraphDrawEdges, 1u);
+    }
+    DemoState->EdgeIndexBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                sizeof(u32) * 2 * DemoState->MaxNumGraphDrawEdges);
+    DemoState->EdgeColorBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                sizeof(u32) * DemoState->MaxNumGraphDrawEdges);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeIndexBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeColorBuffer);
+}
+
+inline b32 GraphLevelOutOfCore(graph_level* Level)
+{
+    b32 Result = DemoState->OutOfCoreEnabled && Level == DemoState->GraphLevels + 0;
+    return Result;
+}
+
+inline graph_edge* GraphEdgesWriteArray(vk_commands* Commands, u32 NumEdges)
+{
+    // NOTE: Loaders write level 0's edges through here so that out of core they land in the host edge store
+    graph_edge* Result = 0;
+    if (DemoState->OutOfCoreEnabled)
+    {
+        Assert(NumEdges <= DemoState->MaxNumGraphEdges);
+        Result = DemoState->EdgeStoreCpu;
+    }
+    else
+    {
+        Result = VkCommandsPushWriteArray(Commands, DemoState->EdgeBuffer, graph_edge, NumEdges,
+                                          BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                          BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    }
+
+    return Result;
+}
+
+inline void GraphEdgeSourcesInit(vk_commands* Commands, graph_level* Level, graph_node_edges* NodeEdges)
+{
+    // NOTE: The edge parallel attraction needs to know which node owns each edge
+    if (Level->NumEdges == 0)
+    {
+        return;
+    }
+
+    u32* EdgeSourceGpu = 0;
+    if (GraphLevelOutOfCore(Level))
+    {
+        EdgeSourceGpu = DemoState->EdgeSourceStoreCpu;
+    }
+    else
+    {
+        EdgeSourceGpu = VkCommandsPushWriteArray(Commands, Level->EdgeSourceBuffer, u32, Level->NumEdges,
+                                                 BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                 BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    }
+    for (u32 NodeId = 0; NodeId < Level->NumNodes; ++NodeId)
+    {
+        for (u32 EdgeId = NodeEdges[NodeId].StartConnections; EdgeId < NodeEdges[NodeId].EndConnections; ++EdgeId)
+        {
+            EdgeSourceGpu[EdgeId] = NodeId;
+        }
+    }
+}
+
+/*
+  NOTE: Builds the level above FineLevelId by collapsing every degree 1 node (most hashtags) into its only neighbour and then greedily
+        matching the remaining nodes along their heaviest edge. Coarse nodes get the summed mass of their fine nodes, parallel edges get
+        merged by summing their weights. The pointers we are passed are updated to point at the new level's data so that the next
+        call can coarsen it further. Returns false if the level wouldn't shrink the graph enough to be worth laying out.
+ */
+inline b32 GraphLevelCoarsen(vk_commands* Commands, u32 FineLevelId, v2** NodePos, f32** NodeDegree, graph_node_edges** NodeEdges, graph_edge** Edges)
+{
+    b32 Result = false;
+    temp_mem TempMem = BeginTempMem(&DemoState->TempArena);
+
+    graph_level* FineLevel = DemoState->GraphLevels + FineLevelId;
+    graph_level* CoarseLevel = DemoState->GraphLevels + FineLevelId + 1;
+    v2* FineNodePos = *NodePos;
+    f32* FineNodeDegree = *NodeDegree;
+    graph_node_edges* FineNodeEdges = *NodeEdges;
+    graph_edge* FineEdges = *Edges;
+    
+    // NOTE: Every fine node either is the root of a coarse node or points to the node it got merged into
+    u32* Leader = PushArray(&DemoState->TempArena, u32, FineLevel->NumNodes);
+    b32* Matched = PushArray(&DemoState->TempArena, b32, FineLevel->NumNodes);
+    for (u32 NodeId = 0; NodeId < FineLevel->NumNodes; ++NodeId)
+    {
+        Leader[NodeId] = 0xFFFFFFFF;
+        Matched[NodeId] = false;
+    }
+
+    // NOTE: Collapse degree 1 nodes into their neighbour
+    for (u32 NodeId = 0; NodeId < FineLevel->NumNodes; ++NodeId)
+    {
+        graph_node_edges CurrEdges = FineNodeEdges[NodeId];
+        if ((CurrEdges.EndConnections - CurrEdges.StartConnections) == 1)
+        {
+            u32 OtherNodeId = FineEdges[CurrEdges.StartConnections].OtherNodeId;
+            graph_node_edges OtherEdges = FineNodeEdges[OtherNodeId];
+            if ((OtherEdges.EndConnections - OtherEdges.StartConnections) > 1)
+            {
+                Leader[NodeId] = OtherNodeId;
+                Matched[NodeId] = true;
+            }
+        }
+    }
+
+    // NOTE: Heavy edge matching for everything else
+    for (u32 NodeId = 0; NodeId < FineLevel->NumNodes; ++NodeId)
+    {
+        if (Matched[NodeId])
+        {
+            continue;
+        }
+
+        u32 BestNodeId = 0xFFFFFFFF;
+        f32 BestWeight = 0.0f;
+        graph_node_edges CurrEdges = FineNodeEdges[NodeId];
+        for (u32 EdgeId = CurrEdges.StartConnections; EdgeId < CurrEdges.EndConnections; ++EdgeId)
+        {
+            graph_edge CurrEdge = FineEdges[EdgeId];
+            if (CurrEdge.OtherNodeId != NodeId && !Matched[CurrEdge.OtherNodeId] && CurrEdge.Weight > BestWeight)
+            {
+                BestNodeId = CurrEdge.OtherNodeId;
+                BestWeight = CurrEdge.Weight;
+            }
+        }
+
+        if (BestNodeId != 0xFFFFFFFF)
+        {
+            Leader[BestNodeId] = NodeId;
+            Matched[BestNodeId] = true;
+            Matched[NodeId] = true;
+        }
+    }
+
+    // NOTE: Number the coarse nodes. Leaders are at most 2 hops away (leaf -> matched node -> root)
+    u32* CoarseNodeIds = PushArray(&DemoState->TempArena, u32, FineLevel->NumNodes);
+    u32 NumCoarseNodes = 0;
+    for (u32 NodeId = 0; NodeId < FineLevel->NumNodes; ++NodeId)
+    {
+        if (Leader[NodeId] == 0xFFFFFFFF)
+        {
+            CoarseNodeIds[NodeId] = NumCoarseNodes++;
+        }
+    }
+    for (u32 NodeId = 0; NodeId < FineLevel->NumNodes; ++NodeId)
+    {
+        u32 RootId = NodeId;
+        while (Leader[RootId] != 0xFFFFFFFF)
+        {
+            RootId = Leader[RootId];
+        }
+        CoarseNodeIds[NodeId] = CoarseNodeIds[RootId];
+    }
+
+    if (NumCoarseNodes > 0 && f32(NumCoarseNodes) < 0.9f * f32(FineLevel->NumNodes))
+    {
+        Result = true;
+        
+        // NOTE: Bucket the fine nodes by their coarse node
+        u32* MemberOffsets = PushArray(&DemoState->TempArena, u32, NumCoarseNodes + 1);
+        u32* MemberCursors = PushArray(&DemoState->TempArena, u32, NumCoarseNodes);
+        u32* Members = PushArray(&DemoState->TempArena, u32, FineLevel->NumNodes);
+        for (u32 CoarseNodeId = 0; CoarseNodeId <= NumCoarseNodes; ++CoarseNodeId)
+        {
+            MemberOffsets[CoarseNodeId] = 0;
+        }
+        for (u32 NodeId = 0; NodeId < FineLevel->NumNodes; ++NodeId)
+        {
+            MemberOffsets[CoarseNodeIds[NodeId] + 1] += 1;
+        }
+        for (u32 CoarseNodeId = 0; CoarseNodeId < NumCoarseNodes; ++CoarseNodeId)
+        {
+            MemberOffsets[CoarseNodeId + 1] += MemberOffsets[CoarseNodeId];
+            MemberCursors[CoarseNodeId] = MemberOffsets[CoarseNodeId];
+        }
+        for (u32 NodeId = 0; NodeId < FineLevel->NumNodes; ++NodeId)
+        {
+            Members[MemberCursors[CoarseNodeIds[NodeId]]++] = NodeId;
+        }
+
+        *CoarseLevel = {};
+        CoarseLevel->NumNodes = NumCoarseNodes;
+        CoarseLevel->NodePosBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                    sizeof(v2) * NumCoarseNodes);
+        CoarseLevel->NodeDegreeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                       sizeof(f32) * NumCoarseNodes);
+        CoarseLevel->NodeStateBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, GraphNodeStateSize(NumCoarseNodes));
+        CoarseLevel->NodeEdgeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                     sizeof(graph_node_edges) * NumCoarseNodes);
+        FineLevel->CoarseNodeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                     sizeof(u32) * FineLevel->NumNodes);
+
+        v2* CoarseNodePos = VkCommandsPushWriteArray(Commands, CoarseLevel->NodePosBuffer, v2, NumCoarseNodes,
+                                                     BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                     BarrierMask(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+        f32* CoarseNodeDegree = VkCommandsPushWriteArray(Commands, CoarseLevel->NodeDegreeBuffer, f32, NumCoarseNodes,
+                                                         BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                         BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+        graph_node_edges* CoarseNodeEdges = VkCommandsPushWriteArray(Commands, CoarseLevel->NodeEdgeBuffer, graph_node_edges, NumCoarseNodes,
+                                                                     BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                                     BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+        u32* CoarseNodeIdsGpu = VkCommandsPushWriteArray(Commands, FineLevel->CoarseNodeBuffer, u32, FineLevel->NumNodes,
+                                                         BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                         BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+        Copy(CoarseNodeIds, CoarseNodeIdsGpu, sizeof(u32) * FineLevel->NumNodes);
+        
+        // NOTE: Merge the edges of every coarse node, dropping edges that became self loops
+        graph_edge* CoarseEdges = PushArray(&DemoState->TempArena, graph_edge, Max(FineLevel->NumEdges, 1u));
+        u32* EdgeSlots = PushArray(&DemoState->TempArena, u32, NumCoarseNodes);
+        u32* EdgeSlotOwners = PushArray(&DemoState->TempArena, u32, NumCoarseNodes);
+        for (u32 CoarseNodeId = 0; CoarseNodeId < NumCoarseNodes; ++CoarseNodeId)
+        {
+            EdgeSlotOwners[CoarseNodeId] = 0xFFFFFFFF;
+        }
+
+        for (u32 CoarseNodeId = 0; CoarseNodeId < NumCoarseNodes; ++CoarseNodeId)
+        {
+            CoarseNodePos[CoarseNodeId] = FineNodePos[Members[MemberOffsets[CoarseNodeId]]];
+            CoarseNodeDegree[CoarseNodeId] = 0.0f;
+            CoarseNodeEdges[CoarseNodeId].StartConnections = CoarseLevel->NumEdges;
+
+            for (u32 MemberId = MemberOffsets[CoarseNodeId]; MemberId < MemberOffsets[CoarseNodeId + 1]; ++MemberId)
+            {
+                u32 FineNodeId = Members[MemberId];
+                CoarseNodeDegree[CoarseNodeId] += FineNodeDegree[FineNodeId];
+
+                graph_node_edges CurrEdges = FineNodeEdges[FineNodeId];
+                for (u32 EdgeId = CurrEdges.StartConnections; EdgeId < CurrEdges.EndConnections; ++EdgeId)
+                {
+                    u32 OtherCoarseNodeId = CoarseNodeIds[FineEdges[EdgeId].OtherNodeId];
+                    if (OtherCoarseNodeId == CoarseNodeId)
+                    {
+                        continue;
+                    }
+
+                    if (EdgeSlotOwners[OtherCoarseNodeId] == CoarseNodeId)
+                    {
+                        CoarseEdges[EdgeSlots[OtherCoarseNodeId]].Weight += FineEdges[EdgeId].Weight;
+                    }
+                    else
+                    {
+                        EdgeSlotOwners[OtherCoarseNodeId] = CoarseNodeId;
+                        EdgeSlots[OtherCoarseNodeId] = CoarseLevel->NumEdges;
+                        CoarseEdges[CoarseLevel->NumEdges].OtherNodeId = OtherCoarseNodeId;
+                        CoarseEdges[CoarseLevel->NumEdges].Weight = FineEdges[EdgeId].Weight;
+                        CoarseLevel->NumEdges += 1;
+                    }
+                }
+            }
+
+            CoarseNodeEdges[CoarseNodeId].EndConnections = CoarseLevel->NumEdges;
+        }
+
+        CoarseLevel->EdgeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                 sizeof(graph_edge) * Max(CoarseLevel->NumEdges, 1u));
+        CoarseLevel->EdgeSourceBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                       sizeof(u32) * Max(CoarseLevel->NumEdges, 1u));
+        CoarseLevel->EdgeCoefficientBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                            sizeof(f32) * Max(CoarseLevel->NumEdges, 1u));
+        CoarseLevel->NodeGravityBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                        sizeof(f32) * NumCoarseNodes);
+        graph_edge* CoarseEdgesGpu = 0;
+        if (CoarseLevel->NumEdges > 0)
+        {
+            CoarseEdgesGpu = VkCommandsPushWriteArray(Commands, CoarseLevel->EdgeBuffer, graph_edge, CoarseLevel->NumEdges,
+                                                      BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                      BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+            Copy(CoarseEdges, CoarseEdgesGpu, sizeof(graph_edge) * CoarseLevel->NumEdges);
+        }
+        GraphEdgeSourcesInit(Commands, CoarseLevel, CoarseNodeEdges);
+
+        // NOTE: Coarse levels share the per frame scratch buffers and render data with level 0 since we only ever simulate 1 level
+        CoarseLevel->Descriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->GraphDescLayout);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, DemoState->GraphGlobalsBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->NodePosBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->NodeDegreeBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodeCellIdBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodeForceBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodePrevForceBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->NodeEdgeBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->EdgeBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodeDrawBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeIndexBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeColorBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 11, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GlobalMoveBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GlobalMoveReductionBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 13, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GlobalMoveCounterBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 14, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->EdgeSourceBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 15, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->AttractionCarryBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 16, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodeCellIdBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 17, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->NodePosBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 18, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GlobalMoveStatsBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 19, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodeActiveBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 20, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ActiveNodeBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 21, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ActiveSetBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 22, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->NodeStateBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 23, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->NodePrevForceHalfBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 24, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->NodeStateBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 25, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->EdgeCoefficientBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, CoarseLevel->Descriptor, 26, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->NodeGravityBuffer);
+
+        GraphLevelFusedDescriptorsCreate(CoarseLevel);
+
+        // NOTE: Point the fine level's prolong bindings at us
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, FineLevel->Descriptor, 16, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, FineLevel->CoarseNodeBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, FineLevel->Descriptor, 17, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->NodePosBuffer);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, FineLevel->Descriptor, 24, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, CoarseLevel->NodeStateBuffer);
+
+        *NodePos = CoarseNodePos;
+        *NodeDegree = CoarseNodeDegree;
+        *NodeEdges = CoarseNodeEdges;
+        *Edges = CoarseEdgesGpu;
+    }
+    
+    EndTempMem(TempMem);
+    return Result;
+}
+
+/*
+  NOTE: Estimates the global memory traffic of 1 full layout iteration for the unpacked and packed node state. Streams count their bytes,
+        random neighbour gathers count a 32 byte sector per buffer they touch since that is the smallest unit the memory system moves.
+        Interleaved fields count the whole stride because the sectors we pull in also carry the fields we skip. This is a model, the
+        layout timer measures what the iterations actually take and GraphLayoutTrafficLog prints both.
+ */
+inline graph_layout_traffic GraphLayoutTrafficEstimate(u32 NumNodes, u32 NumEdges, b32 Packed)
+{
+    graph_layout_traffic Result = {};
+
+    u64 N = NumNodes;
+    u64 E = NumEdges;
+    u64 SectorSize = 32;
+    u64 StateStride = GRAPH_NODE_STATE_FLOATS * sizeof(f32);
+    u64 PosRead = Packed ? StateStride : sizeof(v2);
+    u64 DegreeRead = Packed ? StateStride : sizeof(f32);
+    u64 PosDegreeRead = Packed ? StateStride : sizeof(v2) + sizeof(f32);
+    u64 PrevForceSize = Packed ? sizeof(u32) : sizeof(v2);
+    
+    // NOTE: Stream the edges and their sources, gather 1 neighbour position per edge and write the forces
+    Result.Attraction = E * (sizeof(graph_edge) + sizeof(u32) + SectorSize) + N * (PosRead + sizeof(v2));
+
+    // NOTE: Node ranges, forces, position and degree for gravity
+    Result.MoveConnections = N * (sizeof(graph_node_edges) + 2 * sizeof(v2) + PosDegreeRead);
+
+    // NOTE: Every work group of 32 nodes streams the position and degree of all nodes
+    Result.Repulsion = DispatchSize(NumNodes, 32) * N * PosDegreeRead + N * (PosDegreeRead + 2 * sizeof(v2));
+
+    Result.GlobalSpeed = N * (sizeof(v2) + PrevForceSize + DegreeRead);
+
+    // NOTE: We only write the position part of the packed state
+    Result.UpdateNodes = N * (PosDegreeRead + sizeof(v2) + PrevForceSize) + N * (sizeof(v2) + PrevForceSize + sizeof(u32));
+
+    Result.Total = Result.Attraction + Result.MoveConnections + Result.Repulsion + Result.GlobalSpeed + Result.UpdateNodes;
+    return Result;
+}
+
+inline void GraphLayoutTrafficLog(u32 NumNodes, u32 NumEdges, f32 MeasuredMsPerIteration)
+{
+    graph_layout_traffic Unpacked = GraphLayoutTrafficEstimate(NumNodes, NumEdges, false);
+    graph_layout_traffic Packed = GraphLayoutTrafficEstimate(NumNodes, NumEdges, true);
+    
+    DebugPrintLog("Layout Bytes Per Iteration Estimate (%u nodes, %u edges), Unpacked vs Packed:\n", NumNodes, NumEdges);
+    DebugPrintLog("    Attraction: %llu, %llu\n", Unpacked.Attraction, Packed.Attraction);
+    DebugPrintLog("    Move Connections: %llu, %llu\n", Unpacked.MoveConnections, Packed.MoveConnections);
+    DebugPrintLog("    Repulsion: %llu, %llu\n", Unpacked.Repulsion, Packed.Repulsion);
+    DebugPrintLog("    Global Speed: %llu, %llu\n", Unpacked.GlobalSpeed, Packed.GlobalSpeed);
+    DebugPrintLog("    Update Nodes: %llu, %llu\n", Unpacked.UpdateNodes, Packed.UpdateNodes);
+    DebugPrintLog("    Total: %llu, %llu (%.3fx)\n", Unpacked.Total, Packed.Total, f32(Packed.Total) / f32(Unpacked.Total));
+
+    // NOTE: Only the layout we compiled gets measured, the bandwidth is against its estimate
+    u64 EstimatedBytes = GRAPH_PACKED_NODE_STATE ? Packed.Total : Unpacked.Total;
+    f32 GigaBytesPerSecond = f32(EstimatedBytes) / (MeasuredMsPerIteration * 1000000.0f);
+    DebugPrintLog("Layout Measured GPU Time (%s): %.4f ms per iteration, %.2f GB/s at the estimated bytes\n",
+                  GRAPH_PACKED_NODE_STATE ? "Packed" : "Unpacked", MeasuredMsPerIteration, GigaBytesPerSecond);
+}
+
+/*
+  NOTE: Splits level 0 into shards for the out of core mode. The loaders give every node the edge range right after the one of the
+        previous node, so a run of nodes owns a contiguous run of edges and we close a shard once the next node's edges wouldn't fit
+        in the window anymore. A node's edges never get split across shards, so the window grows to fit the biggest node.
+ */
+inline void GraphShardsInit(graph_node_edges* NodeEdges)
+{
+    u32 NumNodes = DemoState->NumGraphNodes;
+    u32 WindowEdges = GRAPH_SHARD_WINDOW_EDGES;
+    for (u32 NodeId = 0; NodeId < NumNodes; ++NodeId)
+    {
+        WindowEdges = Max(WindowEdges, NodeEdges[NodeId].EndConnections - NodeEdges[NodeId].StartConnections);
+    }
+    DemoState->ShardWindowEdges = WindowEdges;
+
+    // NOTE: Every 2 neighbouring shards hold more than a window of edges
+    u32 MaxNumShards = 2 * DispatchSize(DemoState->NumGraphEdges, WindowEdges) + 1;
+    DemoState->Shards = PushArray(&DemoState->Arena, graph_shard, MaxNumShards);
+    DemoState->NumShards = 0;
+    
+    graph_shard* CurrShard = 0;
+    u32 PrevEdgesEnd = 0;
+    for (u32 NodeId = 0; NodeId < NumNodes; ++NodeId)
+    {
+        graph_node_edges Edges = NodeEdges[NodeId];
+        b32 HasEdges = Edges.StartConnections < Edges.EndConnections;
+        if (!CurrShard || (HasEdges && CurrShard->NumEdges > 0 && Edges.EndConnections - CurrShard->FirstEdge > WindowEdges))
+        {
+            Assert(DemoState->NumShards < MaxNumShards);
+            CurrShard = DemoState->Shards + DemoState->NumShards++;
+            *CurrShard = {};
+            CurrShard->FirstNode = NodeId;
+        }
+
+        if (HasEdges)
+        {
+            Assert(Edges.StartConnections >= PrevEdgesEnd);
+            PrevEdgesEnd = Edges.EndConnections;
+            
+            if (CurrShard->NumEdges == 0)
+            {
+                CurrShard->FirstEdge = Edges.StartConnections;
+            }
+            CurrShard->NumEdges = Edges.EndConnections - CurrShard->FirstEdge;
+        }
+        CurrShard->NumNodes += 1;
+    }
+
+    for (u32 WindowId = 0; WindowId < ArrayCount(DemoState->ShardDescriptors); ++WindowId)
+    {
+        DemoState->ShardEdgeBuffers[WindowId] = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                               sizeof(graph_edge) * WindowEdges);
+        DemoState->ShardEdgeSourceBuffers[WindowId] = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                                     sizeof(u32) * WindowEdges);
+        DemoState->ShardCarryBuffers[WindowId] = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                                2 * sizeof(v2) * DispatchSize(WindowEdges, ATTRACTION_EDGES_PER_GROUP));
+
+        VkDescriptorSet Descriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->ShardDescLayout);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ShardEdgeBuffers[WindowId]);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ShardEdgeSourceBuffers[WindowId]);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ShardCarryBuffers[WindowId]);
+        DemoState->ShardDescriptors[WindowId] = Descriptor;
+        DemoState->ShardWindowIds[WindowId] = 0xFFFFFFFF;
+    }
+
+    DebugPrintLog("Out Of Core Layout: %u edges in %u shards with a window of %u edges\n", DemoState->NumGraphEdges, DemoState->NumShards, WindowEdges);
+}
+
+inline void GraphLevelsInit(vk_commands* Commands, v2* NodePos, f32* NodeDegree, graph_node_edges* NodeEdges, graph_edge* Edges)
+{
+    graph_level* Level = DemoState->GraphLevels + 0;
+    Level->NumNodes = DemoState->NumGraphNodes;
+    Level->NumEdges = DemoState->NumGraphEdges;
+    GraphEdgeSourcesInit(Commands, Level, NodeEdges);
+    if (DemoState->OutOfCoreEnabled)
+    {
+        GraphShardsInit(NodeEdges);
+    }
+
+    // NOTE: GraphAppend needs the node ranges to know where it can grow them
+    Copy(NodeEdges, DemoState->NodeEdgesCpu, sizeof(graph_node_edges) * DemoState->NumGraphNodes);
+    for (u32 NodeId = 0; NodeId < DemoState->NumGraphNodes; ++NodeId)
+    {
+        DemoState->NodeEdgeReserveCpu[NodeId] = NodeEdges[NodeId].EndConnections;
+    }
+
+    // NOTE: Out of core, level 0's edges live in the host edge store. That is staging memory which usually isn't host cached, so
+    // coarsening would read every edge back at uncached speed. We lay out level 0 directly instead
+    if (DemoState->MultilevelEnabled && !DemoState->OutOfCoreEnabled && Level->NumEdges > 0)
+    {
+        while (DemoState->NumGraphLevels < GRAPH_MAX_LEVELS &&
+               DemoState->GraphLevels[DemoState->NumGraphLevels - 1].NumNodes > GRAPH_MIN_LEVEL_NODES &&
+               GraphLevelCoarsen(Commands, DemoState->NumGraphLevels - 1, &NodePos, &NodeDegree, &NodeEdges, &Edges))
+        {
+            DemoState->NumGraphLevels += 1;
+        }
+    }
+
+    // NOTE: Start laying out the coarsest level
+    DemoState->CurrGraphLevel = DemoState->NumGraphLevels - 1;
+    DemoState->CurrLevelIterations = 0;
+    DemoState->NumActiveSetIterations = 0;
+    DemoState->MortonSortedNumNodes = 0;
+
+    // NOTE: The uploads above land in the unpacked buffers, GraphPackNodeState interleaves them once they are on the GPU
+    DemoState->NodeStateDirty = GRAPH_PACKED_NODE_STATE;
+    DemoState->AttractionCacheDirty = true;
+
+    // NOTE: The levels changed, so the layout timer starts over and logs the traffic once it measured a level
+    DemoState->LayoutTimerWritten = false;
+    DemoState->NumLayoutSamples = 0;
 }
 
 inline void GraphInitTest1(vk_commands* Commands)
@@ -212,9 +879,7 @@ inline void GraphInitTest1(vk_commands* Commands)
     graph_node_edges* NodeEdgeGpu = VkCommandsPushWriteArray(Commands, DemoState->NodeEdgeBuffer, graph_node_edges, DemoState->NumGraphNodes,
                                                              BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
                                                              BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-    graph_edge* EdgeGpu = VkCommandsPushWriteArray(Commands, DemoState->EdgeBuffer, graph_edge, MaxNumEdges,
-                                                   BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                   BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    graph_edge* EdgeGpu = GraphEdgesWriteArray(Commands, MaxNumEdges);
     graph_node_draw* NodeDrawGpu = VkCommandsPushWriteArray(Commands, DemoState->NodeDrawBuffer, graph_node_draw, DemoState->NumGraphNodes,
                                                             BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
                                                             BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
@@ -256,15 +921,7 @@ inline void GraphInitTest1(vk_commands* Commands)
 
         // NOTE: Save on memory since nodes are double represented for sim
         {
-            DemoState->NumGraphDrawEdges = DemoState->NumGraphEdges;
-            DemoState->EdgeIndexBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                        sizeof(u32) * 2 * DemoState->NumGraphDrawEdges);
-            DemoState->EdgeColorBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                        sizeof(u32) * DemoState->NumGraphDrawEdges);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeIndexBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeColorBuffer);
+            GraphDrawEdgesCreate(DemoState->NumGraphEdges);
         }
 
         // NOTE: Mirror the connections for black nodes now since GPUs don't support atomic float adds
@@ -298,7 +955,7 @@ inline void GraphInitTest1(vk_commands* Commands)
         {
             graph_node_edges CurrNodeEdges = NodeEdgeGpu[CurrNodeId];
 
-            for (u32 EdgeId = CurrNodeEdges.StartConnections; EdgeId < CurrNodeEdges.EndConnections; ++EdgeId)
+            for (u32 EdgeId = CurrNodeEdges.StartConnections; EdgeId < CurrNodeEdges.EndConnections && EdgeId < DemoState->NumGraphDrawEdges; ++EdgeId)
             {
                 u32 OtherNodeId = EdgeGpu[EdgeId].OtherNodeId;
 
@@ -309,6 +966,8 @@ inline void GraphInitTest1(vk_commands* Commands)
             }
         }
     }
+
+    GraphLevelsInit(Commands, NodePosGpu, NodeDegreeGpu, NodeEdgeGpu, EdgeGpu);
 }
 
 inline void GraphInitTest2(vk_commands* Commands)
@@ -346,9 +1005,7 @@ inline void GraphInitTest2(vk_commands* Commands)
     graph_node_edges* NodeEdgeGpu = VkCommandsPushWriteArray(Commands, DemoState->NodeEdgeBuffer, graph_node_edges, DemoState->NumGraphNodes,
                                                              BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
                                                              BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-    graph_edge* EdgeGpu = VkCommandsPushWriteArray(Commands, DemoState->EdgeBuffer, graph_edge, MaxNumEdges,
-                                                   BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                   BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    graph_edge* EdgeGpu = GraphEdgesWriteArray(Commands, MaxNumEdges);
     graph_node_draw* NodeDrawGpu = VkCommandsPushWriteArray(Commands, DemoState->NodeDrawBuffer, graph_node_draw, DemoState->NumGraphNodes,
                                                             BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
                                                             BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
@@ -441,15 +1098,7 @@ inline void GraphInitTest2(vk_commands* Commands)
         
         // NOTE: Save on memory since nodes are double represented for sim
         {
-            DemoState->NumGraphDrawEdges = DemoState->NumGraphEdges;
-            DemoState->EdgeIndexBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                        sizeof(u32) * 2 * DemoState->NumGraphDrawEdges);
-            DemoState->EdgeColorBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                        sizeof(u32) * DemoState->NumGraphDrawEdges);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeIndexBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeColorBuffer);
+            GraphDrawEdgesCreate(DemoState->NumGraphEdges);
         }
 
         // NOTE: Mirror the connections for black nodes now since GPUs don't support atomic float adds
@@ -517,7 +1166,7 @@ inline void GraphInitTest2(vk_commands* Commands)
         {
             graph_node_edges CurrNodeEdges = NodeEdgeGpu[CurrNodeId];
 
-            for (u32 EdgeId = CurrNodeEdges.StartConnections; EdgeId < CurrNodeEdges.EndConnections; ++EdgeId)
+            for (u32 EdgeId = CurrNodeEdges.StartConnections; EdgeId < CurrNodeEdges.EndConnections && EdgeId < DemoState->NumGraphDrawEdges; ++EdgeId)
             {
                 u32 OtherNodeId = EdgeGpu[EdgeId].OtherNodeId;
 
@@ -528,6 +1177,8 @@ inline void GraphInitTest2(vk_commands* Commands)
             }
         }
     }
+
+    GraphLevelsInit(Commands, NodePosGpu, NodeDegreeGpu, NodeEdgeGpu, EdgeGpu);
 }
 
 inline void GraphInitTest3(vk_commands* Commands)
@@ -554,9 +1205,7 @@ inline void GraphInitTest3(vk_commands* Commands)
     graph_node_edges* NodeEdgeGpu = VkCommandsPushWriteArray(Commands, DemoState->NodeEdgeBuffer, graph_node_edges, DemoState->NumGraphNodes,
                                                              BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
                                                              BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-    graph_edge* EdgeGpu = VkCommandsPushWriteArray(Commands, DemoState->EdgeBuffer, graph_edge, MaxNumEdges,
-                                                   BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                   BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    graph_edge* EdgeGpu = GraphEdgesWriteArray(Commands, MaxNumEdges);
     graph_node_draw* NodeDrawGpu = VkCommandsPushWriteArray(Commands, DemoState->NodeDrawBuffer, graph_node_draw, DemoState->NumGraphNodes,
                                                             BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
                                                             BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
@@ -566,20 +1215,15 @@ inline void GraphInitTest3(vk_commands* Commands)
     for (u32 NodeId = 0; NodeId < NumNodes; ++NodeId)
     {
         GraphNodeInit(0, V3(1, 0, 0), NodeSize, NodePosGpu + NodeId, NodeDegreeGpu + NodeId, NodeDrawGpu + NodeId);
+        NodeEdgeGpu[NodeId] = {};
     }
         
     // NOTE: Save on memory since nodes are double represented for sim
     {
-        DemoState->NumGraphDrawEdges = 1;
-        DemoState->EdgeIndexBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                    sizeof(u32) * 2 * DemoState->NumGraphDrawEdges);
-        DemoState->EdgeColorBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                    sizeof(u32) * DemoState->NumGraphDrawEdges);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeIndexBuffer);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeColorBuffer);
+        GraphDrawEdgesCreate(1);
     }
+
+    GraphLevelsInit(Commands, NodePosGpu, NodeDegreeGpu, NodeEdgeGpu, EdgeGpu);
 }
 
 inline void GraphInitFromFile(vk_commands* Commands)
@@ -609,9 +1253,7 @@ inline void GraphInitFromFile(vk_commands* Commands)
     graph_node_edges* NodeEdgeGpu = VkCommandsPushWriteArray(Commands, DemoState->NodeEdgeBuffer, graph_node_edges, DemoState->NumGraphNodes,
                                                              BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
                                                              BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-    graph_edge* EdgeGpu = VkCommandsPushWriteArray(Commands, DemoState->EdgeBuffer, graph_edge, FileHeader.NumEdges * 2,
-                                                   BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                   BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    graph_edge* EdgeGpu = GraphEdgesWriteArray(Commands, FileHeader.NumEdges * 2);
     graph_node_draw* NodeDrawGpu = VkCommandsPushWriteArray(Commands, DemoState->NodeDrawBuffer, graph_node_draw, DemoState->NumGraphNodes,
                                                             BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
                                                             BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
@@ -673,15 +1315,7 @@ inline void GraphInitFromFile(vk_commands* Commands)
             EndTempMem(EdgeTempMem);
         }
 
-        DemoState->NumGraphDrawEdges = DemoState->NumGraphEdges;
-        DemoState->EdgeIndexBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                    sizeof(u32) * 2 * DemoState->NumGraphDrawEdges);
-        DemoState->EdgeColorBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                    sizeof(u32) * DemoState->NumGraphDrawEdges);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeIndexBuffer);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GraphDescriptor, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeColorBuffer);
+        GraphDrawEdgesCreate(DemoState->NumGraphEdges);
 
         u32* EdgeIndexGpu = VkCommandsPushWriteArray(Commands, DemoState->EdgeIndexBuffer, u32, 2*DemoState->NumGraphDrawEdges,
                                                      BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
@@ -719,7 +1353,7 @@ inline void GraphInitFromFile(vk_commands* Commands)
         {
             graph_node_edges CurrNodeEdges = NodeEdgeGpu[CurrNodeId];
                     
-            for (u32 EdgeId = CurrNodeEdges.StartConnections; EdgeId < CurrNodeEdges.EndConnections; ++EdgeId)
+            for (u32 EdgeId = CurrNodeEdges.StartConnections; EdgeId < CurrNodeEdges.EndConnections && EdgeId < DemoState->NumGraphDrawEdges; ++EdgeId)
             {
                 u32 OtherNodeId = EdgeGpu[EdgeId].OtherNodeId;
 
@@ -755,6 +1389,8 @@ inline void GraphInitFromFile(vk_commands* Commands)
         }
     }
 
+    GraphLevelsInit(Commands, NodePosGpu, NodeDegreeGpu, NodeEdgeGpu, EdgeGpu);
+
     EndTempMem(TempMem);
 }
 
@@ -762,62 +1398,53 @@ inline void GraphInitFromFile(vk_commands* Commands)
 // NOTE: Sort Functions
 //
 
-inline merge_sort_descriptor MergeSortDescriptorCreate(vk_commands* Commands, u32 FlipSize, u32 PassId, u32 N)
+inline void MortonKeysGather(vk_commands* Commands, graph_level* SimLevel, u32 GatherType, u32 DispatchX, u32 DispatchY)
 {
-    merge_sort_descriptor Result = {};
-    Result.UniformBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                          sizeof(merge_sort_uniform_data));
-
-    merge_sort_uniform_data* GpuData = VkCommandsPushWriteStruct(Commands, Result.UniformBuffer, merge_sort_uniform_data,
-                                                                 BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                                 BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-
-    GpuData->ArraySize = DemoState->NumGraphNodes;
-    GpuData->FlipSize = FlipSize;
-    GpuData->PassId = PassId;
-    GpuData->N = N;
-                
-    Result.Descriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->MergeSortDescLayout);
-    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Result.Descriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Result.UniformBuffer);
-    
-    return Result;
-}
-
-inline void MergeSortGlobalFlip(vk_commands* Commands, u32 PassId)
-{
-    u32 DispatchX = CeilU32(f32(DemoState->NumGraphNodes) / 2048.0f);
-
     VkDescriptorSet DescriptorSets[] =
         {
             DemoState->RadixTreeDescriptor,
-            DemoState->GraphDescriptor,
-            DemoState->MergeSortGlobalFlipDescriptors[PassId - 11].Descriptor,
+            SimLevel->Descriptor,
         };
-    VkComputeDispatch(Commands, DemoState->MergeSortGlobalFlipPipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, 1, 1);
+
+    vk_pipeline* Pipeline = DemoState->MortonKeysGatherPipeline;
+    vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(u32), &GatherType);
+    VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, DispatchY, 1);
 
     VkBarrierBufferAdd(Commands, DemoState->RadixMortonKeyBuffer,
-                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-    VkBarrierBufferAdd(Commands, DemoState->RadixElementReMappingBuffer,
-                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->RadixSortedMortonKeyBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
     VkCommandsBarrierFlush(Commands);
 }
 
-inline void MergeSortLocalDisperse(vk_commands* Commands)
+inline void MortonLocalSort(vk_commands* Commands, graph_level* SimLevel, u32 SortType, u32 NumBlocks)
 {
-    u32 DispatchX = CeilU32(f32(DemoState->NumGraphNodes) / 2048.0f);
-    
+    if (NumBlocks == 0)
+    {
+        return;
+    }
+
     VkDescriptorSet DescriptorSets[] =
         {
             DemoState->RadixTreeDescriptor,
-            DemoState->GraphDescriptor,
-            DemoState->MergeSortLocalDisperseDescriptor.Descriptor,
+            SimLevel->Descriptor,
         };
-    VkComputeDispatch(Commands, DemoState->MergeSortLocalDispersePipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, 1, 1);
 
-    VkBarrierBufferAdd(Commands, DemoState->RadixMortonKeyBuffer,
+    u32 DispatchX = NumBlocks;
+    u32 DispatchY = 1;
+    if (DispatchX > MAX_THREAD_GROUPS)
+    {
+        DispatchX = 64;
+        DispatchY = DispatchSize(NumBlocks, DispatchX);
+    }
+
+    vk_pipeline* Pipeline = DemoState->MortonLocalSortPipeline;
+    vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(u32), &SortType);
+    VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, DispatchY, 1);
+
+    VkBarrierBufferAdd(Commands, DemoState->RadixSortedMortonKeyBuffer,
                        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
                        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
     VkBarrierBufferAdd(Commands, DemoState->RadixElementReMappingBuffer,
@@ -826,57 +1453,1763 @@ inline void MergeSortLocalDisperse(vk_commands* Commands)
     VkCommandsBarrierFlush(Commands);
 }
 
-inline void MergeSortGlobalDisperse(vk_commands* Commands, u32 PassId)
+inline void MortonKeysCoherentSort(vk_commands* Commands, graph_level* SimLevel, u32 DispatchX, u32 DispatchY)
 {
-    u32 DispatchX = CeilU32(f32(DemoState->NumGraphNodes) / 2048.0f);
-    
+    // NOTE: Regenerate the full keys in the order of the last sort, see radixtree_shaders.cpp for how we fix them up
+    MortonKeysGather(Commands, SimLevel, MortonGatherType_FullKey, DispatchX, DispatchY);
+
+    u32 NumNodes = SimLevel->NumNodes;
+    u32 NumBlocks = DispatchSize(NumNodes, MORTON_COHERENT_BLOCK_SIZE);
+    u32 NumMergeBlocks = NumNodes > MORTON_COHERENT_BLOCK_SIZE / 2 ? DispatchSize(NumNodes - MORTON_COHERENT_BLOCK_SIZE / 2, MORTON_COHERENT_BLOCK_SIZE) : 0;
+    MortonLocalSort(Commands, SimLevel, MortonLocalSortType_Sort, NumBlocks);
+    MortonLocalSort(Commands, SimLevel, MortonLocalSortType_Merge, NumMergeBlocks);
+
     VkDescriptorSet DescriptorSets[] =
         {
             DemoState->RadixTreeDescriptor,
-            DemoState->GraphDescriptor,
-            DemoState->MergeSortGlobalDisperseDescriptors[PassId - 10].Descriptor,
+            SimLevel->Descriptor,
         };
-    VkComputeDispatch(Commands, DemoState->MergeSortGlobalDispersePipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, 1, 1);
 
-    VkBarrierBufferAdd(Commands, DemoState->RadixMortonKeyBuffer,
-                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-    VkBarrierBufferAdd(Commands, DemoState->RadixElementReMappingBuffer,
-                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-    VkCommandsBarrierFlush(Commands);
-}
+    // NOTE: Check
+    {
+        u32 CheckDispatchX = NumBlocks;
+        u32 CheckDispatchY = 1;
+        if (CheckDispatchX > MAX_THREAD_GROUPS)
+        {
+            CheckDispatchX = 64;
+            CheckDispatchY = DispatchSize(NumBlocks, CheckDispatchX);
+        }
+        VkComputeDispatch(Commands, DemoState->MortonCheckPipeline, DescriptorSets, ArrayCount(DescriptorSets), CheckDispatchX, CheckDispatchY, 1);
+
+        VkBarrierBufferAdd(Commands, DemoState->MortonBlockMaxBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkBarrierBufferAdd(Commands, DemoState->MortonCoherentBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkBarrierBufferAdd(Commands, DemoState->MortonSortStatsBuffer,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+        VkCommandsBarrierFlush(Commands);
+    }
+
+    // NOTE: Clamp, only gets groups if the check found keys out of order
+    {
+        vk_pipeline* Pipeline = DemoState->MortonClampPipeline;
+        vkCmdBindPipeline(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Handle);
+        vkCmdBindDescriptorSets(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Layout, 0, ArrayCount(DescriptorSets), DescriptorSets, 0, 0);
+        // NOTE: The clamp dispatch args come after DisorderCount and DoneCounter
+        vkCmdDispatchIndirect(Commands->Buffer, DemoState->MortonCoherentBuffer, sizeof(u32) * 2);
+
+        VkBarrierBufferAdd(Commands, DemoState->RadixSortedMortonKeyBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        VkBarrierBufferAdd(Commands, DemoState->MortonCoherentBuffer,
+                           VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+    }
+}
+
+//
+// NOTE: Multilevel Functions
+//
+
+inline void GlobalMoveReset(vk_commands* Commands)
+{
+    global_move* GlobalMoveGpu = VkCommandsPushWriteStruct(Commands, DemoState->GlobalMoveBuffer, global_move,
+                                                           BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                           BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    *GlobalMoveGpu = {};
+    GlobalMoveGpu->Speed = 1.0f;
+    GlobalMoveGpu->SpeedEfficiency = 1.0f;
+    GlobalMoveGpu->JitterToleranceConstant = 1.0f;
+    GlobalMoveGpu->MaxJitterTolerance = 10.0f;
+}
+
+inline void GraphLevelProlong(vk_commands* Commands, u32 FineLevelId)
+{
+    graph_level* FineLevel = DemoState->GraphLevels + FineLevelId;
+    graph_level* CoarseLevel = DemoState->GraphLevels + FineLevelId + 1;
+
+    VkBarrierBufferAdd(Commands, CoarseLevel->NodePosBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    VkBarrierBufferAdd(Commands, CoarseLevel->NodeStateBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    u32 DispatchX = DispatchSize(FineLevel->NumNodes, 32);
+    u32 DispatchY = 1;
+    if (DispatchX > MAX_THREAD_GROUPS)
+    {
+        DispatchX = 64;
+        DispatchY = DispatchSize(FineLevel->NumNodes, 32 * DispatchX);
+    }
+
+    VkDescriptorSet DescriptorSets[] =
+        {
+            FineLevel->Descriptor,
+        };
+
+    graph_prolong_constants Constants = {};
+    Constants.NumNodes = FineLevel->NumNodes;
+    Constants.JitterRadius = GRAPH_PROLONG_JITTER;
+    
+    vk_pipeline* Pipeline = DemoState->GraphProlongPipeline;
+    vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+    VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, DispatchY, 1);
+}
+
+inline void GraphPackNodeState(vk_commands* Commands)
+{
+    for (u32 LevelId = 0; LevelId < DemoState->NumGraphLevels; ++LevelId)
+    {
+        graph_level* Level = DemoState->GraphLevels + LevelId;
+
+        u32 DispatchX = DispatchSize(Level->NumNodes, 32);
+        u32 DispatchY = 1;
+        if (DispatchX > MAX_THREAD_GROUPS)
+        {
+            DispatchX = 64;
+            DispatchY = DispatchSize(Level->NumNodes, 32 * DispatchX);
+        }
+
+        VkDescriptorSet DescriptorSets[] =
+            {
+                Level->Descriptor,
+            };
+
+        graph_pack_constants Constants = {};
+        Constants.NumNodes = Level->NumNodes;
+
+        vk_pipeline* Pipeline = DemoState->GraphPackNodeStatePipeline;
+        vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+        VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, DispatchY, 1);
+
+        VkBarrierBufferAdd(Commands, Level->NodeStateBuffer,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    }
+    
+    VkBarrierBufferAdd(Commands, DemoState->NodePrevForceHalfBuffer,
+                       VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    DemoState->NodeStateDirty = false;
+}
+
+inline void GraphAttractionCacheUpdate(vk_commands* Commands)
+{
+    b32 ParamsChanged = (DemoState->CachedAttractionMultiplier != DemoState->AttractionMultiplier ||
+                         DemoState->CachedAttractionWeightPower != DemoState->AttractionWeightPower ||
+                         DemoState->CachedGravityMultiplier != DemoState->GravityMultiplier);
+    if (!DemoState->AttractionCacheDirty && !ParamsChanged)
+    {
+        return;
+    }
+
+    // NOTE: We don't know which level we step down to next, so rebuild all of them, this only happens when a slider moves
+    for (u32 LevelId = 0; LevelId < DemoState->NumGraphLevels; ++LevelId)
+    {
+        graph_level* Level = DemoState->GraphLevels + LevelId;
+
+        // NOTE: Out of core the shard kernels calculate their coefficients on the fly
+        u32 NumCachedEdges = GraphLevelOutOfCore(Level) ? 0 : Level->NumEdges;
+        u32 NumItems = Max(Level->NumNodes, NumCachedEdges);
+        u32 DispatchX = DispatchSize(NumItems, 32);
+        u32 DispatchY = 1;
+        if (DispatchX > MAX_THREAD_GROUPS)
+        {
+            DispatchX = 64;
+            DispatchY = DispatchSize(NumItems, 32 * DispatchX);
+        }
+
+        VkDescriptorSet DescriptorSets[] =
+            {
+                Level->Descriptor,
+            };
+
+        graph_attraction_cache_constants Constants = {};
+        Constants.NumNodes = Level->NumNodes;
+        Constants.NumEdges = NumCachedEdges;
+
+        vk_pipeline* Pipeline = DemoState->GraphAttractionCachePipeline;
+        vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+        VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, DispatchY, 1);
+
+        VkBarrierBufferAdd(Commands, Level->EdgeCoefficientBuffer,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkBarrierBufferAdd(Commands, Level->NodeGravityBuffer,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+    VkCommandsBarrierFlush(Commands);
+
+    DemoState->AttractionCacheDirty = false;
+    DemoState->CachedAttractionMultiplier = DemoState->AttractionMultiplier;
+    DemoState->CachedAttractionWeightPower = DemoState->AttractionWeightPower;
+    DemoState->CachedGravityMultiplier = DemoState->GravityMultiplier;
+}
 
 //
 // NOTE: Reduction Helpers
 //
 
-inline u32 CalcGlobalSpeedNumThreadGroups()
+inline u32 CalcReductionNumThreadGroups(u32 NumNodes)
+{
+    // NOTE: Each group writes out 1 partial result, the last group to finish reduces the partials
+    u32 Result = DispatchSize(NumNodes, REDUCTION_NODES_PER_GROUP);
+    return Result;
+}
+
+//
+// NOTE: Edge Sort Functions
+//
+
+inline void EdgeSortBarrier(vk_commands* Commands, VkBuffer Buffer)
+{
+    VkBarrierBufferAdd(Commands, Buffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+inline void EdgeSortDispatch(vk_commands* Commands, vk_pipeline* Pipeline, edge_sort_constants* Constants, u32 NumGroups)
+{
+    if (NumGroups == 0)
+    {
+        return;
+    }
+
+    u32 DispatchX = NumGroups;
+    u32 DispatchY = 1;
+    if (DispatchX > MAX_THREAD_GROUPS)
+    {
+        DispatchX = 64;
+        DispatchY = DispatchSize(NumGroups, DispatchX);
+    }
+
+    VkDescriptorSet DescriptorSets[] =
+        {
+            DemoState->EdgeSortDescriptor,
+            DemoState->GraphDescriptor,
+        };
+
+    vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(*Constants), Constants);
+    VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, DispatchY, 1);
+}
+
+inline void GraphEdgesSortBatch(vk_commands* Commands, u32* Segments, u32* BatchOffsets, u32 FirstSegment, u32 NumSegments, u32 NumBatchEdges)
+{
+    if (NumSegments == 0)
+    {
+        return;
+    }
+
+    edge_sort_constants Constants = {};
+    Constants.SortKey = DemoState->EdgeSortKey;
+    Constants.FirstSegment = FirstSegment;
+    Constants.NumSegments = NumSegments;
+    Constants.NumBatchEdges = NumBatchEdges;
+
+    // NOTE: The last batch's scatter and copy back might still use the batch buffers
+    EdgeSortBarrier(Commands, DemoState->EdgeSortKeyBuffer);
+    EdgeSortBarrier(Commands, DemoState->EdgeSortPayloadBuffer);
+    EdgeSortBarrier(Commands, DemoState->EdgeSortBatchSegmentBuffer);
+    VkBarrierBufferAdd(Commands, DemoState->EdgeSortScratchEdgeBuffer,
+                       VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+    
+    EdgeSortDispatch(Commands, DemoState->EdgeSortGatherKeysPipeline, &Constants, NumSegments);
+    EdgeSortBarrier(Commands, DemoState->EdgeSortKeyBuffer);
+    EdgeSortBarrier(Commands, DemoState->EdgeSortPayloadBuffer);
+    EdgeSortBarrier(Commands, DemoState->EdgeSortBatchSegmentBuffer);
+    VkCommandsBarrierFlush(Commands);
+
+    // NOTE: Sort by key, then stable sort by segment so every segment ends up contiguous and sorted by key
+    GpuSortKeys(Commands, &DemoState->EdgeSort, NumBatchEdges, GpuSortBackend_Auto, GpuSortFlag_Stable);
+    
+    EdgeSortDispatch(Commands, DemoState->EdgeSortGatherSegmentsPipeline, &Constants, DispatchSize(NumBatchEdges, 32));
+    EdgeSortBarrier(Commands, DemoState->EdgeSortKeyBuffer);
+    VkCommandsBarrierFlush(Commands);
+
+    GpuSortKeys(Commands, &DemoState->EdgeSort, NumBatchEdges, GpuSortBackend_Auto, GpuSortFlag_Stable);
+
+    EdgeSortDispatch(Commands, DemoState->EdgeSortScatterPipeline, &Constants, DispatchSize(NumBatchEdges, 32));
+    VkBarrierBufferAdd(Commands, DemoState->EdgeSortScratchEdgeBuffer,
+                       VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->EdgeBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    // NOTE: Every segment is contiguous in the batch, so it goes back to its range with 1 copy
+    temp_mem TempMem = BeginTempMem(&DemoState->TempArena);
+    VkBufferCopy* Regions = PushArray(&DemoState->TempArena, VkBufferCopy, NumSegments);
+    for (u32 SegmentId = 0; SegmentId < NumSegments; ++SegmentId)
+    {
+        graph_node_edges Range = DemoState->NodeEdgesCpu[Segments[FirstSegment + SegmentId]];
+        
+        VkBufferCopy* Region = Regions + SegmentId;
+        *Region = {};
+        Region->srcOffset = sizeof(graph_edge) * BatchOffsets[FirstSegment + SegmentId];
+        Region->dstOffset = sizeof(graph_edge) * Range.StartConnections;
+        Region->size = sizeof(graph_edge) * (Range.EndConnections - Range.StartConnections);
+    }
+    vkCmdCopyBuffer(Commands->Buffer, DemoState->EdgeSortScratchEdgeBuffer, DemoState->EdgeBuffer, NumSegments, Regions);
+    EndTempMem(TempMem);
+
+    VkBarrierBufferAdd(Commands, DemoState->EdgeBuffer,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+}
+
+/*
+  NOTE: Sorts the edges of the level 0 nodes in NodeIds by DemoState->EdgeSortKey on the GPU, see edge_sort_shaders.cpp. The ranges
+        come from NodeEdgesCpu, so they have to be up to date. Segments bigger than EdgeSort.MaxNumKeys (only hubs that grew a lot
+        through GraphAppend after the load) keep their order.
+ */
+inline void GraphEdgesSort(vk_commands* Commands, u32 NumNodes, u32* NodeIds)
+{
+    // NOTE: Out of core, level 0's edges live in the host edge store
+    if (DemoState->OutOfCoreEnabled || NumNodes == 0)
+    {
+        return;
+    }
+
+    temp_mem TempMem = BeginTempMem(&DemoState->TempArena);
+
+    // NOTE: Bucket the segments by size, thread segments first, then block segments, then batches of big segments
+    u32 NumThreadSegments = 0;
+    u32 NumBlockSegments = 0;
+    u32 NumLargeSegments = 0;
+    u32 MaxBatchEdges = DemoState->EdgeSort.MaxNumKeys;
+    for (u32 Id = 0; Id < NumNodes; ++Id)
+    {
+        graph_node_edges Range = DemoState->NodeEdgesCpu[NodeIds[Id]];
+        u32 NumEdges = Range.EndConnections - Range.StartConnections;
+        if (NumEdges <= 1 || NumEdges > MaxBatchEdges)
+        {
+            continue;
+        }
+
+        if (NumEdges <= EDGE_SORT_THREAD_SIZE)
+        {
+            NumThreadSegments += 1;
+        }
+        else if (NumEdges <= EDGE_SORT_BLOCK_SIZE)
+        {
+            NumBlockSegments += 1;
+        }
+        else
+        {
+            NumLargeSegments += 1;
+        }
+    }
+
+    u32 NumSegments = NumThreadSegments + NumBlockSegments + NumLargeSegments;
+    if (NumSegments > 0)
+    {
+        u32* Segments = PushArray(&DemoState->TempArena, u32, NumSegments);
+        u32* BatchOffsets = PushArray(&DemoState->TempArena, u32, NumSegments);
+        u32 ThreadSegmentId = 0;
+        u32 BlockSegmentId = NumThreadSegments;
+        u32 LargeSegmentId = NumThreadSegments + NumBlockSegments;
+        u32 NumBatchEdges = 0;
+        for (u32 Id = 0; Id < NumNodes; ++Id)
+        {
+            graph_node_edges Range = DemoState->NodeEdgesCpu[NodeIds[Id]];
+            u32 NumEdges = Range.EndConnections - Range.StartConnections;
+            if (NumEdges <= 1 || NumEdges > MaxBatchEdges)
+            {
+                continue;
+            }
+
+            if (NumEdges <= EDGE_SORT_THREAD_SIZE)
+            {
+                BatchOffsets[ThreadSegmentId] = 0;
+                Segments[ThreadSegmentId++] = NodeIds[Id];
+            }
+            else if (NumEdges <= EDGE_SORT_BLOCK_SIZE)
+            {
+                BatchOffsets[BlockSegmentId] = 0;
+                Segments[BlockSegmentId++] = NodeIds[Id];
+            }
+            else
+            {
+                // NOTE: Start a new batch when this segment doesn't fit in the current one
+                if (NumBatchEdges + NumEdges > MaxBatchEdges)
+                {
+                    NumBatchEdges = 0;
+                }
+                BatchOffsets[LargeSegmentId] = NumBatchEdges;
+                Segments[LargeSegmentId++] = NodeIds[Id];
+                NumBatchEdges += NumEdges;
+            }
+        }
+
+        {
+            u32* SegmentsGpu = VkCommandsPushWriteArray(Commands, DemoState->EdgeSortSegmentBuffer, u32, NumSegments,
+                                                        BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT),
+                                                        BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+            Copy(Segments, SegmentsGpu, sizeof(u32) * NumSegments);
+            
+            u32* BatchOffsetsGpu = VkCommandsPushWriteArray(Commands, DemoState->EdgeSortBatchOffsetBuffer, u32, NumSegments,
+                                                            BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT),
+                                                            BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+            Copy(BatchOffsets, BatchOffsetsGpu, sizeof(u32) * NumSegments);
+        }
+
+        // NOTE: The edges might have just been uploaded or moved by GraphAppend
+        VkBarrierBufferAdd(Commands, DemoState->EdgeBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        // NOTE: The thread and block segments are disjoint from every other segment so they need no barriers in between
+        edge_sort_constants Constants = {};
+        Constants.SortKey = DemoState->EdgeSortKey;
+        Constants.FirstSegment = 0;
+        Constants.NumSegments = NumThreadSegments;
+        EdgeSortDispatch(Commands, DemoState->EdgeSortThreadPipeline, &Constants, DispatchSize(NumThreadSegments, 32));
+
+        Constants.FirstSegment = NumThreadSegments;
+        Constants.NumSegments = NumBlockSegments;
+        EdgeSortDispatch(Commands, DemoState->EdgeSortBlockPipeline, &Constants, NumBlockSegments);
+
+        // NOTE: A batch ends where the next segment starts at offset 0 again
+        u32 FirstBatchSegment = NumThreadSegments + NumBlockSegments;
+        for (u32 SegmentId = FirstBatchSegment + 1; SegmentId <= NumSegments; ++SegmentId)
+        {
+            if (SegmentId == NumSegments || BatchOffsets[SegmentId] == 0)
+            {
+                u32 LastSegment = SegmentId - 1;
+                graph_node_edges LastRange = DemoState->NodeEdgesCpu[Segments[LastSegment]];
+                u32 BatchEdges = BatchOffsets[LastSegment] + (LastRange.EndConnections - LastRange.StartConnections);
+                GraphEdgesSortBatch(Commands, Segments, BatchOffsets, FirstBatchSegment, SegmentId - FirstBatchSegment, BatchEdges);
+                FirstBatchSegment = SegmentId;
+            }
+        }
+
+        VkBarrierBufferAdd(Commands, DemoState->EdgeBuffer,
+                           VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        // NOTE: The attraction cache stores a coefficient per edge slot
+        DemoState->AttractionCacheDirty = true;
+    }
+
+    EndTempMem(TempMem);
+}
+
+//
+// NOTE: Streaming Append Functions
+//
+
+inline int GraphAppendEdgeCompare(const void* A, const void* B)
+{
+    u32 SourceA = ((graph_append_directed_edge*)A)->SourceNodeId;
+    u32 SourceB = ((graph_append_directed_edge*)B)->SourceNodeId;
+    int Result = SourceA < SourceB ? -1 : (SourceA > SourceB ? 1 : 0);
+    return Result;
+}
+
+inline u64 GraphAppendStagingPush(u64* StagingUsed, u64 Size)
+{
+    u64 Result = *StagingUsed;
+    *StagingUsed += (Size + 15) & ~15ull;
+    Assert(*StagingUsed <= GRAPH_APPEND_STAGING_SIZE);
+    return Result;
+}
+
+inline void GraphAppendFill(vk_commands* Commands, VkBuffer Buffer, u32 FirstElement, u32 NumElements, u32 Value)
+{
+    if (NumElements > 0)
+    {
+        vkCmdFillBuffer(Commands->Buffer, Buffer, sizeof(u32) * FirstElement, sizeof(u32) * NumElements, Value);
+    }
+}
+
+/*
+  NOTE: Adds NumNewNodes nodes after the last node and NumNewEdges undirected edges to the level 0 graph on the GPU. New nodes get the
+        ids NumGraphNodes onwards in the order they are passed, edges can connect any mix of old and new nodes. Returns false without
+        touching the graph if we ran out of spare capacity or staging memory. The coarse levels were built from the graph at load time
+        so we drop them and only lay out level 0 from here on.
+ */
+inline b32 GraphAppend(vk_commands* Commands, u32 NumNewNodes, graph_append_node* NewNodes, u32 NumNewEdges, graph_append_edge* NewEdges)
+{
+    // NOTE: The out of core edge store has no spare room and its shards would need to be rebuilt
+    if (DemoState->OutOfCoreEnabled)
+    {
+        return false;
+    }
+    
+    b32 Result = false;
+    temp_mem TempMem = BeginTempMem(&DemoState->TempArena);
+
+    u32 FirstNewNode = DemoState->NumGraphNodes;
+    u32 NumNodes = FirstNewNode + NumNewNodes;
+
+    // NOTE: Every edge is stored once per direction, group them by the node that owns them
+    u32 NumDirectedEdges = 2 * NumNewEdges;
+    graph_append_directed_edge* DirectedEdges = PushArray(&DemoState->TempArena, graph_append_directed_edge, NumDirectedEdges);
+    for (u32 EdgeId = 0; EdgeId < NumNewEdges; ++EdgeId)
+    {
+        graph_append_edge CurrEdge = NewEdges[EdgeId];
+        Assert(CurrEdge.NodeA < NumNodes && CurrEdge.NodeB < NumNodes && CurrEdge.NodeA != CurrEdge.NodeB);
+        DirectedEdges[2*EdgeId + 0] = { CurrEdge.NodeA, CurrEdge.NodeB, CurrEdge.Weight };
+        DirectedEdges[2*EdgeId + 1] = { CurrEdge.NodeB, CurrEdge.NodeA, CurrEdge.Weight };
+    }
+    qsort(DirectedEdges, NumDirectedEdges, sizeof(graph_append_directed_edge), GraphAppendEdgeCompare);
+
+    // NOTE: Plan the new range of every node that gains edges before we touch any state
+    graph_append_run* Runs = PushArray(&DemoState->TempArena, graph_append_run, NumDirectedEdges);
+    u32 NumRuns = 0;
+    u32 NumUsedEdges = DemoState->NumGraphEdges;
+    for (u32 EdgeId = 0; EdgeId < NumDirectedEdges;)
+    {
+        graph_append_run* Run = Runs + NumRuns++;
+        *Run = {};
+        Run->NodeId = DirectedEdges[EdgeId].SourceNodeId;
+        Run->FirstDirectedEdge = EdgeId;
+        while (EdgeId < NumDirectedEdges && DirectedEdges[EdgeId].SourceNodeId == Run->NodeId)
+        {
+            Run->NumAddedEdges += 1;
+            EdgeId += 1;
+        }
+
+        // NOTE: New nodes don't own any slots yet so they always take a range in the overflow area
+        if (Run->NodeId < FirstNewNode)
+        {
+            Run->OldEdges = DemoState->NodeEdgesCpu[Run->NodeId];
+            Run->OldReserve = DemoState->NodeEdgeReserveCpu[Run->NodeId];
+        }
+
+        if (Run->OldEdges.EndConnections + Run->NumAddedEdges <= Run->OldReserve)
+        {
+            Run->NewEdges.StartConnections = Run->OldEdges.StartConnections;
+            Run->NewEdges.EndConnections = Run->OldEdges.EndConnections + Run->NumAddedEdges;
+            Run->NewReserve = Run->OldReserve;
+        }
+        else
+        {
+            u32 NumEdges = (Run->OldEdges.EndConnections - Run->OldEdges.StartConnections) + Run->NumAddedEdges;
+            Run->Moved = true;
+            Run->NewEdges.StartConnections = NumUsedEdges;
+            Run->NewEdges.EndConnections = NumUsedEdges + NumEdges;
+            Run->NewReserve = NumUsedEdges + 2 * NumEdges;
+            NumUsedEdges = Run->NewReserve;
+        }
+    }
+
+    u32 NumDrawEdges = DemoState->NumGraphDrawEdges + NumNewEdges;
+    u64 StagingSize = (sizeof(graph_edge) * NumDirectedEdges + sizeof(graph_node_edges) * (NumRuns + NumNewNodes) +
+                       (sizeof(f32) + sizeof(graph_node_draw)) * NumNewNodes + 3 * sizeof(u32) * NumNewEdges + 6 * 16);
+    if (NumNodes <= DemoState->MaxNumGraphNodes && NumUsedEdges <= DemoState->MaxNumGraphEdges &&
+        NumDrawEdges <= DemoState->MaxNumGraphDrawEdges && StagingSize <= GRAPH_APPEND_STAGING_SIZE)
+    {
+        Result = true;
+
+        // NOTE: Our commands wait on last frame's fence before recording, so nothing reads the staging buffer anymore
+        u64 StagingUsed = 0;
+        u8* StagingCpu = DemoState->AppendStagingCpu;
+        VkBuffer StagingBuffer = DemoState->AppendStagingBuffer;
+
+        for (u32 NodeId = FirstNewNode; NodeId < NumNodes; ++NodeId)
+        {
+            DemoState->NodeEdgesCpu[NodeId] = { NumUsedEdges, NumUsedEdges };
+            DemoState->NodeEdgeReserveCpu[NodeId] = NumUsedEdges;
+        }
+        
+        // NOTE: Write the new edges and move the ranges that ran out of room
+        {
+            u64 EdgeStagingOffset = GraphAppendStagingPush(&StagingUsed, sizeof(graph_edge) * NumDirectedEdges);
+            graph_edge* EdgeStaging = (graph_edge*)(StagingCpu + EdgeStagingOffset);
+            u64 NodeEdgeStagingOffset = GraphAppendStagingPush(&StagingUsed, sizeof(graph_node_edges) * (NumRuns + NumNewNodes));
+            graph_node_edges* NodeEdgeStaging = (graph_node_edges*)(StagingCpu + NodeEdgeStagingOffset);
+
+            VkBufferCopy* EdgeMoveRegions = PushArray(&DemoState->TempArena, VkBufferCopy, NumRuns);
+            VkBufferCopy* EdgeUploadRegions = PushArray(&DemoState->TempArena, VkBufferCopy, NumRuns);
+            VkBufferCopy* NodeEdgeRegions = PushArray(&DemoState->TempArena, VkBufferCopy, NumRuns + 1);
+            u32 NumEdgeMoveRegions = 0;
+            u32 NumNodeEdgeRegions = 0;
+            
+            for (u32 RunId = 0; RunId < NumRuns; ++RunId)
+            {
+                graph_append_run* Run = Runs + RunId;
+                u32 NumOldEdges = Run->OldEdges.EndConnections - Run->OldEdges.StartConnections;
+                u32 FirstAddedEdge = Run->NewEdges.EndConnections - Run->NumAddedEdges;
+                
+                DemoState->NodeEdgesCpu[Run->NodeId] = Run->NewEdges;
+                DemoState->NodeEdgeReserveCpu[Run->NodeId] = Run->NewReserve;
+
+                for (u32 AddedId = 0; AddedId < Run->NumAddedEdges; ++AddedId)
+                {
+                    graph_append_directed_edge CurrEdge = DirectedEdges[Run->FirstDirectedEdge + AddedId];
+                    EdgeStaging[Run->FirstDirectedEdge + AddedId].OtherNodeId = CurrEdge.OtherNodeId;
+                    EdgeStaging[Run->FirstDirectedEdge + AddedId].Weight = CurrEdge.Weight;
+                }
+
+                VkBufferCopy* UploadRegion = EdgeUploadRegions + RunId;
+                *UploadRegion = {};
+                UploadRegion->srcOffset = EdgeStagingOffset + sizeof(graph_edge) * Run->FirstDirectedEdge;
+                UploadRegion->dstOffset = sizeof(graph_edge) * FirstAddedEdge;
+                UploadRegion->size = sizeof(graph_edge) * Run->NumAddedEdges;
+                GraphAppendFill(Commands, DemoState->EdgeSourceBuffer, FirstAddedEdge, Run->NumAddedEdges, Run->NodeId);
+
+                if (Run->Moved)
+                {
+                    if (NumOldEdges > 0)
+                    {
+                        VkBufferCopy* MoveRegion = EdgeMoveRegions + NumEdgeMoveRegions++;
+                        *MoveRegion = {};
+                        MoveRegion->srcOffset = sizeof(graph_edge) * Run->OldEdges.StartConnections;
+                        MoveRegion->dstOffset = sizeof(graph_edge) * Run->NewEdges.StartConnections;
+                        MoveRegion->size = sizeof(graph_edge) * NumOldEdges;
+                        GraphAppendFill(Commands, DemoState->EdgeSourceBuffer, Run->NewEdges.StartConnections, NumOldEdges, Run->NodeId);
+                    }
+
+                    // NOTE: The slots we left behind and the room we reserved have no owner
+                    GraphAppendFill(Commands, DemoState->EdgeSourceBuffer, Run->OldEdges.StartConnections,
+                                    Run->OldReserve - Run->OldEdges.StartConnections, 0xFFFFFFFF);
+                    GraphAppendFill(Commands, DemoState->EdgeSourceBuffer, Run->NewEdges.EndConnections,
+                                    Run->NewReserve - Run->NewEdges.EndConnections, 0xFFFFFFFF);
+                }
+
+                if (Run->NodeId < FirstNewNode)
+                {
+                    NodeEdgeStaging[NumNodeEdgeRegions] = Run->NewEdges;
+                    
+                    VkBufferCopy* NodeEdgeRegion = NodeEdgeRegions + NumNodeEdgeRegions;
+                    *NodeEdgeRegion = {};
+                    NodeEdgeRegion->srcOffset = NodeEdgeStagingOffset + sizeof(graph_node_edges) * NumNodeEdgeRegions;
+                    NodeEdgeRegion->dstOffset = sizeof(graph_node_edges) * Run->NodeId;
+                    NodeEdgeRegion->size = sizeof(graph_node_edges);
+                    NumNodeEdgeRegions += 1;
+                }
+            }
+
+            if (NumNewNodes > 0)
+            {
+                Copy(DemoState->NodeEdgesCpu + FirstNewNode, NodeEdgeStaging + NumNodeEdgeRegions, sizeof(graph_node_edges) * NumNewNodes);
+                
+                VkBufferCopy* NodeEdgeRegion = NodeEdgeRegions + NumNodeEdgeRegions;
+                *NodeEdgeRegion = {};
+                NodeEdgeRegion->srcOffset = NodeEdgeStagingOffset + sizeof(graph_node_edges) * NumNodeEdgeRegions;
+                NodeEdgeRegion->dstOffset = sizeof(graph_node_edges) * FirstNewNode;
+                NodeEdgeRegion->size = sizeof(graph_node_edges) * NumNewNodes;
+                NumNodeEdgeRegions += 1;
+            }
+
+            // NOTE: Moves read slots below the old edge count and write above it, so they never overlap
+            if (NumEdgeMoveRegions > 0)
+            {
+                vkCmdCopyBuffer(Commands->Buffer, DemoState->EdgeBuffer, DemoState->EdgeBuffer, NumEdgeMoveRegions, EdgeMoveRegions);
+            }
+            if (NumRuns > 0)
+            {
+                vkCmdCopyBuffer(Commands->Buffer, StagingBuffer, DemoState->EdgeBuffer, NumRuns, EdgeUploadRegions);
+            }
+            if (NumNodeEdgeRegions > 0)
+            {
+                vkCmdCopyBuffer(Commands->Buffer, StagingBuffer, DemoState->NodeEdgeBuffer, NumNodeEdgeRegions, NodeEdgeRegions);
+            }
+        }
+
+        // NOTE: Write the new nodes
+        if (NumNewNodes > 0)
+        {
+            u64 DegreeStagingOffset = GraphAppendStagingPush(&StagingUsed, sizeof(f32) * NumNewNodes);
+            f32* DegreeStaging = (f32*)(StagingCpu + DegreeStagingOffset);
+            u64 DrawStagingOffset = GraphAppendStagingPush(&StagingUsed, sizeof(graph_node_draw) * NumNewNodes);
+            graph_node_draw* DrawStaging = (graph_node_draw*)(StagingCpu + DrawStagingOffset);
+            for (u32 NodeId = 0; NodeId < NumNewNodes; ++NodeId)
+            {
+                DegreeStaging[NodeId] = NewNodes[NodeId].Degree;
+                DrawStaging[NodeId] = NewNodes[NodeId].Draw;
+            }
+
+            VkBufferCopy BufferCopy = {};
+            BufferCopy.srcOffset = DegreeStagingOffset;
+            BufferCopy.dstOffset = sizeof(f32) * FirstNewNode;
+            BufferCopy.size = sizeof(f32) * NumNewNodes;
+            vkCmdCopyBuffer(Commands->Buffer, StagingBuffer, DemoState->NodeDegreeBuffer, 1, &BufferCopy);
+
+            BufferCopy.srcOffset = DrawStagingOffset;
+            BufferCopy.dstOffset = sizeof(graph_node_draw) * FirstNewNode;
+            BufferCopy.size = sizeof(graph_node_draw) * NumNewNodes;
+            vkCmdCopyBuffer(Commands->Buffer, StagingBuffer, DemoState->NodeDrawBuffer, 1, &BufferCopy);
+
+            vkCmdFillBuffer(Commands->Buffer, DemoState->NodeForceBuffer, sizeof(v2) * FirstNewNode, sizeof(v2) * NumNewNodes, 0);
+            vkCmdFillBuffer(Commands->Buffer, DemoState->NodePrevForceBuffer, sizeof(v2) * FirstNewNode, sizeof(v2) * NumNewNodes, 0);
+#if GRAPH_PACKED_NODE_STATE
+            vkCmdFillBuffer(Commands->Buffer, DemoState->NodePrevForceHalfBuffer, sizeof(u32) * FirstNewNode, sizeof(u32) * NumNewNodes, 0);
+#endif
+        }
+
+        // NOTE: Write the new draw edges
+        if (NumNewEdges > 0)
+        {
+            u64 IndexStagingOffset = GraphAppendStagingPush(&StagingUsed, 2 * sizeof(u32) * NumNewEdges);
+            u32* IndexStaging = (u32*)(StagingCpu + IndexStagingOffset);
+            u64 ColorStagingOffset = GraphAppendStagingPush(&StagingUsed, sizeof(u32) * NumNewEdges);
+            u32* ColorStaging = (u32*)(StagingCpu + ColorStagingOffset);
+            for (u32 EdgeId = 0; EdgeId < NumNewEdges; ++EdgeId)
+            {
+                IndexStaging[2*EdgeId + 0] = NewEdges[EdgeId].NodeA;
+                IndexStaging[2*EdgeId + 1] = NewEdges[EdgeId].NodeB;
+                ColorStaging[EdgeId] = NewEdges[EdgeId].Color;
+            }
+
+            VkBufferCopy BufferCopy = {};
+            BufferCopy.srcOffset = IndexStagingOffset;
+            BufferCopy.dstOffset = 2 * sizeof(u32) * DemoState->NumGraphDrawEdges;
+            BufferCopy.size = 2 * sizeof(u32) * NumNewEdges;
+            vkCmdCopyBuffer(Commands->Buffer, StagingBuffer, DemoState->EdgeIndexBuffer, 1, &BufferCopy);
+
+            BufferCopy.srcOffset = ColorStagingOffset;
+            BufferCopy.dstOffset = sizeof(u32) * DemoState->NumGraphDrawEdges;
+            BufferCopy.size = sizeof(u32) * NumNewEdges;
+            vkCmdCopyBuffer(Commands->Buffer, StagingBuffer, DemoState->EdgeColorBuffer, 1, &BufferCopy);
+        }
+
+        // NOTE: The coarse levels don't know about the new nodes
+        graph_level* Level = DemoState->GraphLevels + 0;
+        Level->NumNodes = NumNodes;
+        Level->NumEdges = NumUsedEdges;
+        DemoState->NumGraphNodes = NumNodes;
+        DemoState->NumGraphEdges = NumUsedEdges;
+        DemoState->NumGraphDrawEdges = NumDrawEdges;
+        DemoState->NumGraphLevels = 1;
+        DemoState->SimSettled = false;
+        DemoState->NumCalmSamples = 0;
+        DemoState->AttractionCacheDirty = true;
+
+        if (DemoState->CurrGraphLevel > 0)
+        {
+            // NOTE: Level 0 isn't laid out yet, so we let the whole graph keep going from the prolonged positions
+            DemoState->CurrGraphLevel = 0;
+            DemoState->CurrLevelIterations = 0;
+            DemoState->NumActiveSetIterations = 0;
+            DemoState->MortonSortedNumNodes = 0;
+            DemoState->NumAppendRelaxIterations = 0;
+            GlobalMoveReset(Commands);
+            vkCmdFillBuffer(Commands->Buffer, DemoState->NodePrevForceBuffer, 0, sizeof(v2) * NumNodes, 0);
+#if GRAPH_PACKED_NODE_STATE
+            vkCmdFillBuffer(Commands->Buffer, DemoState->NodePrevForceHalfBuffer, 0, sizeof(u32) * NumNodes, 0);
+#endif
+        }
+        else
+        {
+            // NOTE: Freeze everything except the nodes that gained edges, GRAPH_ACTIVE_COMPACT adds their neighbours
+            DemoState->NumAppendRelaxIterations = GRAPH_APPEND_RELAX_ITERATIONS;
+            
+            vkCmdFillBuffer(Commands->Buffer, DemoState->NodeActiveBuffer, 0, sizeof(u32) * NumNodes, 0);
+            VkBarrierBufferAdd(Commands, DemoState->NodeActiveBuffer,
+                               VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            VkCommandsBarrierFlush(Commands);
+
+            GraphAppendFill(Commands, DemoState->NodeActiveBuffer, FirstNewNode, NumNewNodes, 1);
+            for (u32 RunId = 0; RunId < NumRuns && Runs[RunId].NodeId < FirstNewNode; ++RunId)
+            {
+                GraphAppendFill(Commands, DemoState->NodeActiveBuffer, Runs[RunId].NodeId, 1, 1);
+            }
+        }
+
+        VkBuffer ShaderBuffers[] =
+            {
+                DemoState->NodeDegreeBuffer,
+                DemoState->NodeForceBuffer,
+                DemoState->NodePrevForceBuffer,
+                DemoState->NodePrevForceHalfBuffer,
+                DemoState->NodeEdgeBuffer,
+                DemoState->EdgeBuffer,
+                DemoState->EdgeSourceBuffer,
+                DemoState->NodeDrawBuffer,
+                DemoState->NodeActiveBuffer,
+            };
+        for (u32 BufferId = 0; BufferId < ArrayCount(ShaderBuffers); ++BufferId)
+        {
+            VkBarrierBufferAdd(Commands, ShaderBuffers[BufferId],
+                               VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        }
+        VkBarrierBufferAdd(Commands, DemoState->EdgeIndexBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        VkBarrierBufferAdd(Commands, DemoState->EdgeColorBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        // NOTE: The added edges land at the end of every range, sort the nodes that gained some back into order
+        {
+            u32* SortNodeIds = PushArray(&DemoState->TempArena, u32, NumRuns);
+            for (u32 RunId = 0; RunId < NumRuns; ++RunId)
+            {
+                SortNodeIds[RunId] = Runs[RunId].NodeId;
+            }
+            GraphEdgesSort(Commands, NumRuns, SortNodeIds);
+        }
+
+        // NOTE: Seed the new nodes at the barycentre of their neighbours
+        if (NumNewNodes > 0)
+        {
+            u32 DispatchX = DispatchSize(NumNewNodes, 32);
+            u32 DispatchY = 1;
+            if (DispatchX > MAX_THREAD_GROUPS)
+            {
+                DispatchX = 64;
+                DispatchY = DispatchSize(NumNewNodes, 32 * DispatchX);
+            }
+
+            VkDescriptorSet DescriptorSets[] =
+                {
+                    DemoState->GraphDescriptor,
+                };
+
+            graph_append_seed_constants Constants = {};
+            Constants.FirstNewNode = FirstNewNode;
+            Constants.NumNewNodes = NumNewNodes;
+            Constants.JitterRadius = GRAPH_APPEND_SEED_JITTER;
+            Constants.SpawnRadius = GRAPH_APPEND_SPAWN_RADIUS;
+
+            vk_pipeline* Pipeline = DemoState->GraphAppendSeedPipeline;
+            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+            VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, DispatchY, 1);
+
+            VkBarrierBufferAdd(Commands, DemoState->NodePosBuffer,
+                               VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+            VkBarrierBufferAdd(Commands, DemoState->NodeStateBuffer,
+                               VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+            VkCommandsBarrierFlush(Commands);
+        }
+    }
+
+    EndTempMem(TempMem);
+    return Result;
+}
+
+inline void GraphAppendStreamTest(vk_commands* Commands)
+{
+    temp_mem TempMem = BeginTempMem(&DemoState->TempArena);
+
+    u32 NumOldNodes = DemoState->NumGraphNodes;
+    graph_append_node* NewNodes = PushArray(&DemoState->TempArena, graph_append_node, GRAPH_STREAM_TEST_NODES);
+    graph_append_edge* NewEdges = PushArray(&DemoState->TempArena, graph_append_edge, GRAPH_STREAM_TEST_NODES * GRAPH_STREAM_TEST_EDGES_PER_NODE);
+    u32 NumNewEdges = 0;
+    for (u32 NodeId = 0; NodeId < GRAPH_STREAM_TEST_NODES; ++NodeId)
+    {
+        NewNodes[NodeId].Degree = 2.0f;
+        NewNodes[NodeId].Draw.Color = V3(0, 0, 1);
+        NewNodes[NodeId].Draw.Scale = 5.0f;
+
+        for (u32 EdgeId = 0; NumOldNodes > 0 && EdgeId < GRAPH_STREAM_TEST_EDGES_PER_NODE; ++EdgeId)
+        {
+            // NOTE: rand() only gives us 15 bits
+            graph_append_edge* NewEdge = NewEdges + NumNewEdges++;
+            NewEdge->NodeA = NumOldNodes + NodeId;
+            NewEdge->NodeB = ((u32(rand()) << 15) ^ u32(rand())) % NumOldNodes;
+            NewEdge->Weight = 1.0f;
+            NewEdge->Color = ((0u & 0xFF) << 0) | ((120u & 0xFF) << 8) | ((255u & 0xFF) << 16) | ((0xFFu & 0xFF) << 24);
+        }
+    }
+
+    if (!GraphAppend(Commands, GRAPH_STREAM_TEST_NODES, NewNodes, NumNewEdges, NewEdges))
+    {
+        // NOTE: We ran out of spare capacity
+        DemoState->StreamTestEnabled = false;
+    }
+    
+    EndTempMem(TempMem);
+}
+
+//
+// NOTE: Graph Simulation
+//
+
+inline void GraphDispatchActive(vk_commands* Commands, vk_pipeline* Pipeline, VkDescriptorSet* DescriptorSets, u32 NumDescriptorSets)
+{
+    // NOTE: GRAPH_ACTIVE_DISPATCH_ARGS wrote the group count for the active node list
+    vkCmdBindPipeline(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Handle);
+    vkCmdBindDescriptorSets(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Layout, 0, NumDescriptorSets, DescriptorSets, 0, 0);
+    vkCmdDispatchIndirect(Commands->Buffer, DemoState->ActiveSetBuffer, 0);
+}
+
+inline void GridBarrier(vk_commands* Commands, VkBuffer Buffer)
+{
+    VkBarrierBufferAdd(Commands, Buffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+}
+
+inline void GraphGridRepulsion(vk_commands* Commands, graph_level* SimLevel, b32 FullPass)
+{
+    /*
+      NOTE: Rebuilds the cell list of the sim level and adds the grid repulsion to the node forces. Every step is linear in the
+            number of nodes or cells, so unlike the radix tree we can afford to rebuild it from scratch every iteration.
+     */
+    u32 NodeDispatchX = DispatchSize(SimLevel->NumNodes, 32);
+    u32 NodeDispatchY = 1;
+    if (NodeDispatchX > MAX_THREAD_GROUPS)
+    {
+        NodeDispatchX = 64;
+        NodeDispatchY = DispatchSize(SimLevel->NumNodes, 32 * NodeDispatchX);
+    }
+    
+    VkDescriptorSet GridSets[] =
+        {
+            DemoState->GridDescriptor,
+            SimLevel->Descriptor,
+        };
+
+    // NOTE: Reset the bounds to an empty box and the per cell counters
+    {
+        vkCmdFillBuffer(Commands->Buffer, DemoState->GridBoundsBuffer, 0, 2 * sizeof(u32), 0xFFFFFFFF);
+        vkCmdFillBuffer(Commands->Buffer, DemoState->GridBoundsBuffer, 2 * sizeof(u32), 2 * sizeof(u32), 0);
+        vkCmdFillBuffer(Commands->Buffer, DemoState->GridCellCountBuffer, 0, sizeof(u32) * GRID_NUM_CELLS, 0);
+
+        VkBarrierBufferAdd(Commands, DemoState->GridBoundsBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkBarrierBufferAdd(Commands, DemoState->GridCellCountBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+    }
+
+    VkComputeDispatch(Commands, DemoState->GridBoundsPipeline, GridSets, ArrayCount(GridSets), NodeDispatchX, NodeDispatchY, 1);
+    GridBarrier(Commands, DemoState->GridBoundsBuffer);
+
+    VkComputeDispatch(Commands, DemoState->GridCellIdsPipeline, GridSets, ArrayCount(GridSets), NodeDispatchX, NodeDispatchY, 1);
+    VkBarrierBufferAdd(Commands, DemoState->NodeCellIdBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->GridNodeRankBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    GridBarrier(Commands, DemoState->GridCellCountBuffer);
+
+    VkComputeDispatch(Commands, DemoState->GridScanPipeline, GridSets, ArrayCount(GridSets), 1, 1, 1);
+    GridBarrier(Commands, DemoState->GridCellStartBuffer);
+
+    VkComputeDispatch(Commands, DemoState->GridScatterPipeline, GridSets, ArrayCount(GridSets), NodeDispatchX, NodeDispatchY, 1);
+    GridBarrier(Commands, DemoState->GridCellNodeBuffer);
+
+    // NOTE: Build the centre of mass pyramid, each level reads the level below it
+    VkComputeDispatch(Commands, DemoState->GridSummaryPipeline, GridSets, ArrayCount(GridSets), DispatchSize(GRID_NUM_CELLS, 32), 1, 1);
+    GridBarrier(Commands, DemoState->GridCellSummaryBuffer);
+    for (u32 LevelId = 1; LevelId < GRID_NUM_LEVELS; ++LevelId)
+    {
+        u32 LevelAxis = GRID_CELLS_AXIS >> LevelId;
+        
+        grid_pyramid_constants PushConstants = {};
+        PushConstants.Level = LevelId;
+        vkCmdPushConstants(Commands->Buffer, DemoState->GridPyramidPipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &PushConstants);
+        VkComputeDispatch(Commands, DemoState->GridPyramidPipeline, GridSets, ArrayCount(GridSets), DispatchSize(LevelAxis * LevelAxis, 32), 1, 1);
+        GridBarrier(Commands, DemoState->GridCellSummaryBuffer);
+    }
+
+    if (FullPass)
+    {
+        VkComputeDispatch(Commands, DemoState->GridRepulsionPipeline, GridSets, ArrayCount(GridSets), NodeDispatchX, NodeDispatchY, 1);
+    }
+    else
+    {
+        GraphDispatchActive(Commands, DemoState->GridRepulsionActivePipeline, GridSets, ArrayCount(GridSets));
+    }
+}
+
+inline void FmmBarrier(vk_commands* Commands, VkBuffer Buffer)
+{
+    VkBarrierBufferAdd(Commands, Buffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+inline void GraphFmmRepulsion(vk_commands* Commands, graph_level* SimLevel, b32 FullPass, u32 DispatchX, u32 DispatchY)
+{
+    /*
+      NOTE: Expects the radix tree to be built and its atomics cleared. The upward pass and the depth buckets only depend on the
+            tree, then FMM_WALK builds the interaction lists of the whole tree in a few rounds. We run 1 indirect FMM_DOWNWARD pass per
+            depth that last frame's tree had plus some slack (empty depths dispatch 0 groups), and evaluate the leaves, or only the
+            leaves of the active nodes if this isn't a full pass.
+     */
+    VkDescriptorSet FmmSets[] =
+        {
+            DemoState->FmmDescriptor,
+            DemoState->RadixTreeDescriptor,
+            SimLevel->Descriptor,
+        };
+
+    // NOTE: The stats are from last frame's tree, VkCommandsBegin waited on its fence
+    fmm_stats* Stats = DemoState->FmmStatsCpu;
+    if (Stats->ListOverflow && !DemoState->FmmListOverflowLogged)
+    {
+        DebugPrintLog("FMM interaction lists need %u entries but the pool has %u, replaying the walk per target instead\n",
+                      Stats->NumListEntries, DemoState->FmmMaxListEntries);
+        DemoState->FmmListOverflowLogged = true;
+    }
+
+    vkCmdFillBuffer(Commands->Buffer, DemoState->FmmLevelCountBuffer, 0, sizeof(u32) * FMM_MAX_DEPTH, 0);
+    vkCmdFillBuffer(Commands->Buffer, DemoState->FmmWalkStateBuffer, 0, sizeof(fmm_walk_state), 0);
+    VkBarrierBufferAdd(Commands, DemoState->FmmLevelCountBuffer,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->FmmWalkStateBuffer,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    // NOTE: These also reset the list heads of every node
+    VkComputeDispatch(Commands, DemoState->FmmUpwardPipeline, FmmSets, ArrayCount(FmmSets), DispatchX, DispatchY, 1);
+    VkComputeDispatch(Commands, DemoState->FmmDepthPipeline, FmmSets, ArrayCount(FmmSets), DispatchX, DispatchY, 1);
+    FmmBarrier(Commands, DemoState->FmmLevelCountBuffer);
+    FmmBarrier(Commands, DemoState->FmmNodeLevelBuffer);
+    FmmBarrier(Commands, DemoState->FmmGraphNodeLeafBuffer);
+    FmmBarrier(Commands, DemoState->FmmNodeBoxBuffer);
+    FmmBarrier(Commands, DemoState->FmmMultipoleBuffer);
+    FmmBarrier(Commands, DemoState->FmmExpandHeadBuffer);
+    FmmBarrier(Commands, DemoState->FmmNearHeadBuffer);
+    VkCommandsBarrierFlush(Commands);
+
+    /*
+      NOTE: Round r of the walk has at most 2^r pairs, and we stop splitting before a round could have more pairs than nodes since
+            that is the size of each half of FmmWalkPairBuffer. The last round finishes every pair left depth first.
+     */
+    {
+        u32 NumWalkRounds = 0;
+        while (NumWalkRounds < FMM_MAX_WALK_ROUNDS && (u64(2) << NumWalkRounds) <= u64(SimLevel->NumNodes))
+        {
+            NumWalkRounds += 1;
+        }
+
+        vk_pipeline* Pipeline = DemoState->FmmWalkPipeline;
+        vkCmdBindPipeline(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Handle);
+        vkCmdBindDescriptorSets(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Layout, 0, ArrayCount(FmmSets), FmmSets, 0, 0);
+        for (u32 Round = 0; Round <= NumWalkRounds; ++Round)
+        {
+            fmm_walk_constants PushConstants = {};
+            PushConstants.Round = Round;
+            PushConstants.Final = Round == NumWalkRounds;
+            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &PushConstants);
+
+            u32 MaxNumPairs = 1u << Round;
+            u32 WalkDispatchX = DispatchSize(MaxNumPairs, 32);
+            u32 WalkDispatchY = 1;
+            if (WalkDispatchX > MAX_THREAD_GROUPS)
+            {
+                WalkDispatchX = 64;
+                WalkDispatchY = DispatchSize(MaxNumPairs, 32 * WalkDispatchX);
+            }
+            vkCmdDispatch(Commands->Buffer, WalkDispatchX, WalkDispatchY, 1);
+
+            FmmBarrier(Commands, DemoState->FmmWalkStateBuffer);
+            FmmBarrier(Commands, DemoState->FmmWalkPairBuffer);
+            VkCommandsBarrierFlush(Commands);
+        }
+    }
+
+    VkComputeDispatch(Commands, DemoState->FmmLevelScanPipeline, FmmSets, ArrayCount(FmmSets), 1, 1, 1);
+    FmmBarrier(Commands, DemoState->FmmLevelStartBuffer);
+    VkBarrierBufferAdd(Commands, DemoState->FmmStatsBuffer,
+                       VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    VkComputeDispatch(Commands, DemoState->FmmLevelScatterPipeline, FmmSets, ArrayCount(FmmSets), DispatchX, DispatchY, 1);
+    VkBarrierBufferAdd(Commands, DemoState->FmmLevelDispatchBuffer,
+                       VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+    FmmBarrier(Commands, DemoState->FmmLevelNodeBuffer);
+    FmmBarrier(Commands, DemoState->FmmExpandHeadBuffer);
+    FmmBarrier(Commands, DemoState->FmmNearHeadBuffer);
+    FmmBarrier(Commands, DemoState->FmmListEntryBuffer);
+    VkCommandsBarrierFlush(Commands);
+
+    // NOTE: Every depth reads the local expansions the depth above it wrote
+    {
+        u32 NumDownwardPasses = Min(u32(FMM_MAX_DEPTH), Stats->MaxDepth + 1 + FMM_DOWNWARD_DEPTH_SLACK);
+
+        vk_pipeline* Pipeline = DemoState->FmmDownwardPipeline;
+        vkCmdBindPipeline(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Handle);
+        vkCmdBindDescriptorSets(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Layout, 0, ArrayCount(FmmSets), FmmSets, 0, 0);
+        for (u32 Depth = 0; Depth < NumDownwardPasses; ++Depth)
+        {
+            fmm_downward_constants PushConstants = {};
+            PushConstants.Depth = Depth;
+            PushConstants.LastPass = Depth + 1 == NumDownwardPasses;
+            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &PushConstants);
+            vkCmdDispatchIndirect(Commands->Buffer, DemoState->FmmLevelDispatchBuffer, sizeof(u32) * 4 * Depth);
+
+            FmmBarrier(Commands, DemoState->FmmLocalBuffer);
+            VkCommandsBarrierFlush(Commands);
+        }
+    }
+
+    if (FullPass)
+    {
+        VkComputeDispatch(Commands, DemoState->FmmEvaluatePipeline, FmmSets, ArrayCount(FmmSets), DispatchX, DispatchY, 1);
+    }
+    else
+    {
+        GraphDispatchActive(Commands, DemoState->FmmEvaluateActivePipeline, FmmSets, ArrayCount(FmmSets));
+    }
+}
+
+inline void GraphRadixTreeRepulsion(vk_commands* Commands, graph_level* SimLevel, b32 FullPass)
+{
+    /*
+      NOTE: Rebuilds the LBVH of the sim level from its Morton keys and adds its repulsion to the node forces, either through
+            GraphFmmRepulsion or the Barnes-Hut walk in RADIX_TREE_REPULSION depending on RADIX_TREE_FMM. The tree always covers
+            every node since they all repulse, the active set only cuts down which nodes we compute the repulsion for.
+     */
+    u32 GraphDispatchX = DispatchSize(SimLevel->NumNodes, 32);
+    u32 GraphDispatchY = 1;
+    if (GraphDispatchX > MAX_THREAD_GROUPS)
+    {
+        GraphDispatchX = 64;
+        GraphDispatchY = DispatchSize(SimLevel->NumNodes, 32 * GraphDispatchX);
+    }
+
+    // TODO: There is a bug still with sometimes everything collapsing?
+    VkDescriptorSet RadixDescriptorSets[] =
+        {
+            DemoState->RadixTreeDescriptor,
+            SimLevel->Descriptor,
+        };
+
+    // NOTE: Graph Calc Node Bounds
+    {
+        u32 BoundsDispatchX = CalcReductionNumThreadGroups(SimLevel->NumNodes);
+        u32 BoundsDispatchY = 1;
+        if (BoundsDispatchX > MAX_THREAD_GROUPS)
+        {
+            u32 NumThreadGroups = BoundsDispatchX;
+            BoundsDispatchX = 64;
+            BoundsDispatchY = DispatchSize(NumThreadGroups, BoundsDispatchX);
+        }
+        
+        VkComputeDispatch(Commands, DemoState->CalcWorldBoundsPipeline, RadixDescriptorSets, ArrayCount(RadixDescriptorSets), BoundsDispatchX, BoundsDispatchY, 1);
+    }
+
+    VkBarrierBufferAdd(Commands, DemoState->ElementBoundsBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    // NOTE: Generate and Sort Morton Keys
+    {
+        // NOTE: Reuse the last sort's order while it stays close to sorted, see MortonKeysCoherentSort
+        b32 CoherentSort = (DemoState->MortonCoherentEnabled &&
+                            DemoState->MortonSortedNumNodes == SimLevel->NumNodes &&
+                            DemoState->MortonNumCoherentSorts < MORTON_COHERENT_REFRESH_INTERVAL &&
+                            f32(DemoState->MortonSortStatsCpu->DisorderCount) <= MORTON_COHERENT_DISORDER_THRESHOLD * f32(SimLevel->NumNodes));
+        
+        // NOTE: Generate Morton Keys, this resets the element remapping so the coherent sort skips it and gathers in last frame's order
+        if (!CoherentSort)
+        {
+            vk_pipeline* Pipeline = DemoState->GenerateMortonKeysPipeline;
+            VkComputeDispatch(Commands, Pipeline, RadixDescriptorSets, ArrayCount(RadixDescriptorSets), GraphDispatchX, GraphDispatchY, 1);
+
+            VkBarrierBufferAdd(Commands, DemoState->RadixMortonKeyBuffer,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            VkBarrierBufferAdd(Commands, DemoState->RadixSortedMortonKeyBuffer,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            VkBarrierBufferAdd(Commands, DemoState->RadixElementReMappingBuffer,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            VkCommandsBarrierFlush(Commands);
+        }
+
+        u32 SortBackend = GpuSortPickBackend(DemoState->MortonSortBackend, SimLevel->NumNodes, GpuSortFlag_Stable);
+        if (CoherentSort)
+        {
+            MortonKeysCoherentSort(Commands, SimLevel, GraphDispatchX, GraphDispatchY);
+            DemoState->MortonNumCoherentSorts += 1;
+        }
+        else if (GpuSortBackendIsStable(SortBackend))
+        {
+            // NOTE: Sorts the full 64 bit keys with ties ordered by element index. Its word sort is MortonSort, so the sorted element
+            // indices end up in ElementReMapping
+            GpuSortKeys64(Commands, &DemoState->MortonSort64, SimLevel->NumNodes, SortBackend);
+        }
+        else
+        {
+            // NOTE: The bitonic sorts aren't stable, so we only sort the high word of the keys and build the tree from the high word only
+            GpuSortKeys(Commands, &DemoState->MortonSort, SimLevel->NumNodes, SortBackend);
+            MortonKeysGather(Commands, SimLevel, MortonGatherType_HighKey, GraphDispatchX, GraphDispatchY);
+        }
+
+        if (!CoherentSort)
+        {
+            // NOTE: Nothing is out of order after a full sort, the stats only get written again by the next coherent sort
+            DemoState->MortonSortedNumNodes = SimLevel->NumNodes;
+            DemoState->MortonNumCoherentSorts = 0;
+            DemoState->MortonSortStatsCpu->DisorderCount = 0;
+        }
+    }
+
+    // NOTE: Build Radix Tree
+    VkComputeDispatch(Commands, DemoState->RadixTreeBuildPipeline, RadixDescriptorSets, ArrayCount(RadixDescriptorSets), GraphDispatchX, GraphDispatchY, 1);
+
+    // NOTE: Clear Radix Tree Atomics
+    vkCmdFillBuffer(Commands->Buffer, DemoState->RadixTreeAtomicsBuffer, 0, sizeof(u32) * (SimLevel->NumNodes - 1), 0);
+    
+    VkBarrierBufferAdd(Commands, DemoState->RadixTreeChildrenBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->RadixTreeParentBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->RadixTreeAtomicsBuffer,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+#if RADIX_TREE_FMM
+    GraphFmmRepulsion(Commands, SimLevel, FullPass, GraphDispatchX, GraphDispatchY);
+#else
+    // NOTE: Summarize Radix Tree
+    VkComputeDispatch(Commands, DemoState->RadixTreeSummarizePipeline, RadixDescriptorSets, ArrayCount(RadixDescriptorSets), GraphDispatchX, GraphDispatchY, 1);
+    
+    VkBarrierBufferAdd(Commands, DemoState->RadixTreeParticleBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    // NOTE: Calculate Repulsion
+    if (FullPass)
+    {
+        VkComputeDispatch(Commands, DemoState->RadixTreeRepulsionPipeline, RadixDescriptorSets, ArrayCount(RadixDescriptorSets), GraphDispatchX, GraphDispatchY, 1);
+    }
+    else
+    {
+        GraphDispatchActive(Commands, DemoState->RadixTreeRepulsionActivePipeline, RadixDescriptorSets, ArrayCount(RadixDescriptorSets));
+    }
+#endif
+}
+
+inline void GraphShardCopy(vk_commands* Commands, u32 ShardId)
+{
+    u32 WindowId = ShardId % 2;
+    graph_shard* Shard = DemoState->Shards + ShardId;
+    if (DemoState->ShardWindowIds[WindowId] == ShardId || Shard->NumEdges == 0)
+    {
+        return;
+    }
+
+    VkBufferCopy EdgeCopy = {};
+    EdgeCopy.srcOffset = sizeof(graph_edge) * u64(Shard->FirstEdge);
+    EdgeCopy.dstOffset = 0;
+    EdgeCopy.size = sizeof(graph_edge) * u64(Shard->NumEdges);
+    vkCmdCopyBuffer(Commands->Buffer, DemoState->EdgeStoreBuffer, DemoState->ShardEdgeBuffers[WindowId], 1, &EdgeCopy);
+
+    VkBufferCopy EdgeSourceCopy = {};
+    EdgeSourceCopy.srcOffset = sizeof(u32) * u64(Shard->FirstEdge);
+    EdgeSourceCopy.dstOffset = 0;
+    EdgeSourceCopy.size = sizeof(u32) * u64(Shard->NumEdges);
+    vkCmdCopyBuffer(Commands->Buffer, DemoState->EdgeSourceStoreBuffer, DemoState->ShardEdgeSourceBuffers[WindowId], 1, &EdgeSourceCopy);
+
+    DemoState->ShardWindowIds[WindowId] = ShardId;
+}
+
+inline void GraphShardBarrier(vk_commands* Commands)
 {
-    u32 Result = 1;
-    u32 NumGroupsInPass = CeilU32(f32(DemoState->NumGraphNodes) / 32.0f);
-    while (NumGroupsInPass > 1)
+    // NOTE: Covers the compute work and the copies of both windows, plus the forces the shards write
+    for (u32 WindowId = 0; WindowId < ArrayCount(DemoState->ShardDescriptors); ++WindowId)
     {
-        Result += NumGroupsInPass;
-        NumGroupsInPass = CeilU32(f32(NumGroupsInPass) / 32.0f);
+        VkBarrierBufferAdd(Commands, DemoState->ShardEdgeBuffers[WindowId],
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkBarrierBufferAdd(Commands, DemoState->ShardEdgeSourceBuffers[WindowId],
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkBarrierBufferAdd(Commands, DemoState->ShardCarryBuffers[WindowId],
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
     }
+    VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+}
 
-    return Result;
+/*
+  NOTE: Runs the attraction of level 0 out of core. We record the copy of shard i + 1 before the attraction of shard i so that the
+        2 overlap. The barrier after the attraction of shard i - 1 already freed the window that copy overwrites, and the barrier
+        after the attraction of shard i makes the copy visible to shard i + 1, so the copies never wait on the shard that is running.
+        Shards own disjoint nodes, so their writes to the node forces don't overlap.
+ */
+inline void GraphShardAttraction(vk_commands* Commands, graph_level* SimLevel)
+{
+    GraphShardBarrier(Commands);
+    GraphShardCopy(Commands, 0);
+    GraphShardBarrier(Commands);
+    
+    for (u32 ShardId = 0; ShardId < DemoState->NumShards; ++ShardId)
+    {
+        u32 WindowId = ShardId % 2;
+        graph_shard* Shard = DemoState->Shards + ShardId;
+        if (ShardId + 1 < DemoState->NumShards)
+        {
+            GraphShardCopy(Commands, ShardId + 1);
+        }
+        
+        VkDescriptorSet DescriptorSets[] =
+            {
+                SimLevel->Descriptor,
+                DemoState->ShardDescriptors[WindowId],
+            };
+
+        if (Shard->NumEdges > 0)
+        {
+            u32 EdgesDispatchX = DispatchSize(Shard->NumEdges, ATTRACTION_EDGES_PER_GROUP);
+            u32 EdgesDispatchY = 1;
+            if (EdgesDispatchX > MAX_THREAD_GROUPS)
+            {
+                EdgesDispatchX = 64;
+                EdgesDispatchY = DispatchSize(Shard->NumEdges, ATTRACTION_EDGES_PER_GROUP * EdgesDispatchX);
+            }
+
+            vk_pipeline* Pipeline = DemoState->GraphAttractionEdgesShardPipeline;
+            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(graph_shard), Shard);
+            VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), EdgesDispatchX, EdgesDispatchY, 1);
+        }
+
+        GraphShardBarrier(Commands);
+
+        {
+            u32 NodesDispatchX = DispatchSize(Shard->NumNodes, 32);
+            u32 NodesDispatchY = 1;
+            if (NodesDispatchX > MAX_THREAD_GROUPS)
+            {
+                NodesDispatchX = 64;
+                NodesDispatchY = DispatchSize(Shard->NumNodes, 32 * NodesDispatchX);
+            }
+
+            vk_pipeline* Pipeline = DemoState->GraphMoveConnectionsShardPipeline;
+            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(graph_shard), Shard);
+            VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), NodesDispatchX, NodesDispatchY, 1);
+        }
+    }
+}
+
+inline void GraphSimulateIteration(vk_commands* Commands, graph_level* SimLevel, b32 FullPass)
+{
+    u32 GraphDispatchX = DispatchSize(SimLevel->NumNodes, 32);
+    u32 GraphDispatchY = 1;
+
+    if (GraphDispatchX > MAX_THREAD_GROUPS)
+    {
+        GraphDispatchX = 64;
+        GraphDispatchY = DispatchSize(SimLevel->NumNodes, 32 * GraphDispatchX);
+    }
+    
+    VkDescriptorSet GraphSimSets[] =
+        {
+            SimLevel->Descriptor,
+        };
+    
+    VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+    
+    // NOTE: Graph Attraction
+    if (FullPass && GraphLevelOutOfCore(SimLevel))
+    {
+        GraphShardAttraction(Commands, SimLevel);
+    }
+    else if (FullPass)
+    {
+        u32 EdgesDispatchX = DispatchSize(SimLevel->NumEdges, ATTRACTION_EDGES_PER_GROUP);
+        u32 EdgesDispatchY = 1;
+        if (EdgesDispatchX > MAX_THREAD_GROUPS)
+        {
+            EdgesDispatchX = 64;
+            EdgesDispatchY = DispatchSize(SimLevel->NumEdges, ATTRACTION_EDGES_PER_GROUP * EdgesDispatchX);
+        }
+
+        VkComputeDispatch(Commands, DemoState->GraphAttractionEdgesPipeline, GraphSimSets, ArrayCount(GraphSimSets), EdgesDispatchX, EdgesDispatchY, 1);
+
+        VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkBarrierBufferAdd(Commands, DemoState->AttractionCarryBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+        
+        VkComputeDispatch(Commands, DemoState->GraphMoveConnectionsPipeline, GraphSimSets, ArrayCount(GraphSimSets), GraphDispatchX, GraphDispatchY, 1);
+    }
+    else
+    {
+        // NOTE: Build the active node list from the flags the last GRAPH_UPDATE_NODES wrote
+        VkComputeDispatch(Commands, DemoState->GraphActiveCompactPipeline, GraphSimSets, ArrayCount(GraphSimSets), GraphDispatchX, GraphDispatchY, 1);
+
+        VkBarrierBufferAdd(Commands, DemoState->ActiveSetBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        VkComputeDispatch(Commands, DemoState->GraphActiveDispatchArgsPipeline, GraphSimSets, ArrayCount(GraphSimSets), 1, 1, 1);
+
+        VkBarrierBufferAdd(Commands, DemoState->ActiveSetBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkBarrierBufferAdd(Commands, DemoState->ActiveNodeBuffer,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        GraphDispatchActive(Commands, DemoState->GraphMoveConnectionsActivePipeline, GraphSimSets, ArrayCount(GraphSimSets));
+    }
+
+    VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->NodeCellIdBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+    
+    // NOTE: Graph Repulsion
+    {
+        // NOTE: Out of core graphs are too big for the n^2 repulsion, the cell list summaries stand in for the nodes of far shards
+        b32 RadixTreeRepulsion = false;
+        if (DemoState->GridRepulsionEnabled || GraphLevelOutOfCore(SimLevel))
+        {
+            GraphGridRepulsion(Commands, SimLevel, FullPass);
+        }
+        else if (DemoState->RadixTreeRepulsionEnabled && SimLevel->NumNodes > 1)
+        {
+            GraphRadixTreeRepulsion(Commands, SimLevel, FullPass);
+            RadixTreeRepulsion = true;
+        }
+        else if (FullPass)
+        {
+            VkComputeDispatch(Commands, DemoState->GraphRepulsionPipeline, GraphSimSets, ArrayCount(GraphSimSets), GraphDispatchX, GraphDispatchY, 1);
+        }
+        else
+        {
+            GraphDispatchActive(Commands, DemoState->GraphRepulsionActivePipeline, GraphSimSets, ArrayCount(GraphSimSets));
+        }
+
+        if (!RadixTreeRepulsion)
+        {
+            // NOTE: The nodes keep moving while the radix tree is off, so the coherent sort can't start from its last order anymore
+            DemoState->MortonSortedNumNodes = 0;
+        }
+
+        VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+    }
+
+    // NOTE: Graph Calc Global Speed
+    {
+        u32 GlobalSpeedDispatchX = CalcReductionNumThreadGroups(SimLevel->NumNodes);
+        u32 GlobalSpeedDispatchY = 1;
+        if (GlobalSpeedDispatchX > MAX_THREAD_GROUPS)
+        {
+            u32 NumThreadGroups = GlobalSpeedDispatchX;
+            GlobalSpeedDispatchX = 64;
+            GlobalSpeedDispatchY = DispatchSize(NumThreadGroups, GlobalSpeedDispatchX);
+        }
+        
+        VkComputeDispatch(Commands, DemoState->GraphCalcGlobalSpeedPipeline, GraphSimSets, ArrayCount(GraphSimSets), GlobalSpeedDispatchX, GlobalSpeedDispatchY, 1);
+    }
+    
+    VkBarrierBufferAdd(Commands, DemoState->GlobalMoveBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->GlobalMoveStatsBuffer,
+                       VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    // NOTE: Graph Update Nodes
+    if (FullPass)
+    {
+        VkComputeDispatch(Commands, DemoState->GraphUpdateNodesPipeline, GraphSimSets, ArrayCount(GraphSimSets), GraphDispatchX, GraphDispatchY, 1);
+    }
+    else
+    {
+        GraphDispatchActive(Commands, DemoState->GraphUpdateNodesActivePipeline, GraphSimSets, ArrayCount(GraphSimSets));
+    }
+
+    // NOTE: The next iteration reads the positions and forces we just wrote and overwrites the global move
+#if GRAPH_PACKED_NODE_STATE
+    VkBarrierBufferAdd(Commands, SimLevel->NodeStateBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->NodePrevForceHalfBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+#else
+    VkBarrierBufferAdd(Commands, SimLevel->NodePosBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->NodePrevForceBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+#endif
+    VkBarrierBufferAdd(Commands, DemoState->GlobalMoveBuffer,
+                       VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, DemoState->NodeActiveBuffer,
+                       VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+}
+
+inline void GraphSimulateFused(vk_commands* Commands, graph_level* SimLevel, u32 NumIterations)
+{
+    // NOTE: Every frame starts from state 0 with final positions, see GRAPH_FUSED_LAYOUT in graph_shaders.cpp
+    u32 GraphDispatchX = DispatchSize(SimLevel->NumNodes, 32);
+    u32 GraphDispatchY = 1;
+    if (GraphDispatchX > MAX_THREAD_GROUPS)
+    {
+        GraphDispatchX = 64;
+        GraphDispatchY = DispatchSize(SimLevel->NumNodes, 32 * GraphDispatchX);
+    }
+
+#if GRAPH_PACKED_NODE_STATE
+    VkBuffer State0PosBuffer = SimLevel->NodeStateBuffer;
+    VkBuffer State0ForceBuffer = DemoState->NodePrevForceHalfBuffer;
+#else
+    VkBuffer State0PosBuffer = SimLevel->NodePosBuffer;
+    VkBuffer State0ForceBuffer = DemoState->NodePrevForceBuffer;
+#endif
+
+    for (u32 IterationId = 0; IterationId < NumIterations; ++IterationId)
+    {
+        VkDescriptorSet DescriptorSets[] =
+            {
+                SimLevel->Descriptor,
+                SimLevel->FusedDescriptors[IterationId & 1],
+            };
+
+        graph_fused_constants Constants = {};
+        Constants.ApplyPendingMove = IterationId > 0;
+
+        vk_pipeline* Pipeline = DemoState->GraphFusedLayoutPipeline;
+        vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+        VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), GraphDispatchX, GraphDispatchY, 1);
+
+        // NOTE: The state we wrote gets read next, the state we read gets overwritten next
+        VkBuffer StateBuffers[] =
+            {
+                State0PosBuffer,
+                DemoState->FusedPosBuffer,
+                DemoState->NodeForceBuffer,
+                State0ForceBuffer,
+                DemoState->FusedSwingBuffers[0],
+                DemoState->FusedSwingBuffers[1],
+                DemoState->GlobalMoveBuffer,
+            };
+        for (u32 BufferId = 0; BufferId < ArrayCount(StateBuffers); ++BufferId)
+        {
+            VkBarrierBufferAdd(Commands, StateBuffers[BufferId],
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+        VkBarrierBufferAdd(Commands, DemoState->GlobalMoveStatsBuffer,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+        VkCommandsBarrierFlush(Commands);
+    }
+
+    // NOTE: Apply the last pending move and write it to state 0, so the rest of the frame (and the unfused path) finds it there
+    u32 StateId = NumIterations & 1;
+    {
+        VkDescriptorSet DescriptorSets[] =
+            {
+                SimLevel->Descriptor,
+                SimLevel->FusedDescriptors[StateId],
+            };
+
+        graph_fused_constants Constants = {};
+        Constants.ApplyPendingMove = 1;
+
+        vk_pipeline* Pipeline = DemoState->GraphFusedResolvePipeline;
+        vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+        VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), GraphDispatchX, GraphDispatchY, 1);
+    }
+
+    VkBarrierBufferAdd(Commands, State0PosBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, State0ForceBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+}
+
+inline void GraphUniformsUpload(vk_commands* Commands, graph_level* SimLevel, f32 FrameTime)
+{
+    render_scene* Scene = &DemoState->Scene;
+
+    {
+        graph_globals* GpuData = VkCommandsPushWriteStruct(Commands, DemoState->GraphGlobalsBuffer, graph_globals,
+                                                          BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                          BarrierMask(VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+
+        GpuData->VPTransform = CameraGetVP(&Scene->Camera);
+        GpuData->ViewPort = V2(RenderState->WindowWidth, RenderState->WindowHeight);
+        GpuData->FrameTime = FrameTime;
+        GpuData->NumNodes = SimLevel->NumNodes;
+        GpuData->NumEdges = SimLevel->NumEdges;
+
+        GpuData->AttractionMultiplier = DemoState->AttractionMultiplier;
+        GpuData->AttractionWeightPower = DemoState->AttractionWeightPower;
+        GpuData->RepulsionMultiplier = DemoState->RepulsionMultiplier;
+        GpuData->RepulsionSoftner = DemoState->RepulsionSoftner;
+        GpuData->GravityMultiplier = DemoState->GravityMultiplier;
+        GpuData->StrongGravityEnabled = DemoState->StrongGravityEnabled;
+
+        GpuData->CellDim = DemoState->CellWorldDim;
+        GpuData->WorldRadius = DemoState->WorldRadius;
+        GpuData->NumCellsDim = DemoState->NumCellsAxis;
+
+        GpuData->NumThreadGroupsCalcNodeBounds = CalcReductionNumThreadGroups(SimLevel->NumNodes);
+        GpuData->NumThreadGroupsGlobalSpeed = CalcReductionNumThreadGroups(SimLevel->NumNodes);
+
+        GpuData->ActiveThreshold = DemoState->ActiveThreshold;
+    }
+
+    {
+        // NOTE: The radix tree and the Morton sorts run on whichever level we simulate
+        radix_tree_uniform_data* GpuData = VkCommandsPushWriteStruct(Commands, DemoState->RadixTreeUniformBuffer, radix_tree_uniform_data,
+                                                                     BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                                     BarrierMask(VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+        GpuData->NumNodes = SimLevel->NumNodes;
+    }
 }
 
-inline u32 CalcBoundsNumThreadGroups()
+#if FMM_REFERENCE_TEST
+
+inline f32 FmmGpuReferenceTest()
 {
-    u32 Result = 1;
-    u32 NumGroupsInPass = CeilU32(f32(DemoState->NumGraphNodes) / 32.0f);
-    while (NumGroupsInPass > 1)
+    /*
+      NOTE: Runs GraphRadixTreeRepulsion once on level 0 of the loaded graph, reads the positions, degrees and forces back and
+            compares the forces of FMM_REFERENCE_NUM_SAMPLES nodes against the direct n^2 sum. Expects the init commands to be
+            submitted already.
+     */
+    graph_level* Level = DemoState->GraphLevels + 0;
+    u32 NumNodes = Level->NumNodes;
+    if (NumNodes < 2)
+    {
+        return 0.0f;
+    }
+
+    u64 PosSize = sizeof(v2) * NumNodes;
+    u64 DegreeSize = sizeof(f32) * NumNodes;
+    u64 ForceSize = sizeof(v2) * NumNodes;
+    u64 ReadBackSize = PosSize + DegreeSize + ForceSize;
+    VkDeviceMemory ReadBackMemory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, ReadBackSize);
+    VkBuffer ReadBackBuffer = VkBufferCreate(RenderState->Device, ReadBackMemory, VK_BUFFER_USAGE_TRANSFER_DST_BIT, ReadBackSize);
+
+    vk_commands* Commands = &RenderState->Commands;
+    VkCommandsBegin(Commands, RenderState->Device);
+    {
+        GraphUniformsUpload(Commands, Level, 0.0f);
+        VkCommandsTransferFlush(Commands, RenderState->Device);
+        if (DemoState->NodeStateDirty)
+        {
+            GraphPackNodeState(Commands);
+        }
+
+        // NOTE: The repulsion adds to the forces
+        vkCmdFillBuffer(Commands->Buffer, DemoState->NodeForceBuffer, 0, ForceSize, 0);
+        VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        GraphRadixTreeRepulsion(Commands, Level, true);
+
+        VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        VkBufferCopy PosCopy = { 0, 0, PosSize };
+        VkBufferCopy DegreeCopy = { 0, PosSize, DegreeSize };
+        VkBufferCopy ForceCopy = { 0, PosSize + DegreeSize, ForceSize };
+        vkCmdCopyBuffer(Commands->Buffer, Level->NodePosBuffer, ReadBackBuffer, 1, &PosCopy);
+        vkCmdCopyBuffer(Commands->Buffer, Level->NodeDegreeBuffer, ReadBackBuffer, 1, &DegreeCopy);
+        vkCmdCopyBuffer(Commands->Buffer, DemoState->NodeForceBuffer, ReadBackBuffer, 1, &ForceCopy);
+
+        VkBarrierBufferAdd(Commands, ReadBackBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+        VkCommandsBarrierFlush(Commands);
+    }
+    VkCommandsSubmit(Commands, RenderState->Device, RenderState->GraphicsQueue);
+    VkCheckResult(vkQueueWaitIdle(RenderState->GraphicsQueue));
+
+    u8* ReadBack = 0;
+    VkCheckResult(vkMapMemory(RenderState->Device, ReadBackMemory, 0, ReadBackSize, 0, (void**)&ReadBack));
+    v2* NodePos = (v2*)ReadBack;
+    f32* NodeDegree = (f32*)(ReadBack + PosSize);
+    v2* GpuForces = (v2*)(ReadBack + PosSize + DegreeSize);
+
+    // NOTE: The direct sum is O(n) per node, so we only check an evenly spread sample
+    u32 NumSamples = Min(NumNodes, u32(FMM_REFERENCE_NUM_SAMPLES));
+    u32 SampleStride = NumNodes / NumSamples;
+    f32 ErrorSq = 0.0f;
+    f32 ForceSq = 0.0f;
+    f32 MaxRelativeError = 0.0f;
+    for (u32 SampleId = 0; SampleId < NumSamples; ++SampleId)
     {
-        Result += NumGroupsInPass;
-        NumGroupsInPass = CeilU32(f32(NumGroupsInPass) / 32.0f);
+        u32 NodeId = SampleId * SampleStride;
+        v2 DirectForce = FmmDirectForce(NumNodes, NodePos, NodeDegree, DemoState->RepulsionMultiplier, DemoState->RepulsionSoftner, NodeId);
+        f32 ErrorX = GpuForces[NodeId].x - DirectForce.x;
+        f32 ErrorY = GpuForces[NodeId].y - DirectForce.y;
+        f32 NodeErrorSq = ErrorX * ErrorX + ErrorY * ErrorY;
+        f32 NodeForceSq = DirectForce.x * DirectForce.x + DirectForce.y * DirectForce.y;
+        ErrorSq += NodeErrorSq;
+        ForceSq += NodeForceSq;
+        if (NodeForceSq > 0.0f)
+        {
+            MaxRelativeError = Max(MaxRelativeError, sqrtf(NodeErrorSq / NodeForceSq));
+        }
     }
 
+    f32 Result = ForceSq > 0.0f ? sqrtf(ErrorSq / ForceSq) : sqrtf(ErrorSq);
+    DebugPrintLog("FMM GPU Reference (%u nodes, %u samples, order %u): RMS relative error %e, max relative error %e\n", NumNodes, NumSamples,
+                  FMM_ORDER, Result, MaxRelativeError);
+    Assert(Result < FMM_REFERENCE_MAX_ERROR);
+
+    vkUnmapMemory(RenderState->Device, ReadBackMemory);
+    vkDestroyBuffer(RenderState->Device, ReadBackBuffer, 0);
+    vkFreeMemory(RenderState->Device, ReadBackMemory, 0);
+
+    // NOTE: We sorted level 0, but the layout starts on the coarsest level
+    DemoState->MortonSortedNumNodes = 0;
+
     return Result;
 }
 
+#endif
+
 //
 // NOTE: Asset Storage System
 //
@@ -936,6 +3269,10 @@ DEMO_INIT(Init)
         DemoState->TempArena = LinearSubArena(&DemoState->Arena, MegaBytes(10));
     }
 
+#if FMM_REFERENCE_TEST
+    FmmReferenceTest(&DemoState->TempArena, 4096);
+#endif
+
     ProfilerStateCreate(ProfilerFlag_OutputCsv | ProfilerFlag_AutoSetEndOfFrame);
 
     // NOTE: Init Vulkan
@@ -950,7 +3287,7 @@ DEMO_INIT(Init)
             InitParams.ValidationEnabled = true;
             InitParams.WindowWidth = WindowWidth;
             InitParams.WindowHeight = WindowHeight;
-            InitParams.GpuLocalSize = GigaBytes(1);
+            InitParams.GpuLocalSize = GRAPH_GPU_LOCAL_SIZE;
             InitParams.DeviceExtensionCount = ArrayCount(DeviceExtensions);
             InitParams.DeviceExtensions = DeviceExtensions;
             VkInit(VulkanLib, hInstance, WindowHandle, &DemoState->Arena, &DemoState->TempArena, InitParams);
@@ -998,6 +3335,16 @@ DEMO_INIT(Init)
                 VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
                 VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
                 VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
                 VkDescriptorLayoutEnd(RenderState->Device, &Builder);
             }
 
@@ -1006,6 +3353,10 @@ DEMO_INIT(Init)
                     DemoState->GraphDescLayout,
                 };
 
+            // NOTE: Graph Attraction Edges Pipeline
+            DemoState->GraphAttractionEdgesPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                              "shader_graph_attraction_edges.spv", "main", Layouts, ArrayCount(Layouts));
+
             // NOTE: Graph Move Connections Pipeline
             DemoState->GraphMoveConnectionsPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
                                                                               "shader_graph_move_connections.spv", "main", Layouts, ArrayCount(Layouts));
@@ -1021,8 +3372,99 @@ DEMO_INIT(Init)
             // NOTE: Graph Update Nodes Pipeline
             DemoState->GraphUpdateNodesPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
                                                                           "shader_graph_update_nodes.spv", "main", Layouts, ArrayCount(Layouts));
+
+            // NOTE: Graph Active Set Pipelines
+            DemoState->GraphActiveCompactPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                            "shader_graph_active_compact.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->GraphActiveDispatchArgsPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                                 "shader_graph_active_dispatch_args.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->GraphMoveConnectionsActivePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                                    "shader_graph_move_connections_active.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->GraphRepulsionActivePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                              "shader_graph_repulsion_active.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->GraphUpdateNodesActivePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                                "shader_graph_update_nodes_active.spv", "main", Layouts, ArrayCount(Layouts));
+
+            // NOTE: Graph Prolong Pipeline
+            DemoState->GraphProlongPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                      "shader_graph_prolong.spv", "main", Layouts, ArrayCount(Layouts), sizeof(graph_prolong_constants));
+
+            // NOTE: Graph Append Seed Pipeline
+            DemoState->GraphAppendSeedPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                         "shader_graph_append_seed.spv", "main", Layouts, ArrayCount(Layouts), sizeof(graph_append_seed_constants));
+
+            // NOTE: Graph Pack Node State Pipeline
+            DemoState->GraphPackNodeStatePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                            "shader_graph_pack_node_state.spv", "main", Layouts, ArrayCount(Layouts), sizeof(graph_pack_constants));
+
+            // NOTE: Graph Attraction Cache Pipeline
+            DemoState->GraphAttractionCachePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                              "shader_graph_attraction_cache.spv", "main", Layouts, ArrayCount(Layouts), sizeof(graph_attraction_cache_constants));
+        }
+
+        // NOTE: Fused Layout Data
+        {
+            {
+                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->FusedDescLayout);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+            }
+
+            VkDescriptorSetLayout Layouts[] =
+                {
+                    DemoState->GraphDescLayout,
+                    DemoState->FusedDescLayout,
+                };
+
+            // NOTE: Graph Fused Layout Pipeline
+            DemoState->GraphFusedLayoutPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                          "shader_graph_fused_layout.spv", "main", Layouts, ArrayCount(Layouts), sizeof(graph_fused_constants));
+
+            // NOTE: Graph Fused Resolve Pipeline
+            DemoState->GraphFusedResolvePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                           "shader_graph_fused_resolve.spv", "main", Layouts, ArrayCount(Layouts), sizeof(graph_fused_constants));
+        }
+        
+        // NOTE: Out Of Core Shard Data
+        {
+            {
+                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->ShardDescLayout);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+            }
+
+            VkDescriptorSetLayout Layouts[] =
+                {
+                    DemoState->GraphDescLayout,
+                    DemoState->ShardDescLayout,
+                };
+
+            // NOTE: Graph Attraction Edges Shard Pipeline
+            DemoState->GraphAttractionEdgesShardPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                                   "shader_graph_attraction_edges_shard.spv", "main", Layouts, ArrayCount(Layouts), sizeof(graph_shard));
+
+            // NOTE: Graph Move Connections Shard Pipeline
+            DemoState->GraphMoveConnectionsShardPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                                   "shader_graph_move_connections_shard.spv", "main", Layouts, ArrayCount(Layouts), sizeof(graph_shard));
         }
         
+        // NOTE: Init Layout Timer
+        {
+            VkQueryPoolCreateInfo QueryPoolInfo = {};
+            QueryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            QueryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            QueryPoolInfo.queryCount = 2;
+            VkCheckResult(vkCreateQueryPool(RenderState->Device, &QueryPoolInfo, 0, &DemoState->LayoutTimestampPool));
+            DemoState->TimestampPeriodNs = RenderState->DeviceLimits.timestampPeriod;
+        }
+
         // NOTE: Radix Tree Data
         {
             {
@@ -1037,6 +3479,10 @@ DEMO_INIT(Init)
                 VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
                 VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
                 VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
                 VkDescriptorLayoutEnd(RenderState->Device, &Builder);
             }
 
@@ -1050,6 +3496,18 @@ DEMO_INIT(Init)
             DemoState->GenerateMortonKeysPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
                                                                             "shader_generate_morton_keys.spv", "main", Layouts, ArrayCount(Layouts));
 
+            // NOTE: Gather Morton Keys
+            DemoState->MortonKeysGatherPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                          "shader_morton_keys_gather.spv", "main", Layouts, ArrayCount(Layouts), sizeof(u32));
+
+            // NOTE: Coherent Morton Sort
+            DemoState->MortonLocalSortPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                         "shader_morton_local_sort.spv", "main", Layouts, ArrayCount(Layouts), sizeof(u32));
+            DemoState->MortonCheckPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                     "shader_morton_check.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->MortonClampPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                     "shader_morton_clamp.spv", "main", Layouts, ArrayCount(Layouts));
+
             // NOTE: Calc World Bounds
             DemoState->CalcWorldBoundsPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
                                                                          "shader_calc_world_bounds.spv", "main", Layouts, ArrayCount(Layouts));
@@ -1065,94 +3523,123 @@ DEMO_INIT(Init)
             // NOTE: Radix Tree Repulsion
             DemoState->RadixTreeRepulsionPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
                                                                             "shader_radix_tree_repulsion.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->RadixTreeRepulsionActivePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                                  "shader_radix_tree_repulsion_active.spv", "main", Layouts, ArrayCount(Layouts));
         }        
 
-        // NOTE: Bitonic Merge Sort Pipelines
+        // NOTE: FMM Data
         {
             {
-                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->MergeSortDescLayout);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->FmmDescLayout);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
                 VkDescriptorLayoutEnd(RenderState->Device, &Builder);
             }
 
             VkDescriptorSetLayout Layouts[] =
                 {
+                    DemoState->FmmDescLayout,
                     DemoState->RadixTreeDescLayout,
                     DemoState->GraphDescLayout,
-                    DemoState->MergeSortDescLayout,
                 };
 
-            // NOTE: Local FD
-            DemoState->MergeSortLocalFdPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                          "shader_merge_local_fd.spv", "main", Layouts, ArrayCount(Layouts));
-
-            // NOTE: Global Flip
-            DemoState->MergeSortGlobalFlipPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                             "shader_merge_global_flip.spv", "main", Layouts, ArrayCount(Layouts));
-
-            // NOTE: Local Disperse
-            DemoState->MergeSortLocalDispersePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                                "shader_merge_local_disperse.spv", "main", Layouts, ArrayCount(Layouts));
-
-            // NOTE: Global Disperse
-            DemoState->MergeSortGlobalDispersePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                                 "shader_merge_global_disperse.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->FmmUpwardPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                   "shader_fmm_upward.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->FmmDepthPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                  "shader_fmm_depth.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->FmmLevelScanPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                      "shader_fmm_level_scan.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->FmmLevelScatterPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                         "shader_fmm_level_scatter.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->FmmWalkPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                 "shader_fmm_walk.spv", "main", Layouts, ArrayCount(Layouts), sizeof(fmm_walk_constants));
+            DemoState->FmmDownwardPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                     "shader_fmm_downward.spv", "main", Layouts, ArrayCount(Layouts), sizeof(fmm_downward_constants));
+            DemoState->FmmEvaluatePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                     "shader_fmm_evaluate.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->FmmEvaluateActivePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                           "shader_fmm_evaluate_active.spv", "main", Layouts, ArrayCount(Layouts));
         }
 
-        // NOTE: Parallel Sort Pipelines
+        // NOTE: Grid Repulsion Data
         {
             {
-                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->ParallelSortConstantDescLayout);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-                VkDescriptorLayoutEnd(RenderState->Device, &Builder);
-            }
-            
-            {
-                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->ParallelSortInputOutputDescLayout);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-                VkDescriptorLayoutEnd(RenderState->Device, &Builder);
-            }
-            
-            {
-                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->ParallelSortScanDescLayout);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-                VkDescriptorLayoutEnd(RenderState->Device, &Builder);
-            }
-            
-            {
-                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->ParallelSortScratchDescLayout);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->GridDescLayout);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
                 VkDescriptorLayoutEnd(RenderState->Device, &Builder);
             }
 
             VkDescriptorSetLayout Layouts[] =
                 {
-                    DemoState->ParallelSortConstantDescLayout,
-                    DemoState->ParallelSortInputOutputDescLayout,
-                    DemoState->ParallelSortScanDescLayout,
-                    DemoState->ParallelSortScratchDescLayout,
+                    DemoState->GridDescLayout,
+                    DemoState->GraphDescLayout,
                 };
 
-            DemoState->ParallelSortCountPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                           "shader_parallel_sort_count.spv", "main", Layouts, ArrayCount(Layouts), sizeof(u32));
+            DemoState->GridBoundsPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                    "shader_grid_bounds.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->GridCellIdsPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                     "shader_grid_cell_ids.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->GridScanPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                  "shader_grid_scan.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->GridScatterPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                     "shader_grid_scatter.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->GridSummaryPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                     "shader_grid_summary.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->GridPyramidPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                     "shader_grid_pyramid.spv", "main", Layouts, ArrayCount(Layouts), sizeof(grid_pyramid_constants));
+            DemoState->GridRepulsionPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                       "shader_grid_repulsion.spv", "main", Layouts, ArrayCount(Layouts));
+            DemoState->GridRepulsionActivePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                             "shader_grid_repulsion_active.spv", "main", Layouts, ArrayCount(Layouts));
+        }
 
-            DemoState->ParallelSortReducePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                            "shader_parallel_sort_reduce.spv", "main", Layouts, ArrayCount(Layouts), sizeof(u32));
+        // NOTE: Edge Sort Data
+        {
+            {
+                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->EdgeSortDescLayout);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+                VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+            }
 
-            DemoState->ParallelSortScanPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                          "shader_parallel_sort_scan.spv", "main", Layouts, ArrayCount(Layouts), sizeof(u32));
+            VkDescriptorSetLayout Layouts[] =
+                {
+                    DemoState->EdgeSortDescLayout,
+                    DemoState->GraphDescLayout,
+                };
 
-            DemoState->ParallelSortScanAddPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                             "shader_parallel_sort_scan_add.spv", "main", Layouts, ArrayCount(Layouts), sizeof(u32));
-            
-            DemoState->ParallelSortScatterPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                             "shader_parallel_sort_scatter.spv", "main", Layouts, ArrayCount(Layouts), sizeof(u32));
+            DemoState->EdgeSortThreadPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                        "shader_edge_sort_thread.spv", "main", Layouts, ArrayCount(Layouts), sizeof(edge_sort_constants));
+            DemoState->EdgeSortBlockPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                       "shader_edge_sort_block.spv", "main", Layouts, ArrayCount(Layouts), sizeof(edge_sort_constants));
+            DemoState->EdgeSortGatherKeysPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                            "shader_edge_sort_gather_keys.spv", "main", Layouts, ArrayCount(Layouts), sizeof(edge_sort_constants));
+            DemoState->EdgeSortGatherSegmentsPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                                "shader_edge_sort_gather_segments.spv", "main", Layouts, ArrayCount(Layouts), sizeof(edge_sort_constants));
+            DemoState->EdgeSortScatterPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                         "shader_edge_sort_scatter.spv", "main", Layouts, ArrayCount(Layouts), sizeof(edge_sort_constants));
         }
     }
     
@@ -1261,6 +3748,10 @@ DEMO_INIT(Init)
             // NOTE: Specify input vertex data format
             VkPipelineVertexBindingBegin(&Builder);
             VkPipelineVertexAttributeAdd(&Builder, VK_FORMAT_R32G32_SFLOAT, sizeof(v2));
+#if GRAPH_PACKED_NODE_STATE
+            // NOTE: Skip the degree of the packed node state
+            VkPipelineVertexAttributeAddOffset(&Builder, sizeof(f32));
+#endif
             VkPipelineVertexBindingEnd(&Builder);
 
             VkPipelineInputAssemblyAdd(&Builder, VK_PRIMITIVE_TOPOLOGY_LINE_LIST, VK_FALSE);
@@ -1462,62 +3953,104 @@ DEMO_INIT(Init)
             DemoState->StrongGravityEnabled = true;
 
             DemoState->PauseSim = false;
+            DemoState->MultilevelEnabled = true;
+            DemoState->FusedLayoutEnabled = false;
+            DemoState->ActiveSetEnabled = true;
+            DemoState->GridRepulsionEnabled = false;
+            DemoState->RadixTreeRepulsionEnabled = false;
+            DemoState->ActiveThreshold = 0.01f;
+            DemoState->ConvergenceThreshold = 0.01f;
+            DemoState->IterationsPerFrame = 1.0f;
+            DemoState->TimeBudgetEnabled = false;
+            DemoState->LayoutBudgetMs = 16.0f;
+            DemoState->NumBudgetIterations = 1;
+            DemoState->StreamTestEnabled = false;
             //GraphInitTest3(Commands);
             GraphInitFromFile(Commands);
 
-            global_move* GlobalMoveGpu = VkCommandsPushWriteStruct(Commands, DemoState->GlobalMoveBuffer, global_move,
-                                                                   BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                                   BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-            *GlobalMoveGpu = {};
-            GlobalMoveGpu->Speed = 1.0f;
-            GlobalMoveGpu->SpeedEfficiency = 1.0f;
-            GlobalMoveGpu->JitterToleranceConstant = 1.0f;
-            GlobalMoveGpu->MaxJitterTolerance = 10.0f;
+            GlobalMoveReset(Commands);
+
+            // NOTE: The reduction resets its counter every time it finishes so we only clear it once here
+            global_move_counters* GlobalMoveCountersGpu = VkCommandsPushWriteStruct(Commands, DemoState->GlobalMoveCounterBuffer, global_move_counters,
+                                                                                    BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                                                    BarrierMask(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+            *GlobalMoveCountersGpu = {};
+
+            // NOTE: GRAPH_ACTIVE_DISPATCH_ARGS resets the compaction counter every time it reads it
+            graph_active_set* ActiveSetGpu = VkCommandsPushWriteStruct(Commands, DemoState->ActiveSetBuffer, graph_active_set,
+                                                                       BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                                       BarrierMask(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+            *ActiveSetGpu = {};
         }
 
         // NOTE: Radix Tree Data
         {
-            {
-                DemoState->RadixTreeUniformBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                                   VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                   sizeof(radix_tree_uniform_data));
-
-                radix_tree_uniform_data* GpuData = VkCommandsPushWriteStruct(Commands, DemoState->RadixTreeUniformBuffer, radix_tree_uniform_data,
-                                                                             BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                                             BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-            
-                GpuData->NumNodes = DemoState->NumGraphNodes;
-            }
+            // NOTE: Gets the node count of the sim level every frame
+            DemoState->RadixTreeUniformBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                               sizeof(radix_tree_uniform_data));
 
+            // NOTE: Sized for the spare capacity so that GraphAppend can grow the graph, see GraphAppendCapacity
             DemoState->RadixMortonKeyBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                             sizeof(u32) * DemoState->NumGraphNodes);
+                                                             sizeof(u32) * DemoState->MaxNumGraphNodes);
+            DemoState->RadixSortedMortonKeyBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                                   sizeof(u64) * DemoState->MaxNumGraphNodes);
             DemoState->RadixElementReMappingBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                    sizeof(u32) * DemoState->NumGraphNodes);
+                                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                                    sizeof(u32) * DemoState->MaxNumGraphNodes);
             DemoState->RadixTreeChildrenBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                sizeof(u32) * 2 * (DemoState->NumGraphNodes - 1));
+                                                                sizeof(u32) * 2 * (DemoState->MaxNumGraphNodes - 1));
             DemoState->RadixTreeParentBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                              sizeof(u32) * (2 * DemoState->NumGraphNodes - 1));
+                                                              sizeof(u32) * (2 * DemoState->MaxNumGraphNodes - 1));
             DemoState->RadixTreeParticleBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                sizeof(v4) * (DemoState->NumGraphNodes - 1));
+                                                                sizeof(v4) * (DemoState->MaxNumGraphNodes - 1));
             DemoState->RadixTreeAtomicsBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                               sizeof(u32) * (DemoState->NumGraphNodes - 1));
+                                                               sizeof(u32) * (DemoState->MaxNumGraphNodes - 1));
 
             DemoState->GlobalBoundsReductionBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                    sizeof(gpu_bounds) * (DemoState->NumGraphNodes + CeilU32(f32(DemoState->NumGraphNodes) / 32.0f)));
+                                                                    sizeof(gpu_bounds) * CalcReductionNumThreadGroups(DemoState->MaxNumGraphNodes));
             DemoState->GlobalBoundsCounterBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                  sizeof(u32) * 2);
+                                                                  sizeof(u32));
+            {
+                // NOTE: The reduction resets its counter every time it finishes so we only clear it once here
+                u32* GpuData = VkCommandsPushWriteStruct(Commands, DemoState->GlobalBoundsCounterBuffer, u32,
+                                                         BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                         BarrierMask(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+                *GpuData = 0;
+            }
             DemoState->ElementBoundsBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                                             sizeof(gpu_bounds));
 
+            // NOTE: Coherent sort data, MORTON_CHECK resets its counters every time it finishes so we only clear them once here
+            DemoState->MortonBlockMaxBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                             sizeof(u64) * DispatchSize(DemoState->MaxNumGraphNodes, MORTON_COHERENT_BLOCK_SIZE));
+            DemoState->MortonCoherentBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                             sizeof(morton_coherent_data));
+            {
+                morton_coherent_data* GpuData = VkCommandsPushWriteStruct(Commands, DemoState->MortonCoherentBuffer, morton_coherent_data,
+                                                                          BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                                          BarrierMask(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+                *GpuData = {};
+            }
+            {
+                // NOTE: The CPU reads how out of order the last coherent sort was, so keep the stats in host visible memory
+                VkDeviceMemory GpuMemory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, sizeof(morton_sort_stats));
+                DemoState->MortonSortStatsBuffer = VkBufferCreate(RenderState->Device, GpuMemory, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                                  sizeof(morton_sort_stats));
+                VkCheckResult(vkMapMemory(RenderState->Device, GpuMemory, 0, sizeof(morton_sort_stats), 0, (void**)&DemoState->MortonSortStatsCpu));
+                *DemoState->MortonSortStatsCpu = {};
+            }
+
             DemoState->RadixTreeDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->RadixTreeDescLayout);
             VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->RadixTreeDescriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, DemoState->RadixTreeUniformBuffer);
             VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->RadixTreeDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->RadixMortonKeyBuffer);
@@ -1531,93 +4064,179 @@ DEMO_INIT(Init)
             VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->RadixTreeDescriptor, 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GlobalBoundsReductionBuffer);
             VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->RadixTreeDescriptor, 8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GlobalBoundsCounterBuffer);
             VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->RadixTreeDescriptor, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ElementBoundsBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->RadixTreeDescriptor, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->RadixSortedMortonKeyBuffer);
+
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->RadixTreeDescriptor, 11, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->MortonBlockMaxBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->RadixTreeDescriptor, 12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->MortonCoherentBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->RadixTreeDescriptor, 13, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->MortonSortStatsBuffer);
         }
 
-        // NOTE: Init Sort Data
+        // NOTE: Init FMM Data
         {
-#if BITONIC_MERGE_SORT
-            u32 NumPasses = 20;
-
-            // NOTE: Local Fd Descriptor
-            DemoState->MergeSortLocalFdDescriptor = MergeSortDescriptorCreate(Commands, 0, 0, 0);
-
-            // NOTE: Local Disperse Descriptor
-            DemoState->MergeSortLocalDisperseDescriptor = MergeSortDescriptorCreate(Commands, 0, 0, 0);
-
-            // NOTE: Global Flip Uniforms
-            for (u32 FlipSize = 2048, PassId = 11; FlipSize < DemoState->NumGraphNodes; PassId += 1, FlipSize = FlipSize * 2)
-            {
-                DemoState->MergeSortGlobalFlipDescriptors[PassId - 11] = MergeSortDescriptorCreate(Commands, FlipSize, PassId, 0);
-            }
-            
-            // NOTE: Global Disperse Uniforms
-            for (u32 FlipSize = 1024, PassId = 10; FlipSize < DemoState->NumGraphNodes / 2; PassId += 1, FlipSize = FlipSize * 2)
+            // NOTE: Per internal node data, sized like the radix tree buffers
+            u32 NumInternalNodes = DemoState->MaxNumGraphNodes - 1;
+            DemoState->FmmNodeBoxBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                         sizeof(v4) * NumInternalNodes);
+            DemoState->FmmMultipoleBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                           sizeof(v2) * (FMM_ORDER + 1) * NumInternalNodes);
+            DemoState->FmmLocalBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                       sizeof(v2) * FMM_ORDER * NumInternalNodes);
+            DemoState->FmmNodeLevelBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                           sizeof(u32) * 2 * NumInternalNodes);
+            DemoState->FmmLevelNodeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                           sizeof(u32) * NumInternalNodes);
+
+            // NOTE: Per graph node data
+            DemoState->FmmGraphNodeLeafBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                               sizeof(u32) * DemoState->MaxNumGraphNodes);
+
+            // NOTE: Per depth data
+            DemoState->FmmLevelCountBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                            sizeof(u32) * FMM_MAX_DEPTH);
+            DemoState->FmmLevelStartBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                            sizeof(u32) * FMM_MAX_DEPTH);
+            DemoState->FmmLevelDispatchBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                               sizeof(u32) * 4 * FMM_MAX_DEPTH);
+
+            // NOTE: Interaction lists, heads are per tree node and the walk ping pongs between 2 halves of up to 1 pair per node
+            DemoState->FmmExpandHeadBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                            sizeof(u32) * (2 * DemoState->MaxNumGraphNodes - 1));
+            DemoState->FmmNearHeadBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                          sizeof(u32) * DemoState->MaxNumGraphNodes);
+            DemoState->FmmMaxListEntries = u32(Min(u64(FMM_LIST_ENTRIES_PER_NODE) * u64(DemoState->MaxNumGraphNodes), u64(FMM_LIST_MAX_ENTRIES)));
+            DemoState->FmmListEntryBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                           sizeof(u32) * 2 * DemoState->FmmMaxListEntries);
+            DemoState->FmmWalkStateBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                           sizeof(fmm_walk_state));
+            DemoState->FmmWalkPairBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                          sizeof(u32) * 2 * 2 * DemoState->MaxNumGraphNodes);
             {
-                DemoState->MergeSortGlobalDisperseDescriptors[PassId - 10] = MergeSortDescriptorCreate(Commands, 0, PassId, FlipSize);
+                // NOTE: The CPU reads the max depth of the last tree to cap the downward passes, so keep the stats in host visible memory
+                VkDeviceMemory GpuMemory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, sizeof(fmm_stats));
+                DemoState->FmmStatsBuffer = VkBufferCreate(RenderState->Device, GpuMemory, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                           sizeof(fmm_stats));
+                VkCheckResult(vkMapMemory(RenderState->Device, GpuMemory, 0, sizeof(fmm_stats), 0, (void**)&DemoState->FmmStatsCpu));
+                *DemoState->FmmStatsCpu = {};
+                DemoState->FmmStatsCpu->MaxDepth = FMM_MAX_DEPTH - 1;
             }
-#else
-
-            u32 ScratchBufferSize = 0;
-            u32 ReduceScratchBufferSize = 0;
-            FFX_ParallelSort_CalculateScratchResourceSize(DemoState->NumGraphNodes, ScratchBufferSize, ReduceScratchBufferSize);
 
-            {
-                DemoState->ParallelSortUniformBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                      sizeof(FFX_ParallelSortCB));
+            DemoState->FmmDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->FmmDescLayout);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmNodeBoxBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmMultipoleBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmLocalBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmNodeLevelBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmLevelCountBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmLevelStartBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmLevelDispatchBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmLevelNodeBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmGraphNodeLeafBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmExpandHeadBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmNearHeadBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 11, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmListEntryBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmWalkStateBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 13, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmWalkPairBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->FmmDescriptor, 14, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->FmmStatsBuffer);
+        }
 
-                FFX_ParallelSortCB* GpuData = VkCommandsPushWriteStruct(Commands, DemoState->ParallelSortUniformBuffer, FFX_ParallelSortCB,
-                                                                        BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                                        BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+        // NOTE: Init Grid Repulsion Data
+        {
+            DemoState->GridBoundsBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                         sizeof(grid_bounds));
+            DemoState->GridCellCountBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                            sizeof(u32) * GRID_NUM_CELLS);
+            // NOTE: The last entry holds the total so that every cell's range is [Start[i], Start[i + 1])
+            DemoState->GridCellStartBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                            sizeof(u32) * (GRID_NUM_CELLS + 1));
+            DemoState->GridNodeRankBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                           sizeof(u32) * DemoState->MaxNumGraphNodes);
+            DemoState->GridCellNodeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                           sizeof(v4) * DemoState->MaxNumGraphNodes);
+            DemoState->GridCellSummaryBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                              sizeof(v4) * GRID_NUM_SUMMARY_CELLS);
+
+            DemoState->GridDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->GridDescLayout);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GridDescriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GridBoundsBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GridDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GridCellCountBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GridDescriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GridCellStartBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GridDescriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GridNodeRankBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GridDescriptor, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GridCellNodeBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->GridDescriptor, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->GridCellSummaryBuffer);
+        }
 
-                FFX_ParallelSort_SetConstantAndDispatchData(DemoState->NumGraphNodes, PARALLEL_SORT_MAX_THREAD_GROUPS, *GpuData, DemoState->ParallelSortNumThreadGroups, DemoState->ParallelSortNumReducedThreadGroups);
-            }
+        // NOTE: Init Sort Data
+        {
+            DemoState->MortonSortBackend = GpuSortBackend_Auto;
+            DemoState->MortonCoherentEnabled = true;
+            DemoState->MortonSortedNumNodes = 0;
+            DemoState->MortonSort = GpuSortCreate(&DemoState->Arena, &DemoState->TempArena, Commands, DemoState->RadixMortonKeyBuffer,
+                                                  DemoState->RadixElementReMappingBuffer, DemoState->MaxNumGraphNodes);
+            DemoState->MortonSort64 = GpuSort64Create(&DemoState->TempArena, DemoState->RadixSortedMortonKeyBuffer, VK_NULL_HANDLE,
+                                                      &DemoState->MortonSort, DemoState->MaxNumGraphNodes);
+        }
 
-            DemoState->ParallelSortMortonBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                 sizeof(u32) * DemoState->NumGraphNodes);
+        // NOTE: Init Edge Sort Data
+        {
+            DemoState->EdgeSortKey = EdgeSortKey_OtherNodeId;
 
-            DemoState->ParallelSortPayloadBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+            // NOTE: A batch has to hold the biggest segment, we leave it room to grow through GraphAppend
+            u32 MaxSegmentEdges = 0;
+            for (u32 NodeId = 0; NodeId < DemoState->NumGraphNodes; ++NodeId)
+            {
+                graph_node_edges Range = DemoState->NodeEdgesCpu[NodeId];
+                MaxSegmentEdges = Max(MaxSegmentEdges, Range.EndConnections - Range.StartConnections);
+            }
+            u32 MaxBatchEdges = EDGE_SORT_BLOCK_SIZE;
+            if (!DemoState->OutOfCoreEnabled)
+            {
+                MaxBatchEdges = Min(GraphAppendCapacity(MaxSegmentEdges, GRAPH_APPEND_MIN_SPARE_EDGES), DemoState->MaxNumGraphEdges);
+                MaxBatchEdges = Max(MaxBatchEdges, u32(EDGE_SORT_BLOCK_SIZE));
+            }
+            
+            DemoState->EdgeSortSegmentBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                              sizeof(u32) * DemoState->MaxNumGraphNodes);
+            DemoState->EdgeSortBatchOffsetBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                  sizeof(u32) * DemoState->NumGraphNodes);
+                                                                  sizeof(u32) * DemoState->MaxNumGraphNodes);
+            DemoState->EdgeSortKeyBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                          sizeof(u32) * MaxBatchEdges);
+            DemoState->EdgeSortPayloadBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                              sizeof(u32) * MaxBatchEdges);
+            DemoState->EdgeSortBatchSegmentBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                                   sizeof(u32) * MaxBatchEdges);
+            DemoState->EdgeSortScratchEdgeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                                  sizeof(graph_edge) * MaxBatchEdges);
+
+            DemoState->EdgeSortDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->EdgeSortDescLayout);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->EdgeSortDescriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeSortSegmentBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->EdgeSortDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeSortBatchOffsetBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->EdgeSortDescriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeSortKeyBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->EdgeSortDescriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeSortPayloadBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->EdgeSortDescriptor, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeSortBatchSegmentBuffer);
+            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->EdgeSortDescriptor, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->EdgeSortScratchEdgeBuffer);
+            
+            DemoState->EdgeSort = GpuSortCreate(&DemoState->Arena, &DemoState->TempArena, Commands, DemoState->EdgeSortKeyBuffer,
+                                                DemoState->EdgeSortPayloadBuffer, MaxBatchEdges);
 
-            DemoState->ParallelSortScratchBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                  ScratchBufferSize);
-
-            DemoState->ParallelSortReducedScratchBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                         ReduceScratchBufferSize);
-
-            DemoState->ParallelSortConstantDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->ParallelSortConstantDescLayout);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortConstantDescriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, DemoState->ParallelSortUniformBuffer);
-
-            DemoState->ParallelSortInputOutputDescriptor[0] = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->ParallelSortInputOutputDescLayout);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortInputOutputDescriptor[0], 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->RadixMortonKeyBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortInputOutputDescriptor[0], 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortMortonBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortInputOutputDescriptor[0], 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->RadixElementReMappingBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortInputOutputDescriptor[0], 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortPayloadBuffer);
-
-            DemoState->ParallelSortInputOutputDescriptor[1] = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->ParallelSortInputOutputDescLayout);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortInputOutputDescriptor[1], 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortMortonBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortInputOutputDescriptor[1], 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->RadixMortonKeyBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortInputOutputDescriptor[1], 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortPayloadBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortInputOutputDescriptor[1], 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->RadixElementReMappingBuffer);
-
-            DemoState->ParallelSortScanDescriptor[0] = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->ParallelSortScanDescLayout);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortScanDescriptor[0], 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortReducedScratchBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortScanDescriptor[0], 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortReducedScratchBuffer);
-
-            DemoState->ParallelSortScanDescriptor[1] = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->ParallelSortScanDescLayout);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortScanDescriptor[1], 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortScratchBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortScanDescriptor[1], 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortScratchBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortScanDescriptor[1], 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortReducedScratchBuffer);
-
-            DemoState->ParallelSortScratchDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->ParallelSortScratchDescLayout);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortScratchDescriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortScratchBuffer);
-            VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->ParallelSortScratchDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->ParallelSortReducedScratchBuffer);
+            // NOTE: The descriptor writes have to land before we record the sort
+            VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
             
-#endif
+            temp_mem TempMem = BeginTempMem(&DemoState->TempArena);
+            u32* NodeIds = PushArray(&DemoState->TempArena, u32, DemoState->NumGraphNodes);
+            for (u32 NodeId = 0; NodeId < DemoState->NumGraphNodes; ++NodeId)
+            {
+                NodeIds[NodeId] = NodeId;
+            }
+            GraphEdgesSort(Commands, DemoState->NumGraphNodes, NodeIds);
+            EndTempMem(TempMem);
         }
         
         UiStateCreate(RenderState->Device, &DemoState->Arena, &DemoState->TempArena, RenderState->LocalMemoryId,
@@ -1627,6 +4246,10 @@ DEMO_INIT(Init)
 
     VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
     VkCommandsSubmit(Commands, RenderState->Device, RenderState->GraphicsQueue);
+
+#if FMM_REFERENCE_TEST
+    FmmGpuReferenceTest();
+#endif
 }
 
 DEMO_DESTROY(Destroy)
@@ -1698,6 +4321,76 @@ DEMO_MAIN_LOOP(MainLoop)
                 UiPanelCheckBox(&Panel, &DemoState->PauseSim);
                 UiPanelNextRow(&Panel);            
 
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Multilevel Layout:");
+                UiPanelCheckBox(&Panel, &DemoState->MultilevelEnabled);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Fused Layout Kernel:");
+                UiPanelCheckBox(&Panel, &DemoState->FusedLayoutEnabled);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Active Set Sim:");
+                UiPanelCheckBox(&Panel, &DemoState->ActiveSetEnabled);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Active Threshold:");
+                UiPanelHorizontalSlider(&Panel, 0.0f, 1.0f, &DemoState->ActiveThreshold);
+                UiPanelNumberBox(&Panel, 0.0f, 1.0f, &DemoState->ActiveThreshold);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Cell List Repulsion:");
+                UiPanelCheckBox(&Panel, &DemoState->GridRepulsionEnabled);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Radix Tree Repulsion:");
+                UiPanelCheckBox(&Panel, &DemoState->RadixTreeRepulsionEnabled);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Coherent Morton Sort:");
+                UiPanelCheckBox(&Panel, &DemoState->MortonCoherentEnabled);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Stream Append Test:");
+                UiPanelCheckBox(&Panel, &DemoState->StreamTestEnabled);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                // NOTE: Only the convergence check may settle the sim, so we show the state without letting it be edited
+                UiPanelText(&Panel, "Sim Settled:");
+                UiPanelText(&Panel, DemoState->SimSettled ? "Yes" : "No");
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Convergence Threshold:");
+                UiPanelHorizontalSlider(&Panel, 0.0f, 1.0f, &DemoState->ConvergenceThreshold);
+                UiPanelNumberBox(&Panel, 0.0f, 1.0f, &DemoState->ConvergenceThreshold);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Iterations Per Frame:");
+                UiPanelHorizontalSlider(&Panel, 1.0f, f32(SIM_MAX_ITERATIONS_PER_FRAME), &DemoState->IterationsPerFrame);
+                UiPanelNumberBox(&Panel, 1.0f, f32(SIM_MAX_ITERATIONS_PER_FRAME), &DemoState->IterationsPerFrame);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Time Budget Mode:");
+                UiPanelCheckBox(&Panel, &DemoState->TimeBudgetEnabled);
+                UiPanelNextRow(&Panel);            
+
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Layout Budget Ms:");
+                UiPanelHorizontalSlider(&Panel, 1.0f, 100.0f, &DemoState->LayoutBudgetMs);
+                UiPanelNumberBox(&Panel, 1.0f, 100.0f, &DemoState->LayoutBudgetMs);
+                UiPanelNextRow(&Panel);            
+
                 UiPanelNextRowIndent(&Panel);
                 UiPanelText(&Panel, "FrameTime:");
                 UiPanelHorizontalSlider(&Panel, 0.0f, 0.03f, &ModifiedFrameTime);
@@ -1745,361 +4438,288 @@ DEMO_MAIN_LOOP(MainLoop)
             UiStateEnd(UiState, &RenderState->DescriptorManager);
         }
         
-        // NOTE: Upload scene data
+        // NOTE: Stream new nodes into the graph
+        if (DemoState->StreamTestEnabled && !DemoState->PauseSim)
         {
-            render_scene* Scene = &DemoState->Scene;
-            if (!(DemoState->UiState.MouseTouchingUi || DemoState->UiState.ProcessedInteraction))
-            {
-                CameraUpdate(&Scene->Camera, CurrInput, PrevInput, FrameTime);
-            }
-
-            // NOTE: Populate GPU Buffers
+            GraphAppendStreamTest(Commands);
+        }
+        
+        // NOTE: Read back last frame's layout timestamps, our commands wait on last frame's fence before recording so they are written
+        b32 LayoutTimerRead = DemoState->LayoutTimerWritten;
+        if (DemoState->LayoutTimerWritten)
+        {
+            u64 Timestamps[2] = {};
+            VkCheckResult(vkGetQueryPoolResults(RenderState->Device, DemoState->LayoutTimestampPool, 0, 2, sizeof(Timestamps), Timestamps, sizeof(u64),
+                                                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+            DemoState->LayoutGpuMs = f32(Timestamps[1] - Timestamps[0]) * DemoState->TimestampPeriodNs / 1000000.0f;
+            DemoState->LayoutTimerWritten = false;
+
+            // NOTE: The traffic estimate models the separate kernels, so we only log measurements of those
+            if (!DemoState->LayoutTimerFused)
             {
+                if (DemoState->NumLayoutSamples == 0 || DemoState->LayoutSampleLevel != DemoState->LayoutTimerLevel)
                 {
-                    CPU_TIMED_BLOCK("Upload scene buffer to  GPU");
-                    graph_globals* GpuData = VkCommandsPushWriteStruct(Commands, DemoState->GraphGlobalsBuffer, graph_globals,
-                                                                      BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                                      BarrierMask(VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-
-                    GpuData->VPTransform = CameraGetVP(&Scene->Camera);
-                    GpuData->ViewPort = V2(RenderState->WindowWidth, RenderState->WindowHeight);
-                    GpuData->FrameTime = ModifiedFrameTime * (!DemoState->PauseSim);
-                    GpuData->NumNodes = DemoState->NumGraphNodes;
-
-                    GpuData->AttractionMultiplier = DemoState->AttractionMultiplier;
-                    GpuData->AttractionWeightPower = DemoState->AttractionWeightPower;
-                    GpuData->RepulsionMultiplier = DemoState->RepulsionMultiplier;
-                    GpuData->RepulsionSoftner = DemoState->RepulsionSoftner;
-                    GpuData->GravityMultiplier = DemoState->GravityMultiplier;
-                    GpuData->StrongGravityEnabled = DemoState->StrongGravityEnabled;
-
-                    GpuData->CellDim = DemoState->CellWorldDim;
-                    GpuData->WorldRadius = DemoState->WorldRadius;
-                    GpuData->NumCellsDim = DemoState->NumCellsAxis;
+                    DemoState->LayoutSampleLevel = DemoState->LayoutTimerLevel;
+                    DemoState->NumLayoutSamples = 0;
+                    DemoState->LayoutSampleTotalMs = 0.0f;
+                    DemoState->LayoutSampleTotalIterations = 0;
+                }
 
-                    GpuData->NumThreadGroupsCalcNodeBounds = CalcGlobalSpeedNumThreadGroups();
-                    GpuData->NumThreadGroupsGlobalSpeed = CalcBoundsNumThreadGroups();
+                DemoState->NumLayoutSamples += 1;
+                DemoState->LayoutSampleTotalMs += DemoState->LayoutGpuMs;
+                DemoState->LayoutSampleTotalIterations += DemoState->LayoutTimerNumIterations;
+                if (DemoState->NumLayoutSamples == LAYOUT_TIMER_LOG_SAMPLES)
+                {
+                    graph_level* TimedLevel = DemoState->GraphLevels + DemoState->LayoutSampleLevel;
+                    f32 MsPerIteration = DemoState->LayoutSampleTotalMs / f32(DemoState->LayoutSampleTotalIterations);
+                    GraphLayoutTrafficLog(TimedLevel->NumNodes, TimedLevel->NumEdges, MsPerIteration);
                 }
             }
-            
-            VkCommandsTransferFlush(Commands, RenderState->Device);
         }
         
-        // NOTE: Simulate graph layout
+        // NOTE: Decide if and which graph level we simulate this frame
+        b32 SimulateThisFrame = false;
+        u32 NumIterations = 0;
         {
-            u32 GraphDispatchX = DispatchSize(DemoState->NumGraphNodes, 32);
-            u32 GraphDispatchY = 1;
-
-            if (GraphDispatchX > MAX_THREAD_GROUPS)
-            {
-                GraphDispatchX = 64;
-                GraphDispatchY = DispatchSize(DemoState->NumGraphNodes, 32 * GraphDispatchX);
-            }
-            
-            // TODO: Remove the clears here (reduction we should be able to never clear, counter we can clear in a cs pass)
-            vkCmdFillBuffer(Commands->Buffer, DemoState->GlobalMoveReductionBuffer, 0, VK_WHOLE_SIZE, 0);
-            vkCmdFillBuffer(Commands->Buffer, DemoState->GlobalMoveCounterBuffer, 0, VK_WHOLE_SIZE, 0);
-            
-            VkDescriptorSet GraphSimSets[] =
+            // NOTE: Any change to the layout parameters wakes the sim up
+            f32 LayoutParams[] =
                 {
-                    DemoState->GraphDescriptor,
+                    DemoState->AttractionMultiplier,
+                    DemoState->AttractionWeightPower,
+                    DemoState->RepulsionMultiplier,
+                    DemoState->RepulsionSoftner,
+                    DemoState->GravityMultiplier,
+                    f32(DemoState->StrongGravityEnabled),
+                    f32(DemoState->MultilevelEnabled),
+                    DemoState->ConvergenceThreshold,
                 };
+            Assert(ArrayCount(LayoutParams) == ArrayCount(DemoState->PrevLayoutParams));
             
-            VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            VkCommandsBarrierFlush(Commands);
-            
-            // NOTE: Graph Attraction
-            VkComputeDispatch(Commands, DemoState->GraphMoveConnectionsPipeline, GraphSimSets, ArrayCount(GraphSimSets), GraphDispatchX, GraphDispatchY, 1);
+            b32 ParamsChanged = false;
+            for (u32 ParamId = 0; ParamId < ArrayCount(LayoutParams); ++ParamId)
+            {
+                ParamsChanged = ParamsChanged || LayoutParams[ParamId] != DemoState->PrevLayoutParams[ParamId];
+                DemoState->PrevLayoutParams[ParamId] = LayoutParams[ParamId];
+            }
 
-            VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            VkBarrierBufferAdd(Commands, DemoState->NodeCellIdBuffer,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            VkCommandsBarrierFlush(Commands);
-            
-            // NOTE: Graph Repulsion
-#if 1
+            // NOTE: Check how much the last iteration we simulated moved the nodes. Our commands wait on last frame's fence before
+            // recording so the stats are already written
+            b32 LevelConverged = false;
+            if (DemoState->SimRanLastFrame)
             {
-                VkComputeDispatch(Commands, DemoState->GraphRepulsionPipeline, GraphSimSets, ArrayCount(GraphSimSets), GraphDispatchX, GraphDispatchY, 1);
+                f32 MeanDisplacement = DemoState->GlobalMoveStatsCpu->MeanDisplacement;
+                if (MeanDisplacement < DemoState->ConvergenceThreshold)
+                {
+                    DemoState->NumCalmSamples += 1;
+                }
+                else
+                {
+                    DemoState->NumCalmSamples = 0;
+                }
+                LevelConverged = DemoState->NumCalmSamples >= CONVERGENCE_CALM_SAMPLES;
 
-                VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
-                                   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-                VkCommandsBarrierFlush(Commands);
+                if (DemoState->SimSettled && MeanDisplacement > CONVERGENCE_WAKE_FACTOR * DemoState->ConvergenceThreshold)
+                {
+                    DemoState->SimSettled = false;
+                }
             }
-#else
 
-            // TODO: There is a bug still with sometimes everything collapsing?
-            VkDescriptorSet RadixDescriptorSets[] =
+            if (ParamsChanged)
+            {
+                DemoState->SimSettled = false;
+                DemoState->NumCalmSamples = 0;
+                DemoState->NumActiveSetIterations = 0;
+                LevelConverged = false;
+            }
+            
+            if (DemoState->CurrGraphLevel > 0)
+            {
+                u32 LevelIterations = GRAPH_REFINE_ITERATIONS;
+                if (DemoState->CurrGraphLevel == DemoState->NumGraphLevels - 1)
                 {
-                    DemoState->RadixTreeDescriptor,
-                    DemoState->GraphDescriptor,
-                };
+                    LevelIterations = GRAPH_COARSEST_ITERATIONS;
+                }
 
-            // NOTE: Graph Calc Node Bounds
-            {
-                u32 BoundsDispatchX = CalcBoundsNumThreadGroups();
-                u32 BoundsDispatchY = 1;
-                if (BoundsDispatchX > MAX_THREAD_GROUPS)
+                if (!DemoState->MultilevelEnabled || LevelConverged || DemoState->CurrLevelIterations >= LevelIterations)
                 {
-                    u32 NumThreadGroups = BoundsDispatchX;
-                    BoundsDispatchX = 64;
-                    BoundsDispatchY = DispatchSize(NumThreadGroups, BoundsDispatchX);
+                    // NOTE: The finer level already holds last frame's prolonged positions, we only have to reset the sim state
+                    DemoState->CurrGraphLevel -= 1;
+                    DemoState->CurrLevelIterations = 0;
+                    DemoState->NumCalmSamples = 0;
+                    DemoState->NumActiveSetIterations = 0;
+                    DemoState->MortonSortedNumNodes = 0;
+                    GlobalMoveReset(Commands);
+                    
+                    vkCmdFillBuffer(Commands->Buffer, DemoState->NodePrevForceBuffer, 0, sizeof(v2) * DemoState->GraphLevels[DemoState->CurrGraphLevel].NumNodes, 0);
+                    VkBarrierBufferAdd(Commands, DemoState->NodePrevForceBuffer,
+                                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+#if GRAPH_PACKED_NODE_STATE
+                    vkCmdFillBuffer(Commands->Buffer, DemoState->NodePrevForceHalfBuffer, 0, sizeof(u32) * DemoState->GraphLevels[DemoState->CurrGraphLevel].NumNodes, 0);
+                    VkBarrierBufferAdd(Commands, DemoState->NodePrevForceHalfBuffer,
+                                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+#endif
+                    VkCommandsBarrierFlush(Commands);
                 }
-                
-                VkComputeDispatch(Commands, DemoState->CalcWorldBoundsPipeline, RadixDescriptorSets, ArrayCount(RadixDescriptorSets), BoundsDispatchX, BoundsDispatchY, 1);
+            }
+            else if (LevelConverged && !DemoState->SimSettled)
+            {
+                DemoState->SimSettled = true;
+                DemoState->NumSettledFrames = 0;
             }
 
-            VkBarrierBufferAdd(Commands, DemoState->ElementBoundsBuffer,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            VkCommandsBarrierFlush(Commands);
-
-            // NOTE: Generate and Sort Morton Keys
+            if (!DemoState->PauseSim)
             {
-#if BITONIC_MERGE_SORT
-                // NOTE: Local FD
+                if (DemoState->SimSettled)
                 {
-                    u32 DispatchX = CeilU32(f32(DemoState->NumGraphNodes) / 2048.0f);
-                                
-                    VkDescriptorSet DescriptorSets[] =
-                        {
-                            DemoState->RadixTreeDescriptor,
-                            DemoState->GraphDescriptor,
-                            DemoState->MergeSortLocalFdDescriptor.Descriptor,
-                        };
-                    VkComputeDispatch(Commands, DemoState->MergeSortLocalFdPipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, 1, 1);
-
-                    VkBarrierBufferAdd(Commands, DemoState->RadixMortonKeyBuffer,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-                    VkBarrierBufferAdd(Commands, DemoState->RadixElementReMappingBuffer,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-                    VkCommandsBarrierFlush(Commands);
+                    DemoState->NumSettledFrames += 1;
+                    SimulateThisFrame = (DemoState->NumSettledFrames % CONVERGENCE_REFRESH_INTERVAL) == 0;
+                }
+                else
+                {
+                    SimulateThisFrame = true;
                 }
+            }
             
-                // NOTE: General Pass
-                u32 NumNodesNextPow2 = NextPow2(DemoState->NumGraphNodes) / 2;
-                for (u32 FlipSize = 2048, PassId = 11; FlipSize < NumNodesNextPow2; PassId += 1, FlipSize *= 2)
+            // NOTE: Pick how many iterations we record this frame
+            {
+                if (DemoState->TimeBudgetEnabled)
                 {
-                    MergeSortGlobalFlip(Commands, PassId);
-                
-                    for (u32 N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
+                    // NOTE: Settled frames and coarse levels can run fewer iterations than the budget, so we scale the time we
+                    // measured to what the budget's iteration count would take
+                    if (LayoutTimerRead)
                     {
-                        if (N < 1024)
+                        f32 MsPerIteration = DemoState->LayoutGpuMs / f32(Max(1u, DemoState->LayoutTimerNumIterations));
+                        f32 BudgetIterationsMs = MsPerIteration * f32(DemoState->NumBudgetIterations);
+                        if (BudgetIterationsMs > DemoState->LayoutBudgetMs)
                         {
-                            MergeSortLocalDisperse(Commands);
-                            break;
+                            DemoState->NumBudgetIterations = Max(1u, u32(SIM_BUDGET_BACKOFF * f32(DemoState->NumBudgetIterations)));
                         }
-                        else
+                        else if (BudgetIterationsMs < SIM_BUDGET_HEADROOM * DemoState->LayoutBudgetMs)
                         {
-                            MergeSortGlobalDisperse(Commands, NPassId);
+                            DemoState->NumBudgetIterations = Min(u32(SIM_MAX_ITERATIONS_PER_FRAME), DemoState->NumBudgetIterations + 1);
                         }
                     }
-                }
-#else
-                // NOTE: Generate Morton Keys
-                {
-                    VkDescriptorSet DescriptorSets[] =
-                    {
-                        DemoState->RadixTreeDescriptor,
-                    };
                     
-                    vk_pipeline* Pipeline = DemoState->GenerateMortonKeysPipeline;
-                    VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), GraphDispatchX, GraphDispatchY, 1);
-
-                    VkBarrierBufferAdd(Commands, DemoState->RadixMortonKeyBuffer,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-                    VkCommandsBarrierFlush(Commands);
+                    NumIterations = DemoState->NumBudgetIterations;
                 }
-     
-                // NOTE: Parallel Sort
-                VkBuffer SrcMortonBuffer = DemoState->RadixMortonKeyBuffer;
-                VkBuffer DstMortonBuffer = DemoState->ParallelSortMortonBuffer;
-                VkBuffer SrcPayloadBuffer = DemoState->RadixElementReMappingBuffer;
-                VkBuffer DstPayloadBuffer = DemoState->ParallelSortPayloadBuffer;
-
-                u32 DispatchX = DemoState->ParallelSortNumThreadGroups;
-                u32 DispatchY = 1;
-
-                if (DispatchX > MAX_THREAD_GROUPS)
+                else
                 {
-                    DispatchX = 64;
-                    DispatchY = DispatchSize(DemoState->ParallelSortNumThreadGroups, DispatchX);
+                    NumIterations = Max(1u, u32(DemoState->IterationsPerFrame));
                 }
 
-                u32 ReducedDispatchX = DemoState->ParallelSortNumReducedThreadGroups;
-                u32 ReducedDispatchY = 1;
-
-                if (ReducedDispatchX > MAX_THREAD_GROUPS)
+                if (DemoState->SimSettled)
                 {
-                    ReducedDispatchX = 64;
-                    ReducedDispatchY = DispatchSize(DemoState->ParallelSortNumReducedThreadGroups, ReducedDispatchX);
+                    // NOTE: A settled sim only needs 1 iteration to check if it is still at rest
+                    NumIterations = 1;
                 }
-                
-                b32 InputSet = 0;                
-                for (u32 Shift = 0; Shift < 32u; Shift += FFX_PARALLELSORT_SORT_BITS_PER_PASS)
+                else if (DemoState->CurrGraphLevel > 0)
                 {
-                    VkDescriptorSet SharedDescriptorSets0[] =
+                    // NOTE: Don't run past the iteration count of a coarse level
+                    u32 LevelIterations = GRAPH_REFINE_ITERATIONS;
+                    if (DemoState->CurrGraphLevel == DemoState->NumGraphLevels - 1)
                     {
-                        DemoState->ParallelSortConstantDescriptor,
-                        DemoState->ParallelSortInputOutputDescriptor[InputSet],
-                        DemoState->ParallelSortScanDescriptor[0],
-                        DemoState->ParallelSortScratchDescriptor,
-                    };
+                        LevelIterations = GRAPH_COARSEST_ITERATIONS;
+                    }
+                    NumIterations = Max(1u, Min(NumIterations, LevelIterations - Min(LevelIterations, DemoState->CurrLevelIterations)));
+                }
+            }
+            
+            if (SimulateThisFrame)
+            {
+                DemoState->CurrLevelIterations += NumIterations;
+            }
+            else
+            {
+                NumIterations = 0;
+            }
+            DemoState->SimRanLastFrame = SimulateThisFrame;
+        }
+        graph_level* SimLevel = DemoState->GraphLevels + DemoState->CurrGraphLevel;
+        
+        // NOTE: Upload scene data
+        {
+            render_scene* Scene = &DemoState->Scene;
+            if (!(DemoState->UiState.MouseTouchingUi || DemoState->UiState.ProcessedInteraction))
+            {
+                CameraUpdate(&Scene->Camera, CurrInput, PrevInput, FrameTime);
+            }
 
-                    VkDescriptorSet SharedDescriptorSets1[] =
-                    {
-                        DemoState->ParallelSortConstantDescriptor,
-                        DemoState->ParallelSortInputOutputDescriptor[InputSet],
-                        DemoState->ParallelSortScanDescriptor[1],
-                        DemoState->ParallelSortScratchDescriptor,
-                    };
+            // NOTE: Populate GPU Buffers
+            {
+                CPU_TIMED_BLOCK("Upload scene buffer to  GPU");
+                GraphUniformsUpload(Commands, SimLevel, ModifiedFrameTime * (!DemoState->PauseSim));
+            }
+            
+            VkCommandsTransferFlush(Commands, RenderState->Device);
+        }
 
-                    // NOTE: Sort Count
-                    {
-                        vk_pipeline* Pipeline = DemoState->ParallelSortCountPipeline;
-                        vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 4, &Shift);
-                        VkComputeDispatch(Commands, Pipeline, SharedDescriptorSets0, ArrayCount(SharedDescriptorSets0),
-                                          DispatchX, DispatchY, 1);
-                    }
-                    
-                    VkBarrierBufferAdd(Commands, DemoState->ParallelSortScratchBuffer,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-                    VkCommandsBarrierFlush(Commands);
+        if (DemoState->NodeStateDirty)
+        {
+            GraphPackNodeState(Commands);
+        }
+        GraphAttractionCacheUpdate(Commands);
+        
+        // NOTE: Simulate graph layout
+        if (SimulateThisFrame)
+        {
+            // NOTE: The timer starts once the compute stage is free, so it doesn't count the uploads in front of us
+            vkCmdResetQueryPool(Commands->Buffer, DemoState->LayoutTimestampPool, 0, 2);
+            vkCmdWriteTimestamp(Commands->Buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, DemoState->LayoutTimestampPool, 0);
+            DemoState->LayoutTimerWritten = true;
+            DemoState->LayoutTimerFused = false;
+            DemoState->LayoutTimerLevel = DemoState->CurrGraphLevel;
+            DemoState->LayoutTimerNumIterations = NumIterations;
             
-                    // NOTE: Sort Reduce
-                    {
-                        vk_pipeline* Pipeline = DemoState->ParallelSortReducePipeline;
-                        vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 4, &Shift);
-                        VkComputeDispatch(Commands, Pipeline, SharedDescriptorSets0, ArrayCount(SharedDescriptorSets0),
-                                          ReducedDispatchX, ReducedDispatchY, 1);
-                    }
+            if (DemoState->FusedLayoutEnabled && DemoState->NumAppendRelaxIterations == 0 &&
+                !GraphLevelOutOfCore(SimLevel))
+            {
+                DemoState->LayoutTimerFused = true;
+                GraphSimulateFused(Commands, SimLevel, NumIterations);
 
-                    VkBarrierBufferAdd(Commands, DemoState->ParallelSortReducedScratchBuffer,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-                    VkCommandsBarrierFlush(Commands);
+                // NOTE: The fused kernel doesn't write the active flags or use the Morton order
+                DemoState->NumActiveSetIterations = 0;
+                DemoState->MortonSortedNumNodes = 0;
+            }
+            else
+            {
+                for (u32 IterationId = 0; IterationId < NumIterations; ++IterationId)
+                {
+                    // NOTE: The active flags are only valid once we ran a full pass on this level
+                    b32 FullPass = !DemoState->ActiveSetEnabled || (DemoState->NumActiveSetIterations % ACTIVE_SET_REFRESH_INTERVAL) == 0;
+                    DemoState->NumActiveSetIterations += 1;
 
-                    // NOTE: Sort Scan
+                    // NOTE: The active set gathers the edges of its nodes, out of core only the shard we streamed in is resident
+                    if (GraphLevelOutOfCore(SimLevel))
                     {
-                        // NOTE: First do scan prefix of reduced values
-                        {
-                            vk_pipeline* Pipeline = DemoState->ParallelSortScanPipeline;
-                            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 4, &Shift);
-                            // NOTE: Need to account for bigger reduced histogram scan
-                            Assert(DemoState->ParallelSortNumReducedThreadGroups < FFX_PARALLELSORT_ELEMENTS_PER_THREAD * FFX_PARALLELSORT_THREADGROUP_SIZE);
-                            VkComputeDispatch(Commands, Pipeline, SharedDescriptorSets0, ArrayCount(SharedDescriptorSets0),
-                                              1, 1, 1);
-                        }
-
-                        VkBarrierBufferAdd(Commands, DemoState->ParallelSortReducedScratchBuffer,
-                                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-                        VkCommandsBarrierFlush(Commands);
-                
-                        // NOTE: Next do scan prefix on the histogram with partial sums that we just did
-                        {
-                            vk_pipeline* Pipeline = DemoState->ParallelSortScanAddPipeline;
-                            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 4, &Shift);
-                            VkComputeDispatch(Commands, Pipeline, SharedDescriptorSets1, ArrayCount(SharedDescriptorSets1),
-                                              ReducedDispatchX, ReducedDispatchY, 1);
-                        }
+                        FullPass = true;
                     }
 
-                    VkBarrierBufferAdd(Commands, DemoState->ParallelSortScratchBuffer,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-                    VkCommandsBarrierFlush(Commands);
-            
-                    // NOTE: Sort Scatter
+                    // NOTE: After an append only the new nodes and the nodes around them move, GraphAppend set up their active flags
+                    if (DemoState->NumAppendRelaxIterations > 0)
                     {
-                        vk_pipeline* Pipeline = DemoState->ParallelSortScatterPipeline;
-                        vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 4, &Shift);
-                        VkComputeDispatch(Commands, Pipeline, SharedDescriptorSets1, ArrayCount(SharedDescriptorSets1),
-                                          DispatchX, DispatchY, 1);
+                        FullPass = false;
+                        DemoState->NumAppendRelaxIterations -= 1;
                     }
                     
-                    VkBarrierBufferAdd(Commands, DstMortonBuffer,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-                    VkBarrierBufferAdd(Commands, DstPayloadBuffer,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-                    VkCommandsBarrierFlush(Commands);
-            
-                    // NOTE: Swap read/write sources
-                    std::swap(SrcMortonBuffer, DstMortonBuffer);
-                    std::swap(SrcPayloadBuffer, DstPayloadBuffer);
-                    InputSet = !InputSet;
+                    GraphSimulateIteration(Commands, SimLevel, FullPass);
                 }
-#endif
             }
+            vkCmdWriteTimestamp(Commands->Buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, DemoState->LayoutTimestampPool, 1);
 
-            // NOTE: Build Radix Tree
-            VkComputeDispatch(Commands, DemoState->RadixTreeBuildPipeline, RadixDescriptorSets, ArrayCount(RadixDescriptorSets), GraphDispatchX, GraphDispatchY, 1);
-
-            // NOTE: Clear Radix Tree Atomics
-            vkCmdFillBuffer(Commands->Buffer, DemoState->RadixTreeAtomicsBuffer, 0, sizeof(u32) * (DemoState->NumGraphNodes - 1), 0);
-            
-            VkBarrierBufferAdd(Commands, DemoState->RadixTreeChildrenBuffer,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            VkBarrierBufferAdd(Commands, DemoState->RadixTreeParentBuffer,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            VkCommandsBarrierFlush(Commands);
-
-            // NOTE: Summarize Radix Tree
-            VkComputeDispatch(Commands, DemoState->RadixTreeSummarizePipeline, RadixDescriptorSets, ArrayCount(RadixDescriptorSets), GraphDispatchX, GraphDispatchY, 1);
-            
-            VkBarrierBufferAdd(Commands, DemoState->RadixTreeParticleBuffer,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            VkCommandsBarrierFlush(Commands);
-
-            // NOTE: Calculate Repulsion
-            VkComputeDispatch(Commands, DemoState->RadixTreeRepulsionPipeline, RadixDescriptorSets, ArrayCount(RadixDescriptorSets), GraphDispatchX, GraphDispatchY, 1);
-            
-            VkBarrierBufferAdd(Commands, DemoState->NodeForceBuffer,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            VkCommandsBarrierFlush(Commands);
-            
-#endif
-
-            // NOTE: Graph Calc Global Speed
+            // NOTE: Prolong the coarse positions all the way down to level 0 so that we can render them
+            for (u32 LevelId = DemoState->CurrGraphLevel; LevelId > 0; --LevelId)
             {
-                u32 GlobalSpeedDispatchX = CalcGlobalSpeedNumThreadGroups();
-                u32 GlobalSpeedDispatchY = 1;
-                if (GlobalSpeedDispatchX > MAX_THREAD_GROUPS)
-                {
-                    u32 NumThreadGroups = GlobalSpeedDispatchX;
-                    GlobalSpeedDispatchX = 64;
-                    GlobalSpeedDispatchY = DispatchSize(NumThreadGroups, GlobalSpeedDispatchX);
-                }
-                
-                VkComputeDispatch(Commands, DemoState->GraphCalcGlobalSpeedPipeline, GraphSimSets, ArrayCount(GraphSimSets), GlobalSpeedDispatchX, GlobalSpeedDispatchY, 1);
+                GraphLevelProlong(Commands, LevelId - 1);
             }
             
-            VkBarrierBufferAdd(Commands, DemoState->GlobalMoveBuffer,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            VkCommandsBarrierFlush(Commands);
-
-            // NOTE: Graph Update Nodes
-            VkComputeDispatch(Commands, DemoState->GraphUpdateNodesPipeline, GraphSimSets, ArrayCount(GraphSimSets), GraphDispatchX, GraphDispatchY, 1);
-            
             VkBarrierBufferAdd(Commands, DemoState->NodePosBuffer,
                                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
                                VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            VkBarrierBufferAdd(Commands, DemoState->NodeStateBuffer,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                               VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
             VkBarrierBufferAdd(Commands, DemoState->EdgeIndexBuffer,
                                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
                                VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
@@ -2146,7 +4766,11 @@ DEMO_MAIN_LOOP(MainLoop)
             }
 
             VkDeviceSize Offset = 0;
+#if GRAPH_PACKED_NODE_STATE
+            vkCmdBindVertexBuffers(Commands->Buffer, 0, 1, &DemoState->NodeStateBuffer, &Offset);
+#else
             vkCmdBindVertexBuffers(Commands->Buffer, 0, 1, &DemoState->NodePosBuffer, &Offset);
+#endif
             vkCmdBindIndexBuffer(Commands->Buffer, DemoState->EdgeIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
             vkCmdDrawIndexed(Commands->Buffer, 2*DemoState->NumGraphDrawEdges, 1, 0, 0, 0);
 #endif
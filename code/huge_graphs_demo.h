@@ -11,6 +11,7 @@
 #include "profiling\profiling.h"
 
 #include "file_headers.h"
+#include "huge_graphs_sort.h"
 
 //
 // NOTE: Graph Data
@@ -34,13 +35,6 @@ struct graph_node_draw
     f32 Scale;
 };
 
-struct grid_cell_block
-{
-    uint NextBlockOffset;
-    uint NumElements;
-    uint ElementIds[1024];
-};
-
 struct global_move
 {
     f32 SpeedEfficiency;
@@ -49,54 +43,245 @@ struct global_move
     f32 MaxJitterTolerance;
 };
 
+struct global_move_reduction
+{
+    f32 Swing;
+    f32 Traction;
+    f32 Displacement;
+};
+
 struct global_move_counters
 {
-    u32 GlobalMoveWorkCounter;
     u32 GlobalMoveDoneCounter;
 };
 
+struct global_move_stats
+{
+    f32 TotalSwing;
+    f32 TotalTraction;
+    f32 MeanDisplacement;
+    f32 Speed;
+};
+
+/*
+  NOTE: Convergence policy. A level counts as converged once the mean node displacement stayed below the threshold for
+        CONVERGENCE_CALM_SAMPLES samples in a row. We only read back the last iteration of every simulated frame, so a sample is a
+        frame no matter how many iterations it ran. A converged coarse level moves on to the next level, a converged level 0 puts
+        the sim to sleep. While asleep we only run 1 iteration every CONVERGENCE_REFRESH_INTERVAL frames and wake up if it moves more than
+        CONVERGENCE_WAKE_FACTOR times the threshold, or if any layout parameter changed.
+ */
+#define CONVERGENCE_CALM_SAMPLES 30
+#define CONVERGENCE_REFRESH_INTERVAL 30
+#define CONVERGENCE_WAKE_FACTOR 2.0f
+
+/*
+  NOTE: We record multiple layout iterations back to back in 1 command buffer. In time budget mode, the layout timer gives us the GPU
+        time per iteration of the last frame we simulated. The iteration count grows by 1 while it would finish under
+        SIM_BUDGET_HEADROOM of the budget and gets scaled by SIM_BUDGET_BACKOFF while it would go over. The CPU frame time includes the
+        vsync and present waits, so it can't tell us how much layout fits.
+ */
+#define SIM_MAX_ITERATIONS_PER_FRAME 64
+#define SIM_BUDGET_HEADROOM 0.9f
+#define SIM_BUDGET_BACKOFF 0.75f
+
+/*
+  NOTE: We write a GPU timestamp before and after the layout dispatches of a frame and read them back next frame. Once a level ran
+        LAYOUT_TIMER_LOG_SAMPLES timed frames through the separate kernels, we log its measured time per iteration next to the bytes
+        GraphLayoutTrafficEstimate expects it to move. GRAPH_PACKED_NODE_STATE is a compile time switch, so comparing the packed and
+        unpacked node state takes a build of each.
+ */
+#define LAYOUT_TIMER_LOG_SAMPLES 60
+
+// NOTE: Each thread in a reduction loads this many elements before we reduce across the work group
+#define REDUCTION_ITEMS_PER_THREAD 16
+#define REDUCTION_NODES_PER_GROUP (32 * REDUCTION_ITEMS_PER_THREAD)
+
+// NOTE: Each thread in the edge parallel attraction processes this many edges
+#define ATTRACTION_ITEMS_PER_THREAD 16
+#define ATTRACTION_EDGES_PER_GROUP (32 * ATTRACTION_ITEMS_PER_THREAD)
+
 //
-// NOTE: Merge Sort Data
+// NOTE: Multilevel Layout Data
 //
 
-struct merge_sort_uniform_data
+/*
+  NOTE: Level 0 is the graph we render, every level above it is a coarser version of the level below. We lay out the coarsest level
+        from random positions and then prolong the positions down 1 level at a time, running a short refinement on each level.
+ */
+
+#define GRAPH_MAX_LEVELS 8
+// NOTE: We stop coarsening once a level has fewer nodes than this or it didn't shrink the graph by at least 10%
+#define GRAPH_MIN_LEVEL_NODES 1000
+#define GRAPH_COARSEST_ITERATIONS 1000
+#define GRAPH_REFINE_ITERATIONS 100
+#define GRAPH_PROLONG_JITTER 1.0f
+
+struct graph_level
 {
-    u32 ArraySize;
-    u32 FlipSize;
-    u32 PassId;
-    u32 N;
-    u32 StartIndexOffset;
+    u32 NumNodes;
+    u32 NumEdges;
+
+    VkDescriptorSet Descriptor;
+    VkBuffer NodePosBuffer;
+    VkBuffer NodeDegreeBuffer;
+    VkBuffer NodeStateBuffer;
+    VkBuffer NodeEdgeBuffer;
+    VkBuffer EdgeBuffer;
+    VkBuffer EdgeSourceBuffer;
+    VkBuffer EdgeCoefficientBuffer;
+    VkBuffer NodeGravityBuffer;
+
+    // NOTE: Maps each of our nodes to its node in the next coarser level
+    VkBuffer CoarseNodeBuffer;
+
+    // NOTE: Ping pong state sets of the fused layout kernel, set i reads state i and writes state 1 - i
+    VkDescriptorSet FusedDescriptors[2];
 };
 
-struct merge_sort_descriptor
+struct graph_prolong_constants
 {
-    VkBuffer UniformBuffer;
-    VkDescriptorSet Descriptor;
+    u32 NumNodes;
+    f32 JitterRadius;
+};
+
+struct graph_fused_constants
+{
+    u32 ApplyPendingMove;
 };
 
-struct merge_sort_atomic_uniform_data
+struct graph_attraction_cache_constants
 {
-    u32 ArraySize;
+    u32 NumNodes;
+    u32 NumEdges;
 };
 
-struct merge_sort_atomic_buffer_data
+/*
+  NOTE: Active set simulation. GRAPH_UPDATE_NODES flags nodes that still move more than the active threshold, GRAPH_ACTIVE_COMPACT
+        lists those and their neighbours, and the attraction, repulsion and update kernels run over that list with indirect dispatches.
+        Nodes outside of the list keep their position and last force. Every ACTIVE_SET_REFRESH_INTERVAL iterations we run a full pass so
+        that frozen nodes that got pushed by non neighbours can wake up again.
+ */
+#define ACTIVE_SET_REFRESH_INTERVAL 16
+
+struct graph_active_set
 {
-    u32 WorkCountId;
-    u32 DoneCounterId;
+    // NOTE: The first 3 values are the VkDispatchIndirectCommand
+    u32 DispatchX;
+    u32 DispatchY;
+    u32 DispatchZ;
+    u32 NumActiveNodes;
+    u32 ActiveCounter;
 };
 
-#define MergeSortPassType_None 0
-#define MergeSortPassType_LocalFd 1
-#define MergeSortPassType_GlobalFlip 2
-#define MergeSortPassType_LocalDisperse 3
-#define MergeSortPassType_GlobalDisperse 4
+/*
+  NOTE: Streaming appends. GraphCreateBuffers gives every node and edge buffer spare capacity so that GraphAppend can add nodes and
+        edges to the resident CSR without rebuilding it. New nodes go after the last node. A node that gains edges adds them at the end
+        of its range if it still has reserved room, otherwise its whole range moves to the end of the used edges (the overflow area)
+        and reserves as many free slots as it holds edges so that hubs don't move on every append. Slots without an owner are marked
+        with 0xFFFFFFFF in EdgeSourceArray. New nodes start at the barycentre of their placed neighbours and only they and the nodes
+        around them relax for GRAPH_APPEND_RELAX_ITERATIONS iterations through the active set while the rest of the graph stays put.
+ */
+#define GRAPH_APPEND_SPARE_FRACTION 0.25f
+#define GRAPH_APPEND_MIN_SPARE_NODES 4096
+#define GRAPH_APPEND_MIN_SPARE_EDGES 65536
+#define GRAPH_APPEND_STAGING_SIZE MegaBytes(16)
+#define GRAPH_APPEND_RELAX_ITERATIONS 64
+#define GRAPH_APPEND_SEED_JITTER 1.0f
+#define GRAPH_APPEND_SPAWN_RADIUS 40.0f
+
+// NOTE: The stream test appends this many nodes every frame, each connected to a few random nodes of the graph
+#define GRAPH_STREAM_TEST_NODES 16
+#define GRAPH_STREAM_TEST_EDGES_PER_NODE 2
+
+struct graph_append_node
+{
+    f32 Degree;
+    graph_node_draw Draw;
+};
 
-struct merge_sort_atomic_pass_params
+struct graph_append_edge
 {
-    u32 PassType;
-    u32 FlipSize;
-    u32 PassId;
-    u32 N;
+    u32 NodeA;
+    u32 NodeB;
+    f32 Weight;
+    u32 Color;
+};
+
+struct graph_append_directed_edge
+{
+    u32 SourceNodeId;
+    u32 OtherNodeId;
+    f32 Weight;
+};
+
+// NOTE: The plan for 1 node that gains edges in GraphAppend
+struct graph_append_run
+{
+    u32 NodeId;
+    u32 FirstDirectedEdge;
+    u32 NumAddedEdges;
+    b32 Moved;
+    graph_node_edges OldEdges;
+    u32 OldReserve;
+    graph_node_edges NewEdges;
+    u32 NewReserve;
+};
+
+struct graph_append_seed_constants
+{
+    u32 FirstNewNode;
+    u32 NumNewNodes;
+    f32 JitterRadius;
+    f32 SpawnRadius;
+};
+
+/*
+  NOTE: Packed node state. Instead of gathering a neighbour's position and degree from 2 buffers, we keep x, y and degree next to
+        each other in 1 stream and store the previous force, which only the node itself reads, as 2 halfs. The unpacked position and
+        degree buffers are only the upload format then. This has to match the define in graph_shaders.h.
+ */
+#define GRAPH_PACKED_NODE_STATE 1
+#define GRAPH_NODE_STATE_FLOATS 3
+
+struct graph_pack_constants
+{
+    u32 NumNodes;
+};
+
+/*
+  NOTE: Out of core layout. Once level 0's edges, their sources and their cached coefficients would take more than
+        GRAPH_RESIDENT_EDGE_BUDGET of GPU memory, the edges and sources live in host visible memory and only the node data stays
+        resident. Level 0 gets split into shards, runs of nodes whose edges fit in a window of GRAPH_SHARD_WINDOW_EDGES, and every
+        iteration copies the shards 1 at a time into 2 ping ponged window buffers to run the attraction over them. Repulsion doesn't
+        need edges, so it runs over all nodes through the cell list whose summary pyramid stands in for the far away nodes of other
+        shards. Coarse levels are small enough to stay resident.
+ */
+#define GRAPH_GPU_LOCAL_SIZE GigaBytes(1)
+#define GRAPH_RESIDENT_EDGE_BUDGET (GRAPH_GPU_LOCAL_SIZE / 2)
+#define GRAPH_SHARD_WINDOW_EDGES (1 << 22)
+// NOTE: Drawing costs 12 bytes per edge, so out of core we only draw the first this many edges
+#define GRAPH_OUT_OF_CORE_DRAW_EDGES (1 << 22)
+// NOTE: Runs graphs that would fit through the out of core path too, to test it
+#define GRAPH_FORCE_OUT_OF_CORE 0
+
+// NOTE: Also the push constants of the GRAPH_SHARD kernels
+struct graph_shard
+{
+    u32 FirstNode;
+    u32 NumNodes;
+    u32 FirstEdge;
+    u32 NumEdges;
+};
+
+// NOTE: Estimated bytes of global memory 1 full layout iteration moves, split by kernel
+struct graph_layout_traffic
+{
+    u64 Attraction;
+    u64 MoveConnections;
+    u64 Repulsion;
+    u64 GlobalSpeed;
+    u64 UpdateNodes;
+    u64 Total;
 };
 
 //
@@ -114,6 +299,121 @@ struct radix_tree_uniform_data
     u32 NumNodes;
 };
 
+#define MortonGatherType_FullKey 0
+#define MortonGatherType_HighKey 1
+
+// NOTE: These have to match radixtree_shaders.h
+#define MORTON_COHERENT_BLOCK_SIZE 2048
+#define MortonLocalSortType_Sort 0
+#define MortonLocalSortType_Merge 1
+
+struct morton_coherent_data
+{
+    u32 DisorderCount;
+    u32 DoneCounter;
+    u32 ClampDispatchX;
+    u32 ClampDispatchY;
+    u32 ClampDispatchZ;
+};
+
+struct morton_sort_stats
+{
+    u32 DisorderCount;
+};
+
+// NOTE: Coherent sorts fall back to a full sort once more than this fraction of the keys was still out of order last time
+#define MORTON_COHERENT_DISORDER_THRESHOLD 0.001f
+// NOTE: Nodes that moved too far stay misplaced under the threshold, so we still run a full sort this often
+#define MORTON_COHERENT_REFRESH_INTERVAL 64
+
+// NOTE: These have to match the defines in fmm_shaders.h
+#define FMM_ORDER 8
+#define FMM_THETA 0.5f
+#define FMM_SOFTNER_SCALE 100.0f
+#define FMM_MAX_DEPTH 96
+#define FMM_MAX_WALK_ROUNDS 32
+
+// NOTE: Size of the interaction list pool, 8 bytes per entry. If a tree needs more the FMM replays the walk per target instead
+#define FMM_LIST_ENTRIES_PER_NODE 48
+#define FMM_LIST_MAX_ENTRIES (1 << 24)
+// NOTE: We record this many FMM_DOWNWARD passes past last frame's max depth, the last one finishes any deeper subtrees
+#define FMM_DOWNWARD_DEPTH_SLACK 4
+
+struct fmm_walk_state
+{
+    u32 NumListEntries;
+    u32 ListOverflow;
+    u32 RoundCounts[FMM_MAX_WALK_ROUNDS + 1];
+};
+
+struct fmm_stats
+{
+    u32 MaxDepth;
+    u32 NumListEntries;
+    u32 ListOverflow;
+};
+
+struct fmm_walk_constants
+{
+    u32 Round;
+    u32 Final;
+};
+
+struct fmm_downward_constants
+{
+    u32 Depth;
+    u32 LastPass;
+};
+
+//
+// NOTE: Grid Repulsion Data
+//
+
+// NOTE: These have to match the defines in graph_grid_shaders.h
+#define GRID_CELLS_AXIS_LOG2 8
+#define GRID_CELLS_AXIS (1 << GRID_CELLS_AXIS_LOG2)
+#define GRID_NUM_CELLS (GRID_CELLS_AXIS * GRID_CELLS_AXIS)
+#define GRID_NUM_LEVELS GRID_CELLS_AXIS_LOG2
+// NOTE: Cells in all levels of the summary pyramid, 4^8 + 4^7 + ... + 4^1
+#define GRID_NUM_SUMMARY_CELLS ((4 * GRID_NUM_CELLS - 4) / 3)
+
+struct grid_bounds
+{
+    u32 MinX;
+    u32 MinY;
+    u32 MaxX;
+    u32 MaxY;
+};
+
+struct grid_pyramid_constants
+{
+    u32 Level;
+};
+
+//
+// NOTE: Edge Sort Data
+//
+
+/*
+  NOTE: Sorts the edges of every node inside its StartConnections/EndConnections range, see edge_sort_shaders.cpp. Sorting by the other
+        node's id is what dedup and delta compression want, sorting by weight (heaviest first) gives the top k neighbours. It runs
+        once on load and on the nodes that gained edges in GraphAppend. These have to match the defines in edge_sort_shaders.h.
+ */
+#define EDGE_SORT_THREAD_SIZE 16
+#define EDGE_SORT_BLOCK_SIZE 1024
+#define EDGE_SORT_BLOCK_THREADS 256
+
+#define EdgeSortKey_OtherNodeId 0
+#define EdgeSortKey_Weight 1
+
+struct edge_sort_constants
+{
+    u32 SortKey;
+    u32 FirstSegment;
+    u32 NumSegments;
+    u32 NumBatchEdges;
+};
+
 //
 // NOTE: Render Data
 //
@@ -138,6 +438,7 @@ struct graph_globals
     v2 ViewPort;
     f32 FrameTime;
     u32 NumNodes;
+    u32 NumEdges;
 
     // NOTE: Layout Data
     float AttractionMultiplier;
@@ -155,6 +456,9 @@ struct graph_globals
     // NOTE: Reduction data
     u32 NumThreadGroupsCalcNodeBounds;
     u32 NumThreadGroupsGlobalSpeed;
+
+    // NOTE: Active Set Data
+    f32 ActiveThreshold;
 };
 
 struct render_mesh
@@ -178,7 +482,12 @@ struct render_scene
 };
 
 #define MAX_THREAD_GROUPS 65535
-#define BITONIC_MERGE_SORT 0
+// NOTE: The radix tree path uses the fast multipole method instead of Barnes-Hut for repulsion
+#define RADIX_TREE_FMM 1
+// NOTE: Checks the CPU FMM reference and the GPU FMM on the loaded graph against the n^2 sum on startup, and asserts on the RMS error
+#define FMM_REFERENCE_TEST 1
+#define FMM_REFERENCE_NUM_SAMPLES 256
+#define FMM_REFERENCE_MAX_ERROR 1e-2f
 #define LINE_PIPELINE_2 0
 
 struct demo_state
@@ -220,6 +529,40 @@ struct demo_state
     f32 CellWorldDim;
     f32 WorldRadius;
 
+    // NOTE: Convergence
+    b32 SimSettled;
+    b32 SimRanLastFrame;
+    u32 NumCalmSamples;
+    u32 NumSettledFrames;
+    f32 ConvergenceThreshold;
+    f32 PrevLayoutParams[8];
+
+    // NOTE: Iterations per frame
+    f32 IterationsPerFrame;
+    b32 TimeBudgetEnabled;
+    f32 LayoutBudgetMs;
+    u32 NumBudgetIterations;
+
+    // NOTE: Layout Timer
+    VkQueryPool LayoutTimestampPool;
+    f32 TimestampPeriodNs;
+    b32 LayoutTimerWritten;
+    b32 LayoutTimerFused;
+    u32 LayoutTimerLevel;
+    u32 LayoutTimerNumIterations;
+    f32 LayoutGpuMs;
+    u32 LayoutSampleLevel;
+    u32 NumLayoutSamples;
+    f32 LayoutSampleTotalMs;
+    u32 LayoutSampleTotalIterations;
+    
+    // NOTE: Multilevel Layout
+    b32 MultilevelEnabled;
+    u32 NumGraphLevels;
+    u32 CurrGraphLevel;
+    u32 CurrLevelIterations;
+    graph_level GraphLevels[GRAPH_MAX_LEVELS];
+
     //======================================================================
     // NOTE: Graph GPU Data
     //======================================================================
@@ -234,22 +577,133 @@ struct demo_state
     VkBuffer NodePrevForceBuffer;
     VkBuffer NodeEdgeBuffer;
     VkBuffer EdgeBuffer;
+    VkBuffer EdgeSourceBuffer;
+    VkBuffer AttractionCarryBuffer;
 
     VkBuffer GlobalMoveBuffer;
     VkBuffer GlobalMoveReductionBuffer;
     VkBuffer GlobalMoveCounterBuffer;
+    VkBuffer GlobalMoveStatsBuffer;
+    global_move_stats* GlobalMoveStatsCpu;
         
+    vk_pipeline* GraphAttractionEdgesPipeline;
     vk_pipeline* GraphMoveConnectionsPipeline;
     vk_pipeline* GraphCalcGlobalSpeedPipeline;
     vk_pipeline* GraphUpdateNodesPipeline;
+    vk_pipeline* GraphProlongPipeline;
+
+    // NOTE: Active set simulation
+    b32 ActiveSetEnabled;
+    f32 ActiveThreshold;
+    u32 NumActiveSetIterations;
+    VkBuffer NodeActiveBuffer;
+    VkBuffer ActiveNodeBuffer;
+    VkBuffer ActiveSetBuffer;
+    vk_pipeline* GraphActiveCompactPipeline;
+    vk_pipeline* GraphActiveDispatchArgsPipeline;
+    vk_pipeline* GraphMoveConnectionsActivePipeline;
+    vk_pipeline* GraphRepulsionActivePipeline;
+    vk_pipeline* GraphUpdateNodesActivePipeline;
+
+    // NOTE: Fused layout kernel
+    b32 FusedLayoutEnabled;
+    VkDescriptorSetLayout FusedDescLayout;
+    VkBuffer FusedPosBuffer;
+    VkBuffer FusedSwingBuffers[2];
+    vk_pipeline* GraphFusedLayoutPipeline;
+    vk_pipeline* GraphFusedResolvePipeline;
+
+    // NOTE: Streaming appends
+    b32 StreamTestEnabled;
+    u32 MaxNumGraphNodes;
+    u32 MaxNumGraphEdges;
+    u32 MaxNumGraphDrawEdges;
+    u32 NumAppendRelaxIterations;
+    // NOTE: CPU copy of the level 0 node ranges plus the end of the slots each range reserved
+    graph_node_edges* NodeEdgesCpu;
+    u32* NodeEdgeReserveCpu;
+    VkBuffer AppendStagingBuffer;
+    u8* AppendStagingCpu;
+    vk_pipeline* GraphAppendSeedPipeline;
+
+    // NOTE: Out of core layout
+    b32 OutOfCoreEnabled;
+    VkBuffer EdgeStoreBuffer;
+    VkBuffer EdgeSourceStoreBuffer;
+    graph_edge* EdgeStoreCpu;
+    u32* EdgeSourceStoreCpu;
+    u32 NumShards;
+    graph_shard* Shards;
+    u32 ShardWindowEdges;
+    // NOTE: The shard each window holds right now, so that graphs with 2 or fewer shards only get copied once
+    u32 ShardWindowIds[2];
+    VkBuffer ShardEdgeBuffers[2];
+    VkBuffer ShardEdgeSourceBuffers[2];
+    VkBuffer ShardCarryBuffers[2];
+    VkDescriptorSetLayout ShardDescLayout;
+    VkDescriptorSet ShardDescriptors[2];
+    vk_pipeline* GraphAttractionEdgesShardPipeline;
+    vk_pipeline* GraphMoveConnectionsShardPipeline;
+    
+    // NOTE: Packed node state
+    VkBuffer NodeStateBuffer;
+    VkBuffer NodePrevForceHalfBuffer;
+    b32 NodeStateDirty;
+    vk_pipeline* GraphPackNodeStatePipeline;
+
+    // NOTE: Attraction coefficient and gravity cache, rebuilt when the graph or the params it was built with change
+    b32 AttractionCacheDirty;
+    f32 CachedAttractionMultiplier;
+    f32 CachedAttractionWeightPower;
+    f32 CachedGravityMultiplier;
+    vk_pipeline* GraphAttractionCachePipeline;
 
     // NOTE: Regular n^2 repulsion
     vk_pipeline* GraphRepulsionPipeline;
 
+    // NOTE: Cell list repulsion
+    b32 GridRepulsionEnabled;
+    VkDescriptorSetLayout GridDescLayout;
+    VkDescriptorSet GridDescriptor;
+    VkBuffer GridBoundsBuffer;
+    VkBuffer GridCellCountBuffer;
+    VkBuffer GridCellStartBuffer;
+    VkBuffer GridNodeRankBuffer;
+    VkBuffer GridCellNodeBuffer;
+    VkBuffer GridCellSummaryBuffer;
+    vk_pipeline* GridBoundsPipeline;
+    vk_pipeline* GridCellIdsPipeline;
+    vk_pipeline* GridScanPipeline;
+    vk_pipeline* GridScatterPipeline;
+    vk_pipeline* GridSummaryPipeline;
+    vk_pipeline* GridPyramidPipeline;
+    vk_pipeline* GridRepulsionPipeline;
+    vk_pipeline* GridRepulsionActivePipeline;
+
+    // NOTE: Per node edge sort. Segments too big for a work group get sorted in batches of up to EdgeSort.MaxNumKeys edges
+    u32 EdgeSortKey;
+    VkDescriptorSetLayout EdgeSortDescLayout;
+    VkDescriptorSet EdgeSortDescriptor;
+    VkBuffer EdgeSortSegmentBuffer;
+    VkBuffer EdgeSortBatchOffsetBuffer;
+    VkBuffer EdgeSortKeyBuffer;
+    VkBuffer EdgeSortPayloadBuffer;
+    VkBuffer EdgeSortBatchSegmentBuffer;
+    VkBuffer EdgeSortScratchEdgeBuffer;
+    gpu_sort EdgeSort;
+    vk_pipeline* EdgeSortThreadPipeline;
+    vk_pipeline* EdgeSortBlockPipeline;
+    vk_pipeline* EdgeSortGatherKeysPipeline;
+    vk_pipeline* EdgeSortGatherSegmentsPipeline;
+    vk_pipeline* EdgeSortScatterPipeline;
+
     //======================================================================
     // NOTE: Radix Repulsion GPU Data
     //======================================================================
 
+    // NOTE: The cell list takes priority when both are enabled
+    b32 RadixTreeRepulsionEnabled;
+    
     VkBuffer GlobalBoundsReductionBuffer;
     VkBuffer GlobalBoundsCounterBuffer;
     VkBuffer ElementBoundsBuffer;
@@ -259,6 +713,7 @@ struct demo_state
     // NOTE: Radix Tree Data
     VkBuffer RadixTreeUniformBuffer;
     VkBuffer RadixMortonKeyBuffer;
+    VkBuffer RadixSortedMortonKeyBuffer;
     VkBuffer RadixElementReMappingBuffer;
     VkBuffer RadixTreeChildrenBuffer;
     VkBuffer RadixTreeParentBuffer;
@@ -268,46 +723,60 @@ struct demo_state
     VkDescriptorSetLayout RadixTreeDescLayout;
 
     vk_pipeline* GenerateMortonKeysPipeline;
+    vk_pipeline* MortonKeysGatherPipeline;
     vk_pipeline* RadixTreeBuildPipeline;
     vk_pipeline* RadixTreeSummarizePipeline;
     vk_pipeline* RadixTreeRepulsionPipeline;
+    vk_pipeline* RadixTreeRepulsionActivePipeline;
+
+    // NOTE: FMM Data
+    VkDescriptorSetLayout FmmDescLayout;
+    VkDescriptorSet FmmDescriptor;
+    VkBuffer FmmNodeBoxBuffer;
+    VkBuffer FmmMultipoleBuffer;
+    VkBuffer FmmLocalBuffer;
+    VkBuffer FmmNodeLevelBuffer;
+    VkBuffer FmmLevelCountBuffer;
+    VkBuffer FmmLevelStartBuffer;
+    VkBuffer FmmLevelDispatchBuffer;
+    VkBuffer FmmLevelNodeBuffer;
+    VkBuffer FmmGraphNodeLeafBuffer;
+    VkBuffer FmmExpandHeadBuffer;
+    VkBuffer FmmNearHeadBuffer;
+    VkBuffer FmmListEntryBuffer;
+    VkBuffer FmmWalkStateBuffer;
+    VkBuffer FmmWalkPairBuffer;
+    VkBuffer FmmStatsBuffer;
+    fmm_stats* FmmStatsCpu;
+    u32 FmmMaxListEntries;
+    b32 FmmListOverflowLogged;
+    vk_pipeline* FmmUpwardPipeline;
+    vk_pipeline* FmmDepthPipeline;
+    vk_pipeline* FmmLevelScanPipeline;
+    vk_pipeline* FmmLevelScatterPipeline;
+    vk_pipeline* FmmWalkPipeline;
+    vk_pipeline* FmmDownwardPipeline;
+    vk_pipeline* FmmEvaluatePipeline;
+    vk_pipeline* FmmEvaluateActivePipeline;
     
-    // NOTE: Merge Sort Data
-    VkDescriptorSetLayout MergeSortDescLayout;
-    merge_sort_descriptor MergeSortLocalFdDescriptor;
-    merge_sort_descriptor MergeSortLocalDisperseDescriptor;
-    merge_sort_descriptor MergeSortGlobalFlipDescriptors[10];
-    merge_sort_descriptor MergeSortGlobalDisperseDescriptors[10];
-
-    vk_pipeline* MergeSortLocalFdPipeline;
-    vk_pipeline* MergeSortGlobalFlipPipeline;
-    vk_pipeline* MergeSortLocalDispersePipeline;
-    vk_pipeline* MergeSortGlobalDispersePipeline;
-
-    // NOTE: Parallel Sort Data
-#define PARALLEL_SORT_MAX_THREAD_GROUPS 1000000
-    u32 ParallelSortNumThreadGroups;
-    u32 ParallelSortNumReducedThreadGroups;
-
-    VkDescriptorSet ParallelSortConstantDescriptor;
-    VkDescriptorSet ParallelSortInputOutputDescriptor[2];
-    VkDescriptorSet ParallelSortScanDescriptor[2];
-    VkDescriptorSet ParallelSortScratchDescriptor;
-    VkBuffer ParallelSortUniformBuffer;
-    VkBuffer ParallelSortMortonBuffer;
-    VkBuffer ParallelSortPayloadBuffer;
-    VkBuffer ParallelSortScratchBuffer;
-    VkBuffer ParallelSortReducedScratchBuffer;
-
-    VkDescriptorSetLayout ParallelSortConstantDescLayout;
-    VkDescriptorSetLayout ParallelSortInputOutputDescLayout;
-    VkDescriptorSetLayout ParallelSortScanDescLayout;
-    VkDescriptorSetLayout ParallelSortScratchDescLayout;
-    vk_pipeline* ParallelSortCountPipeline;
-    vk_pipeline* ParallelSortReducePipeline;
-    vk_pipeline* ParallelSortScanPipeline;
-    vk_pipeline* ParallelSortScanAddPipeline;
-    vk_pipeline* ParallelSortScatterPipeline;
+    // NOTE: Sort Data
+    // NOTE: Any GpuSortBackend_. Stable backends sort the full morton keys with MortonSort64, which uses MortonSort for its word sorts
+    u32 MortonSortBackend;
+    gpu_sort MortonSort;
+    gpu_sort64 MortonSort64;
+
+    // NOTE: Coherent sort for the radix tree repulsion, starts from the last sorted ElementReMapping. MortonSortedNumNodes is how many
+    // nodes it is valid for, 0 after we switch levels or run a frame without the radix tree
+    b32 MortonCoherentEnabled;
+    u32 MortonSortedNumNodes;
+    u32 MortonNumCoherentSorts;
+    VkBuffer MortonBlockMaxBuffer;
+    VkBuffer MortonCoherentBuffer;
+    VkBuffer MortonSortStatsBuffer;
+    morton_sort_stats* MortonSortStatsCpu;
+    vk_pipeline* MortonLocalSortPipeline;
+    vk_pipeline* MortonCheckPipeline;
+    vk_pipeline* MortonClampPipeline;
     
     //======================================================================
     // NOTE: Graph Draw Data
@@ -0,0 +1,669 @@
+
+//
+// NOTE: FMM CPU Reference
+//
+
+/*
+  NOTE: CPU version of fmm_shaders.cpp. It builds the same LBVH from the same Morton keys and runs the same passes with the same
+        interaction lists, so a node's force here should match the GPU up to float rounding. The upward and downward passes and the
+        interaction list walk recurse over the tree instead of using atomics, depth buckets and a work queue, but every node sees the
+        same inputs. FmmReferenceTest compares the result against the direct n^2 sum on random clustered points, and
+        FmmGpuReferenceTest in huge_graphs_demo.cpp does the same for the GPU on the loaded graph.
+ */
+
+#define FMM_LEAF_BIT 0x80000000
+
+struct fmm_complex
+{
+    f32 Re;
+    f32 Im;
+};
+
+struct fmm_box
+{
+    v2 Min;
+    v2 Max;
+};
+
+struct fmm_list_entry
+{
+    u32 SourceId;
+    fmm_list_entry* Next;
+};
+
+struct fmm_tree
+{
+    u32 NumLeaves;
+    v2* NodePos;
+    f32* NodeDegree;
+
+    u32* ElementReMapping;
+    u64* SortedKeys;
+    u32* Children;
+    u32* Parents;
+
+    fmm_box* Boxes;
+    fmm_complex* Multipoles;
+    fmm_complex* Locals;
+
+    // NOTE: Like the GPU, expand lists are per tree node with the leaves after the internal nodes and near lists are per leaf
+    linear_arena* Arena;
+    fmm_list_entry** ExpandHeads;
+    fmm_list_entry** NearHeads;
+};
+
+inline fmm_complex FmmComplex(f32 Re, f32 Im)
+{
+    fmm_complex Result = {};
+    Result.Re = Re;
+    Result.Im = Im;
+    return Result;
+}
+
+inline fmm_complex FmmComplex(v2 A)
+{
+    fmm_complex Result = FmmComplex(A.x, A.y);
+    return Result;
+}
+
+inline fmm_complex FmmComplexAdd(fmm_complex A, fmm_complex B)
+{
+    fmm_complex Result = FmmComplex(A.Re + B.Re, A.Im + B.Im);
+    return Result;
+}
+
+inline fmm_complex FmmComplexScale(f32 Scale, fmm_complex A)
+{
+    fmm_complex Result = FmmComplex(Scale * A.Re, Scale * A.Im);
+    return Result;
+}
+
+inline fmm_complex FmmComplexMul(fmm_complex A, fmm_complex B)
+{
+    fmm_complex Result = FmmComplex(A.Re * B.Re - A.Im * B.Im, A.Re * B.Im + A.Im * B.Re);
+    return Result;
+}
+
+inline fmm_complex FmmComplexInverse(fmm_complex A)
+{
+    f32 LengthSq = A.Re * A.Re + A.Im * A.Im;
+    fmm_complex Result = FmmComplex(A.Re / LengthSq, -A.Im / LengthSq);
+    return Result;
+}
+
+inline f32 FmmBinomial(u32 N, u32 K)
+{
+    f32 Result = 1.0f;
+    for (u32 Id = 1; Id <= K; ++Id)
+    {
+        Result = Result * f32(N - K + Id) / f32(Id);
+    }
+    return Result;
+}
+
+inline v2 FmmBoxCenter(fmm_box Box)
+{
+    v2 Result = V2(0.5f * (Box.Min.x + Box.Max.x), 0.5f * (Box.Min.y + Box.Max.y));
+    return Result;
+}
+
+inline f32 FmmBoxDiagSq(fmm_box Box)
+{
+    f32 Result = (Box.Max.x - Box.Min.x) * (Box.Max.x - Box.Min.x) + (Box.Max.y - Box.Min.y) * (Box.Max.y - Box.Min.y);
+    return Result;
+}
+
+inline b32 FmmWellSeparated(fmm_box BoxA, fmm_box BoxB, f32 RepulsionSoftner)
+{
+    // NOTE: Expansions drop the softner, so we also need the gap to be big next to it
+    f32 GapX = Max(Max(BoxA.Min.x - BoxB.Max.x, BoxB.Min.x - BoxA.Max.x), 0.0f);
+    f32 GapY = Max(Max(BoxA.Min.y - BoxB.Max.y, BoxB.Min.y - BoxA.Max.y), 0.0f);
+    f32 GapSq = GapX * GapX + GapY * GapY;
+    b32 Result = (FMM_THETA * FMM_THETA * GapSq > Max(FmmBoxDiagSq(BoxA), FmmBoxDiagSq(BoxB)) &&
+                  GapSq > FMM_SOFTNER_SCALE * RepulsionSoftner);
+    return Result;
+}
+
+//
+// NOTE: Tree Build
+//
+
+inline u32 FmmMortonExpandBits(u32 Value)
+{
+    u32 Result = (Value | (Value << 16)) & 0x0000FFFF;
+    Result = (Result | (Result << 8)) & 0x00FF00FF;
+    Result = (Result | (Result << 4)) & 0x0F0F0F0F;
+    Result = (Result | (Result << 2)) & 0x33333333;
+    Result = (Result | (Result << 1)) & 0x55555555;
+    return Result;
+}
+
+inline u32 FmmMortonAxis(f32 Pos, f32 BoundsMin, f32 BoundsMax, u32* LowBits)
+{
+    // NOTE: Same quantization as Morton2d in radixtree_shaders.cpp
+    f32 Extent = Max(BoundsMax - BoundsMin, 1e-20f);
+    f32 CellSize = Extent / 65536.0f;
+    f32 RelativePos = Max(Pos - BoundsMin, 0.0f);
+    u32 Result = u32(Min(RelativePos / CellSize, 65535.0f));
+
+    f32 LowPos = fmaf(-f32(Result), CellSize, RelativePos) / CellSize * 65536.0f;
+    *LowBits = u32(Min(Max(LowPos, 0.0f), 65535.0f));
+    return Result;
+}
+
+inline u64 FmmMortonKey(v2 Pos, fmm_box Bounds)
+{
+    u32 LowX, LowY;
+    u32 HighX = FmmMortonAxis(Pos.x, Bounds.Min.x, Bounds.Max.x, &LowX);
+    u32 HighY = FmmMortonAxis(Pos.y, Bounds.Min.y, Bounds.Max.y, &LowY);
+
+    u64 HighWord = 2 * FmmMortonExpandBits(HighX) + FmmMortonExpandBits(HighY);
+    u64 LowWord = 2 * FmmMortonExpandBits(LowX) + FmmMortonExpandBits(LowY);
+    u64 Result = (HighWord << 32) | LowWord;
+    return Result;
+}
+
+inline i32 FmmFindMsb(u64 Value)
+{
+    i32 Result = -1;
+    while (Value != 0)
+    {
+        Result += 1;
+        Value = Value >> 1;
+    }
+    return Result;
+}
+
+inline i32 FmmCommonPrefix(fmm_tree* Tree, i32 Id0, i32 Id1)
+{
+    // NOTE: Same as LengthCommonPrefix in radixtree_shaders.cpp
+    i32 Result = -1;
+    if (Id1 >= 0 && Id1 < i32(Tree->NumLeaves))
+    {
+        u64 Key0 = Tree->SortedKeys[Id0];
+        u64 Key1 = Tree->SortedKeys[Id1];
+        if (Key0 == Key1)
+        {
+            Result = 95 - FmmFindMsb(u64(Id0 ^ Id1));
+        }
+        else
+        {
+            Result = 63 - FmmFindMsb(Key0 ^ Key1);
+        }
+    }
+    return Result;
+}
+
+inline void FmmTreeBuild(fmm_tree* Tree)
+{
+    // NOTE: Same as RADIX_TREE_BUILD, every internal node finds its key range and split on its own
+    i32 NumLeaves = i32(Tree->NumLeaves);
+    for (i32 NodeId = 0; NodeId < NumLeaves - 1; ++NodeId)
+    {
+        i32 PrefixNext = FmmCommonPrefix(Tree, NodeId, NodeId + 1);
+        i32 PrefixPrev = FmmCommonPrefix(Tree, NodeId, NodeId - 1);
+        i32 KeyRangeDir = PrefixNext > PrefixPrev ? 1 : (PrefixNext < PrefixPrev ? -1 : 0);
+        i32 DistMin = FmmCommonPrefix(Tree, NodeId, NodeId - KeyRangeDir);
+
+        i32 KeyRangeUpperBound = 2;
+        while (FmmCommonPrefix(Tree, NodeId, NodeId + KeyRangeUpperBound * KeyRangeDir) > DistMin)
+        {
+            KeyRangeUpperBound = KeyRangeUpperBound * 2;
+        }
+
+        i32 L = 0;
+        for (i32 T = KeyRangeUpperBound / 2; T >= 1; T = T / 2)
+        {
+            if (FmmCommonPrefix(Tree, NodeId, NodeId + (L + T) * KeyRangeDir) > DistMin)
+            {
+                L = L + T;
+            }
+        }
+
+        i32 J = NodeId + L * KeyRangeDir;
+        i32 DistNode = FmmCommonPrefix(Tree, NodeId, J);
+
+        i32 S = 0;
+        for (i32 T = (L + 1) / 2; T > 1; T = (T + 1) / 2)
+        {
+            if (FmmCommonPrefix(Tree, NodeId, NodeId + (S + T) * KeyRangeDir) > DistNode)
+            {
+                S = S + T;
+            }
+        }
+        if (FmmCommonPrefix(Tree, NodeId, NodeId + (S + 1) * KeyRangeDir) > DistNode)
+        {
+            S = S + 1;
+        }
+
+        i32 SplitPos = NodeId + S * KeyRangeDir + Min(0, KeyRangeDir);
+        b32 LeftLeaf = Min(NodeId, J) == SplitPos;
+        b32 RightLeaf = Max(NodeId, J) == SplitPos + 1;
+
+        u32 LeftChild = u32(SplitPos);
+        u32 RightChild = u32(SplitPos + 1);
+        Tree->Parents[LeftChild + (LeftLeaf ? NumLeaves - 1 : 0)] = NodeId;
+        Tree->Parents[RightChild + (RightLeaf ? NumLeaves - 1 : 0)] = NodeId;
+        Tree->Children[2 * NodeId + 0] = LeftChild | (LeftLeaf ? FMM_LEAF_BIT : 0);
+        Tree->Children[2 * NodeId + 1] = RightChild | (RightLeaf ? FMM_LEAF_BIT : 0);
+    }
+}
+
+//
+// NOTE: Expansions
+//
+
+inline fmm_box FmmLoadBox(fmm_tree* Tree, u32 TreeNodeId)
+{
+    fmm_box Result = {};
+    if (TreeNodeId & FMM_LEAF_BIT)
+    {
+        v2 Pos = Tree->NodePos[Tree->ElementReMapping[TreeNodeId & ~FMM_LEAF_BIT]];
+        Result.Min = Pos;
+        Result.Max = Pos;
+    }
+    else
+    {
+        Result = Tree->Boxes[TreeNodeId];
+    }
+    return Result;
+}
+
+inline v2 FmmLoadMultipole(fmm_tree* Tree, u32 TreeNodeId, fmm_complex* Multipole)
+{
+    v2 Center = {};
+    if (TreeNodeId & FMM_LEAF_BIT)
+    {
+        u32 GraphNodeId = Tree->ElementReMapping[TreeNodeId & ~FMM_LEAF_BIT];
+        Center = Tree->NodePos[GraphNodeId];
+        Multipole[0] = FmmComplex(Tree->NodeDegree[GraphNodeId], 0.0f);
+        for (u32 TermId = 1; TermId <= FMM_ORDER; ++TermId)
+        {
+            Multipole[TermId] = FmmComplex(0.0f, 0.0f);
+        }
+    }
+    else
+    {
+        Center = FmmBoxCenter(Tree->Boxes[TreeNodeId]);
+        for (u32 TermId = 0; TermId <= FMM_ORDER; ++TermId)
+        {
+            Multipole[TermId] = Tree->Multipoles[TreeNodeId * (FMM_ORDER + 1) + TermId];
+        }
+    }
+    return Center;
+}
+
+inline void FmmListAppend(fmm_tree* Tree, fmm_list_entry** Head, u32 SourceId)
+{
+    fmm_list_entry* Entry = PushStruct(Tree->Arena, fmm_list_entry);
+    Entry->SourceId = SourceId;
+    Entry->Next = *Head;
+    *Head = Entry;
+}
+
+inline void FmmWalk(fmm_tree* Tree, u32 TargetId, u32 SourceId, f32 RepulsionSoftner)
+{
+    // NOTE: Same pairs as FMM_WALK in fmm_shaders.cpp, but 1 thread can just recurse instead of going through a work queue
+    fmm_box TargetBox = FmmLoadBox(Tree, TargetId);
+    fmm_box SourceBox = FmmLoadBox(Tree, SourceId);
+
+    b32 TargetLeaf = (TargetId & FMM_LEAF_BIT) != 0;
+    b32 SourceLeaf = (SourceId & FMM_LEAF_BIT) != 0;
+    if (FmmWellSeparated(TargetBox, SourceBox, RepulsionSoftner))
+    {
+        u32 HeadId = TargetLeaf ? (TargetId & ~FMM_LEAF_BIT) + Tree->NumLeaves - 1 : TargetId;
+        FmmListAppend(Tree, Tree->ExpandHeads + HeadId, SourceId);
+    }
+    else if (TargetLeaf && SourceLeaf)
+    {
+        FmmListAppend(Tree, Tree->NearHeads + (TargetId & ~FMM_LEAF_BIT), SourceId);
+    }
+    else if (!TargetLeaf && (SourceLeaf || FmmBoxDiagSq(TargetBox) >= FmmBoxDiagSq(SourceBox)))
+    {
+        FmmWalk(Tree, Tree->Children[2 * TargetId + 0], SourceId, RepulsionSoftner);
+        FmmWalk(Tree, Tree->Children[2 * TargetId + 1], SourceId, RepulsionSoftner);
+    }
+    else
+    {
+        FmmWalk(Tree, TargetId, Tree->Children[2 * SourceId + 0], RepulsionSoftner);
+        FmmWalk(Tree, TargetId, Tree->Children[2 * SourceId + 1], RepulsionSoftner);
+    }
+}
+
+inline void FmmUpward(fmm_tree* Tree, u32 NodeId)
+{
+    u32 ChildIds[2] = { Tree->Children[2 * NodeId + 0], Tree->Children[2 * NodeId + 1] };
+    for (u32 ChildId = 0; ChildId < 2; ++ChildId)
+    {
+        if (!(ChildIds[ChildId] & FMM_LEAF_BIT))
+        {
+            FmmUpward(Tree, ChildIds[ChildId]);
+        }
+    }
+
+    fmm_box LeftBox = FmmLoadBox(Tree, ChildIds[0]);
+    fmm_box RightBox = FmmLoadBox(Tree, ChildIds[1]);
+    fmm_box Box = {};
+    Box.Min = V2(Min(LeftBox.Min.x, RightBox.Min.x), Min(LeftBox.Min.y, RightBox.Min.y));
+    Box.Max = V2(Max(LeftBox.Max.x, RightBox.Max.x), Max(LeftBox.Max.y, RightBox.Max.y));
+    Tree->Boxes[NodeId] = Box;
+    v2 Center = FmmBoxCenter(Box);
+
+    // NOTE: M2M, b_l = -Q * z0^l / l + sum_{k <= l} a_k * z0^(l - k) * C(l - 1, k - 1)
+    fmm_complex* Multipole = Tree->Multipoles + NodeId * (FMM_ORDER + 1);
+    for (u32 TermId = 0; TermId <= FMM_ORDER; ++TermId)
+    {
+        Multipole[TermId] = FmmComplex(0.0f, 0.0f);
+    }
+
+    for (u32 ChildId = 0; ChildId < 2; ++ChildId)
+    {
+        fmm_complex ChildMultipole[FMM_ORDER + 1];
+        v2 ChildCenter = FmmLoadMultipole(Tree, ChildIds[ChildId], ChildMultipole);
+
+        fmm_complex Z0 = FmmComplex(ChildCenter.x - Center.x, ChildCenter.y - Center.y);
+        fmm_complex Z0Pow[FMM_ORDER + 1];
+        Z0Pow[0] = FmmComplex(1.0f, 0.0f);
+        for (u32 PowerId = 1; PowerId <= FMM_ORDER; ++PowerId)
+        {
+            Z0Pow[PowerId] = FmmComplexMul(Z0Pow[PowerId - 1], Z0);
+        }
+
+        f32 Charge = ChildMultipole[0].Re;
+        Multipole[0].Re += Charge;
+        for (u32 L = 1; L <= FMM_ORDER; ++L)
+        {
+            fmm_complex Term = FmmComplexScale(-Charge / f32(L), Z0Pow[L]);
+            for (u32 K = 1; K <= L; ++K)
+            {
+                Term = FmmComplexAdd(Term, FmmComplexScale(FmmBinomial(L - 1, K - 1), FmmComplexMul(ChildMultipole[K], Z0Pow[L - K])));
+            }
+            Multipole[L] = FmmComplexAdd(Multipole[L], Term);
+        }
+    }
+}
+
+inline void FmmDownward(fmm_tree* Tree, u32 NodeId, f32 RepulsionSoftner)
+{
+    fmm_box Box = Tree->Boxes[NodeId];
+    v2 Center = FmmBoxCenter(Box);
+    fmm_complex* Local = Tree->Locals + NodeId * FMM_ORDER;
+    for (u32 TermId = 0; TermId < FMM_ORDER; ++TermId)
+    {
+        Local[TermId] = FmmComplex(0.0f, 0.0f);
+    }
+
+    if (NodeId != 0)
+    {
+        u32 ParentId = Tree->Parents[NodeId];
+        fmm_box ParentBox = Tree->Boxes[ParentId];
+
+        // NOTE: L2L, b'_l = sum_{k >= l} b_k * C(k, l) * w^(k - l)
+        {
+            fmm_complex* ParentLocal = Tree->Locals + ParentId * FMM_ORDER;
+            v2 ParentCenter = FmmBoxCenter(ParentBox);
+            fmm_complex W = FmmComplex(Center.x - ParentCenter.x, Center.y - ParentCenter.y);
+            fmm_complex WPow[FMM_ORDER];
+            WPow[0] = FmmComplex(1.0f, 0.0f);
+            for (u32 PowerId = 1; PowerId < FMM_ORDER; ++PowerId)
+            {
+                WPow[PowerId] = FmmComplexMul(WPow[PowerId - 1], W);
+            }
+
+            for (u32 L = 1; L <= FMM_ORDER; ++L)
+            {
+                for (u32 K = L; K <= FMM_ORDER; ++K)
+                {
+                    Local[L - 1] = FmmComplexAdd(Local[L - 1], FmmComplexScale(FmmBinomial(K, L), FmmComplexMul(ParentLocal[K - 1], WPow[K - L])));
+                }
+            }
+        }
+
+        // NOTE: M2L from our interaction list
+        for (fmm_list_entry* Entry = Tree->ExpandHeads[NodeId]; Entry; Entry = Entry->Next)
+        {
+            fmm_complex Multipole[FMM_ORDER + 1];
+            v2 SourceCenter = FmmLoadMultipole(Tree, Entry->SourceId, Multipole);
+
+            fmm_complex InvZ0 = FmmComplexInverse(FmmComplex(SourceCenter.x - Center.x, SourceCenter.y - Center.y));
+            fmm_complex InvZ0Pow[FMM_ORDER + 1];
+            InvZ0Pow[0] = FmmComplex(1.0f, 0.0f);
+            for (u32 PowerId = 1; PowerId <= FMM_ORDER; ++PowerId)
+            {
+                InvZ0Pow[PowerId] = FmmComplexMul(InvZ0Pow[PowerId - 1], InvZ0);
+            }
+
+            for (u32 L = 1; L <= FMM_ORDER; ++L)
+            {
+                fmm_complex Sum = FmmComplex(-Multipole[0].Re / f32(L), 0.0f);
+                for (u32 K = 1; K <= FMM_ORDER; ++K)
+                {
+                    f32 Sign = (K & 1) ? -1.0f : 1.0f;
+                    Sum = FmmComplexAdd(Sum, FmmComplexScale(Sign * FmmBinomial(L + K - 1, K - 1), FmmComplexMul(Multipole[K], InvZ0Pow[K])));
+                }
+                Local[L - 1] = FmmComplexAdd(Local[L - 1], FmmComplexMul(InvZ0Pow[L], Sum));
+            }
+        }
+    }
+
+    for (u32 ChildId = 0; ChildId < 2; ++ChildId)
+    {
+        u32 ChildNodeId = Tree->Children[2 * NodeId + ChildId];
+        if (!(ChildNodeId & FMM_LEAF_BIT))
+        {
+            FmmDownward(Tree, ChildNodeId, RepulsionSoftner);
+        }
+    }
+}
+
+inline v2 FmmEvaluate(fmm_tree* Tree, u32 LeafId, f32 RepulsionMultiplier, f32 RepulsionSoftner)
+{
+    u32 GraphNodeId = Tree->ElementReMapping[LeafId];
+    v2 GraphNodePos = Tree->NodePos[GraphNodeId];
+    f32 GraphNodeDegree = Tree->NodeDegree[GraphNodeId];
+
+    u32 ParentId = Tree->Parents[LeafId + Tree->NumLeaves - 1];
+    fmm_box ParentBox = Tree->Boxes[ParentId];
+    v2 Force = V2(0.0f, 0.0f);
+
+    // NOTE: L2P
+    fmm_complex Field = FmmComplex(0.0f, 0.0f);
+    {
+        v2 ParentCenter = FmmBoxCenter(ParentBox);
+        fmm_complex Z = FmmComplex(GraphNodePos.x - ParentCenter.x, GraphNodePos.y - ParentCenter.y);
+        fmm_complex ZPow = FmmComplex(1.0f, 0.0f);
+        for (u32 L = 1; L <= FMM_ORDER; ++L)
+        {
+            Field = FmmComplexAdd(Field, FmmComplexScale(f32(L), FmmComplexMul(Tree->Locals[ParentId * FMM_ORDER + L - 1], ZPow)));
+            ZPow = FmmComplexMul(ZPow, Z);
+        }
+    }
+
+    // NOTE: P2P
+    for (fmm_list_entry* Entry = Tree->NearHeads[LeafId]; Entry; Entry = Entry->Next)
+    {
+        u32 OtherGraphNodeId = Tree->ElementReMapping[Entry->SourceId & ~FMM_LEAF_BIT];
+        if (OtherGraphNodeId != GraphNodeId)
+        {
+            v2 OtherNodePos = Tree->NodePos[OtherGraphNodeId];
+            f32 DistanceX = GraphNodePos.x - OtherNodePos.x;
+            f32 DistanceY = GraphNodePos.y - OtherNodePos.y;
+            f32 DistanceSq = DistanceX * DistanceX + DistanceY * DistanceY + RepulsionSoftner;
+            f32 Multiplier = RepulsionMultiplier * GraphNodeDegree * Tree->NodeDegree[OtherGraphNodeId] / DistanceSq;
+            Force = V2(Force.x + Multiplier * DistanceX, Force.y + Multiplier * DistanceY);
+        }
+    }
+
+    // NOTE: M2P
+    for (fmm_list_entry* Entry = Tree->ExpandHeads[LeafId + Tree->NumLeaves - 1]; Entry; Entry = Entry->Next)
+    {
+        fmm_complex Multipole[FMM_ORDER + 1];
+        v2 SourceCenter = FmmLoadMultipole(Tree, Entry->SourceId, Multipole);
+
+        fmm_complex InvZ = FmmComplexInverse(FmmComplex(GraphNodePos.x - SourceCenter.x, GraphNodePos.y - SourceCenter.y));
+        fmm_complex InvZPow = InvZ;
+        Field = FmmComplexAdd(Field, FmmComplexScale(Multipole[0].Re, InvZ));
+        for (u32 K = 1; K <= FMM_ORDER; ++K)
+        {
+            InvZPow = FmmComplexMul(InvZPow, InvZ);
+            Field = FmmComplexAdd(Field, FmmComplexScale(-f32(K), FmmComplexMul(Multipole[K], InvZPow)));
+        }
+    }
+
+    // NOTE: The force is k * d_i * conj(field)
+    f32 FieldScale = RepulsionMultiplier * GraphNodeDegree;
+    Force = V2(Force.x + FieldScale * Field.Re, Force.y - FieldScale * Field.Im);
+    return Force;
+}
+
+//
+// NOTE: Reference Entry Points
+//
+
+inline void FmmReferenceForces(linear_arena* Arena, u32 NumNodes, v2* NodePos, f32* NodeDegree, f32 RepulsionMultiplier,
+                               f32 RepulsionSoftner, v2* OutForces)
+{
+    Assert(NumNodes > 1);
+
+    fmm_tree Tree = {};
+    Tree.NumLeaves = NumNodes;
+    Tree.NodePos = NodePos;
+    Tree.NodeDegree = NodeDegree;
+    Tree.ElementReMapping = PushArray(Arena, u32, NumNodes);
+    Tree.SortedKeys = PushArray(Arena, u64, NumNodes);
+    Tree.Children = PushArray(Arena, u32, 2 * (NumNodes - 1));
+    Tree.Parents = PushArray(Arena, u32, 2 * NumNodes - 1);
+    Tree.Boxes = PushArray(Arena, fmm_box, NumNodes - 1);
+    Tree.Multipoles = PushArray(Arena, fmm_complex, (FMM_ORDER + 1) * (NumNodes - 1));
+    Tree.Locals = PushArray(Arena, fmm_complex, FMM_ORDER * (NumNodes - 1));
+    Tree.Arena = Arena;
+    Tree.ExpandHeads = PushArray(Arena, fmm_list_entry*, 2 * NumNodes - 1);
+    Tree.NearHeads = PushArray(Arena, fmm_list_entry*, NumNodes);
+
+    // NOTE: Sort the nodes by Morton key with the node index as a tie breaker, like the GPU's stable gpu_sort64
+    {
+        fmm_box Bounds = {};
+        Bounds.Min = NodePos[0];
+        Bounds.Max = NodePos[0];
+        for (u32 NodeId = 1; NodeId < NumNodes; ++NodeId)
+        {
+            Bounds.Min = V2(Min(Bounds.Min.x, NodePos[NodeId].x), Min(Bounds.Min.y, NodePos[NodeId].y));
+            Bounds.Max = V2(Max(Bounds.Max.x, NodePos[NodeId].x), Max(Bounds.Max.y, NodePos[NodeId].y));
+        }
+
+        for (u32 NodeId = 0; NodeId < NumNodes; ++NodeId)
+        {
+            Tree.SortedKeys[NodeId] = FmmMortonKey(NodePos[NodeId], Bounds);
+        }
+        CpuSortIdentityPayload(NumNodes, Tree.ElementReMapping);
+
+        // NOTE: The radix sort is stable, so equal keys stay in node index order
+        u64* ScratchKeys = PushArray(Arena, u64, NumNodes);
+        u32* ScratchReMapping = PushArray(Arena, u32, NumNodes);
+        CpuRadixSort64(NumNodes, Tree.SortedKeys, Tree.ElementReMapping, ScratchKeys, ScratchReMapping);
+    }
+
+    FmmTreeBuild(&Tree);
+    FmmUpward(&Tree, 0);
+    for (u32 HeadId = 0; HeadId < 2 * NumNodes - 1; ++HeadId)
+    {
+        Tree.ExpandHeads[HeadId] = 0;
+    }
+    for (u32 LeafId = 0; LeafId < NumNodes; ++LeafId)
+    {
+        Tree.NearHeads[LeafId] = 0;
+    }
+    FmmWalk(&Tree, 0, 0, RepulsionSoftner);
+    FmmDownward(&Tree, 0, RepulsionSoftner);
+    for (u32 LeafId = 0; LeafId < NumNodes; ++LeafId)
+    {
+        OutForces[Tree.ElementReMapping[LeafId]] = FmmEvaluate(&Tree, LeafId, RepulsionMultiplier, RepulsionSoftner);
+    }
+}
+
+inline f32 FmmRandFloat()
+{
+    f32 Result = f32(rand()) / f32(RAND_MAX);
+    return Result;
+}
+
+inline v2 FmmDirectForce(u32 NumNodes, v2* NodePos, f32* NodeDegree, f32 RepulsionMultiplier, f32 RepulsionSoftner, u32 CurrNodeId)
+{
+    v2 Result = V2(0.0f, 0.0f);
+    for (u32 OtherNodeId = 0; OtherNodeId < NumNodes; ++OtherNodeId)
+    {
+        if (OtherNodeId != CurrNodeId)
+        {
+            f32 DistanceX = NodePos[CurrNodeId].x - NodePos[OtherNodeId].x;
+            f32 DistanceY = NodePos[CurrNodeId].y - NodePos[OtherNodeId].y;
+            f32 DistanceSq = DistanceX * DistanceX + DistanceY * DistanceY + RepulsionSoftner;
+            f32 Multiplier = RepulsionMultiplier * NodeDegree[CurrNodeId] * NodeDegree[OtherNodeId] / DistanceSq;
+            Result = V2(Result.x + Multiplier * DistanceX, Result.y + Multiplier * DistanceY);
+        }
+    }
+    return Result;
+}
+
+inline void FmmDirectForces(u32 NumNodes, v2* NodePos, f32* NodeDegree, f32 RepulsionMultiplier, f32 RepulsionSoftner, v2* OutForces)
+{
+    for (u32 CurrNodeId = 0; CurrNodeId < NumNodes; ++CurrNodeId)
+    {
+        OutForces[CurrNodeId] = FmmDirectForce(NumNodes, NodePos, NodeDegree, RepulsionMultiplier, RepulsionSoftner, CurrNodeId);
+    }
+}
+
+inline f32 FmmReferenceTest(linear_arena* Arena, u32 NumNodes)
+{
+    temp_mem TempMem = BeginTempMem(Arena);
+
+    // NOTE: A few dense clusters so that we get deep trees, near fields and far fields
+    v2* NodePos = PushArray(Arena, v2, NumNodes);
+    f32* NodeDegree = PushArray(Arena, f32, NumNodes);
+    {
+        u32 NumClusters = 8;
+        v2 ClusterCenters[8];
+        for (u32 ClusterId = 0; ClusterId < NumClusters; ++ClusterId)
+        {
+            ClusterCenters[ClusterId] = V2(200.0f * FmmRandFloat() - 100.0f, 200.0f * FmmRandFloat() - 100.0f);
+        }
+
+        for (u32 NodeId = 0; NodeId < NumNodes; ++NodeId)
+        {
+            v2 ClusterCenter = ClusterCenters[NodeId % NumClusters];
+            f32 Radius = (NodeId % 3) == 0 ? 40.0f : 4.0f;
+            NodePos[NodeId] = V2(ClusterCenter.x + Radius * (2.0f * FmmRandFloat() - 1.0f), ClusterCenter.y + Radius * (2.0f * FmmRandFloat() - 1.0f));
+            NodeDegree[NodeId] = f32(1 + (rand() % 8));
+        }
+    }
+
+    v2* FmmForces = PushArray(Arena, v2, NumNodes);
+    v2* DirectForces = PushArray(Arena, v2, NumNodes);
+    f32 RepulsionSoftner = 0.05f * 0.05f;
+    FmmReferenceForces(Arena, NumNodes, NodePos, NodeDegree, 1.0f, RepulsionSoftner, FmmForces);
+    FmmDirectForces(NumNodes, NodePos, NodeDegree, 1.0f, RepulsionSoftner, DirectForces);
+
+    f32 ErrorSq = 0.0f;
+    f32 ForceSq = 0.0f;
+    f32 MaxRelativeError = 0.0f;
+    for (u32 NodeId = 0; NodeId < NumNodes; ++NodeId)
+    {
+        f32 ErrorX = FmmForces[NodeId].x - DirectForces[NodeId].x;
+        f32 ErrorY = FmmForces[NodeId].y - DirectForces[NodeId].y;
+        f32 NodeErrorSq = ErrorX * ErrorX + ErrorY * ErrorY;
+        f32 NodeForceSq = DirectForces[NodeId].x * DirectForces[NodeId].x + DirectForces[NodeId].y * DirectForces[NodeId].y;
+        ErrorSq += NodeErrorSq;
+        ForceSq += NodeForceSq;
+        if (NodeForceSq > 0.0f)
+        {
+            MaxRelativeError = Max(MaxRelativeError, sqrtf(NodeErrorSq / NodeForceSq));
+        }
+    }
+
+    f32 Result = sqrtf(ErrorSq / ForceSq);
+    DebugPrintLog("FMM Reference (%u nodes, order %u): RMS relative error %e, max relative error %e\n", NumNodes, FMM_ORDER, Result,
+                  MaxRelativeError);
+    Assert(Result < FMM_REFERENCE_MAX_ERROR);
+
+    EndTempMem(TempMem);
+    return Result;
+}
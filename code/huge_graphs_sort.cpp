@@ -0,0 +1,951 @@
+
+//
+// NOTE: Gpu Sort
+//
+
+#define FFX_CPP
+#include "FFX_ParallelSort.h"
+
+inline b32 GpuSortBackendIsStable(u32 Backend)
+{
+    b32 Result = (Backend == GpuSortBackend_Ffx || Backend == GpuSortBackend_Onesweep || Backend == GpuSortBackend_Cpu);
+    return Result;
+}
+
+inline u32 GpuSortPickBackend(u32 Backend, u32 NumKeys, u32 Flags)
+{
+    u32 Result = Backend;
+    if (Result == GpuSortBackend_Auto)
+    {
+        // NOTE: One bitonic group sorts small arrays in a single dispatch, everything else goes through onesweep. We never auto pick
+        // the atomic bitonic sort since it only beats the multi dispatch sorts where launches dominate, or the CPU sort since it stalls
+        // the frame
+        if (!(Flags & GpuSortFlag_Stable) && NumKeys <= GPU_SORT_BITONIC_GROUP_SIZE)
+        {
+            Result = GpuSortBackend_Bitonic;
+        }
+        else
+        {
+            Result = GpuSortBackend_Onesweep;
+        }
+    }
+
+    // NOTE: The atomic bitonic sort only handles powers of 2 that fill whole groups
+    if (Result == GpuSortBackend_AtomicBitonic && (NumKeys < GPU_SORT_BITONIC_GROUP_SIZE || (NumKeys & (NumKeys - 1)) != 0))
+    {
+        Result = GpuSortBackend_Bitonic;
+    }
+
+    return Result;
+}
+
+inline void GpuSortBarrier(vk_commands* Commands, VkBuffer Buffer)
+{
+    VkBarrierBufferAdd(Commands, Buffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+inline void GpuSortKeysBarrier(vk_commands* Commands, gpu_sort* Sort)
+{
+    GpuSortBarrier(Commands, Sort->KeyBuffer);
+    GpuSortBarrier(Commands, Sort->PayloadBuffer);
+    GpuSortBarrier(Commands, Sort->ScratchKeyBuffer);
+    GpuSortBarrier(Commands, Sort->ScratchPayloadBuffer);
+    VkCommandsBarrierFlush(Commands);
+}
+
+//
+// NOTE: Bitonic Sort
+//
+
+inline void GpuSortBitonicDispatch(vk_commands* Commands, gpu_sort* Sort, vk_pipeline* Pipeline, bitonic_sort_constants Constants)
+{
+    u32 NumGroups = u32((u64(Constants.NumThreads) + 1023) / 1024);
+    u32 DispatchX = NumGroups;
+    u32 DispatchY = 1;
+    if (DispatchX > GPU_SORT_MAX_THREAD_GROUPS)
+    {
+        DispatchX = 64;
+        DispatchY = DispatchSize(NumGroups, DispatchX);
+    }
+
+    vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+    VkComputeDispatch(Commands, Pipeline, &Sort->BitonicDescriptor, 1, DispatchX, DispatchY, 1);
+
+    GpuSortBarrier(Commands, Sort->KeyBuffer);
+    GpuSortBarrier(Commands, Sort->PayloadBuffer);
+    VkCommandsBarrierFlush(Commands);
+}
+
+inline u32 GpuSortBitonicNumGlobalThreads(u32 NumKeys, u64 HalfSize)
+{
+    // NOTE: A global pass with blocks of 2*HalfSize keys pairs every lower half index with one in the upper half. Only pairs whose
+    // lower index is a real key can swap, so we count those and skip the rest of the virtual padding
+    u64 NumFullBlocks = u64(NumKeys) / (2*HalfSize);
+    u64 NumRemainingKeys = u64(NumKeys) % (2*HalfSize);
+    u32 Result = u32(NumFullBlocks*HalfSize + (NumRemainingKeys < HalfSize ? NumRemainingKeys : HalfSize));
+    return Result;
+}
+
+inline void GpuSortBitonic(vk_commands* Commands, gpu_sort* Sort, u32 NumKeys)
+{
+    /*
+      NOTE: The key count is virtually padded to a power of 2, the shaders treat slots past NumKeys as max keys. Local passes only run
+            the groups holding real keys and global passes only run the pairs that start on a real key, so sorting 2^20 + 1 keys
+            costs about as much as 2^20 instead of 2^21. The pass math is done in 64 bits so it holds up to 2^32 keys.
+     */
+    u32 NumLocalThreads = u32((u64(NumKeys) + GPU_SORT_BITONIC_GROUP_SIZE - 1) / GPU_SORT_BITONIC_GROUP_SIZE) * 1024;
+
+    bitonic_sort_constants Constants = {};
+    Constants.ArraySize = NumKeys;
+    Constants.NumThreads = NumLocalThreads;
+    GpuSortBitonicDispatch(Commands, Sort, Sort->BitonicLocalFdPipeline, Constants);
+
+    for (u64 FlipSize = 2048, PassId = 11; FlipSize < NumKeys; PassId += 1, FlipSize *= 2)
+    {
+        Constants.FlipSize = u32(FlipSize);
+        Constants.PassId = u32(PassId);
+        Constants.N = 0;
+        Constants.NumThreads = GpuSortBitonicNumGlobalThreads(NumKeys, FlipSize);
+        GpuSortBitonicDispatch(Commands, Sort, Sort->BitonicGlobalFlipPipeline, Constants);
+
+        for (u64 N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
+        {
+            if (N <= 1024)
+            {
+                // NOTE: The local disperse does every N from 1024 down in shared memory
+                Constants.NumThreads = NumLocalThreads;
+                GpuSortBitonicDispatch(Commands, Sort, Sort->BitonicLocalDispersePipeline, Constants);
+                break;
+            }
+            else
+            {
+                Constants.FlipSize = 0;
+                Constants.PassId = u32(NPassId);
+                Constants.N = u32(N);
+                Constants.NumThreads = GpuSortBitonicNumGlobalThreads(NumKeys, N);
+                GpuSortBitonicDispatch(Commands, Sort, Sort->BitonicGlobalDispersePipeline, Constants);
+            }
+        }
+    }
+}
+
+inline u32 GpuSortAtomicNumLaunchedGroups(u32 NumKeys)
+{
+    u32 NumItemsPerPass = NumKeys / GPU_SORT_BITONIC_GROUP_SIZE;
+    u32 Result = NumItemsPerPass < ATOMIC_SORT_MAX_LAUNCH_GROUPS ? NumItemsPerPass : ATOMIC_SORT_MAX_LAUNCH_GROUPS;
+    return Result;
+}
+
+inline void GpuSortAtomicBitonic(vk_commands* Commands, gpu_sort* Sort, u32 NumKeys)
+{
+    // NOTE: The pass list only changes with the key count, so we only re upload it when the count changes
+    if (Sort->AtomicNumKeys != NumKeys)
+    {
+        atomic_sort_pass_params Passes[ATOMIC_SORT_MAX_PASSES] = {};
+        u32 NumPasses = 0;
+        Passes[NumPasses++] = { AtomicSortPassType_LocalFd, 0, 0, 0 };
+        for (u32 FlipSize = 2048, PassId = 11; FlipSize < NumKeys; PassId += 1, FlipSize *= 2)
+        {
+            Passes[NumPasses++] = { AtomicSortPassType_GlobalFlip, FlipSize, PassId, 0 };
+            for (u32 N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
+            {
+                if (N <= 1024)
+                {
+                    Passes[NumPasses++] = { AtomicSortPassType_LocalDisperse, 0, NPassId, N };
+                    break;
+                }
+                else
+                {
+                    Passes[NumPasses++] = { AtomicSortPassType_GlobalDisperse, 0, NPassId, N };
+                }
+            }
+        }
+        Assert(NumPasses <= ATOMIC_SORT_MAX_PASSES);
+
+        atomic_sort_uniform_data Uniforms = {};
+        Uniforms.ArraySize = NumKeys;
+        Uniforms.NumPasses = NumPasses;
+        Uniforms.NumLaunchedGroups = GpuSortAtomicNumLaunchedGroups(NumKeys);
+
+        VkBarrierBufferAdd(Commands, Sort->AtomicUniformBuffer,
+                           VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkBarrierBufferAdd(Commands, Sort->AtomicPassBuffer,
+                           VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        vkCmdUpdateBuffer(Commands->Buffer, Sort->AtomicUniformBuffer, 0, sizeof(Uniforms), &Uniforms);
+        vkCmdUpdateBuffer(Commands->Buffer, Sort->AtomicPassBuffer, 0, sizeof(atomic_sort_pass_params) * NumPasses, Passes);
+
+        VkBarrierBufferAdd(Commands, Sort->AtomicUniformBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkBarrierBufferAdd(Commands, Sort->AtomicPassBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        Sort->AtomicNumKeys = NumKeys;
+        Sort->AtomicNumPasses = NumPasses;
+    }
+
+    VkBarrierBufferAdd(Commands, Sort->AtomicCounterBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    vkCmdFillBuffer(Commands->Buffer, Sort->AtomicCounterBuffer, 0, sizeof(atomic_sort_buffer_data), 0);
+    VkBarrierBufferAdd(Commands, Sort->AtomicCounterBuffer,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    // NOTE: The groups that join loop over every pass, so we only launch up to one pass worth of groups
+    VkComputeDispatch(Commands, Sort->AtomicPipeline, &Sort->AtomicDescriptor, 1, GpuSortAtomicNumLaunchedGroups(NumKeys), 1, 1);
+
+    GpuSortBarrier(Commands, Sort->KeyBuffer);
+    GpuSortBarrier(Commands, Sort->PayloadBuffer);
+    VkCommandsBarrierFlush(Commands);
+}
+
+//
+// NOTE: Parallel Sort
+//
+
+inline void GpuSortParallel(vk_commands* Commands, gpu_sort* Sort, u32 NumKeys)
+{
+    // NOTE: FFX bakes the key count into its constant buffer, so we only re upload it when the count changes
+    if (Sort->ParallelSortNumKeys != NumKeys)
+    {
+        FFX_ParallelSortCB Constants = {};
+        FFX_ParallelSort_SetConstantAndDispatchData(NumKeys, PARALLEL_SORT_MAX_THREAD_GROUPS, Constants, Sort->ParallelSortNumThreadGroups,
+                                                    Sort->ParallelSortNumReducedThreadGroups);
+
+        VkBarrierBufferAdd(Commands, Sort->ParallelSortUniformBuffer,
+                           VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        vkCmdUpdateBuffer(Commands->Buffer, Sort->ParallelSortUniformBuffer, 0, sizeof(Constants), &Constants);
+
+        VkBarrierBufferAdd(Commands, Sort->ParallelSortUniformBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        Sort->ParallelSortNumKeys = NumKeys;
+    }
+
+    // NOTE: We always do an even number of passes so the sorted results end up back in the bound buffers
+    u32 DispatchX = Sort->ParallelSortNumThreadGroups;
+    u32 DispatchY = 1;
+
+    if (DispatchX > GPU_SORT_MAX_THREAD_GROUPS)
+    {
+        DispatchX = 64;
+        DispatchY = DispatchSize(Sort->ParallelSortNumThreadGroups, DispatchX);
+    }
+
+    u32 ReducedDispatchX = Sort->ParallelSortNumReducedThreadGroups;
+    u32 ReducedDispatchY = 1;
+
+    if (ReducedDispatchX > GPU_SORT_MAX_THREAD_GROUPS)
+    {
+        ReducedDispatchX = 64;
+        ReducedDispatchY = DispatchSize(Sort->ParallelSortNumReducedThreadGroups, ReducedDispatchX);
+    }
+
+    b32 InputSet = 0;
+    for (u32 Shift = 0; Shift < 32u; Shift += FFX_PARALLELSORT_SORT_BITS_PER_PASS)
+    {
+        VkDescriptorSet SharedDescriptorSets0[] =
+        {
+            Sort->ParallelSortConstantDescriptor,
+            Sort->InputOutputDescriptor[InputSet],
+            Sort->ParallelSortScanDescriptor[0],
+            Sort->ParallelSortScratchDescriptor,
+        };
+
+        VkDescriptorSet SharedDescriptorSets1[] =
+        {
+            Sort->ParallelSortConstantDescriptor,
+            Sort->InputOutputDescriptor[InputSet],
+            Sort->ParallelSortScanDescriptor[1],
+            Sort->ParallelSortScratchDescriptor,
+        };
+
+        // NOTE: Sort Count
+        {
+            vk_pipeline* Pipeline = Sort->ParallelSortCountPipeline;
+            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 4, &Shift);
+            VkComputeDispatch(Commands, Pipeline, SharedDescriptorSets0, ArrayCount(SharedDescriptorSets0),
+                              DispatchX, DispatchY, 1);
+        }
+
+        GpuSortBarrier(Commands, Sort->ParallelSortScratchBuffer);
+        VkCommandsBarrierFlush(Commands);
+
+        // NOTE: Sort Reduce
+        {
+            vk_pipeline* Pipeline = Sort->ParallelSortReducePipeline;
+            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 4, &Shift);
+            VkComputeDispatch(Commands, Pipeline, SharedDescriptorSets0, ArrayCount(SharedDescriptorSets0),
+                              ReducedDispatchX, ReducedDispatchY, 1);
+        }
+
+        GpuSortBarrier(Commands, Sort->ParallelSortReducedScratchBuffer);
+        VkCommandsBarrierFlush(Commands);
+
+        // NOTE: Sort Scan
+        {
+            // NOTE: Scan prefix of reduced values
+            {
+                vk_pipeline* Pipeline = Sort->ParallelSortScanPipeline;
+                vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 4, &Shift);
+                // NOTE: Need to account for bigger reduced histogram scan
+                Assert(Sort->ParallelSortNumReducedThreadGroups < FFX_PARALLELSORT_ELEMENTS_PER_THREAD * FFX_PARALLELSORT_THREADGROUP_SIZE);
+                VkComputeDispatch(Commands, Pipeline, SharedDescriptorSets0, ArrayCount(SharedDescriptorSets0), 1, 1, 1);
+            }
+
+            GpuSortBarrier(Commands, Sort->ParallelSortReducedScratchBuffer);
+            VkCommandsBarrierFlush(Commands);
+
+            // NOTE: Scan prefix on the histogram with partial sums that we just now calculated
+            {
+                vk_pipeline* Pipeline = Sort->ParallelSortScanAddPipeline;
+                vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 4, &Shift);
+                VkComputeDispatch(Commands, Pipeline, SharedDescriptorSets1, ArrayCount(SharedDescriptorSets1),
+                                  ReducedDispatchX, ReducedDispatchY, 1);
+            }
+        }
+
+        GpuSortBarrier(Commands, Sort->ParallelSortScratchBuffer);
+        VkCommandsBarrierFlush(Commands);
+
+        // NOTE: Sort Scatter
+        {
+            vk_pipeline* Pipeline = Sort->ParallelSortScatterPipeline;
+            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 4, &Shift);
+            VkComputeDispatch(Commands, Pipeline, SharedDescriptorSets1, ArrayCount(SharedDescriptorSets1),
+                              DispatchX, DispatchY, 1);
+        }
+
+        GpuSortKeysBarrier(Commands, Sort);
+        InputSet = !InputSet;
+    }
+}
+
+//
+// NOTE: Onesweep Sort
+//
+
+inline void GpuSortOnesweep(vk_commands* Commands, gpu_sort* Sort, u32 NumKeys)
+{
+    // NOTE: Same contract as the FFX sort but with 8 bit digits. One histogram pass counts the digits of all 4 passes, one scan
+    // turns them into global offsets, and then every pass is a single dispatch that chains tile offsets with decoupled look back.
+    // The scan also zeroes the indirect dispatch of every pass whose digit is constant across all keys, so narrow key ranges skip
+    // passes without a readback. The sorted results always end up back in the bound buffers
+    VkDescriptorSet DescriptorSets[] =
+        {
+            Sort->OnesweepDescriptor,
+            Sort->InputOutputDescriptor[0],
+        };
+
+    u32 NumTiles = DispatchSize(NumKeys, ONESWEEP_TILE_SIZE);
+    u32 DispatchX = NumTiles;
+    u32 DispatchY = 1;
+    if (DispatchX > GPU_SORT_MAX_THREAD_GROUPS)
+    {
+        DispatchX = 64;
+        DispatchY = DispatchSize(NumTiles, DispatchX);
+    }
+
+    onesweep_constants Constants = {};
+    Constants.NumKeys = NumKeys;
+    Constants.NumTiles = NumTiles;
+    Constants.DispatchX = DispatchX;
+    Constants.DispatchY = DispatchY;
+
+    // NOTE: Clear the histograms and tile counters, the previous sort may still be reading them
+    {
+        VkBarrierBufferAdd(Commands, Sort->OnesweepGlobalHistogramBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkBarrierBufferAdd(Commands, Sort->OnesweepPassHistogramBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkBarrierBufferAdd(Commands, Sort->OnesweepTileCounterBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkBarrierBufferAdd(Commands, Sort->OnesweepPassArgsBuffer,
+                           VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        vkCmdFillBuffer(Commands->Buffer, Sort->OnesweepGlobalHistogramBuffer, 0, VK_WHOLE_SIZE, 0);
+        vkCmdFillBuffer(Commands->Buffer, Sort->OnesweepPassHistogramBuffer, 0, VK_WHOLE_SIZE, 0);
+        vkCmdFillBuffer(Commands->Buffer, Sort->OnesweepTileCounterBuffer, 0, VK_WHOLE_SIZE, 0);
+
+        VkBarrierBufferAdd(Commands, Sort->OnesweepGlobalHistogramBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkBarrierBufferAdd(Commands, Sort->OnesweepPassHistogramBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkBarrierBufferAdd(Commands, Sort->OnesweepTileCounterBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+    }
+
+    // NOTE: Global Histogram
+    {
+        vk_pipeline* Pipeline = Sort->OnesweepGlobalHistogramPipeline;
+        vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+        VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, DispatchY, 1);
+
+        GpuSortBarrier(Commands, Sort->OnesweepGlobalHistogramBuffer);
+        VkCommandsBarrierFlush(Commands);
+    }
+
+    // NOTE: Global Scan
+    {
+        vk_pipeline* Pipeline = Sort->OnesweepGlobalScanPipeline;
+        vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+        VkComputeDispatch(Commands, Pipeline, DescriptorSets, ArrayCount(DescriptorSets), 1, 1, 1);
+
+        GpuSortBarrier(Commands, Sort->OnesweepPassHistogramBuffer);
+        VkBarrierBufferAdd(Commands, Sort->OnesweepPassArgsBuffer,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+    }
+
+    // NOTE: Digit Passes, the scan picked which key buffer every pass reads from so we barrier both sides after each one
+    {
+        vk_pipeline* Pipeline = Sort->OnesweepDigitPassPipeline;
+        vkCmdBindPipeline(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Handle);
+        vkCmdBindDescriptorSets(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Layout, 0, ArrayCount(DescriptorSets), DescriptorSets, 0, 0);
+        for (u32 PassId = 0; PassId < ONESWEEP_NUM_PASSES; ++PassId)
+        {
+            Constants.Shift = PassId * ONESWEEP_RADIX_BITS;
+            vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+            vkCmdDispatchIndirect(Commands->Buffer, Sort->OnesweepPassArgsBuffer, sizeof(u32) * ONESWEEP_PASS_ARGS_STRIDE * PassId);
+            GpuSortKeysBarrier(Commands, Sort);
+        }
+    }
+
+    // NOTE: Copy the keys back to the bound buffers, only gets groups if an odd number of passes ran
+    {
+        vk_pipeline* Pipeline = Sort->OnesweepCopyPipeline;
+        vkCmdBindPipeline(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Handle);
+        vkCmdBindDescriptorSets(Commands->Buffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Layout, 0, ArrayCount(DescriptorSets), DescriptorSets, 0, 0);
+        vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+        vkCmdDispatchIndirect(Commands->Buffer, Sort->OnesweepPassArgsBuffer, sizeof(u32) * ONESWEEP_PASS_ARGS_STRIDE * ONESWEEP_NUM_PASSES);
+        GpuSortKeysBarrier(Commands, Sort);
+    }
+}
+
+//
+// NOTE: Cpu Sort
+//
+
+inline void GpuSortCpu(vk_commands* Commands, gpu_sort* Sort, u32 NumKeys)
+{
+    // NOTE: Reference backend. We have to submit and wait mid frame to read the keys back, so this is only for testing the others
+    VkBufferCopy BufferCopy = {};
+    BufferCopy.size = sizeof(u32) * NumKeys;
+
+    VkBarrierBufferAdd(Commands, Sort->KeyBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    VkBarrierBufferAdd(Commands, Sort->PayloadBuffer,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    vkCmdCopyBuffer(Commands->Buffer, Sort->KeyBuffer, Sort->CpuKeyBuffer, 1, &BufferCopy);
+    vkCmdCopyBuffer(Commands->Buffer, Sort->PayloadBuffer, Sort->CpuPayloadBuffer, 1, &BufferCopy);
+
+    VkBarrierBufferAdd(Commands, Sort->CpuKeyBuffer,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+    VkBarrierBufferAdd(Commands, Sort->CpuPayloadBuffer,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+    VkCommandsBarrierFlush(Commands);
+
+    VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
+    VkCommandsSubmit(Commands, RenderState->Device, RenderState->GraphicsQueue);
+    VkCheckResult(vkQueueWaitIdle(RenderState->GraphicsQueue));
+
+    CpuRadixSort(NumKeys, Sort->CpuKeys, Sort->CpuPayload, Sort->CpuScratchKeys, Sort->CpuScratchPayload);
+
+    VkCommandsBegin(Commands, RenderState->Device);
+
+    vkCmdCopyBuffer(Commands->Buffer, Sort->CpuKeyBuffer, Sort->KeyBuffer, 1, &BufferCopy);
+    vkCmdCopyBuffer(Commands->Buffer, Sort->CpuPayloadBuffer, Sort->PayloadBuffer, 1, &BufferCopy);
+
+    VkBarrierBufferAdd(Commands, Sort->KeyBuffer,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkBarrierBufferAdd(Commands, Sort->PayloadBuffer,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkCommandsBarrierFlush(Commands);
+}
+
+//
+// NOTE: Gpu Sort Api
+//
+
+inline void GpuSortKeys(vk_commands* Commands, gpu_sort* Sort, u32 NumKeys, u32 Backend, u32 Flags = 0)
+{
+    Assert(NumKeys <= Sort->MaxNumKeys);
+    if (NumKeys <= 1)
+    {
+        return;
+    }
+
+    Backend = GpuSortPickBackend(Backend, NumKeys, Flags);
+    Assert(!(Flags & GpuSortFlag_Stable) || GpuSortBackendIsStable(Backend));
+
+    switch (Backend)
+    {
+        case GpuSortBackend_Bitonic:
+        {
+            GpuSortBitonic(Commands, Sort, NumKeys);
+        } break;
+
+        case GpuSortBackend_AtomicBitonic:
+        {
+            GpuSortAtomicBitonic(Commands, Sort, NumKeys);
+        } break;
+
+        case GpuSortBackend_Ffx:
+        {
+            GpuSortParallel(Commands, Sort, NumKeys);
+        } break;
+
+        case GpuSortBackend_Onesweep:
+        {
+            Assert(Sort->MaxNumKeys <= ONESWEEP_MAX_NUM_KEYS);
+            GpuSortOnesweep(Commands, Sort, NumKeys);
+        } break;
+
+        case GpuSortBackend_Cpu:
+        {
+            GpuSortCpu(Commands, Sort, NumKeys);
+        } break;
+
+        default:
+        {
+            InvalidCodePath;
+        } break;
+    }
+}
+
+inline gpu_sort GpuSortCreate(linear_arena* Arena, linear_arena* TempArena, vk_commands* Commands, VkBuffer KeyBuffer, VkBuffer PayloadBuffer,
+                              u32 MaxNumKeys)
+{
+    gpu_sort Result = {};
+    Result.MaxNumKeys = MaxNumKeys;
+    Result.KeyBuffer = KeyBuffer;
+    Result.PayloadBuffer = PayloadBuffer;
+
+    VkDevice Device = RenderState->Device;
+    vk_descriptor_manager* DescriptorManager = &RenderState->DescriptorManager;
+
+    // NOTE: Shared Radix Data
+    {
+        Result.ScratchKeyBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                 sizeof(u32) * MaxNumKeys);
+        Result.ScratchPayloadBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                     sizeof(u32) * MaxNumKeys);
+
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result.InputOutputDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(Device, &Builder);
+        }
+
+        Result.InputOutputDescriptor[0] = VkDescriptorSetAllocate(Device, RenderState->DescriptorPool, Result.InputOutputDescLayout);
+        VkDescriptorBufferWrite(DescriptorManager, Result.InputOutputDescriptor[0], 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, KeyBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.InputOutputDescriptor[0], 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ScratchKeyBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.InputOutputDescriptor[0], 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, PayloadBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.InputOutputDescriptor[0], 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ScratchPayloadBuffer);
+
+        Result.InputOutputDescriptor[1] = VkDescriptorSetAllocate(Device, RenderState->DescriptorPool, Result.InputOutputDescLayout);
+        VkDescriptorBufferWrite(DescriptorManager, Result.InputOutputDescriptor[1], 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ScratchKeyBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.InputOutputDescriptor[1], 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, KeyBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.InputOutputDescriptor[1], 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ScratchPayloadBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.InputOutputDescriptor[1], 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, PayloadBuffer);
+    }
+
+    // NOTE: Bitonic Data
+    {
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result.BitonicDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(Device, &Builder);
+        }
+
+        VkDescriptorSetLayout Layouts[] =
+            {
+                Result.BitonicDescLayout,
+            };
+
+        Result.BitonicLocalFdPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_merge_local_fd.spv", "main",
+                                                                Layouts, ArrayCount(Layouts), sizeof(bitonic_sort_constants));
+        Result.BitonicGlobalFlipPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_merge_global_flip.spv", "main",
+                                                                   Layouts, ArrayCount(Layouts), sizeof(bitonic_sort_constants));
+        Result.BitonicLocalDispersePipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_merge_local_disperse.spv", "main",
+                                                                      Layouts, ArrayCount(Layouts), sizeof(bitonic_sort_constants));
+        Result.BitonicGlobalDispersePipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_merge_global_disperse.spv", "main",
+                                                                       Layouts, ArrayCount(Layouts), sizeof(bitonic_sort_constants));
+
+        Result.BitonicDescriptor = VkDescriptorSetAllocate(Device, RenderState->DescriptorPool, Result.BitonicDescLayout);
+        VkDescriptorBufferWrite(DescriptorManager, Result.BitonicDescriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, KeyBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.BitonicDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, PayloadBuffer);
+    }
+
+    // NOTE: Atomic Bitonic Data
+    {
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result.AtomicDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(Device, &Builder);
+        }
+
+        VkDescriptorSetLayout Layouts[] =
+            {
+                Result.AtomicDescLayout,
+            };
+
+        Result.AtomicPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_atomic_merge_sort.spv", "main",
+                                                        Layouts, ArrayCount(Layouts));
+
+        Result.AtomicUniformBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                    sizeof(atomic_sort_uniform_data));
+        Result.AtomicCounterBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                    sizeof(atomic_sort_buffer_data));
+        Result.AtomicPassBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                 sizeof(atomic_sort_pass_params) * ATOMIC_SORT_MAX_PASSES);
+
+        Result.AtomicDescriptor = VkDescriptorSetAllocate(Device, RenderState->DescriptorPool, Result.AtomicDescLayout);
+        VkDescriptorBufferWrite(DescriptorManager, Result.AtomicDescriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Result.AtomicUniformBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.AtomicDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, KeyBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.AtomicDescriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.AtomicCounterBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.AtomicDescriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.AtomicPassBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.AtomicDescriptor, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, PayloadBuffer);
+    }
+
+    // NOTE: Parallel Sort Data
+    {
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result.ParallelSortConstantDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(Device, &Builder);
+        }
+
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result.ParallelSortScanDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(Device, &Builder);
+        }
+
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result.ParallelSortScratchDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(Device, &Builder);
+        }
+
+        VkDescriptorSetLayout Layouts[] =
+            {
+                Result.ParallelSortConstantDescLayout,
+                Result.InputOutputDescLayout,
+                Result.ParallelSortScanDescLayout,
+                Result.ParallelSortScratchDescLayout,
+            };
+
+        Result.ParallelSortCountPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_parallel_sort_count.spv", "main",
+                                                                   Layouts, ArrayCount(Layouts), sizeof(u32));
+        Result.ParallelSortReducePipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_parallel_sort_reduce.spv", "main",
+                                                                    Layouts, ArrayCount(Layouts), sizeof(u32));
+        Result.ParallelSortScanPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_parallel_sort_scan.spv", "main",
+                                                                  Layouts, ArrayCount(Layouts), sizeof(u32));
+        Result.ParallelSortScanAddPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_parallel_sort_scan_add.spv", "main",
+                                                                     Layouts, ArrayCount(Layouts), sizeof(u32));
+        Result.ParallelSortScatterPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_parallel_sort_scatter.spv", "main",
+                                                                     Layouts, ArrayCount(Layouts), sizeof(u32));
+
+        // NOTE: Scratch sizes only grow with the key count, so we size them for the max
+        u32 ScratchBufferSize = 0;
+        u32 ReduceScratchBufferSize = 0;
+        FFX_ParallelSort_CalculateScratchResourceSize(MaxNumKeys, ScratchBufferSize, ReduceScratchBufferSize);
+
+        Result.ParallelSortUniformBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                          sizeof(FFX_ParallelSortCB));
+        Result.ParallelSortScratchBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                          ScratchBufferSize);
+        Result.ParallelSortReducedScratchBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                                 ReduceScratchBufferSize);
+
+        Result.ParallelSortConstantDescriptor = VkDescriptorSetAllocate(Device, RenderState->DescriptorPool, Result.ParallelSortConstantDescLayout);
+        VkDescriptorBufferWrite(DescriptorManager, Result.ParallelSortConstantDescriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Result.ParallelSortUniformBuffer);
+
+        Result.ParallelSortScanDescriptor[0] = VkDescriptorSetAllocate(Device, RenderState->DescriptorPool, Result.ParallelSortScanDescLayout);
+        VkDescriptorBufferWrite(DescriptorManager, Result.ParallelSortScanDescriptor[0], 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ParallelSortReducedScratchBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.ParallelSortScanDescriptor[0], 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ParallelSortReducedScratchBuffer);
+
+        Result.ParallelSortScanDescriptor[1] = VkDescriptorSetAllocate(Device, RenderState->DescriptorPool, Result.ParallelSortScanDescLayout);
+        VkDescriptorBufferWrite(DescriptorManager, Result.ParallelSortScanDescriptor[1], 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ParallelSortScratchBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.ParallelSortScanDescriptor[1], 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ParallelSortScratchBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.ParallelSortScanDescriptor[1], 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ParallelSortReducedScratchBuffer);
+
+        Result.ParallelSortScratchDescriptor = VkDescriptorSetAllocate(Device, RenderState->DescriptorPool, Result.ParallelSortScratchDescLayout);
+        VkDescriptorBufferWrite(DescriptorManager, Result.ParallelSortScratchDescriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ParallelSortScratchBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.ParallelSortScratchDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ParallelSortReducedScratchBuffer);
+    }
+
+    // NOTE: Onesweep Data
+    {
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result.OnesweepDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(Device, &Builder);
+        }
+
+        VkDescriptorSetLayout Layouts[] =
+            {
+                Result.OnesweepDescLayout,
+                Result.InputOutputDescLayout,
+            };
+
+        Result.OnesweepGlobalHistogramPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_onesweep_global_histogram.spv", "main",
+                                                                         Layouts, ArrayCount(Layouts), sizeof(onesweep_constants));
+        Result.OnesweepGlobalScanPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_onesweep_global_scan.spv", "main",
+                                                                    Layouts, ArrayCount(Layouts), sizeof(onesweep_constants));
+        Result.OnesweepDigitPassPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_onesweep_digit_pass.spv", "main",
+                                                                   Layouts, ArrayCount(Layouts), sizeof(onesweep_constants));
+        Result.OnesweepCopyPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_onesweep_copy.spv", "main",
+                                                              Layouts, ArrayCount(Layouts), sizeof(onesweep_constants));
+
+        // NOTE: The pass histogram has an extra slot per pass for the global offsets
+        u32 MaxNumTiles = DispatchSize(MaxNumKeys, ONESWEEP_TILE_SIZE);
+        Result.OnesweepGlobalHistogramBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                              sizeof(u32) * ONESWEEP_NUM_PASSES * ONESWEEP_RADIX);
+        Result.OnesweepPassHistogramBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                            sizeof(u32) * ONESWEEP_NUM_PASSES * (MaxNumTiles + 1) * ONESWEEP_RADIX);
+        Result.OnesweepTileCounterBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                          sizeof(u32) * ONESWEEP_NUM_PASSES);
+        Result.OnesweepPassArgsBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                       sizeof(u32) * ONESWEEP_PASS_ARGS_STRIDE * ONESWEEP_NUM_PASS_ARGS);
+
+        Result.OnesweepDescriptor = VkDescriptorSetAllocate(Device, RenderState->DescriptorPool, Result.OnesweepDescLayout);
+        VkDescriptorBufferWrite(DescriptorManager, Result.OnesweepDescriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.OnesweepGlobalHistogramBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.OnesweepDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.OnesweepPassHistogramBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.OnesweepDescriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.OnesweepTileCounterBuffer);
+        VkDescriptorBufferWrite(DescriptorManager, Result.OnesweepDescriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.OnesweepPassArgsBuffer);
+    }
+
+    // NOTE: Cpu Data
+    {
+        u64 BufferSize = sizeof(u32) * MaxNumKeys;
+
+        VkDeviceMemory KeyMemory = VkMemoryAllocate(Device, RenderState->StagingMemoryId, BufferSize);
+        Result.CpuKeyBuffer = VkBufferCreate(Device, KeyMemory, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, BufferSize);
+        VkCheckResult(vkMapMemory(Device, KeyMemory, 0, BufferSize, 0, (void**)&Result.CpuKeys));
+
+        VkDeviceMemory PayloadMemory = VkMemoryAllocate(Device, RenderState->StagingMemoryId, BufferSize);
+        Result.CpuPayloadBuffer = VkBufferCreate(Device, PayloadMemory, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, BufferSize);
+        VkCheckResult(vkMapMemory(Device, PayloadMemory, 0, BufferSize, 0, (void**)&Result.CpuPayload));
+
+        Result.CpuScratchKeys = PushArray(Arena, u32, MaxNumKeys);
+        Result.CpuScratchPayload = PushArray(Arena, u32, MaxNumKeys);
+    }
+
+    return Result;
+}
+
+//
+// NOTE: Gpu Sort 64
+//
+
+inline void GpuSort64Dispatch(vk_commands* Commands, gpu_sort64* Sort, vk_pipeline* Pipeline, u32 NumKeys)
+{
+    u32 NumGroups = DispatchSize(NumKeys, 64);
+    u32 DispatchX = NumGroups;
+    u32 DispatchY = 1;
+    if (DispatchX > GPU_SORT_MAX_THREAD_GROUPS)
+    {
+        DispatchX = 64;
+        DispatchY = DispatchSize(NumGroups, DispatchX);
+    }
+
+    sort64_constants Constants = {};
+    Constants.NumKeys = NumKeys;
+    Constants.HasPayload = Sort->HasPayload;
+    
+    vkCmdPushConstants(Commands->Buffer, Pipeline->Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &Constants);
+    VkComputeDispatch(Commands, Pipeline, &Sort->Descriptor, 1, DispatchX, DispatchY, 1);
+}
+
+inline void GpuSortKeys64(vk_commands* Commands, gpu_sort64* Sort, u32 NumKeys, u32 Backend)
+{
+    Assert(NumKeys <= Sort->MaxNumKeys);
+    if (NumKeys <= 1)
+    {
+        return;
+    }
+
+    // NOTE: The last sort might still be reading the word buffers and copying out of the scratch buffers
+    GpuSortBarrier(Commands, Sort->WordBuffer);
+    GpuSortBarrier(Commands, Sort->IndexBuffer);
+    VkBarrierBufferAdd(Commands, Sort->ScratchKeyBuffer,
+                       VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    if (Sort->HasPayload)
+    {
+        VkBarrierBufferAdd(Commands, Sort->ScratchPayloadBuffer,
+                           VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+    VkCommandsBarrierFlush(Commands);
+
+    // NOTE: LSD order, the low words first and then the high words. Both sorts have to be stable for the second to keep the first
+    GpuSort64Dispatch(Commands, Sort, Sort->LowWordPipeline, NumKeys);
+    GpuSortBarrier(Commands, Sort->WordBuffer);
+    GpuSortBarrier(Commands, Sort->IndexBuffer);
+    VkCommandsBarrierFlush(Commands);
+
+    GpuSortKeys(Commands, Sort->WordSort, NumKeys, Backend, GpuSortFlag_Stable);
+
+    GpuSort64Dispatch(Commands, Sort, Sort->HighWordPipeline, NumKeys);
+    GpuSortBarrier(Commands, Sort->WordBuffer);
+    VkCommandsBarrierFlush(Commands);
+
+    GpuSortKeys(Commands, Sort->WordSort, NumKeys, Backend, GpuSortFlag_Stable);
+
+    // NOTE: Gather through the sorted indices and copy the results back to the bound buffers
+    GpuSort64Dispatch(Commands, Sort, Sort->PermutePipeline, NumKeys);
+    VkBarrierBufferAdd(Commands, Sort->ScratchKeyBuffer,
+                       VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    VkBarrierBufferAdd(Commands, Sort->KeyBuffer,
+                       VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    if (Sort->HasPayload)
+    {
+        VkBarrierBufferAdd(Commands, Sort->ScratchPayloadBuffer,
+                           VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkBarrierBufferAdd(Commands, Sort->PayloadBuffer,
+                           VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+    VkCommandsBarrierFlush(Commands);
+
+    {
+        VkBufferCopy BufferCopy = {};
+        BufferCopy.size = sizeof(u64) * NumKeys;
+        vkCmdCopyBuffer(Commands->Buffer, Sort->ScratchKeyBuffer, Sort->KeyBuffer, 1, &BufferCopy);
+
+        if (Sort->HasPayload)
+        {
+            BufferCopy.size = sizeof(u32) * NumKeys;
+            vkCmdCopyBuffer(Commands->Buffer, Sort->ScratchPayloadBuffer, Sort->PayloadBuffer, 1, &BufferCopy);
+        }
+    }
+
+    VkBarrierBufferAdd(Commands, Sort->KeyBuffer,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    if (Sort->HasPayload)
+    {
+        VkBarrierBufferAdd(Commands, Sort->PayloadBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+    // NOTE: Callers that use the sorted order read it from the index buffer
+    GpuSortBarrier(Commands, Sort->IndexBuffer);
+    VkCommandsBarrierFlush(Commands);
+}
+
+inline gpu_sort64 GpuSort64Create(linear_arena* TempArena, VkBuffer KeyBuffer, VkBuffer PayloadBuffer, gpu_sort* WordSort, u32 MaxNumKeys)
+{
+    Assert(MaxNumKeys <= WordSort->MaxNumKeys);
+
+    gpu_sort64 Result = {};
+    Result.MaxNumKeys = MaxNumKeys;
+    Result.KeyBuffer = KeyBuffer;
+    Result.PayloadBuffer = PayloadBuffer;
+    Result.HasPayload = PayloadBuffer != VK_NULL_HANDLE;
+    Result.WordSort = WordSort;
+    Result.WordBuffer = WordSort->KeyBuffer;
+    Result.IndexBuffer = WordSort->PayloadBuffer;
+
+    VkDevice Device = RenderState->Device;
+    vk_descriptor_manager* DescriptorManager = &RenderState->DescriptorManager;
+
+    Result.ScratchKeyBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                             sizeof(u64) * MaxNumKeys);
+    if (Result.HasPayload)
+    {
+        Result.ScratchPayloadBuffer = VkBufferCreate(Device, &RenderState->GpuArena, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                     sizeof(u32) * MaxNumKeys);
+    }
+
+    {
+        vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result.DescLayout);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorLayoutEnd(Device, &Builder);
+    }
+
+    VkDescriptorSetLayout Layouts[] =
+        {
+            Result.DescLayout,
+        };
+
+    Result.LowWordPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_sort64_low_word.spv", "main",
+                                                     Layouts, ArrayCount(Layouts), sizeof(sort64_constants));
+    Result.HighWordPipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_sort64_high_word.spv", "main",
+                                                      Layouts, ArrayCount(Layouts), sizeof(sort64_constants));
+    Result.PermutePipeline = VkPipelineComputeCreate(Device, &RenderState->PipelineManager, TempArena, "shader_sort64_permute.spv", "main",
+                                                     Layouts, ArrayCount(Layouts), sizeof(sort64_constants));
+
+    Result.Descriptor = VkDescriptorSetAllocate(Device, RenderState->DescriptorPool, Result.DescLayout);
+    // NOTE: Without a payload the permute never touches its bindings, so we fill them with the key buffers
+    VkBuffer BoundPayloadBuffer = Result.HasPayload ? PayloadBuffer : KeyBuffer;
+    VkBuffer BoundScratchPayloadBuffer = Result.HasPayload ? Result.ScratchPayloadBuffer : Result.ScratchKeyBuffer;
+    VkDescriptorBufferWrite(DescriptorManager, Result.Descriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, KeyBuffer);
+    VkDescriptorBufferWrite(DescriptorManager, Result.Descriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, BoundPayloadBuffer);
+    VkDescriptorBufferWrite(DescriptorManager, Result.Descriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.WordBuffer);
+    VkDescriptorBufferWrite(DescriptorManager, Result.Descriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.IndexBuffer);
+    VkDescriptorBufferWrite(DescriptorManager, Result.Descriptor, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Result.ScratchKeyBuffer);
+    VkDescriptorBufferWrite(DescriptorManager, Result.Descriptor, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, BoundScratchPayloadBuffer);
+
+    return Result;
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "huge_graphs_cpu_sort.h"
+
+//
+// NOTE: Gpu Sort
+//
+
+/*
+  NOTE: Sorts a buffer of u32 keys and a buffer of u32 payloads in place, in ascending key order. A gpu_sort owns the pipelines and
+        scratch memory of every backend and is bound to one key/payload buffer pair up to MaxNumKeys when it gets created. The key
+        count and backend can change every call, GpuSortBackend_Auto picks the fastest backend for the count. Only the radix backends
+        are stable, so callers that sort a wide key one word at a time have to pass GpuSortFlag_Stable.
+
+        The key and payload buffers need storage, transfer src and transfer dst usage since the CPU backend copies through staging.
+ */
+
+#define GpuSortBackend_Auto 0
+#define GpuSortBackend_Bitonic 1
+#define GpuSortBackend_AtomicBitonic 2
+#define GpuSortBackend_Ffx 3
+#define GpuSortBackend_Onesweep 4
+#define GpuSortBackend_Cpu 5
+#define GpuSortBackend_Count 6
+
+#define GpuSortFlag_Stable (1 << 0)
+
+// NOTE: One bitonic local flip disperse group sorts this many keys, below it a single dispatch beats the radix sorts
+#define GPU_SORT_BITONIC_GROUP_SIZE 2048
+// NOTE: Minimum maxComputeWorkGroupCount that Vulkan guarantees, bigger dispatches get split into 2D
+#define GPU_SORT_MAX_THREAD_GROUPS 65535
+
+//
+// NOTE: Bitonic Sort Data
+//
+
+// NOTE: These have to match the push constants in sort_shaders.cpp
+struct bitonic_sort_constants
+{
+    u32 ArraySize;
+    u32 FlipSize;
+    u32 PassId;
+    u32 N;
+    u32 NumThreads;
+};
+
+// NOTE: These have to match sort_shaders_atomic.h
+struct atomic_sort_uniform_data
+{
+    u32 ArraySize;
+    u32 NumPasses;
+    u32 NumLaunchedGroups;
+};
+
+struct atomic_sort_buffer_data
+{
+    u32 PollState;
+    u32 BarrierCounter;
+};
+
+#define AtomicSortPassType_None 0
+#define AtomicSortPassType_LocalFd 1
+#define AtomicSortPassType_GlobalFlip 2
+#define AtomicSortPassType_LocalDisperse 3
+#define AtomicSortPassType_GlobalDisperse 4
+
+struct atomic_sort_pass_params
+{
+    u32 PassType;
+    u32 FlipSize;
+    u32 PassId;
+    u32 N;
+};
+
+// NOTE: Enough passes for 2^32 keys
+#define ATOMIC_SORT_MAX_PASSES 512
+// NOTE: More 1024 thread groups than any GPU keeps resident at once, the shader trims the launch down to the groups that actually are
+#define ATOMIC_SORT_MAX_LAUNCH_GROUPS 1024
+
+//
+// NOTE: Parallel Sort Data
+//
+
+#define PARALLEL_SORT_MAX_THREAD_GROUPS 1000000
+
+//
+// NOTE: Onesweep Sort Data
+//
+
+// NOTE: These have to match the defines in parallel_sort_shaders.h
+#define ONESWEEP_RADIX_BITS 8
+#define ONESWEEP_RADIX (1 << ONESWEEP_RADIX_BITS)
+#define ONESWEEP_NUM_PASSES (32 / ONESWEEP_RADIX_BITS)
+#define ONESWEEP_THREADGROUP_SIZE 256
+#define ONESWEEP_KEYS_PER_THREAD 8
+#define ONESWEEP_TILE_SIZE (ONESWEEP_THREADGROUP_SIZE * ONESWEEP_KEYS_PER_THREAD)
+#define ONESWEEP_PASS_ARGS_STRIDE 4
+#define ONESWEEP_NUM_PASS_ARGS (ONESWEEP_NUM_PASSES + 1)
+// NOTE: The look back words keep a 2 bit status flag above the count, see ONESWEEP_FLAG_BITS in parallel_sort_shaders.h
+#define ONESWEEP_MAX_NUM_KEYS (1u << 30)
+
+struct onesweep_constants
+{
+    u32 NumKeys;
+    u32 NumTiles;
+    u32 Shift;
+    u32 DispatchX;
+    u32 DispatchY;
+};
+
+struct gpu_sort
+{
+    u32 MaxNumKeys;
+    VkBuffer KeyBuffer;
+    VkBuffer PayloadBuffer;
+
+    // NOTE: The radix backends ping pong between the bound buffers and these
+    VkBuffer ScratchKeyBuffer;
+    VkBuffer ScratchPayloadBuffer;
+    VkDescriptorSetLayout InputOutputDescLayout;
+    VkDescriptorSet InputOutputDescriptor[2];
+
+    // NOTE: Bitonic Data
+    VkDescriptorSetLayout BitonicDescLayout;
+    VkDescriptorSet BitonicDescriptor;
+    vk_pipeline* BitonicLocalFdPipeline;
+    vk_pipeline* BitonicGlobalFlipPipeline;
+    vk_pipeline* BitonicLocalDispersePipeline;
+    vk_pipeline* BitonicGlobalDispersePipeline;
+
+    // NOTE: Atomic Bitonic Data
+    u32 AtomicNumKeys;
+    u32 AtomicNumPasses;
+    VkBuffer AtomicUniformBuffer;
+    VkBuffer AtomicCounterBuffer;
+    VkBuffer AtomicPassBuffer;
+    VkDescriptorSetLayout AtomicDescLayout;
+    VkDescriptorSet AtomicDescriptor;
+    vk_pipeline* AtomicPipeline;
+
+    // NOTE: Parallel Sort Data
+    u32 ParallelSortNumKeys;
+    u32 ParallelSortNumThreadGroups;
+    u32 ParallelSortNumReducedThreadGroups;
+    VkBuffer ParallelSortUniformBuffer;
+    VkBuffer ParallelSortScratchBuffer;
+    VkBuffer ParallelSortReducedScratchBuffer;
+
+    VkDescriptorSet ParallelSortConstantDescriptor;
+    VkDescriptorSet ParallelSortScanDescriptor[2];
+    VkDescriptorSet ParallelSortScratchDescriptor;
+    VkDescriptorSetLayout ParallelSortConstantDescLayout;
+    VkDescriptorSetLayout ParallelSortScanDescLayout;
+    VkDescriptorSetLayout ParallelSortScratchDescLayout;
+    vk_pipeline* ParallelSortCountPipeline;
+    vk_pipeline* ParallelSortReducePipeline;
+    vk_pipeline* ParallelSortScanPipeline;
+    vk_pipeline* ParallelSortScanAddPipeline;
+    vk_pipeline* ParallelSortScatterPipeline;
+
+    // NOTE: Onesweep Data
+    VkBuffer OnesweepGlobalHistogramBuffer;
+    VkBuffer OnesweepPassHistogramBuffer;
+    VkBuffer OnesweepTileCounterBuffer;
+    VkBuffer OnesweepPassArgsBuffer;
+    VkDescriptorSet OnesweepDescriptor;
+    VkDescriptorSetLayout OnesweepDescLayout;
+    vk_pipeline* OnesweepGlobalHistogramPipeline;
+    vk_pipeline* OnesweepGlobalScanPipeline;
+    vk_pipeline* OnesweepDigitPassPipeline;
+    vk_pipeline* OnesweepCopyPipeline;
+
+    // NOTE: Cpu Data
+    VkBuffer CpuKeyBuffer;
+    VkBuffer CpuPayloadBuffer;
+    u32* CpuKeys;
+    u32* CpuPayload;
+    u32* CpuScratchKeys;
+    u32* CpuScratchPayload;
+};
+
+//
+// NOTE: Gpu Sort 64
+//
+
+/*
+  NOTE: Sorts a buffer of u64 keys and a buffer of u32 payloads in place, in ascending key order, and keeps equal keys in the order
+        they came in. It sorts the low words and then the high words of the keys with a stable gpu_sort over (word, index) pairs, so
+        it runs on the same scan and scatter passes as the 32 bit sort, and then gathers the keys and payloads through the sorted
+        indices. Onesweep skips the digit passes that are constant across all keys, so keys that only use a few bits of the high
+        word cost little more than a 32 bit sort.
+
+        The word sort is a gpu_sort of the caller, its key and payload buffers hold the words and indices. Afterwards its payload
+        buffer holds the input index of every sorted key, so callers that only need that order can pass no payload buffer.
+
+        Only the stable backends can be picked. The key and payload buffers need storage and transfer dst usage.
+ */
+
+// NOTE: These have to match the push constants in sort_shaders_64.cpp
+struct sort64_constants
+{
+    u32 NumKeys;
+    u32 HasPayload;
+};
+
+struct gpu_sort64
+{
+    u32 MaxNumKeys;
+    VkBuffer KeyBuffer;
+    VkBuffer PayloadBuffer;
+    b32 HasPayload;
+
+    // NOTE: The word sort orders one 32 bit word of every key with the index of the key as its payload
+    gpu_sort* WordSort;
+    VkBuffer WordBuffer;
+    VkBuffer IndexBuffer;
+
+    VkBuffer ScratchKeyBuffer;
+    VkBuffer ScratchPayloadBuffer;
+    VkDescriptorSetLayout DescLayout;
+    VkDescriptorSet Descriptor;
+    vk_pipeline* LowWordPipeline;
+    vk_pipeline* HighWordPipeline;
+    vk_pipeline* PermutePipeline;
+};
@@ -1,329 +1,635 @@
 
-inline sort_globals SortGlobalsInit()
+#include "huge_graphs_sort_bench.h"
+
+#include <algorithm>
+
+#include "huge_graphs_cpu_sort.cpp"
+#include "huge_graphs_sort.cpp"
+
+//
+// NOTE: Key Generation
+//
+
+inline u32 SortBenchRandomU32()
+{
+    // NOTE: rand() only gives us 15 bits
+    u32 Result = (u32(rand()) << 30) ^ (u32(rand()) << 15) ^ u32(rand());
+    return Result;
+}
+
+inline f32 SortBenchRandomUnilateral()
 {
-    sort_globals Result = {};
-    
-    // NOTE: Bitonic Merge Sort Pipelines
+    f32 Result = f32(SortBenchRandomU32() >> 8) / f32(1 << 24);
+    return Result;
+}
+
+inline u32 SortBenchMortonExpandBits(u32 Value)
+{
+    u32 Result = (Value | (Value << 16)) & 0x0000FFFF;
+    Result = (Result | (Result << 8)) & 0x00FF00FF;
+    Result = (Result | (Result << 4)) & 0x0F0F0F0F;
+    Result = (Result | (Result << 2)) & 0x33333333;
+    Result = (Result | (Result << 1)) & 0x55555555;
+    return Result;
+}
+
+inline u32 SortBenchMortonKey(f32 PosX, f32 PosY)
+{
+    // NOTE: Same as the high word of Morton2d in radixtree_shaders.cpp for bounds of the unit square, 2^16 cells per axis with the
+    // max edge clamped into the last one
+    u32 FixedX = u32(Min(Max(PosX, 0.0f) * 65536.0f, 65535.0f));
+    u32 FixedY = u32(Min(Max(PosY, 0.0f) * 65536.0f, 65535.0f));
+    u32 Result = 2 * SortBenchMortonExpandBits(FixedX) + SortBenchMortonExpandBits(FixedY);
+    return Result;
+}
+
+inline void SortBenchKeysGenerate(u32 Distribution, u32 NumKeys, u32* Keys)
+{
+    switch (Distribution)
     {
+        case SortBenchDist_Uniform:
         {
-            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->SortDescLayout);
-            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-            VkDescriptorLayoutEnd(RenderState->Device, &Builder);
-        }
+            for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+            {
+                Keys[KeyId] = SortBenchRandomU32();
+            }
+        } break;
 
-        // NOTE: Local FD
+        case SortBenchDist_Sorted:
+        case SortBenchDist_Reverse:
         {
-            VkDescriptorSetLayout Layouts[] =
-                {
-                    DemoState->SortDescLayout,
-                };
-            
-            DemoState->SortLocalFdPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                     "shader_merge_local_fd.spv", "main", Layouts, ArrayCount(Layouts));
-        }
+            for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+            {
+                Keys[KeyId] = SortBenchRandomU32();
+            }
+
+            std::sort(Keys, Keys + NumKeys);
+            if (Distribution == SortBenchDist_Reverse)
+            {
+                std::reverse(Keys, Keys + NumKeys);
+            }
+        } break;
 
-        // NOTE: Global Flip
+        case SortBenchDist_NearlySortedMorton:
         {
-            VkDescriptorSetLayout Layouts[] =
-                {
-                    DemoState->SortDescLayout,
-                };
-            
-            DemoState->SortGlobalFlipPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                        "shader_merge_global_flip.spv", "main", Layouts, ArrayCount(Layouts));
-        }
+            // NOTE: Mimics the radix tree keys from one frame to the next. The points were sorted by morton key last frame and then
+            // every point moved a little, so most keys are still in order and the rest are only a short distance off
+            temp_mem TempMem = BeginTempMem(&GlobalState.TempArena);
+
+            f32* PosX = PushArray(&GlobalState.TempArena, f32, NumKeys);
+            f32* PosY = PushArray(&GlobalState.TempArena, f32, NumKeys);
+            for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+            {
+                PosX[KeyId] = SortBenchRandomUnilateral();
+                PosY[KeyId] = SortBenchRandomUnilateral();
+                GlobalState.CpuKeys[KeyId] = SortBenchMortonKey(PosX[KeyId], PosY[KeyId]);
+                GlobalState.CpuPayload[KeyId] = KeyId;
+            }
 
-        // NOTE: Local Disperse
+            CpuRadixSort(NumKeys, GlobalState.CpuKeys, GlobalState.CpuPayload, GlobalState.CpuScratchKeys, GlobalState.CpuScratchPayload);
+
+            for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+            {
+                u32 PointId = GlobalState.CpuPayload[KeyId];
+                f32 NewPosX = PosX[PointId] + SORT_BENCH_MORTON_JITTER * (2.0f * SortBenchRandomUnilateral() - 1.0f);
+                f32 NewPosY = PosY[PointId] + SORT_BENCH_MORTON_JITTER * (2.0f * SortBenchRandomUnilateral() - 1.0f);
+                Keys[KeyId] = SortBenchMortonKey(NewPosX, NewPosY);
+            }
+
+            EndTempMem(TempMem);
+        } break;
+
+        case SortBenchDist_Duplicates:
         {
-            VkDescriptorSetLayout Layouts[] =
-                {
-                    DemoState->SortDescLayout,
-                };
-            
-            DemoState->SortLocalDispersePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                           "shader_merge_local_disperse.spv", "main", Layouts, ArrayCount(Layouts));
+            for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+            {
+                Keys[KeyId] = SortBenchRandomU32() % SORT_BENCH_NUM_DUPLICATE_VALUES;
+            }
+        } break;
+
+        default:
+        {
+            InvalidCodePath;
+        } break;
+    }
+}
+
+inline void SortBenchKeys64Generate(u32 Distribution, u32 NumKeys)
+{
+    // NOTE: The high words are the 32 bit keys of the run and the low words a second draw from the same distribution. Sorted and
+    // reversed keys stay sorted and reversed as u64 keys, and the duplicates only take 16 * 16 values so stability still gets tested
+    temp_mem TempMem = BeginTempMem(&GlobalState.TempArena);
+
+    u32* LowWords = PushArray(&GlobalState.TempArena, u32, NumKeys);
+    SortBenchKeysGenerate(Distribution, NumKeys, LowWords);
+    for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+    {
+        GlobalState.InputKeys64[KeyId] = (u64(GlobalState.InputKeys[KeyId]) << 32) | u64(LowWords[KeyId]);
+    }
+
+    EndTempMem(TempMem);
+}
+
+inline const char* SortBenchDistName(u32 Distribution)
+{
+    const char* Names[] =
+        {
+            "uniform",
+            "sorted",
+            "reverse",
+            "nearly_sorted_morton",
+            "duplicates",
+        };
+    Assert(Distribution < ArrayCount(Names));
+    return Names[Distribution];
+}
+
+inline const char* SortBenchGpuName(u32 Backend)
+{
+    const char* Names[] =
+        {
+            "gpu_auto",
+            "gpu_bitonic",
+            "gpu_atomic_bitonic",
+            "gpu_ffx",
+            "gpu_onesweep",
+            "gpu_cpu_readback",
+        };
+    Assert(Backend < ArrayCount(Names));
+    return Names[Backend];
+}
+
+inline const char* SortBenchGpu64Name(u32 Backend)
+{
+    const char* Names[] =
+        {
+            "gpu64_auto",
+            "gpu64_bitonic",
+            "gpu64_atomic_bitonic",
+            "gpu64_ffx",
+            "gpu64_onesweep",
+            "gpu64_cpu_readback",
+        };
+    Assert(Backend < ArrayCount(Names));
+    return Names[Backend];
+}
+
+inline const char* SortBenchCpuName(u32 CpuSort)
+{
+    const char* Names[] =
+        {
+            "cpu_std_sort",
+            "cpu_radix",
+        };
+    Assert(CpuSort < ArrayCount(Names));
+    return Names[CpuSort];
+}
+
+//
+// NOTE: Validation
+//
+
+inline b32 SortBenchValidate(u32 NumKeys, u32* Keys, u32* Payload, b32 CheckStable)
+{
+    // NOTE: Payloads start out as the key index, so they tell us where every key came from. We need the keys in order, every payload
+    // to show up exactly once and point at an input with the same key, and for stable sorts equal keys to keep their input order
+    b32 Result = true;
+
+    temp_mem TempMem = BeginTempMem(&GlobalState.TempArena);
+    u8* Seen = PushArray(&GlobalState.TempArena, u8, NumKeys);
+    for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+    {
+        Seen[KeyId] = 0;
+    }
+
+    for (u32 KeyId = 0; KeyId < NumKeys && Result; ++KeyId)
+    {
+        u32 SrcId = Payload[KeyId];
+        Result = SrcId < NumKeys && !Seen[SrcId] && GlobalState.InputKeys[SrcId] == Keys[KeyId];
+        if (Result)
+        {
+            Seen[SrcId] = 1;
         }
 
-        // NOTE: Global Disperse
+        if (Result && KeyId > 0)
         {
-            VkDescriptorSetLayout Layouts[] =
-                {
-                    DemoState->SortDescLayout,
-                };
-            
-            DemoState->SortGlobalDispersePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                            "shader_merge_global_disperse.spv", "main", Layouts, ArrayCount(Layouts));
+            Result = Keys[KeyId - 1] < Keys[KeyId] || (Keys[KeyId - 1] == Keys[KeyId] && (!CheckStable || Payload[KeyId - 1] < SrcId));
         }
+    }
+
+    EndTempMem(TempMem);
+
+    return Result;
+}
 
+inline b32 SortBenchValidate64(u32 NumKeys, u64* Keys, u32* Payload)
+{
+    // NOTE: Same checks as SortBenchValidate, gpu_sort64 is always stable
+    b32 Result = true;
+
+    temp_mem TempMem = BeginTempMem(&GlobalState.TempArena);
+    u8* Seen = PushArray(&GlobalState.TempArena, u8, NumKeys);
+    for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+    {
+        Seen[KeyId] = 0;
+    }
+
+    for (u32 KeyId = 0; KeyId < NumKeys && Result; ++KeyId)
+    {
+        u32 SrcId = Payload[KeyId];
+        Result = SrcId < NumKeys && !Seen[SrcId] && GlobalState.InputKeys64[SrcId] == Keys[KeyId];
+        if (Result)
         {
-            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&DemoState->AtomicSortDescLayout);
-            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-            VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+            Seen[SrcId] = 1;
         }
 
-        // NOTE: Atomic Merge Sort
+        if (Result && KeyId > 0)
         {
-            VkDescriptorSetLayout Layouts[] =
-                {
-                    DemoState->AtomicSortDescLayout,
-                };
-            
-            DemoState->AtomicSortPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
-                                                                    "shader_atomic_merge_sort.spv", "main", Layouts, ArrayCount(Layouts));
+            Result = Keys[KeyId - 1] < Keys[KeyId] || (Keys[KeyId - 1] == Keys[KeyId] && Payload[KeyId - 1] < SrcId);
         }
     }
 
-    // NOTE: Init Sort Data
+    EndTempMem(TempMem);
+
+    return Result;
+}
+
+//
+// NOTE: Benchmark Runs
+//
+
+inline void SortBenchResultWrite(const char* SortName, u32 Distribution, u32 NumKeys, f32 TimeMs, b32 Valid)
+{
+    f32 KeysPerSecond = f32(NumKeys) / (TimeMs / 1000.0f);
+    printf("%-20s %-22s %10u %12.4f ms %12.2f Mkeys/s %s\n", SortName, SortBenchDistName(Distribution), NumKeys, TimeMs,
+           KeysPerSecond / 1000000.0f, Valid ? "ok" : "FAILED");
+    fprintf(GlobalState.CsvFile, "%s,%s,%u,%f,%f,%u\n", SortName, SortBenchDistName(Distribution), NumKeys, TimeMs, KeysPerSecond, Valid);
+    fflush(GlobalState.CsvFile);
+}
+
+inline f32 SortBenchGpuRun(u32 Backend, u32 NumKeys, b32 Keys64)
+{
+    vk_commands* Commands = &RenderState->Commands;
+    VkBuffer KeyBuffer = Keys64 ? GlobalState.Key64Buffer : GlobalState.KeyBuffer;
+    VkBuffer StagingKeyBuffer = Keys64 ? GlobalState.StagingKey64Buffer : GlobalState.StagingKeyBuffer;
+
+    VkBufferCopy KeyCopy = {};
+    KeyCopy.size = (Keys64 ? sizeof(u64) : sizeof(u32)) * NumKeys;
+    VkBufferCopy PayloadCopy = {};
+    PayloadCopy.size = sizeof(u32) * NumKeys;
+
+    // NOTE: Readbacks overwrite the staging buffers, so we copy the inputs in before every run
+    if (Keys64)
+    {
+        Copy(GlobalState.InputKeys64, GlobalState.StagingKeys64, sizeof(u64) * NumKeys);
+    }
+    else
+    {
+        Copy(GlobalState.InputKeys, GlobalState.StagingKeys, sizeof(u32) * NumKeys);
+    }
+    for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+    {
+        GlobalState.StagingPayload[KeyId] = KeyId;
+    }
+
+    VkCommandsBegin(Commands, RenderState->Device);
+
+    // NOTE: Upload
     {
-        u32 NumPasses = 20;
-        DemoState->SortArraySize = (u32)Pow(2.0f, (f32)NumPasses);
-            
+        VkBarrierBufferAdd(Commands, KeyBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkBarrierBufferAdd(Commands, GlobalState.PayloadBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        vkCmdCopyBuffer(Commands->Buffer, StagingKeyBuffer, KeyBuffer, 1, &KeyCopy);
+        vkCmdCopyBuffer(Commands->Buffer, GlobalState.StagingPayloadBuffer, GlobalState.PayloadBuffer, 1, &PayloadCopy);
+
+        VkBarrierBufferAdd(Commands, KeyBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkBarrierBufferAdd(Commands, GlobalState.PayloadBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        VkCommandsBarrierFlush(Commands);
+    }
+
+    // NOTE: The timestamps only cover the sort, the transfers around it aren't part of what the demo pays per frame. The start
+    // waits on the compute stage so the timer doesn't start before the upload barrier lets the sort run
+    vkCmdResetQueryPool(Commands->Buffer, GlobalState.TimestampPool, 0, 2);
+    vkCmdWriteTimestamp(Commands->Buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, GlobalState.TimestampPool, 0);
+    if (Keys64)
+    {
+        GpuSortKeys64(Commands, &GlobalState.Sort64, NumKeys, Backend);
+    }
+    else
+    {
+        GpuSortKeys(Commands, &GlobalState.Sort, NumKeys, Backend);
+    }
+    vkCmdWriteTimestamp(Commands->Buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, GlobalState.TimestampPool, 1);
+
+    // NOTE: Readback
+    {
+        VkBarrierBufferAdd(Commands, KeyBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkBarrierBufferAdd(Commands, GlobalState.PayloadBuffer,
+                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkCommandsBarrierFlush(Commands);
+
+        vkCmdCopyBuffer(Commands->Buffer, KeyBuffer, StagingKeyBuffer, 1, &KeyCopy);
+        vkCmdCopyBuffer(Commands->Buffer, GlobalState.PayloadBuffer, GlobalState.StagingPayloadBuffer, 1, &PayloadCopy);
+
+        VkBarrierBufferAdd(Commands, StagingKeyBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+        VkBarrierBufferAdd(Commands, GlobalState.StagingPayloadBuffer,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+        VkCommandsBarrierFlush(Commands);
+    }
+
+    VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
+    VkCommandsSubmit(Commands, RenderState->Device, RenderState->GraphicsQueue);
+    VkCheckResult(vkQueueWaitIdle(RenderState->GraphicsQueue));
+
+    u64 Timestamps[2] = {};
+    VkCheckResult(vkGetQueryPoolResults(RenderState->Device, GlobalState.TimestampPool, 0, 2, sizeof(Timestamps), Timestamps, sizeof(u64),
+                                        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+    f32 Result = f32(Timestamps[1] - Timestamps[0]) * GlobalState.TimestampPeriodNs / 1000000.0f;
+    return Result;
+}
+
+inline f32 SortBenchCpuRun(u32 CpuSort, u32 NumKeys, u64* Pairs)
+{
+    Copy(GlobalState.InputKeys, GlobalState.CpuKeys, sizeof(u32) * NumKeys);
+    for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+    {
+        GlobalState.CpuPayload[KeyId] = KeyId;
+    }
+
+    LARGE_INTEGER StartTime = {};
+    LARGE_INTEGER EndTime = {};
+    QueryPerformanceCounter(&StartTime);
+
+    switch (CpuSort)
+    {
+        case SortBenchCpu_StdSort:
         {
-#if 0
-            VkDeviceMemory GpuMemory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, sizeof(u32)*DemoState->SortArraySize);
-            DemoState->SortBuffer = VkBufferCreate(RenderState->Device, GpuMemory,
-                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                   sizeof(u32)*DemoState->SortArraySize);
-            VkCheckResult(vkMapMemory(RenderState->Device, GpuMemory, 0, sizeof(u32)*DemoState->SortArraySize, 0, (void**)&DemoState->SortBufferCpu));
-#endif
-
-#if 1
-            DemoState->SortBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                   sizeof(u32)*DemoState->SortArraySize);
-#endif
-                
-            DemoState->SortBuffer2 = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                    sizeof(u32)*DemoState->SortArraySize);
-
-            u32* GpuData = VkCommandsPushWriteArray(Commands, DemoState->SortBuffer2, u32, DemoState->SortArraySize,
-                                                    BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                    BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-
-            for (u32 ElementId = 0; ElementId < DemoState->SortArraySize; ++ElementId)
+            // NOTE: Pack the payload under the key so std::sort moves both, same work as sorting a key/value struct
+            for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
             {
-                GpuData[ElementId] = rand(); //DemoState->SortArraySize - ElementId - 1;
+                Pairs[KeyId] = (u64(GlobalState.CpuKeys[KeyId]) << 32) | u64(GlobalState.CpuPayload[KeyId]);
             }
-        }
 
-        // NOTE: Local Fd Descriptor
-        DemoState->SortLocalFdDescriptor = SortDescriptorCreate(Commands, 0, 0, 0);
+            std::sort(Pairs, Pairs + NumKeys);
 
-        // NOTE: Local Disperse Descriptor
-        DemoState->SortLocalDisperseDescriptor = SortDescriptorCreate(Commands, 0, 0, 0);
+            for (u32 KeyId = 0; KeyId < NumKeys; ++KeyId)
+            {
+                GlobalState.CpuKeys[KeyId] = u32(Pairs[KeyId] >> 32);
+                GlobalState.CpuPayload[KeyId] = u32(Pairs[KeyId]);
+            }
+        } break;
 
-        // NOTE: Global Flip Uniforms
-        for (u32 FlipSize = 2048, PassId = 11; FlipSize < DemoState->SortArraySize; PassId += 1, FlipSize = FlipSize * 2)
+        case SortBenchCpu_Radix:
         {
-            DemoState->SortGlobalFlipDescriptors[PassId - 11] = SortDescriptorCreate(Commands, FlipSize, PassId, 0);
-        }
-            
-        // NOTE: Global Disperse Uniforms
-        for (u32 FlipSize = 1024, PassId = 10; FlipSize < DemoState->SortArraySize / 2; PassId += 1, FlipSize = FlipSize * 2)
+            CpuRadixSort(NumKeys, GlobalState.CpuKeys, GlobalState.CpuPayload, GlobalState.CpuScratchKeys, GlobalState.CpuScratchPayload);
+        } break;
+
+        default:
         {
-            DemoState->SortGlobalDisperseDescriptors[PassId - 10] = SortDescriptorCreate(Commands, 0, PassId, FlipSize);
-        }
+            InvalidCodePath;
+        } break;
     }
 
-    // NOTE: Init Atomic Sort Data
+    QueryPerformanceCounter(&EndTime);
+
+    f32 Result = f32(EndTime.QuadPart - StartTime.QuadPart) * 1000.0f / f32(GlobalState.CounterFrequency);
+    return Result;
+}
+
+inline void SortBenchSweep(u64* Pairs)
+{
+    // NOTE: The atomic bitonic sort only waits on groups it found resident, so it doesn't hang without forward progress guarantees.
+    // On lavapipe, which runs groups one after the other, a single group ends up doing the whole sort. The small sizes of the sweep
+    // are where its single launch should beat the multi dispatch bitonic and FFX sorts
+    b32 GpuBackendEnabled[GpuSortBackend_Count] = {};
+    GpuBackendEnabled[GpuSortBackend_Bitonic] = true;
+    GpuBackendEnabled[GpuSortBackend_AtomicBitonic] = true;
+    GpuBackendEnabled[GpuSortBackend_Ffx] = true;
+    GpuBackendEnabled[GpuSortBackend_Onesweep] = true;
+
+    for (u32 Log2 = GlobalState.MinLog2; Log2 <= GlobalState.MaxLog2; ++Log2)
     {
+        u32 NumKeys = 1u << Log2;
+        for (u32 Distribution = 0; Distribution < SortBenchDist_Count; ++Distribution)
         {
-            DemoState->AtomicSortUniformBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                sizeof(atomic_sort_uniform_data));
-
-            atomic_sort_uniform_data* GpuData = VkCommandsPushWriteStruct(Commands, DemoState->AtomicSortUniformBuffer, atomic_sort_uniform_data,
-                                                                          BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                                          BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-            
-            GpuData->ArraySize = DemoState->SortArraySize;
-        }
+            SortBenchKeysGenerate(Distribution, NumKeys, GlobalState.InputKeys);
 
-        {
-            // NOTE: Calculate num elements
-            u32 NumElements = 1;
-            for (u32 FlipSize = 2048, PassId = 11; FlipSize < DemoState->SortArraySize; PassId += 1, FlipSize *= 2)
+            for (u32 Backend = 0; Backend < GpuSortBackend_Count; ++Backend)
             {
-                NumElements += 1;
-                
-                for (u32 N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
+                if (!GpuBackendEnabled[Backend] || GpuSortPickBackend(Backend, NumKeys, 0) != Backend)
                 {
-                    if (N < 1024)
-                    {
-                        NumElements += 1;
-                        break;
-                    }
-                    else
-                    {
-                        NumElements += 1;
-                    }
+                    continue;
                 }
-            }
 
-            DemoState->AtomicSortPassBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                             sizeof(atomic_pass_params) * NumElements);
+                f32 TotalTimeMs = 0.0f;
+                for (u32 RunId = 0; RunId < SORT_BENCH_NUM_WARMUP_RUNS + SORT_BENCH_NUM_RUNS; ++RunId)
+                {
+                    f32 TimeMs = SortBenchGpuRun(Backend, NumKeys, false);
+                    TotalTimeMs += RunId >= SORT_BENCH_NUM_WARMUP_RUNS ? TimeMs : 0.0f;
+                }
 
-            atomic_pass_params* GpuData = VkCommandsPushWriteArray(Commands, DemoState->AtomicSortPassBuffer, atomic_pass_params, NumElements,
-                                                                   BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                                   BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+                // NOTE: Staging holds the results of the last run
+                b32 Valid = SortBenchValidate(NumKeys, GlobalState.StagingKeys, GlobalState.StagingPayload, GpuSortBackendIsStable(Backend));
+                SortBenchResultWrite(SortBenchGpuName(Backend), Distribution, NumKeys, TotalTimeMs / f32(SORT_BENCH_NUM_RUNS), Valid);
+            }
 
-            // NOTE: Fill in array
-            NumElements = 0;
-            GpuData[NumElements++] = { PassType_LocalFd, 0, 0, 0 };
-                
-            for (u32 FlipSize = 2048, PassId = 11; FlipSize < DemoState->SortArraySize; PassId += 1, FlipSize *= 2)
+            if (NumKeys <= GlobalState.MaxNumKeys64)
             {
-                GpuData[NumElements++] = { PassType_GlobalFlip, FlipSize, PassId, 0 };
-                
-                for (u32 N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
+                SortBenchKeys64Generate(Distribution, NumKeys);
+
+                for (u32 Backend = 0; Backend < GpuSortBackend_Count; ++Backend)
                 {
-                    if (N < 1024)
+                    // NOTE: gpu_sort64 only takes stable backends
+                    if (!GpuBackendEnabled[Backend] || !GpuSortBackendIsStable(Backend) ||
+                        GpuSortPickBackend(Backend, NumKeys, GpuSortFlag_Stable) != Backend)
                     {
-                        GpuData[NumElements++] = { PassType_LocalDisperse, 0, NPassId, N };
-                        break;
+                        continue;
                     }
-                    else
+
+                    f32 TotalTimeMs = 0.0f;
+                    for (u32 RunId = 0; RunId < SORT_BENCH_NUM_WARMUP_RUNS + SORT_BENCH_NUM_RUNS; ++RunId)
                     {
-                        GpuData[NumElements++] = { PassType_GlobalDisperse, 0, NPassId, N };
+                        f32 TimeMs = SortBenchGpuRun(Backend, NumKeys, true);
+                        TotalTimeMs += RunId >= SORT_BENCH_NUM_WARMUP_RUNS ? TimeMs : 0.0f;
                     }
+
+                    b32 Valid = SortBenchValidate64(NumKeys, GlobalState.StagingKeys64, GlobalState.StagingPayload);
+                    SortBenchResultWrite(SortBenchGpu64Name(Backend), Distribution, NumKeys, TotalTimeMs / f32(SORT_BENCH_NUM_RUNS), Valid);
                 }
             }
-        }
 
-        DemoState->AtomicSortBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                     sizeof(atomic_sort_buffer_data));
-            
-        DemoState->AtomicSortDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, DemoState->AtomicSortDescLayout);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->AtomicSortDescriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, DemoState->AtomicSortUniformBuffer);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->AtomicSortDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->SortBuffer);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->AtomicSortDescriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->AtomicSortBuffer);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, DemoState->AtomicSortDescriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DemoState->AtomicSortPassBuffer);
+            for (u32 CpuSort = 0; CpuSort < SortBenchCpu_Count; ++CpuSort)
+            {
+                f32 TotalTimeMs = 0.0f;
+                for (u32 RunId = 0; RunId < SORT_BENCH_NUM_WARMUP_RUNS + SORT_BENCH_NUM_RUNS; ++RunId)
+                {
+                    f32 TimeMs = SortBenchCpuRun(CpuSort, NumKeys, Pairs);
+                    TotalTimeMs += RunId >= SORT_BENCH_NUM_WARMUP_RUNS ? TimeMs : 0.0f;
+                }
+
+                b32 Valid = SortBenchValidate(NumKeys, GlobalState.CpuKeys, GlobalState.CpuPayload, true);
+                SortBenchResultWrite(SortBenchCpuName(CpuSort), Distribution, NumKeys, TotalTimeMs / f32(SORT_BENCH_NUM_RUNS), Valid);
+            }
+        }
     }
 }
 
-inline void GpuBitonicMergeSort()
+int main(int argc, char** argv)
 {
-    // TODO: REMOVE THIS (check if our array is sorted)
-    // TODO: Write API to read back data from GPU
-#if 0
-    local_global b32 FirstFrame = true;
-    if (!FirstFrame)
+    // NOTE: Usage is sort_bench.exe [MinLog2] [MaxLog2], the big sizes need a lot of memory so CI runs can cap the sweep
+    GlobalState.MinLog2 = SORT_BENCH_MIN_LOG2;
+    GlobalState.MaxLog2 = SORT_BENCH_MAX_LOG2;
+    if (argc > 1)
     {
-        for (u32 ElementId = 0; ElementId < DemoState->SortArraySize - 1; ++ElementId)
-        {
-            Assert(DemoState->SortBufferCpu[ElementId] <= DemoState->SortBufferCpu[ElementId + 1]);
-        }
+        GlobalState.MinLog2 = u32(atoi(argv[1]));
     }
-    FirstFrame = false;
-#endif
+    if (argc > 2)
+    {
+        GlobalState.MaxLog2 = u32(atoi(argv[2]));
+    }
+    GlobalState.MaxLog2 = Min(GlobalState.MaxLog2, u32(SORT_BENCH_MAX_LOG2));
+    GlobalState.MinLog2 = Min(GlobalState.MinLog2, GlobalState.MaxLog2);
+    GlobalState.MaxNumKeys = 1u << GlobalState.MaxLog2;
+    GlobalState.MaxNumKeys64 = 1u << Min(GlobalState.MaxLog2, u32(SORT_BENCH_MAX_LOG2_64));
+
+    u32 MaxNumKeys = GlobalState.MaxNumKeys;
+    u32 MaxNumKeys64 = GlobalState.MaxNumKeys64;
 
-    // TODO: Test Big Sort
-#if 0
+    // NOTE: Init Memory
     {
-        VkBufferCopy BufferCopy = {};
-        BufferCopy.srcOffset = 0;
-        BufferCopy.dstOffset = 0;
-        BufferCopy.size = sizeof(u32) * DemoState->SortArraySize;
-        vkCmdCopyBuffer(Commands->Buffer, DemoState->SortBuffer2, DemoState->SortBuffer, 1, &BufferCopy);
-
-        VkBarrierBufferAdd(Commands, DemoState->SortBuffer,
-                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-        VkCommandsBarrierFlush(Commands);
+        // NOTE: gpu_sort keeps 2 CPU scratch arrays, we keep 5 more plus the std::sort pairs and the temp arena for inputs. We also
+        // keep the u64 inputs, and generating those pushes the low words above the morton inputs
+        u64 TempArenaSize = MegaBytes(16) + sizeof(f32) * 3 * u64(MaxNumKeys);
+        u64 ArenaSize = (MegaBytes(64) + TempArenaSize + sizeof(u32) * 7 * u64(MaxNumKeys) + sizeof(u64) * u64(MaxNumKeys) +
+                         sizeof(u64) * u64(MaxNumKeys64));
+        GlobalState.Arena = LinearArenaCreate(MemoryAllocate(ArenaSize), ArenaSize);
+        GlobalState.TempArena = LinearSubArena(&GlobalState.Arena, TempArenaSize);
+
+        RenderState = PushStruct(&GlobalState.Arena, render_state);
+        *RenderState = {};
+
+        GlobalState.InputKeys = PushArray(&GlobalState.Arena, u32, MaxNumKeys);
+        GlobalState.InputKeys64 = PushArray(&GlobalState.Arena, u64, MaxNumKeys64);
+        GlobalState.CpuKeys = PushArray(&GlobalState.Arena, u32, MaxNumKeys);
+        GlobalState.CpuPayload = PushArray(&GlobalState.Arena, u32, MaxNumKeys);
+        GlobalState.CpuScratchKeys = PushArray(&GlobalState.Arena, u32, MaxNumKeys);
+        GlobalState.CpuScratchPayload = PushArray(&GlobalState.Arena, u32, MaxNumKeys);
+    }
 
-#if 0
-        // NOTE: Local FD
-        {
-            u32 DispatchX = CeilU32(f32(DemoState->SortArraySize) / 2048.0f);
-                                
-            VkDescriptorSet DescriptorSets[] =
-                {
-                    DemoState->SortLocalFdDescriptor.Descriptor,
-                };
-            VkComputeDispatch(Commands, DemoState->SortLocalFdPipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, 1, 1);
-
-            VkBarrierBufferAdd(Commands, DemoState->SortBuffer,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-            VkCommandsBarrierFlush(Commands);
-        }
-            
-        // NOTE: General Pass
-        for (u32 FlipSize = 2048, PassId = 11; FlipSize < DemoState->SortArraySize; PassId += 1, FlipSize *= 2)
+    u64* Pairs = PushArray(&GlobalState.Arena, u64, MaxNumKeys);
+
+    // NOTE: Init Vulkan. The framework always makes a swap chain, so we give it a window that never gets shown
+    {
+        HINSTANCE hInstance = GetModuleHandleA(0);
+
+        WNDCLASSA WindowClass = {};
+        WindowClass.lpfnWndProc = DefWindowProcA;
+        WindowClass.hInstance = hInstance;
+        WindowClass.lpszClassName = "HugeGraphsSortBench";
+        RegisterClassA(&WindowClass);
+
+        HWND WindowHandle = CreateWindowExA(0, WindowClass.lpszClassName, "Huge Graphs Sort Bench", WS_OVERLAPPEDWINDOW,
+                                            CW_USEDEFAULT, CW_USEDEFAULT, 64, 64, 0, 0, hInstance, 0);
+        HMODULE VulkanLib = LoadLibraryA("vulkan-1.dll");
+        if (!WindowHandle || !VulkanLib)
         {
-            SortGlobalFlip(Commands, PassId);
-                
-            for (u32 N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
-            {
-                if (N < 1024)
-                {
-                    SortLocalDisperse(Commands);
-                    break;
-                }
-                else
-                {
-                    SortGlobalDisperse(Commands, NPassId);
-                }
-            }
+            printf("Failed to create a window or load vulkan-1.dll\n");
+            return 1;
         }
-            
-#else
-            
-        vkCmdFillBuffer(Commands->Buffer, DemoState->AtomicSortBuffer, 0, sizeof(atomic_sort_buffer_data), 0);
-
-        VkBarrierBufferAdd(Commands, DemoState->AtomicSortBuffer,
-                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                           VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT); //VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-        VkCommandsBarrierFlush(Commands);
 
-        u32 DispatchPerPass = CeilU32(f32(DemoState->SortArraySize) / 2048.0f);
-        u32 DispatchSize = DispatchPerPass;
+        // NOTE: Bound buffers, ping pong scratch and the onesweep tile histograms, plus slack for the small buffers. gpu_sort64 runs
+        // its word sorts on the 32 bit sort and only adds the u64 keys and their scratch
+        render_init_params InitParams = {};
+        InitParams.ValidationEnabled = false;
+        InitParams.WindowWidth = 64;
+        InitParams.WindowHeight = 64;
+        InitParams.GpuLocalSize = MegaBytes(64) + sizeof(u32) * 6 * u64(MaxNumKeys) + sizeof(u32) * 4 * u64(MaxNumKeys64);
+        VkInit(VulkanLib, hInstance, WindowHandle, &GlobalState.Arena, &GlobalState.TempArena, InitParams);
+    }
 
-        // NOTE: General Pass
-        for (u32 FlipSize = 2048, PassId = 11; FlipSize < DemoState->SortArraySize; PassId += 1, FlipSize *= 2)
-        {
-            DispatchSize += DispatchPerPass;
-                
-            for (u32 N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
-            {
-                if (N < 1024)
-                {
-                    DispatchSize += DispatchPerPass;
-                    break;
-                }
-                else
-                {
-                    DispatchSize += DispatchPerPass;
-                }
-            }
-        }
+    vk_commands* Commands = &RenderState->Commands;
+    VkCommandsBegin(Commands, RenderState->Device);
 
-        DispatchSize = 4*DispatchPerPass;
-            
-        u32 DispatchX = DispatchSize;
-        u32 DispatchY = 1;
-        if (DispatchSize > 16384)
-        {
-            DispatchX = 1024;
-            DispatchY = CeilU32(f32(DispatchSize) / 1024.0f);
-        }
+    // NOTE: Init Sort Data
+    {
+        u64 BufferSize = sizeof(u32) * u64(MaxNumKeys);
 
-        VkDescriptorSet DescriptorSets[] =
-            {
-                DemoState->AtomicSortDescriptor,
-            };
-            
-        VkComputeDispatch(Commands, DemoState->AtomicSortPipeline, DescriptorSets, ArrayCount(DescriptorSets), DispatchX, DispatchY, 1);
+        GlobalState.KeyBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                               BufferSize);
+        GlobalState.PayloadBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                   BufferSize);
+
+        VkDeviceMemory KeyMemory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, BufferSize);
+        GlobalState.StagingKeyBuffer = VkBufferCreate(RenderState->Device, KeyMemory, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, BufferSize);
+        VkCheckResult(vkMapMemory(RenderState->Device, KeyMemory, 0, BufferSize, 0, (void**)&GlobalState.StagingKeys));
 
-#endif
+        VkDeviceMemory PayloadMemory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, BufferSize);
+        GlobalState.StagingPayloadBuffer = VkBufferCreate(RenderState->Device, PayloadMemory, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, BufferSize);
+        VkCheckResult(vkMapMemory(RenderState->Device, PayloadMemory, 0, BufferSize, 0, (void**)&GlobalState.StagingPayload));
+
+        GlobalState.Sort = GpuSortCreate(&GlobalState.Arena, &GlobalState.TempArena, Commands, GlobalState.KeyBuffer, GlobalState.PayloadBuffer,
+                                         MaxNumKeys);
+
+        u64 Buffer64Size = sizeof(u64) * u64(MaxNumKeys64);
+        GlobalState.Key64Buffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                 Buffer64Size);
+
+        VkDeviceMemory Key64Memory = VkMemoryAllocate(RenderState->Device, RenderState->StagingMemoryId, Buffer64Size);
+        GlobalState.StagingKey64Buffer = VkBufferCreate(RenderState->Device, Key64Memory, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, Buffer64Size);
+        VkCheckResult(vkMapMemory(RenderState->Device, Key64Memory, 0, Buffer64Size, 0, (void**)&GlobalState.StagingKeys64));
+
+        // NOTE: Same setup as the morton sort of the demo, the word sort leaves the input index of every sorted key in PayloadBuffer
+        GlobalState.Sort64 = GpuSort64Create(&GlobalState.TempArena, GlobalState.Key64Buffer, VK_NULL_HANDLE, &GlobalState.Sort, MaxNumKeys64);
+    }
+
+    // NOTE: Init Timers
+    {
+        VkQueryPoolCreateInfo QueryPoolInfo = {};
+        QueryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        QueryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        QueryPoolInfo.queryCount = 2;
+        VkCheckResult(vkCreateQueryPool(RenderState->Device, &QueryPoolInfo, 0, &GlobalState.TimestampPool));
+        GlobalState.TimestampPeriodNs = RenderState->DeviceLimits.timestampPeriod;
+
+        LARGE_INTEGER Frequency = {};
+        QueryPerformanceFrequency(&Frequency);
+        GlobalState.CounterFrequency = Frequency.QuadPart;
     }
-#endif
 
+    VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
+    VkCommandsSubmit(Commands, RenderState->Device, RenderState->GraphicsQueue);
+    VkCheckResult(vkQueueWaitIdle(RenderState->GraphicsQueue));
+
+    GlobalState.CsvFile = fopen("sort_bench.csv", "wb");
+    if (!GlobalState.CsvFile)
+    {
+        printf("Failed to open sort_bench.csv\n");
+        return 1;
+    }
+    fprintf(GlobalState.CsvFile, "Sort,Distribution,NumKeys,TimeMs,KeysPerSecond,Valid\n");
+
+    SortBenchSweep(Pairs);
+
+    fclose(GlobalState.CsvFile);
+
+    return 0;
 }
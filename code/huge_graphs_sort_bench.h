@@ -1,28 +1,80 @@
 #pragma once
 
-struct sort_globals
+#define VALIDATION 1
+
+#include "framework_vulkan\framework_vulkan.h"
+#include "huge_graphs_sort.h"
+
+/*
+  NOTE: Command line sort benchmark. Sweeps the key count over powers of 2 and a set of key distributions, times every GPU backend
+        with timestamp queries and the CPU sorts with the performance counter, checks every result and writes keys/s to a csv. Any
+        Vulkan device works, lavapipe included, so this runs on machines without a GPU. It still needs a desktop session, VkInit
+        always creates a surface and a swap chain so we make a hidden window for it.
+
+        The stable GPU backends also run through gpu_sort64 on u64 keys, whose high word is the key of the distribution and whose
+        low word is a second draw of it. gpu_sort64 needs about twice the memory per key, so its sweep stops at
+        SORT_BENCH_MAX_LOG2_64.
+ */
+
+#define SortBenchDist_Uniform 0
+#define SortBenchDist_Sorted 1
+#define SortBenchDist_Reverse 2
+#define SortBenchDist_NearlySortedMorton 3
+#define SortBenchDist_Duplicates 4
+#define SortBenchDist_Count 5
+
+#define SortBenchCpu_StdSort 0
+#define SortBenchCpu_Radix 1
+#define SortBenchCpu_Count 2
+
+#define SORT_BENCH_MIN_LOG2 10
+#define SORT_BENCH_MAX_LOG2 28
+#define SORT_BENCH_MAX_LOG2_64 24
+#define SORT_BENCH_NUM_WARMUP_RUNS 1
+#define SORT_BENCH_NUM_RUNS 5
+// NOTE: Only 16 distinct values so every radix pass and bitonic compare sees long runs of equal keys
+#define SORT_BENCH_NUM_DUPLICATE_VALUES 16
+// NOTE: How far points move between frames for the nearly sorted morton keys, relative to the unit square
+#define SORT_BENCH_MORTON_JITTER 0.001f
+
+struct sort_bench_state
 {
-    // NOTE: Sort Data
-    u32 SortArraySize;
-    VkDescriptorSetLayout SortDescLayout;
-    sort_descriptor SortLocalFdDescriptor;
-    sort_descriptor SortLocalDisperseDescriptor;
-    sort_descriptor SortGlobalFlipDescriptors[10];
-    sort_descriptor SortGlobalDisperseDescriptors[10];
-    VkBuffer SortBuffer;
-    VkBuffer SortBuffer2;
-    u32* SortBufferCpu;
-
-    vk_pipeline* SortLocalFdPipeline;
-    vk_pipeline* SortGlobalFlipPipeline;
-    vk_pipeline* SortLocalDispersePipeline;
-    vk_pipeline* SortGlobalDispersePipeline;
-
-    // NOTE: Atomic Sort Data
-    VkBuffer AtomicSortUniformBuffer;
-    VkBuffer AtomicSortBuffer;
-    VkBuffer AtomicSortPassBuffer;
-    VkDescriptorSet AtomicSortDescriptor;
-    VkDescriptorSetLayout AtomicSortDescLayout;
-    vk_pipeline* AtomicSortPipeline;
+    linear_arena Arena;
+    linear_arena TempArena;
+
+    u32 MaxNumKeys;
+    u32 MinLog2;
+    u32 MaxLog2;
+    u32 MaxNumKeys64;
+    gpu_sort Sort;
+    gpu_sort64 Sort64;
+
+    // NOTE: The sorted buffers, and staging we upload inputs from and read results back through
+    VkBuffer KeyBuffer;
+    VkBuffer PayloadBuffer;
+    VkBuffer StagingKeyBuffer;
+    VkBuffer StagingPayloadBuffer;
+    u32* StagingKeys;
+    u32* StagingPayload;
+
+    // NOTE: The u64 keys of gpu_sort64, its word sort is the 32 bit sort so the sorted indices come back in its payload buffer
+    VkBuffer Key64Buffer;
+    VkBuffer StagingKey64Buffer;
+    u64* StagingKeys64;
+
+    // NOTE: Inputs of the current run, and CPU copies the CPU sorts run on
+    u32* InputKeys;
+    u64* InputKeys64;
+    u32* CpuKeys;
+    u32* CpuPayload;
+    u32* CpuScratchKeys;
+    u32* CpuScratchPayload;
+
+    VkQueryPool TimestampPool;
+    f32 TimestampPeriodNs;
+    u64 CounterFrequency;
+
+    FILE* CsvFile;
 };
+
+global sort_bench_state GlobalState;
@@ -2,6 +2,16 @@
 #define FFX_HLSL
 #define kRS_ValueCopy 1
 #include "FFX_ParallelSort.h"
+#include "parallel_sort_shaders.h"
+
+#define ONESWEEP_KERNEL (ONESWEEP_GLOBAL_HISTOGRAM || ONESWEEP_GLOBAL_SCAN || ONESWEEP_DIGIT_PASS || ONESWEEP_COPY)
+
+[[vk::binding(0, 1)]] RWStructuredBuffer<uint>  SrcBuffer       : register(u0, space0);                 // The unsorted keys or scan data
+[[vk::binding(1, 1)]] RWStructuredBuffer<uint>  DstBuffer       : register(u0, space1);                 // The sorted keys or prefixed data
+[[vk::binding(2, 1)]] RWStructuredBuffer<uint>  SrcPayload      : register(u0, space2);                 // The payload data
+[[vk::binding(3, 1)]] RWStructuredBuffer<uint>  DstPayload      : register(u0, space3);                 // the sorted payload data
+
+#if !ONESWEEP_KERNEL
 
 struct RootConstantData {
     uint CShiftBit;
@@ -11,11 +21,6 @@ struct RootConstantData {
 
 [[vk::binding(0, 0)]] ConstantBuffer<FFX_ParallelSortCB>    CBuffer     : register(b0);                 // Constant buffer
 
-[[vk::binding(0, 1)]] RWStructuredBuffer<uint>  SrcBuffer       : register(u0, space0);                 // The unsorted keys or scan data
-[[vk::binding(1, 1)]] RWStructuredBuffer<uint>  DstBuffer       : register(u0, space1);                 // The sorted keys or prefixed data
-[[vk::binding(2, 1)]] RWStructuredBuffer<uint>  SrcPayload      : register(u0, space2);                 // The payload data
-[[vk::binding(3, 1)]] RWStructuredBuffer<uint>  DstPayload      : register(u0, space3);                 // the sorted payload data
-
 [[vk::binding(0, 2)]] RWStructuredBuffer<uint>  ScanSrc         : register(u0, space4);                 // Source for Scan Data
 [[vk::binding(1, 2)]] RWStructuredBuffer<uint>  ScanDst         : register(u0, space5);                 // Destination for Scan Data
 [[vk::binding(2, 2)]] RWStructuredBuffer<uint>  ScanScratch     : register(u0, space6);                 // Scratch data for Scan
@@ -23,6 +28,8 @@ struct RootConstantData {
 [[vk::binding(0, 3)]] RWStructuredBuffer<uint>  SumTable        : register(u0, space7);                 // The sum table we will write sums to
 [[vk::binding(1, 3)]] RWStructuredBuffer<uint>  ReduceTable     : register(u0, space8);                 // The reduced sum table we will write sums to
 
+#endif
+
 //=========================================================================================================================================
 // NOTE: Parallel Sort Count
 //=========================================================================================================================================
@@ -132,3 +139,382 @@ void main(uint localID : SV_GroupThreadID, uint2 InGroupID : SV_GroupID)
 }
 
 #endif
+
+//=========================================================================================================================================
+// NOTE: Onesweep Helpers
+//=========================================================================================================================================
+
+/*
+  NOTE: Onesweep replaces the 5 dispatches per 4 bit pass above with one histogram of all 4 digits up front, one scan of those
+        histograms, and then a single dispatch per 8 bit pass. Each tile of a pass ranks its keys locally and gets its global offset
+        by chaining off the tiles before it (decoupled look back), so we never do a device wide scan in between passes.
+
+        A pass whose digit is the same for every key (one histogram bin holds all the keys) doesn't change the order, so the scan
+        gives it zero groups in its indirect dispatch. Skipping passes breaks the fixed ping pong between the key buffers, so the scan
+        also records which buffer every pass reads from, and an extra copy pass moves the keys back if we end up in the wrong one.
+ */
+
+#if ONESWEEP_KERNEL
+
+struct OnesweepConstantData
+{
+    uint NumKeys;
+    uint NumTiles;
+    uint Shift;
+    uint DispatchX;
+    uint DispatchY;
+};
+
+[[vk::push_constant]] OnesweepConstantData OnesweepConstants;
+
+[[vk::binding(0, 0)]] RWStructuredBuffer<uint>                  GlobalHistogram : register(u0, space9);     // The digit counts for every pass
+[[vk::binding(1, 0)]] globallycoherent RWStructuredBuffer<uint> PassHistogram   : register(u0, space10);    // Look back values, (NumTiles + 1) x Radix per pass
+[[vk::binding(2, 0)]] RWStructuredBuffer<uint>                  TileCounter     : register(u0, space11);    // The next tile id for every pass
+[[vk::binding(3, 0)]] RWStructuredBuffer<uint>                  PassArgs        : register(u0, space12);    // Dispatch args + input buffer for every pass and the copy
+
+uint OnesweepPassInput(uint PassId)
+{
+    return PassArgs[PassId * ONESWEEP_PASS_ARGS_STRIDE + 3];
+}
+
+#endif
+
+#if ONESWEEP_GLOBAL_SCAN || ONESWEEP_DIGIT_PASS
+
+groupshared uint OnesweepScanData[ONESWEEP_THREADGROUP_SIZE];
+
+// NOTE: Exclusive scan across the thread group, every thread has to call this
+uint OnesweepBlockExclusiveScan(uint ThreadId, uint Value, out uint Total)
+{
+    OnesweepScanData[ThreadId] = Value;
+    GroupMemoryBarrierWithGroupSync();
+    
+    for (uint Offset = 1; Offset < ONESWEEP_THREADGROUP_SIZE; Offset <<= 1)
+    {
+        uint Add = ThreadId >= Offset ? OnesweepScanData[ThreadId - Offset] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        OnesweepScanData[ThreadId] += Add;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint Inclusive = OnesweepScanData[ThreadId];
+    Total = OnesweepScanData[ONESWEEP_THREADGROUP_SIZE - 1];
+    GroupMemoryBarrierWithGroupSync();
+
+    return Inclusive - Value;
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Onesweep Global Histogram
+//=========================================================================================================================================
+
+#if ONESWEEP_GLOBAL_HISTOGRAM
+
+groupshared uint LocalHistogram[ONESWEEP_NUM_PASSES * ONESWEEP_RADIX];
+
+[numthreads(ONESWEEP_THREADGROUP_SIZE, 1, 1)]
+void main(uint ThreadId : SV_GroupThreadID, uint2 InGroupID : SV_GroupID)
+{
+    uint TileId = InGroupID.y * 64 + InGroupID.x;
+    if (TileId >= OnesweepConstants.NumTiles)
+    {
+        return;
+    }
+
+    for (uint ClearId = ThreadId; ClearId < ONESWEEP_NUM_PASSES * ONESWEEP_RADIX; ClearId += ONESWEEP_THREADGROUP_SIZE)
+    {
+        LocalHistogram[ClearId] = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // NOTE: We read the keys once and count the digits of all passes at the same time
+    uint TileStart = TileId * ONESWEEP_TILE_SIZE;
+    for (uint KeyId = 0; KeyId < ONESWEEP_KEYS_PER_THREAD; ++KeyId)
+    {
+        uint Index = TileStart + KeyId * ONESWEEP_THREADGROUP_SIZE + ThreadId;
+        if (Index < OnesweepConstants.NumKeys)
+        {
+            uint Key = SrcBuffer[Index];
+
+            [unroll]
+            for (uint PassId = 0; PassId < ONESWEEP_NUM_PASSES; ++PassId)
+            {
+                uint Digit = (Key >> (PassId * ONESWEEP_RADIX_BITS)) & ONESWEEP_RADIX_MASK;
+                InterlockedAdd(LocalHistogram[PassId * ONESWEEP_RADIX + Digit], 1);
+            }
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint BinId = ThreadId; BinId < ONESWEEP_NUM_PASSES * ONESWEEP_RADIX; BinId += ONESWEEP_THREADGROUP_SIZE)
+    {
+        uint Count = LocalHistogram[BinId];
+        if (Count > 0)
+        {
+            InterlockedAdd(GlobalHistogram[BinId], Count);
+        }
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Onesweep Global Scan
+//=========================================================================================================================================
+
+#if ONESWEEP_GLOBAL_SCAN
+
+groupshared uint PassIsConstant;
+
+// NOTE: One thread per digit, we loop over the passes so we can track which key buffer every pass reads from
+[numthreads(ONESWEEP_THREADGROUP_SIZE, 1, 1)]
+void main(uint ThreadId : SV_GroupThreadID)
+{
+    uint InputSet = 0;
+    for (uint PassId = 0; PassId < ONESWEEP_NUM_PASSES; ++PassId)
+    {
+        if (ThreadId == 0)
+        {
+            PassIsConstant = 0;
+        }
+        
+        uint Count = GlobalHistogram[PassId * ONESWEEP_RADIX + ThreadId];
+        uint Total = 0;
+        uint Prefix = OnesweepBlockExclusiveScan(ThreadId, Count, Total);
+
+        // NOTE: Slot 0 of every pass holds the global digit offsets as inclusive values, so every look back ends there
+        uint PassBase = PassId * (OnesweepConstants.NumTiles + 1) * ONESWEEP_RADIX;
+        PassHistogram[PassBase + ThreadId] = (Prefix << ONESWEEP_FLAG_BITS) | ONESWEEP_FLAG_INCLUSIVE;
+
+        // NOTE: At most one digit can hold every key
+        if (Count == OnesweepConstants.NumKeys)
+        {
+            PassIsConstant = 1;
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        bool Active = PassIsConstant == 0;
+        if (ThreadId == 0)
+        {
+            uint ArgsBase = PassId * ONESWEEP_PASS_ARGS_STRIDE;
+            PassArgs[ArgsBase + 0] = Active ? OnesweepConstants.DispatchX : 0;
+            PassArgs[ArgsBase + 1] = OnesweepConstants.DispatchY;
+            PassArgs[ArgsBase + 2] = 1;
+            PassArgs[ArgsBase + 3] = InputSet;
+        }
+        InputSet = Active ? InputSet ^ 1 : InputSet;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    // NOTE: Copy the keys back into the source buffers if we did an odd number of passes
+    if (ThreadId == 0)
+    {
+        uint ArgsBase = ONESWEEP_NUM_PASSES * ONESWEEP_PASS_ARGS_STRIDE;
+        PassArgs[ArgsBase + 0] = InputSet ? OnesweepConstants.DispatchX : 0;
+        PassArgs[ArgsBase + 1] = OnesweepConstants.DispatchY;
+        PassArgs[ArgsBase + 2] = 1;
+        PassArgs[ArgsBase + 3] = InputSet;
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Onesweep Digit Pass
+//=========================================================================================================================================
+
+#if ONESWEEP_DIGIT_PASS
+
+groupshared uint TileIdShared;
+groupshared uint TileKeys[ONESWEEP_TILE_SIZE];
+groupshared uint TilePayload[ONESWEEP_TILE_SIZE];
+groupshared uint DigitCount[ONESWEEP_RADIX];
+groupshared uint DigitGlobalOffset[ONESWEEP_RADIX];
+
+uint OnesweepDigit(uint Key)
+{
+    return (Key >> OnesweepConstants.Shift) & ONESWEEP_RADIX_MASK;
+}
+
+// NOTE: Requires ONESWEEP_RADIX == ONESWEEP_THREADGROUP_SIZE since every thread owns one digit during the look back
+[numthreads(ONESWEEP_THREADGROUP_SIZE, 1, 1)]
+void main(uint ThreadId : SV_GroupThreadID)
+{
+    uint PassId = OnesweepConstants.Shift / ONESWEEP_RADIX_BITS;
+    
+    // NOTE: Tiles are handed out in the order groups start running, so we never spin on a tile that hasn't been scheduled yet
+    if (ThreadId == 0)
+    {
+        InterlockedAdd(TileCounter[PassId], 1, TileIdShared);
+    }
+    DigitCount[ThreadId] = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint TileId = TileIdShared;
+    if (TileId >= OnesweepConstants.NumTiles)
+    {
+        return;
+    }
+
+    uint TileStart = TileId * ONESWEEP_TILE_SIZE;
+    uint TileCount = min(ONESWEEP_TILE_SIZE, OnesweepConstants.NumKeys - TileStart);
+    uint InputSet = OnesweepPassInput(PassId);
+    
+    // NOTE: Load the tile, keys past the end get the max value so they sort to the end of the tile
+    for (uint LoadId = 0; LoadId < ONESWEEP_KEYS_PER_THREAD; ++LoadId)
+    {
+        uint LocalIndex = LoadId * ONESWEEP_THREADGROUP_SIZE + ThreadId;
+        uint Index = TileStart + LocalIndex;
+        bool InRange = LocalIndex < TileCount;
+        TileKeys[LocalIndex] = InRange ? (InputSet ? DstBuffer[Index] : SrcBuffer[Index]) : 0xFFFFFFFF;
+        TilePayload[LocalIndex] = InRange ? (InputSet ? DstPayload[Index] : SrcPayload[Index]) : 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    uint Keys[ONESWEEP_KEYS_PER_THREAD];
+    uint Payload[ONESWEEP_KEYS_PER_THREAD];
+    [unroll]
+    for (uint RegId = 0; RegId < ONESWEEP_KEYS_PER_THREAD; ++RegId)
+    {
+        Keys[RegId] = TileKeys[ThreadId * ONESWEEP_KEYS_PER_THREAD + RegId];
+        Payload[RegId] = TilePayload[ThreadId * ONESWEEP_KEYS_PER_THREAD + RegId];
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // NOTE: Rank the tile locally by splitting on one bit at a time. Each split is stable so equal digits keep their input order
+    for (uint BitId = 0; BitId < ONESWEEP_RADIX_BITS; ++BitId)
+    {
+        uint Bit = OnesweepConstants.Shift + BitId;
+        uint NumZeros = 0;
+
+        [unroll]
+        for (uint CountId = 0; CountId < ONESWEEP_KEYS_PER_THREAD; ++CountId)
+        {
+            NumZeros += ((Keys[CountId] >> Bit) & 1) ^ 1;
+        }
+
+        uint TotalZeros = 0;
+        uint ZerosBefore = OnesweepBlockExclusiveScan(ThreadId, NumZeros, TotalZeros);
+
+        [unroll]
+        for (uint SplitId = 0; SplitId < ONESWEEP_KEYS_PER_THREAD; ++SplitId)
+        {
+            uint LocalIndex = ThreadId * ONESWEEP_KEYS_PER_THREAD + SplitId;
+            uint DstIndex = 0;
+            if (((Keys[SplitId] >> Bit) & 1) == 0)
+            {
+                DstIndex = ZerosBefore;
+                ZerosBefore += 1;
+            }
+            else
+            {
+                DstIndex = TotalZeros + LocalIndex - ZerosBefore;
+            }
+            
+            TileKeys[DstIndex] = Keys[SplitId];
+            TilePayload[DstIndex] = Payload[SplitId];
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        [unroll]
+        for (uint ReloadId = 0; ReloadId < ONESWEEP_KEYS_PER_THREAD; ++ReloadId)
+        {
+            Keys[ReloadId] = TileKeys[ThreadId * ONESWEEP_KEYS_PER_THREAD + ReloadId];
+            Payload[ReloadId] = TilePayload[ThreadId * ONESWEEP_KEYS_PER_THREAD + ReloadId];
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    // NOTE: The tile is now sorted on the digit, so the local offset of a digit is the scan of the digit counts
+    [unroll]
+    for (uint HistId = 0; HistId < ONESWEEP_KEYS_PER_THREAD; ++HistId)
+    {
+        if (ThreadId * ONESWEEP_KEYS_PER_THREAD + HistId < TileCount)
+        {
+            InterlockedAdd(DigitCount[OnesweepDigit(Keys[HistId])], 1);
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    uint Digit = ThreadId;
+    uint Count = DigitCount[Digit];
+    uint TotalCount = 0;
+    uint LocalOffset = OnesweepBlockExclusiveScan(ThreadId, Count, TotalCount);
+
+    // NOTE: Publish our count first so later tiles can keep looking back while we wait on our own prefix
+    uint PassBase = PassId * (OnesweepConstants.NumTiles + 1) * ONESWEEP_RADIX;
+    uint TileSlot = PassBase + (TileId + 1) * ONESWEEP_RADIX + Digit;
+    InterlockedAdd(PassHistogram[TileSlot], (Count << ONESWEEP_FLAG_BITS) | ONESWEEP_FLAG_AGGREGATE);
+
+    uint Prefix = 0;
+    uint LookBackSlot = TileId;
+    while (true)
+    {
+        uint Value = PassHistogram[PassBase + LookBackSlot * ONESWEEP_RADIX + Digit];
+        uint Flag = Value & ONESWEEP_FLAG_MASK;
+        if (Flag != ONESWEEP_FLAG_NOT_READY)
+        {
+            Prefix += Value >> ONESWEEP_FLAG_BITS;
+            if (Flag == ONESWEEP_FLAG_INCLUSIVE)
+            {
+                break;
+            }
+            LookBackSlot -= 1;
+        }
+    }
+
+    // NOTE: Adding a second aggregate flag turns our entry into an inclusive one
+    InterlockedAdd(PassHistogram[TileSlot], (Prefix << ONESWEEP_FLAG_BITS) | ONESWEEP_FLAG_AGGREGATE);
+    DigitGlobalOffset[Digit] = Prefix - LocalOffset;
+    GroupMemoryBarrierWithGroupSync();
+
+    // NOTE: Neighbouring threads write neighbouring sorted keys so writes within a digit coalesce
+    for (uint StoreId = 0; StoreId < ONESWEEP_KEYS_PER_THREAD; ++StoreId)
+    {
+        uint LocalIndex = StoreId * ONESWEEP_THREADGROUP_SIZE + ThreadId;
+        if (LocalIndex < TileCount)
+        {
+            uint Key = TileKeys[LocalIndex];
+            uint DstIndex = DigitGlobalOffset[OnesweepDigit(Key)] + LocalIndex;
+            if (InputSet)
+            {
+                SrcBuffer[DstIndex] = Key;
+                SrcPayload[DstIndex] = TilePayload[LocalIndex];
+            }
+            else
+            {
+                DstBuffer[DstIndex] = Key;
+                DstPayload[DstIndex] = TilePayload[LocalIndex];
+            }
+        }
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Onesweep Copy
+//=========================================================================================================================================
+
+#if ONESWEEP_COPY
+
+// NOTE: Only gets groups when an odd number of passes ran, moves the sorted keys from the ping pong buffers back into the source ones
+[numthreads(ONESWEEP_THREADGROUP_SIZE, 1, 1)]
+void main(uint ThreadId : SV_GroupThreadID, uint2 InGroupID : SV_GroupID)
+{
+    uint TileId = InGroupID.y * 64 + InGroupID.x;
+    uint TileStart = TileId * ONESWEEP_TILE_SIZE;
+    for (uint KeyId = 0; KeyId < ONESWEEP_KEYS_PER_THREAD; ++KeyId)
+    {
+        uint Index = TileStart + KeyId * ONESWEEP_THREADGROUP_SIZE + ThreadId;
+        if (Index < OnesweepConstants.NumKeys)
+        {
+            SrcBuffer[Index] = DstBuffer[Index];
+            SrcPayload[Index] = DstPayload[Index];
+        }
+    }
+}
+
+#endif
@@ -1,4 +1,27 @@
 #if !defined(PARALLEL_SORT_SHADERS_H)
 
+/*
+  NOTE: Onesweep sorts 32 bit keys with 8 bit digits, so 4 passes in total. Every pass splits the keys into tiles and each tile gets
+        its global offsets by looking back at the tiles before it. Look back values store a 2 bit flag in the low bits, so we can
+        sort at most 2^30 keys. These have to match the defines in huge_graphs_sort.h.
+ */
+#define ONESWEEP_RADIX_BITS 8
+#define ONESWEEP_RADIX (1 << ONESWEEP_RADIX_BITS)
+#define ONESWEEP_RADIX_MASK (ONESWEEP_RADIX - 1)
+#define ONESWEEP_NUM_PASSES (32 / ONESWEEP_RADIX_BITS)
+#define ONESWEEP_THREADGROUP_SIZE 256
+#define ONESWEEP_KEYS_PER_THREAD 8
+#define ONESWEEP_TILE_SIZE (ONESWEEP_THREADGROUP_SIZE * ONESWEEP_KEYS_PER_THREAD)
+
+// NOTE: Every pass and the final copy get a VkDispatchIndirectCommand followed by the key buffer they read from
+#define ONESWEEP_PASS_ARGS_STRIDE 4
+#define ONESWEEP_NUM_PASS_ARGS (ONESWEEP_NUM_PASSES + 1)
+
+#define ONESWEEP_FLAG_NOT_READY 0
+#define ONESWEEP_FLAG_AGGREGATE 1
+#define ONESWEEP_FLAG_INCLUSIVE 2
+#define ONESWEEP_FLAG_MASK 3
+#define ONESWEEP_FLAG_BITS 2
+
 #define PARALLEL_SORT_SHADERS_H
 #endif
@@ -2,6 +2,7 @@
 
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_GOOGLE_include_directive : enable
+#extension GL_KHR_shader_subgroup_basic : enable
 #extension GL_KHR_shader_subgroup_arithmetic : enable
 #extension GL_KHR_shader_subgroup_vote : enable
 
@@ -16,10 +17,15 @@ RADIX_DESCRIPTOR_LAYOUT(0)
 GRAPH_DESCRIPTOR_LAYOUT(1)
 
 //=========================================================================================================================================
-// NOTE: Generate Morton Keys Pipeline
+// NOTE: Morton Keys
 //=========================================================================================================================================
 
-#if GENERATE_MORTON_KEYS
+/*
+  NOTE: Morton keys are 64 bits, 32 bits per axis, stored as a uvec2(LowWord, HighWord) which is the layout of a u64 on the host. The
+        high word interleaves the top 16 bits of each axis and the low word interleaves the bottom 16 bits, so comparing
+        (HighWord, LowWord) lexicographically is the same as comparing the 64 bit key. The stable sort path orders the full keys with
+        gpu_sort64, which leaves the sorted element indices in ElementReMapping. The unstable path only sorts the high words.
+ */
 
 uint Morton2dExpandBits(uint Value)
 {
@@ -33,18 +39,37 @@ uint Morton2dExpandBits(uint Value)
     return Result;
 }
 
-uint Morton2d(vec2 Pos)
+uvec2 Morton2d(vec2 Pos)
 {
-    vec2 NormalizedPos = (Pos - ElementBounds.Min) / (ElementBounds.Max - ElementBounds.Min);
-
-    // NOTE: Each axis gets 16 bits so we convert x/y into fixed point
-    float BitRange = pow(2, 16);
-    vec2 FixedPointPos = min(max(NormalizedPos * BitRange, 0.0f), BitRange - 1);
-
-    uint Result = 2 * Morton2dExpandBits(uint(FixedPointPos.x)) + Morton2dExpandBits(uint(FixedPointPos.y));
+    /*
+      NOTE: Each axis gets 32 bits of fixed point relative to the bounds min. Scaling the normalized position by 2^32 would need more
+            than the 24 bits of a float, so we take the top 16 bits from the position relative to the min and the bottom 16 bits from
+            what is left of it inside its top level cell. CellSize is the extent times a power of 2 so it is exact, and fma gets the
+            remainder with a single rounding, so the key keeps every bit the relative position has. That is all 32 bits next to the
+            min corner, but a float relative position only carries 24 bits, so nodes out near the max corner resolve to about 24 bits
+            per axis and the index tie breaker orders whatever is left.
+     */
+    vec2 Extent = max(ElementBounds.Max - ElementBounds.Min, vec2(1e-20f));
+    vec2 CellSize = Extent / 65536.0f;
+    vec2 RelativePos = max(Pos - ElementBounds.Min, vec2(0.0f));
+    uvec2 HighBits = uvec2(min(RelativePos / CellSize, vec2(65535.0f)));
+
+    // NOTE: Rounding can put us right below our cell or at its top, so we clamp the remainder into the cell
+    vec2 Remainder = fma(-vec2(HighBits), CellSize, RelativePos);
+    uvec2 LowBits = uvec2(clamp(Remainder / CellSize * 65536.0f, vec2(0.0f), vec2(65535.0f)));
+
+    uvec2 Result;
+    Result.x = 2 * Morton2dExpandBits(LowBits.x) + Morton2dExpandBits(LowBits.y);
+    Result.y = 2 * Morton2dExpandBits(HighBits.x) + Morton2dExpandBits(HighBits.y);
     return Result;
 }
 
+//=========================================================================================================================================
+// NOTE: Generate Morton Keys Pipeline
+//=========================================================================================================================================
+
+#if GENERATE_MORTON_KEYS
+
 layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
@@ -53,7 +78,10 @@ void main()
 
     if (GlobalThreadId < RadixTreeUniforms.NumNodes)
     {
-        MortonKeys[GlobalThreadId] = Morton2d(NodePositionArray[GlobalThreadId]);
+        // NOTE: The stable path sorts the full keys, the unstable path only sorts the high words
+        uvec2 Key = Morton2d(NodeLoadPos(GlobalThreadId));
+        SortedMortonKeys[GlobalThreadId] = Key;
+        MortonKeys[GlobalThreadId] = Key.y;
         ElementReMapping[GlobalThreadId] = GlobalThreadId;
     }
 }
@@ -61,132 +89,450 @@ void main()
 #endif
 
 //=========================================================================================================================================
-// NOTE: Calc World Bounds Pipeline
+// NOTE: Gather Morton Keys Pipeline
 //=========================================================================================================================================
 
-#if CALC_WORLD_BOUNDS
+#if MORTON_KEYS_GATHER
+
+layout(push_constant) uniform push_constants
+{
+    uint GatherType;
+} PushConstants;
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint GlobalThreadId = WorkGroupId * 32 + gl_LocalInvocationIndex;
+
+    if (GlobalThreadId < RadixTreeUniforms.NumNodes)
+    {
+        uvec2 Key = Morton2d(NodeLoadPos(ElementReMapping[GlobalThreadId]));
+        switch (PushConstants.GatherType)
+        {
+            case MortonGatherType_FullKey:
+            {
+                SortedMortonKeys[GlobalThreadId] = Key;
+            } break;
+
+            case MortonGatherType_HighKey:
+            {
+                // NOTE: Only the high word got sorted (unstable sort path) so we drop the low word to keep the keys in sorted order
+                SortedMortonKeys[GlobalThreadId] = uvec2(0, Key.y);
+            } break;
+        }
+    }
+}
 
-shared uint WorkCounterId;
-shared uint PassId;
-shared uint DoneCounterToWaitOn;
-shared uint NumGroupsInPrevPass;
-shared uint NumGroupsInPrevPrevPass;
-shared uint NumThreadsInGroup;
+#endif
+
+//=========================================================================================================================================
+// NOTE: Coherent Morton Sort
+//=========================================================================================================================================
 
-// TODO: Port math lib to shader code as well?
-uint CeilU32(float Val)
+/*
+  NOTE: Nodes barely move between iterations so last sort's ElementReMapping is almost sorted. The coherent path gathers the full keys in
+        that order and fixes them up instead of sorting from scratch. MORTON_LOCAL_SORT bitonic sorts every block of 2048 keys in shared
+        memory, and then runs again over blocks shifted by half a block where it only has to merge 2 sorted halves. That fixes any node
+        that moved less than half a block. MORTON_CHECK counts what is still out of order, which the CPU reads back to decide when to
+        fall back to a full sort. If anything is, MORTON_CLAMP raises every key to the max key in front of it so the tree build still
+        sees sorted keys, the boxes come from the node positions so the few nodes that land in the wrong leaf only loosen the tree.
+
+        Keys are compared with the element index as a tie breaker, the same order the stable gpu_sort64 produces.
+ */
+
+bool MortonKeyGreater(uvec2 Key0, uint Id0, uvec2 Key1, uint Id1)
 {
-    uint Result = uint(ceil(Val));
+    bool Result = Id0 > Id1;
+    if (Key0.y != Key1.y)
+    {
+        Result = Key0.y > Key1.y;
+    }
+    else if (Key0.x != Key1.x)
+    {
+        Result = Key0.x > Key1.x;
+    }
     return Result;
 }
 
-#define NUM_THREADS 32
+uvec2 MortonKeyMax(uvec2 Key0, uvec2 Key1)
+{
+    bool Key0Greater = Key0.y != Key1.y ? Key0.y > Key1.y : Key0.x > Key1.x;
+    uvec2 Result = Key0Greater ? Key0 : Key1;
+    return Result;
+}
 
-layout(local_size_x = NUM_THREADS, local_size_y = 1, local_size_z = 1) in;
+uint MortonNumBlocks()
+{
+    uint Result = (RadixTreeUniforms.NumNodes + MORTON_COHERENT_BLOCK_SIZE - 1) / MORTON_COHERENT_BLOCK_SIZE;
+    return Result;
+}
+
+//=========================================================================================================================================
+// NOTE: Morton Local Sort Pipeline
+//=========================================================================================================================================
+
+#if MORTON_LOCAL_SORT
+
+layout(push_constant) uniform push_constants
+{
+    uint SortType;
+} PushConstants;
+
+shared uvec2 SharedKeys[MORTON_COHERENT_BLOCK_SIZE];
+shared uint SharedIds[MORTON_COHERENT_BLOCK_SIZE];
+
+void SharedCompareAndSwap(uint Id0, uint Id1)
+{
+    if (MortonKeyGreater(SharedKeys[Id0], SharedIds[Id0], SharedKeys[Id1], SharedIds[Id1]))
+    {
+        uvec2 TempKey = SharedKeys[Id0];
+        SharedKeys[Id0] = SharedKeys[Id1];
+        SharedKeys[Id1] = TempKey;
+
+        uint TempId = SharedIds[Id0];
+        SharedIds[Id0] = SharedIds[Id1];
+        SharedIds[Id1] = TempId;
+    }
+}
+
+layout(local_size_x = 1024, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
     uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
-    if (WorkGroupId >= GraphGlobals.NumThreadGroupsCalcNodeBounds)
+    uint LocalThreadId = gl_LocalInvocationIndex;
+    uint BlockOffset = PushConstants.SortType == MortonLocalSortType_Merge ? MORTON_COHERENT_BLOCK_SIZE / 2 : 0;
+    uint BlockStart = WorkGroupId * MORTON_COHERENT_BLOCK_SIZE + BlockOffset;
+
+    // NOTE: Slots past the end get the max key so they stay at the end of the block
+    for (uint Offset = 0; Offset < 2; ++Offset)
     {
-        return;
+        uint SharedId = 2*LocalThreadId + Offset;
+        uint GlobalId = BlockStart + SharedId;
+        bool InRange = GlobalId < RadixTreeUniforms.NumNodes;
+        SharedKeys[SharedId] = InRange ? SortedMortonKeys[GlobalId] : uvec2(0xFFFFFFFF);
+        SharedIds[SharedId] = InRange ? ElementReMapping[GlobalId] : 0xFFFFFFFF;
     }
 
-    if (gl_LocalInvocationID.x == 0)
+    // NOTE: Both halves of a merge block are already sorted, so we only need the last flip and its disperses
+    uint StartFlipSize = PushConstants.SortType == MortonLocalSortType_Merge ? MORTON_COHERENT_BLOCK_SIZE / 2 : 1;
+    for (uint FlipSize = StartFlipSize, PassId = uint(findMSB(StartFlipSize)); FlipSize < MORTON_COHERENT_BLOCK_SIZE; PassId += 1, FlipSize *= 2)
     {
-        // TODO: I think a lot of this garbage can be simplified
-        WorkCounterId = atomicAdd(GlobalBoundsWorkCounter, 1);
-        PassId = 0;
-        DoneCounterToWaitOn = 0;
-        NumGroupsInPrevPass = RadixTreeUniforms.NumNodes;
-        NumGroupsInPrevPrevPass = RadixTreeUniforms.NumNodes;
-
-        uint NumGroupsInPass = CeilU32(float(RadixTreeUniforms.NumNodes) / 32.0f);
-        while (!(WorkCounterId < (DoneCounterToWaitOn + NumGroupsInPass)))
+        barrier();
+
+        // NOTE: Do Flip
         {
-            DoneCounterToWaitOn += NumGroupsInPass;
-            NumGroupsInPrevPrevPass = NumGroupsInPrevPass;
-            NumGroupsInPrevPass = NumGroupsInPass;
-            NumGroupsInPass = CeilU32(float(NumGroupsInPass) / 32.0f);
-            PassId += 1;
+            uint LowerHeightBits = FlipSize - 1;
+            uint FlipId1 = 2*FlipSize * (LocalThreadId >> PassId) + (LocalThreadId & LowerHeightBits);
+            uint FlipId2 = FlipId1 + 2*FlipSize - 2 * (LocalThreadId & LowerHeightBits) - 1;
+
+            SharedCompareAndSwap(FlipId1, FlipId2);
         }
 
-        // NOTE: Calculate how many threads in this thread group need to be active (last thread group in each pass might have too
-        // extra threads that do nothing)
+        barrier();
+
+        // NOTE: Do Disperse
+        for (uint N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
         {
-            bool LastGroupInPass = (WorkCounterId - DoneCounterToWaitOn) == (NumGroupsInPass - 1);
-            NumThreadsInGroup = (LastGroupInPass ?
-                                 NUM_THREADS - (NUM_THREADS * CeilU32(float(NumGroupsInPrevPass) / 32.0f) - NumGroupsInPrevPass) :
-                                 NUM_THREADS);
+            uint DoubleHeight = N * 2;
+            uint LowerBits = N - 1;
+            uint DisperseId1 = DoubleHeight * ((LocalThreadId & (~LowerBits)) >> NPassId) + (LocalThreadId & LowerBits);
+            uint DisperseId2 = DisperseId1 + N;
+
+            SharedCompareAndSwap(DisperseId1, DisperseId2);
+            barrier();
         }
     }
 
     barrier();
-    
-    // NOTE: Wait for Done Counter to match (only happens if last pass hasn't finished). We have to do this atomically to not read
-    // garbage
-    // TODO: We can choose a more exact counter to wait on
-    while (atomicAdd(GlobalBoundsDoneCounter, 0) < DoneCounterToWaitOn)
+
+    for (uint Offset = 0; Offset < 2; ++Offset)
     {
+        uint SharedId = 2*LocalThreadId + Offset;
+        uint GlobalId = BlockStart + SharedId;
+        if (GlobalId < RadixTreeUniforms.NumNodes)
+        {
+            SortedMortonKeys[GlobalId] = SharedKeys[SharedId];
+            ElementReMapping[GlobalId] = SharedIds[SharedId];
+        }
     }
-    
-    bounds BoundsReduction;
-    BoundsReduction.Min = vec2(0);
-    BoundsReduction.Max = vec2(0);
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Morton Check Pipeline
+//=========================================================================================================================================
+
+#if MORTON_CHECK || MORTON_CLAMP
+
+#define NUM_THREADS 32
+#define ITEMS_PER_THREAD (MORTON_COHERENT_BLOCK_SIZE / NUM_THREADS)
+
+shared uvec2 SharedMax[NUM_THREADS];
+
+#endif
 
-    // TODO: Move back in
-    uint LoadIndex = 0;
-    if (gl_LocalInvocationID.x < NumThreadsInGroup)
+#if MORTON_CHECK
+
+/*
+  NOTE: 1 group per block, same done counter scheme as CALC_WORLD_BOUNDS. The last group to finish turns the block maxes into a running
+        max, writes the clamp dispatch and the stats, and resets the counters.
+ */
+
+shared uint SharedDisorder[NUM_THREADS];
+shared uint SharedTotalDisorder;
+shared bool IsLastGroup;
+
+layout(local_size_x = NUM_THREADS, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint NumBlocks = MortonNumBlocks();
+    if (WorkGroupId >= NumBlocks)
+    {
+        return;
+    }
+
+    // NOTE: Count the keys that are bigger than the key after them, the last key of the block checks the first key of the next one
+    uint Disorder = 0;
+    uvec2 MaxKey = uvec2(0);
+    for (uint ItemId = 0; ItemId < ITEMS_PER_THREAD; ++ItemId)
     {
-        if (PassId == 0)
+        uint NodeId = WorkGroupId * MORTON_COHERENT_BLOCK_SIZE + ItemId * NUM_THREADS + gl_LocalInvocationIndex;
+        if (NodeId < RadixTreeUniforms.NumNodes)
         {
-            // NOTE: First set of downsample reads directly from required buffers
-            uint NodeId = NUM_THREADS * (WorkCounterId - DoneCounterToWaitOn) + gl_LocalInvocationIndex;
-            if (NodeId < RadixTreeUniforms.NumNodes)
+            uvec2 Key = SortedMortonKeys[NodeId];
+            MaxKey = MortonKeyMax(MaxKey, Key);
+            if (NodeId + 1 < RadixTreeUniforms.NumNodes &&
+                MortonKeyGreater(Key, ElementReMapping[NodeId], SortedMortonKeys[NodeId + 1], ElementReMapping[NodeId + 1]))
             {
-                vec2 NodePos = NodePositionArray[NodeId];
-                BoundsReduction.Min = NodePos;
-                BoundsReduction.Max = NodePos;
+                Disorder += 1;
             }
         }
-        else
+    }
+    SharedDisorder[gl_LocalInvocationIndex] = Disorder;
+    SharedMax[gl_LocalInvocationIndex] = MaxKey;
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0)
+    {
+        uint GroupDisorder = 0;
+        uvec2 GroupMax = uvec2(0);
+        for (uint ThreadId = 0; ThreadId < NUM_THREADS; ++ThreadId)
         {
-            LoadIndex = NUM_THREADS * (WorkCounterId - DoneCounterToWaitOn) + gl_LocalInvocationIndex;
-            if ((PassId & 0x1) == 0)
-            {
-                // NOTE: We have a odd number pass id so we don't start from the beginning of the buffer
-                LoadIndex += NumGroupsInPrevPrevPass;
-            }
-        
-            BoundsReduction = GlobalBoundsReductionArray[LoadIndex];
+            GroupDisorder += SharedDisorder[ThreadId];
+            GroupMax = MortonKeyMax(GroupMax, SharedMax[ThreadId]);
+        }
+
+        MortonBlockMax[WorkGroupId] = GroupMax;
+        if (GroupDisorder > 0)
+        {
+            atomicAdd(MortonCoherent.DisorderCount, GroupDisorder);
         }
+        memoryBarrierBuffer();
+        uint NumGroupsDone = atomicAdd(MortonCoherent.DoneCounter, 1);
+        IsLastGroup = NumGroupsDone == (NumBlocks - 1);
     }
-    
-    BoundsReduction.Min = subgroupMin(BoundsReduction.Min);
-    BoundsReduction.Max = subgroupMax(BoundsReduction.Max);
     barrier();
 
-    if (gl_LocalInvocationID.x == 0)
+    if (IsLastGroup)
     {
-        if (WorkCounterId != GraphGlobals.NumThreadGroupsCalcNodeBounds - 1)
+        // NOTE: All other groups have added their disorder and written their block max
+        memoryBarrierBuffer();
+        if (gl_LocalInvocationIndex == 0)
+        {
+            SharedTotalDisorder = atomicAdd(MortonCoherent.DisorderCount, 0);
+        }
+        barrier();
+
+        uint TotalDisorder = SharedTotalDisorder;
+        if (TotalDisorder > 0)
+        {
+            // NOTE: Every thread takes a contiguous run of blocks, scans its run and then adds the max of the runs before it
+            uint BlocksPerThread = (NumBlocks + NUM_THREADS - 1) / NUM_THREADS;
+            uint StartBlockId = gl_LocalInvocationIndex * BlocksPerThread;
+            uint EndBlockId = min(StartBlockId + BlocksPerThread, NumBlocks);
+
+            uvec2 RunMax = uvec2(0);
+            for (uint BlockId = StartBlockId; BlockId < EndBlockId; ++BlockId)
+            {
+                RunMax = MortonKeyMax(RunMax, MortonBlockMax[BlockId]);
+                MortonBlockMax[BlockId] = RunMax;
+            }
+            SharedMax[gl_LocalInvocationIndex] = RunMax;
+            barrier();
+
+            uvec2 PrevMax = uvec2(0);
+            for (uint ThreadId = 0; ThreadId < gl_LocalInvocationIndex; ++ThreadId)
+            {
+                PrevMax = MortonKeyMax(PrevMax, SharedMax[ThreadId]);
+            }
+            for (uint BlockId = StartBlockId; BlockId < EndBlockId; ++BlockId)
+            {
+                MortonBlockMax[BlockId] = MortonKeyMax(PrevMax, MortonBlockMax[BlockId]);
+            }
+        }
+
+        if (gl_LocalInvocationIndex == 0)
         {
-            // NOTE: Write out the summed values
-            uint WriteIndex = WorkCounterId - DoneCounterToWaitOn;
-            if ((PassId & 0x1) != 0)
+            // NOTE: The clamp only gets groups when something is still out of order
+            uint NumClampGroups = TotalDisorder > 0 ? NumBlocks : 0;
+            MortonCoherent.ClampDispatchX = NumClampGroups;
+            MortonCoherent.ClampDispatchY = 1;
+            MortonCoherent.ClampDispatchZ = 1;
+            if (NumClampGroups > 65535)
             {
-                // NOTE: We have a even number pass id so we have to write offsetted
-                WriteIndex += NumGroupsInPrevPass;
+                MortonCoherent.ClampDispatchX = 64;
+                MortonCoherent.ClampDispatchY = (NumClampGroups + 63) / 64;
             }
 
-            GlobalBoundsReductionArray[WriteIndex] = BoundsReduction;
+            MortonSortStatsDisorderCount = TotalDisorder;
+            MortonCoherent.DisorderCount = 0;
+            MortonCoherent.DoneCounter = 0;
+        }
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Morton Clamp Pipeline
+//=========================================================================================================================================
+
+#if MORTON_CLAMP
+
+layout(local_size_x = NUM_THREADS, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    if (WorkGroupId >= MortonNumBlocks())
+    {
+        return;
+    }
+
+    // NOTE: Every thread clamps a contiguous run of keys, starting from the max of every key in front of its run
+    uint StartNodeId = WorkGroupId * MORTON_COHERENT_BLOCK_SIZE + gl_LocalInvocationIndex * ITEMS_PER_THREAD;
+    uint EndNodeId = min(StartNodeId + ITEMS_PER_THREAD, RadixTreeUniforms.NumNodes);
+
+    uvec2 RunMax = uvec2(0);
+    for (uint NodeId = StartNodeId; NodeId < EndNodeId; ++NodeId)
+    {
+        RunMax = MortonKeyMax(RunMax, SortedMortonKeys[NodeId]);
+    }
+    SharedMax[gl_LocalInvocationIndex] = RunMax;
+    barrier();
+
+    uvec2 CurrMax = WorkGroupId > 0 ? MortonBlockMax[WorkGroupId - 1] : uvec2(0);
+    for (uint ThreadId = 0; ThreadId < gl_LocalInvocationIndex; ++ThreadId)
+    {
+        CurrMax = MortonKeyMax(CurrMax, SharedMax[ThreadId]);
+    }
+
+    for (uint NodeId = StartNodeId; NodeId < EndNodeId; ++NodeId)
+    {
+        CurrMax = MortonKeyMax(CurrMax, SortedMortonKeys[NodeId]);
+        SortedMortonKeys[NodeId] = CurrMax;
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Calc World Bounds Pipeline
+//=========================================================================================================================================
+
+#if CALC_WORLD_BOUNDS
+
+/*
+  NOTE: Same scheme as the global speed reduction. Each work group reduces REDUCTION_NODES_PER_GROUP nodes, writes out 1 partial bounds
+        and bumps a done counter once. The last group to finish reduces all the partials and resets the counter. No group ever waits
+        on another group so this is safe without forward progress guarantees.
+ */
+
+#define NUM_THREADS 32
+
+shared bounds SharedReduction[NUM_THREADS];
+shared bool IsLastGroup;
+
+bounds WorkGroupReduce(bounds Value)
+{
+    // NOTE: Subgroups can be smaller than the work group (lavapipe, intel) so we combine the subgroup results through shared memory
+    Value.Min = subgroupMin(Value.Min);
+    Value.Max = subgroupMax(Value.Max);
+    if (subgroupElect())
+    {
+        SharedReduction[gl_SubgroupID] = Value;
+    }
+    barrier();
+
+    bounds Result = SharedReduction[0];
+    for (uint SubgroupId = 1; SubgroupId < gl_NumSubgroups; ++SubgroupId)
+    {
+        Result.Min = min(Result.Min, SharedReduction[SubgroupId].Min);
+        Result.Max = max(Result.Max, SharedReduction[SubgroupId].Max);
+    }
+    barrier();
+
+    return Result;
+}
 
-            memoryBarrier();
-            atomicAdd(GlobalBoundsDoneCounter, 1);
+layout(local_size_x = NUM_THREADS, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    if (WorkGroupId >= GraphGlobals.NumThreadGroupsCalcNodeBounds)
+    {
+        return;
+    }
+
+    // NOTE: Reduce our nodes
+    float MaxFloat = 3.402823466e+38f;
+    bounds BoundsReduction;
+    BoundsReduction.Min = vec2(MaxFloat);
+    BoundsReduction.Max = vec2(-MaxFloat);
+    for (uint ItemId = 0; ItemId < REDUCTION_ITEMS_PER_THREAD; ++ItemId)
+    {
+        uint NodeId = WorkGroupId * REDUCTION_NODES_PER_GROUP + ItemId * NUM_THREADS + gl_LocalInvocationIndex;
+        if (NodeId < RadixTreeUniforms.NumNodes)
+        {
+            vec2 NodePos = NodeLoadPos(NodeId);
+            BoundsReduction.Min = min(BoundsReduction.Min, NodePos);
+            BoundsReduction.Max = max(BoundsReduction.Max, NodePos);
         }
-        else
+    }
+    BoundsReduction = WorkGroupReduce(BoundsReduction);
+
+    // NOTE: Write out our partial bounds and check if we are the last group to finish
+    if (gl_LocalInvocationIndex == 0)
+    {
+        GlobalBoundsReductionArray[WorkGroupId] = BoundsReduction;
+        memoryBarrierBuffer();
+        uint NumGroupsDone = atomicAdd(GlobalBoundsDoneCounter, 1);
+        IsLastGroup = NumGroupsDone == (GraphGlobals.NumThreadGroupsCalcNodeBounds - 1);
+    }
+    barrier();
+
+    if (IsLastGroup)
+    {
+        // NOTE: All other groups have written their partial bounds so reduce them into the final bounds
+        memoryBarrierBuffer();
+
+        bounds FinalReduction;
+        FinalReduction.Min = vec2(MaxFloat);
+        FinalReduction.Max = vec2(-MaxFloat);
+        for (uint GroupId = gl_LocalInvocationIndex; GroupId < GraphGlobals.NumThreadGroupsCalcNodeBounds; GroupId += NUM_THREADS)
+        {
+            bounds GroupReduction = GlobalBoundsReductionArray[GroupId];
+            FinalReduction.Min = min(FinalReduction.Min, GroupReduction.Min);
+            FinalReduction.Max = max(FinalReduction.Max, GroupReduction.Max);
+        }
+        FinalReduction = WorkGroupReduce(FinalReduction);
+
+        if (gl_LocalInvocationIndex == 0)
         {
-            atomicMin(GlobalBoundsWorkCounter, 0);
-            atomicMin(GlobalBoundsDoneCounter, 0);
-            ElementBounds = BoundsReduction;
+            GlobalBoundsDoneCounter = 0;
+            ElementBounds = FinalReduction;
         }
     }
 }
@@ -199,12 +545,24 @@ void main()
 
 int LengthCommonPrefix(int Id0, int Id1)
 {
+    // NOTE: Keys are 64 bits with the sorted index appended as a tie breaker so that duplicate keys still produce a balanced tree
     int Result = -1;
     if (Id1 >= 0 && Id1 < RadixTreeUniforms.NumNodes)
     {
-        uint Key0 = MortonKeys[Id0];
-        uint Key1 = MortonKeys[Id1];
-        Result = Key0 == Key1 ? 63 - int(findMSB(Id0 ^ Id1)) : 31 - int(findMSB(Key0 ^ Key1));
+        uvec2 Key0 = SortedMortonKeys[Id0];
+        uvec2 Key1 = SortedMortonKeys[Id1];
+        if (Key0 == Key1)
+        {
+            Result = 95 - int(findMSB(Id0 ^ Id1));
+        }
+        else if (Key0.y != Key1.y)
+        {
+            Result = 31 - int(findMSB(Key0.y ^ Key1.y));
+        }
+        else
+        {
+            Result = 63 - int(findMSB(Key0.x ^ Key1.x));
+        }
     }
     return Result;
 }
@@ -323,8 +681,8 @@ void RadixNodeGetData(int Index, out vec2 Pos, out float Degree)
     {
         // NOTE: This is a leaf node
         uint ReMappedId = ElementReMapping[Index & (~int(1 << 31))];
-        Pos = NodePositionArray[ReMappedId];
-        Degree = NodeDegreeArray[ReMappedId];
+        Pos = NodeLoadPos(ReMappedId);
+        Degree = NodeLoadDegree(ReMappedId);
 
         // TODO: REMOVE Debug code
 #if 0
@@ -389,29 +747,20 @@ void main()
 #endif
 
 //=========================================================================================================================================
-// NOTE: Radix Tree Summarize 
+// NOTE: Radix Tree Repulsion
 //=========================================================================================================================================
 
 #if RADIX_TREE_REPULSION
 
-#define STACK_SIZE 32
-
-shared int StackPointer;
-shared int StackNodes[STACK_SIZE];
-
-// TODO: REMOVE
-#define DEBUG_ITERATION 0
-#if DEBUG_ITERATION
-shared uint DebugNumLeafs;
-shared uint DebugNumInternals;
-shared uint DebugNumRecursions;
+/*
+  NOTE: Each invocation walks the tree on its own so the traversal stack is a private global (registers/local memory) instead of
+        shared memory. A shared stack had every invocation in the group push and pop the same nodes which serialized the walk and
+        mixed up the traversals. The stack is sized for the deepest tree our keys can build, see RADIX_TREE_STACK_SIZE, so we never
+        have to cut a walk short.
+ */
 
-shared uint IterationCount;
-shared uint SavedStackPtrs[4];
-shared uint SavedIterationCount[4];
-shared uint SavedNodeTypes[4];
-shared uint EndStackPointers[4];
-#endif
+int StackPointer;
+int StackNodes[RADIX_TREE_STACK_SIZE];
 
 void StackPushNodeChildren(uint NodeId)
 {
@@ -436,41 +785,40 @@ vec2 NodeCalculateRepulsion(vec2 DistanceVec, float DistanceSq, float NodeDegree
     return Result;
 }
 
+/*
+  NOTE: With GRAPH_ACTIVE_SET we only walk the tree for the nodes in the active list. The tree still summarizes every node since the
+        inactive nodes keep repulsing the active ones. Without it, thread i takes the i'th sorted leaf so neighbouring threads walk
+        similar paths. Returns 0xFFFFFFFF for threads past the end.
+ */
+uint RadixThreadGraphNodeId(uint ThreadId)
+{
+#if GRAPH_ACTIVE_SET
+    uint Result = ThreadId < ActiveSet.NumActiveNodes ? ActiveNodeArray[ThreadId] : 0xFFFFFFFF;
+#else
+    uint Result = ThreadId < RadixTreeUniforms.NumNodes ? ElementReMapping[ThreadId] : 0xFFFFFFFF;
+#endif
+    return Result;
+}
+
 layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
     uint WorkGroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
     uint ThreadId = WorkGroupId * 32 + gl_LocalInvocationIndex;
+    uint GraphNodeId = RadixThreadGraphNodeId(ThreadId);
 
-    if (ThreadId < RadixTreeUniforms.NumNodes)
+    if (GraphNodeId != 0xFFFFFFFF)
     {
-        uint GraphNodeId = ElementReMapping[ThreadId];
-        float GraphNodeDegree = NodeDegreeArray[GraphNodeId];
-        vec2 GraphNodePos = NodePositionArray[GraphNodeId];
+        float GraphNodeDegree = NodeLoadDegree(GraphNodeId);
+        vec2 GraphNodePos = NodeLoadPos(GraphNodeId);
         vec2 GraphNodeForce = NodeForceArray[GraphNodeId];
 
-        // TODO: REMOVE
-#if DEBUG_ITERATION
-        DebugNumLeafs = 0;
-        DebugNumInternals = 0;
-        DebugNumRecursions = 0;
-        IterationCount = 0;
-#endif
-        
         // NOTE: Push root onto the stack
         StackPointer = 0;
         StackPushNodeChildren(0);
         
         while (StackPointer > 0)
         {
-#if DEBUG_ITERATION
-            if (IterationCount < 4)
-            {
-                SavedStackPtrs[IterationCount] = StackPointer;
-                SavedIterationCount[IterationCount] = IterationCount;
-            }
-#endif
-            
             int TreeNodeId = StackPopNode();
             
             int TreeLeafNodeId = TreeNodeId & (~int(1 << 31));
@@ -482,22 +830,13 @@ void main()
                 uint OtherGraphNodeId = ElementReMapping[TreeLeafNodeId];
                 if (GraphNodeId != OtherGraphNodeId)
                 {
-                    vec2 OtherNodePos = NodePositionArray[OtherGraphNodeId];
-                    float OtherNodeDegree = NodeDegreeArray[OtherGraphNodeId];
+                    vec2 OtherNodePos = NodeLoadPos(OtherGraphNodeId);
+                    float OtherNodeDegree = NodeLoadDegree(OtherGraphNodeId);
 
                     vec2 DistanceVec = GraphNodePos - OtherNodePos;
                     float DistanceSq = DistanceVec.x * DistanceVec.x + DistanceVec.y * DistanceVec.y + GraphGlobals.RepulsionSoftner;
 
                     GraphNodeForce += NodeCalculateRepulsion(DistanceVec, DistanceSq, GraphNodeDegree, OtherNodeDegree);
-
-#if DEBUG_ITERATION
-                    if (IterationCount < 4)
-                    {
-                        SavedNodeTypes[IterationCount] = 10;
-                    }
-            
-                    DebugNumLeafs++;
-#endif
                 }
             }
             else
@@ -508,61 +847,20 @@ void main()
                 float DistanceSq = DistanceVec.x * DistanceVec.x + DistanceVec.y * DistanceVec.y + GraphGlobals.RepulsionSoftner;
                 float Theta = 0.1f;
 
-                if (subgroupAll(Theta * sqrt(DistanceSq) > NodeParticle.Size) || StackPointer >= (STACK_SIZE - 2))
+                // NOTE: Each invocation decides on its own, we don't need the rest of the subgroup to agree anymore
+                if (Theta * sqrt(DistanceSq) > NodeParticle.Size)
                 {
-                    // NOTE: We either are far enough away or we don't have enough room on the stack for more nodes so
-                    // take average data and quit traversing this sub tree
+                    // NOTE: We are far enough away so take average data and quit traversing this sub tree
                     GraphNodeForce += NodeCalculateRepulsion(DistanceVec, DistanceSq, GraphNodeDegree, NodeParticle.Degree);
-
-#if DEBUG_ITERATION
-                    DebugNumInternals++;
-
-                    if (IterationCount < 4)
-                    {
-                        SavedNodeTypes[IterationCount] = 20;
-                    }
-#endif
                 }
                 else
                 {
-#if DEBUG_ITERATION
-                    if (IterationCount < 4)
-                    {
-                        SavedNodeTypes[IterationCount] = 30;
-                    }
-                    DebugNumRecursions++;
-#endif
-                    
                     StackPushNodeChildren(TreeNodeId);
                 }
             }
-
-#if DEBUG_ITERATION
-            if (IterationCount < 4)
-            {
-                EndStackPointers[IterationCount] = StackPointer;
-            }
-            
-            IterationCount += 1;
-#endif
         }
 
         NodeForceArray[GraphNodeId] = GraphNodeForce;
-
-#if DEBUG_ITERATION
-        // TODO: DEBUG REMOVE
-        if (gl_LocalInvocationIndex == 0)
-        {
-            uint CurrOffset = 0;
-            NodeForceArray[CurrOffset++] = vec2(DebugNumLeafs, DebugNumInternals);
-            NodeForceArray[CurrOffset++] = vec2(DebugNumRecursions, IterationCount);
-            for (uint I = 0; I < 4; ++I)
-            {
-                NodeForceArray[CurrOffset++] = vec2(SavedStackPtrs[I], SavedIterationCount[I]);
-                NodeForceArray[CurrOffset++] = vec2(SavedNodeTypes[I], EndStackPointers[I]);
-            }
-        }
-#endif
     }
 }
 
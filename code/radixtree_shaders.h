@@ -12,6 +12,27 @@ struct bounds
     vec2 Max;
 };
 
+// NOTE: Keys are 64 bits plus a 32 bit index tie breaker, so no internal node can be deeper than this. A depth first walk that pushes
+// both children of every node it opens holds at most 1 pending sibling per level plus the 2 children it just pushed
+#define RADIX_TREE_MAX_DEPTH 96
+#define RADIX_TREE_STACK_SIZE (RADIX_TREE_MAX_DEPTH + 2)
+
+#define MortonGatherType_FullKey 0
+#define MortonGatherType_HighKey 1
+
+#define MORTON_COHERENT_BLOCK_SIZE 2048
+#define MortonLocalSortType_Sort 0
+#define MortonLocalSortType_Merge 1
+
+struct morton_coherent_data
+{
+    uint DisorderCount;
+    uint DoneCounter;
+    uint ClampDispatchX;
+    uint ClampDispatchY;
+    uint ClampDispatchZ;
+};
+
 #define RADIX_DESCRIPTOR_LAYOUT(set_id)                                 \
                                                                         \
     layout(set = set_id, binding = 0) uniform radix_tree_uniforms       \
@@ -62,11 +83,32 @@ struct bounds
                                                                         \
     layout(set = set_id, binding = 8) buffer global_bounds_counter_buffer \
     {                                                                   \
-        uint GlobalBoundsWorkCounter;                                   \
         uint GlobalBoundsDoneCounter;                                   \
     };                                                                  \
                                                                         \
     layout(set = set_id, binding = 9) buffer element_bounds             \
     {                                                                   \
         bounds ElementBounds;                                           \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 10) buffer sorted_morton_keys        \
+    {                                                                   \
+        uvec2 SortedMortonKeys[];                                       \
+    };                                                                  \
+                                                                        \
+                                                                        \
+                                                                        \
+    layout(set = set_id, binding = 11) coherent buffer morton_block_max \
+    {                                                                   \
+        uvec2 MortonBlockMax[];                                         \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 12) coherent buffer morton_coherent  \
+    {                                                                   \
+        morton_coherent_data MortonCoherent;                            \
+    };                                                                  \
+                                                                        \
+    layout(set = set_id, binding = 13) buffer morton_sort_stats         \
+    {                                                                   \
+        uint MortonSortStatsDisorderCount;                              \
     };                                                                  
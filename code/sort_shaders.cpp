@@ -6,40 +6,105 @@
 
 /*
   NOTE: Implementation based on https://poniesandlight.co.uk/reflect/bitonic_merge_sort/
+
+        Sorts the keys and payloads the sort module binds in set 0. The key count is virtually padded to a power of 2, every slot
+        past ArraySize acts like a max key that never moves, so any key count sorts correctly. Nothing is stored for the padding and
+        the sort module only launches the threads whose lower index is a real key, NumThreads of them per pass. Dispatches can be 2D
+        once they pass the group count limit.
  */
 
-#include "graph_shaders.h"
-#include "radixtree_shaders.h"
+layout(set = 0, binding = 0) buffer sort_key_array
+{
+    uint SortKeyArray[];
+};
 
-RADIX_DESCRIPTOR_LAYOUT(0)
-GRAPH_DESCRIPTOR_LAYOUT(1)
+layout(set = 0, binding = 1) buffer sort_payload_array
+{
+    uint SortPayloadArray[];
+};
 
-layout(set = 2, binding = 0) uniform sort_uniforms
+layout(push_constant) uniform push_constants
 {
     uint ArraySize;
     uint FlipSize;
     uint PassId;
     uint N;
-} SortUniforms;
+    uint NumThreads;
+} PushConstants;
+
+uint BitonicThreadId()
+{
+    uint GroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint Result = GroupId * 1024 + uint(gl_LocalInvocationIndex);
+    return Result;
+}
 
 void GlobalCompareAndSwap(uint Index1, uint Index2)
 {
-    if (Index1 < SortUniforms.ArraySize && Index2 < SortUniforms.ArraySize)
+    if (Index1 < PushConstants.ArraySize && Index2 < PushConstants.ArraySize)
     {
-        uint MortonKey0 = MortonKeys[Index1];
-        uint MortonKey1 = MortonKeys[Index2];
-        if (MortonKey0 > MortonKey1)
+        uint Key0 = SortKeyArray[Index1];
+        uint Key1 = SortKeyArray[Index2];
+        if (Key0 > Key1)
         {
-            MortonKeys[Index1] = MortonKey1;
-            MortonKeys[Index2] = MortonKey0;
+            SortKeyArray[Index1] = Key1;
+            SortKeyArray[Index2] = Key0;
 
-            uint Temp = ElementReMapping[Index1];
-            ElementReMapping[Index1] = ElementReMapping[Index2];
-            ElementReMapping[Index2] = Temp;
+            uint Temp = SortPayloadArray[Index1];
+            SortPayloadArray[Index1] = SortPayloadArray[Index2];
+            SortPayloadArray[Index2] = Temp;
         }
     }
 }
 
+#if BITONIC_LOCAL_DISPERSE || BITONIC_LOCAL_FD
+
+shared uint SharedArrayValues[2048];
+shared uint SharedIndexValues[2048];
+
+void SharedCheckAndSwapValues(uint Id0, uint Id1)
+{
+    uint ArrayVal0 = SharedArrayValues[Id0];
+    uint ArrayVal1 = SharedArrayValues[Id1];
+    if (ArrayVal0 > ArrayVal1)
+    {
+        SharedArrayValues[Id0] = ArrayVal1;
+        SharedArrayValues[Id1] = ArrayVal0;
+
+        uint Temp = SharedIndexValues[Id0];
+        SharedIndexValues[Id0] = SharedIndexValues[Id1];
+        SharedIndexValues[Id1] = Temp;
+    }
+}
+
+// NOTE: Every thread takes part so barriers stay uniform. Slots past the end load the max key, and since we only swap on a strict
+// greater than they never move in front of a real key
+void SharedLoad(uint GlobalThreadId, uint LocalThreadId)
+{
+    for (uint Offset = 0; Offset < 2; ++Offset)
+    {
+        uint GlobalId = 2*GlobalThreadId + Offset;
+        bool InRange = GlobalId < PushConstants.ArraySize;
+        SharedArrayValues[2*LocalThreadId + Offset] = InRange ? SortKeyArray[GlobalId] : 0xFFFFFFFF;
+        SharedIndexValues[2*LocalThreadId + Offset] = InRange ? SortPayloadArray[GlobalId] : 0;
+    }
+}
+
+void SharedStore(uint GlobalThreadId, uint LocalThreadId)
+{
+    for (uint Offset = 0; Offset < 2; ++Offset)
+    {
+        uint GlobalId = 2*GlobalThreadId + Offset;
+        if (GlobalId < PushConstants.ArraySize)
+        {
+            SortKeyArray[GlobalId] = SharedArrayValues[2*LocalThreadId + Offset];
+            SortPayloadArray[GlobalId] = SharedIndexValues[2*LocalThreadId + Offset];
+        }
+    }
+}
+
+#endif
+
 //=========================================================================================================================================
 // NOTE: Bitonic Merge Sort Global Flip
 //=========================================================================================================================================
@@ -49,22 +114,19 @@ void GlobalCompareAndSwap(uint Index1, uint Index2)
 layout(local_size_x = 1024, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
-    uint ThreadId = uint(gl_GlobalInvocationID.x);
-
-    if (ThreadId < SortUniforms.ArraySize / 2)
+    uint ThreadId = BitonicThreadId();
+    if (ThreadId >= PushConstants.NumThreads)
     {
-        uint DoubleFlip = 2*SortUniforms.FlipSize;
-        uint LowerHeightBits = SortUniforms.FlipSize - 1;
-        uint FlipId1 = DoubleFlip * (ThreadId >> SortUniforms.PassId) + (ThreadId & LowerHeightBits);
-        uint FlipId2 = FlipId1 + DoubleFlip - 2 * (ThreadId & LowerHeightBits) - 1;
-
-        /*
-        SortArray[2*ThreadId + 0] = FlipId1;
-        SortArray[2*ThreadId + 1] = FlipId2;
-        */
-        
-        GlobalCompareAndSwap(FlipId1, FlipId2);
+        // NOTE: Past the last pair with a real key, the indices here can also wrap around for arrays close to 2^32
+        return;
     }
+
+    uint DoubleFlip = 2*PushConstants.FlipSize;
+    uint LowerHeightBits = PushConstants.FlipSize - 1;
+    uint FlipId1 = DoubleFlip * (ThreadId >> PushConstants.PassId) + (ThreadId & LowerHeightBits);
+    uint FlipId2 = FlipId1 + DoubleFlip - 2 * (ThreadId & LowerHeightBits) - 1;
+
+    GlobalCompareAndSwap(FlipId1, FlipId2);
 }
 
 #endif
@@ -75,68 +137,35 @@ void main()
 
 #if BITONIC_LOCAL_DISPERSE
 
-shared uint SharedArrayValues[2048];
-shared uint SharedIndexValues[2048];
-
-void SharedCheckAndSwapValues(uint Id0, uint Id1)
-{
-    if (Id0 < SortUniforms.ArraySize && Id1 < SortUniforms.ArraySize)
-    {
-        uint ArrayVal0 = SharedArrayValues[Id0];
-        uint ArrayVal1 = SharedArrayValues[Id1];
-        if (ArrayVal0 > ArrayVal1)
-        {
-            SharedArrayValues[Id0] = ArrayVal1;
-            SharedArrayValues[Id1] = ArrayVal0;
-
-            uint Temp = SharedIndexValues[Id0];
-            SharedIndexValues[Id0] = SharedIndexValues[Id1];
-            SharedIndexValues[Id1] = Temp;
-        }
-    }
-}
-
 layout(local_size_x = 1024, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
-    uint GlobalThreadId = uint(gl_GlobalInvocationID.x);
-
-    if (GlobalThreadId < SortUniforms.ArraySize / 2)
+    uint GlobalThreadId = BitonicThreadId();
+    if (GlobalThreadId - uint(gl_LocalInvocationIndex) >= PushConstants.NumThreads)
     {
-        // TODO: We can make this quicker probably with better LDS indexing to avoid bank conflicts
-        uint LocalThreadId = uint(gl_LocalInvocationIndex);
-        SharedArrayValues[2*LocalThreadId + 0] = MortonKeys[2*GlobalThreadId + 0];
-        SharedArrayValues[2*LocalThreadId + 1] = MortonKeys[2*GlobalThreadId + 1];
+        // NOTE: The whole group returns together so the barriers below stay uniform
+        return;
+    }
 
-        SharedIndexValues[2*LocalThreadId + 0] = ElementReMapping[2*GlobalThreadId + 0];
-        SharedIndexValues[2*LocalThreadId + 1] = ElementReMapping[2*GlobalThreadId + 1];
+    // TODO: We can make this quicker probably with better LDS indexing to avoid bank conflicts
+    uint LocalThreadId = uint(gl_LocalInvocationIndex);
+    SharedLoad(GlobalThreadId, LocalThreadId);
 
-        barrier();
+    barrier();
 
-        // NOTE: Do Disperse
-        for (uint N = 1024, NPassId = 10; N > 0; NPassId -= 1, N = N / 2)
-        {
-            uint DoubleHeight = N * 2;
-            uint LowerBits = N - 1;
-            uint DisperseId1 = DoubleHeight * ((LocalThreadId & (~LowerBits)) >> NPassId) + (LocalThreadId & LowerBits);
-            uint DisperseId2 = DisperseId1 + N;
-
-            /*
-            SharedArrayValues[2*LocalThreadId + 0] = DisperseId1;
-            SharedArrayValues[2*LocalThreadId + 1] = DisperseId2;
-            */
-
-            SharedCheckAndSwapValues(DisperseId1, DisperseId2);
-            barrier();
-        }
-        
-        // TODO: We can make this quicker probably with better LDS indexing to avoid bank conflicts
-        MortonKeys[2*GlobalThreadId + 0] = SharedArrayValues[2*LocalThreadId + 0];
-        MortonKeys[2*GlobalThreadId + 1] = SharedArrayValues[2*LocalThreadId + 1];
+    // NOTE: Do Disperse
+    for (uint N = 1024, NPassId = 10; N > 0; NPassId -= 1, N = N / 2)
+    {
+        uint DoubleHeight = N * 2;
+        uint LowerBits = N - 1;
+        uint DisperseId1 = DoubleHeight * ((LocalThreadId & (~LowerBits)) >> NPassId) + (LocalThreadId & LowerBits);
+        uint DisperseId2 = DisperseId1 + N;
 
-        ElementReMapping[2*GlobalThreadId + 0] = SharedIndexValues[2*LocalThreadId + 0];
-        ElementReMapping[2*GlobalThreadId + 1] = SharedIndexValues[2*LocalThreadId + 1];
+        SharedCheckAndSwapValues(DisperseId1, DisperseId2);
+        barrier();
     }
+
+    SharedStore(GlobalThreadId, LocalThreadId);
 }
 
 #endif
@@ -150,17 +179,19 @@ void main()
 layout(local_size_x = 1024, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
-    uint ThreadId = uint(gl_GlobalInvocationID.x);
-
-    if (ThreadId < SortUniforms.ArraySize / 2)
+    uint ThreadId = BitonicThreadId();
+    if (ThreadId >= PushConstants.NumThreads)
     {
-        uint DoubleHeight = SortUniforms.N * 2;
-        uint LowerBits = SortUniforms.N - 1;
-        uint DisperseId1 = DoubleHeight * ((ThreadId & (~LowerBits)) >> SortUniforms.PassId) + (ThreadId & LowerBits);
-        uint DisperseId2 = DisperseId1 + SortUniforms.N;
-
-        GlobalCompareAndSwap(DisperseId1, DisperseId2);
+        // NOTE: Past the last pair with a real key, the indices here can also wrap around for arrays close to 2^32
+        return;
     }
+
+    uint DoubleHeight = PushConstants.N * 2;
+    uint LowerBits = PushConstants.N - 1;
+    uint DisperseId1 = DoubleHeight * ((ThreadId & (~LowerBits)) >> PushConstants.PassId) + (ThreadId & LowerBits);
+    uint DisperseId2 = DisperseId1 + PushConstants.N;
+
+    GlobalCompareAndSwap(DisperseId1, DisperseId2);
 }
 
 #endif
@@ -171,118 +202,53 @@ void main()
 
 #if BITONIC_LOCAL_FD
 
-uint NextPow2(uint Val)
-{
-    // NOTE: https://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
-    uint Result = Val;
-    Result--;
-    Result |= Result >> 1;
-    Result |= Result >> 2;
-    Result |= Result >> 4;
-    Result |= Result >> 8;
-    Result |= Result >> 16;
-    Result++;
-
-    return Result / 2;
-}
-
-uint Morton2dExpandBits(uint Value)
-{
-    // NOTE: https://stackoverflow.com/questions/30539347/2d-morton-code-encode-decode-64bits
-    // NOTE: Expands a 16-bit integer into 32 bits by inserting 1 zeros after each bit.
-    uint Result = (Value | (Value << 16)) & 0x0000FFFF;
-    Result = (Result | (Result << 8)) & 0x00FF00FF;
-    Result = (Result | (Result << 4)) & 0x0F0F0F0F;
-    Result = (Result | (Result << 2)) & 0x33333333;
-    Result = (Result | (Result << 1)) & 0x55555555;
-    return Result;
-}
-
-uint Morton2d(vec2 Pos)
+layout(local_size_x = 1024, local_size_y = 1, local_size_z = 1) in;
+void main()
 {
-    vec2 NormalizedPos = (Pos - ElementBounds.Min) / (ElementBounds.Max - ElementBounds.Min);
-
-    // NOTE: Each axis gets 16 bits so we convert x/y into fixed point
-    float BitRange = pow(2, 16);
-    vec2 FixedPointPos = min(max(NormalizedPos * BitRange, 0.0f), BitRange - 1);
-
-    uint Result = 2 * Morton2dExpandBits(uint(FixedPointPos.x)) + Morton2dExpandBits(uint(FixedPointPos.y));
-    return Result;
-}
+    uint GlobalThreadId = BitonicThreadId();
+    if (GlobalThreadId - uint(gl_LocalInvocationIndex) >= PushConstants.NumThreads)
+    {
+        // NOTE: The whole group returns together so the barriers below stay uniform
+        return;
+    }
 
-shared uint SharedArrayValues[2048];
-shared uint SharedIndexValues[2048];
+    // TODO: We can make this quicker probably with better LDS indexing to avoid bank conflicts
+    uint LocalThreadId = uint(gl_LocalInvocationIndex);
+    SharedLoad(GlobalThreadId, LocalThreadId);
 
-void SharedCheckAndSwapValues(uint Id0, uint Id1)
-{
-    if (Id0 < SortUniforms.ArraySize && Id1 < SortUniforms.ArraySize)
+    uint MinArraySize = min(PushConstants.ArraySize, 2048);
+    for (uint FlipSize = 1, PassId = 0; FlipSize < MinArraySize; PassId += 1, FlipSize *= 2)
     {
-        uint ArrayVal0 = SharedArrayValues[Id0];
-        uint ArrayVal1 = SharedArrayValues[Id1];
-        if (ArrayVal0 > ArrayVal1)
+        barrier();
+
+        // NOTE: Do Flip
         {
-            SharedArrayValues[Id0] = ArrayVal1;
-            SharedArrayValues[Id1] = ArrayVal0;
+            uint LowerHeightBits = FlipSize - 1;
+            uint FlipId1 = 2*FlipSize * (LocalThreadId >> PassId) + (LocalThreadId & LowerHeightBits);
+            uint FlipId2 = FlipId1 + 2*FlipSize - 2 * (LocalThreadId & LowerHeightBits) - 1;
 
-            uint Temp = SharedIndexValues[Id0];
-            SharedIndexValues[Id0] = SharedIndexValues[Id1];
-            SharedIndexValues[Id1] = Temp;
+            SharedCheckAndSwapValues(FlipId1, FlipId2);
         }
-    }
-}
 
-layout(local_size_x = 1024, local_size_y = 1, local_size_z = 1) in;
-void main()
-{
-    uint GlobalThreadId = uint(gl_GlobalInvocationID.x);
-
-    if (GlobalThreadId < SortUniforms.ArraySize / 2)
-    {
-        // TODO: We can make this quicker probably with better LDS indexing to avoid bank conflicts
-        uint LocalThreadId = uint(gl_LocalInvocationIndex);
-        SharedArrayValues[2*LocalThreadId + 0] = Morton2d(NodePositionArray[2*GlobalThreadId + 0]);
-        SharedArrayValues[2*LocalThreadId + 1] = Morton2d(NodePositionArray[2*GlobalThreadId + 1]);
-
-        SharedIndexValues[2*LocalThreadId + 0] = 2*GlobalThreadId + 0;
-        SharedIndexValues[2*LocalThreadId + 1] = 2*GlobalThreadId + 1;
+        barrier();
 
-        uint MinArraySize = min(NextPow2(SortUniforms.ArraySize), 2048);
-        
-        for (uint FlipSize = 1, PassId = 0; FlipSize < MinArraySize; PassId += 1, FlipSize *= 2)
+        // NOTE: Do Disperse
+        for (uint N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
         {
-            barrier();
-
-            // NOTE: Do Flip
-            {
-                uint LowerHeightBits = FlipSize - 1;
-                uint FlipId1 = 2*FlipSize * (LocalThreadId >> PassId) + (LocalThreadId & LowerHeightBits);
-                uint FlipId2 = FlipId1 + 2*FlipSize - 2 * (LocalThreadId & LowerHeightBits) - 1;
+            uint DoubleHeight = N * 2;
+            uint LowerBits = N - 1;
+            uint DisperseId1 = DoubleHeight * ((LocalThreadId & (~LowerBits)) >> NPassId) + (LocalThreadId & LowerBits);
+            uint DisperseId2 = DisperseId1 + N;
 
-                SharedCheckAndSwapValues(FlipId1, FlipId2);
-            }
-        
+            SharedCheckAndSwapValues(DisperseId1, DisperseId2);
             barrier();
-
-            // NOTE: Do Disperse
-            for (uint N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
-            {
-                uint DoubleHeight = N * 2;
-                uint LowerBits = N - 1;
-                uint DisperseId1 = DoubleHeight * ((LocalThreadId & (~LowerBits)) >> NPassId) + (LocalThreadId & LowerBits);
-                uint DisperseId2 = DisperseId1 + N;
-
-                SharedCheckAndSwapValues(DisperseId1, DisperseId2);
-                barrier();
-            }
         }
+    }
 
-        // TODO: We can make this quicker probably with better LDS indexing to avoid bank conflicts
-        MortonKeys[2*GlobalThreadId + 0] = SharedArrayValues[2*LocalThreadId + 0];
-        MortonKeys[2*GlobalThreadId + 1] = SharedArrayValues[2*LocalThreadId + 1];
+    barrier();
 
-        ElementReMapping[2*GlobalThreadId + 0] = SharedIndexValues[2*LocalThreadId + 0];
-        ElementReMapping[2*GlobalThreadId + 1] = SharedIndexValues[2*LocalThreadId + 1];
-    }
+    // TODO: We can make this quicker probably with better LDS indexing to avoid bank conflicts
+    SharedStore(GlobalThreadId, LocalThreadId);
 }
 
 #endif
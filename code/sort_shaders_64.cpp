@@ -0,0 +1,120 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+/*
+  NOTE: Helper passes for the stable 64 bit key sort in huge_graphs_sort.cpp. The keys are u64 on the host, which is a uvec2 of
+        (low word, high word) here, so we don't need the int64 extension. The sort itself is an LSD radix sort over the two words
+        that reuses the stable 32 bit sort for the scan and scatter passes:
+
+        1) SORT64_LOW_WORD writes the low word of every key with its index as the payload, and the 32 bit sort orders them.
+        2) SORT64_HIGH_WORD swaps every low word for the high word of the key its index points to, and the 32 bit sort orders them
+           again. The sort is stable, so keys with the same high word keep their low word order and the indices end up in full
+           64 bit order.
+        3) SORT64_PERMUTE gathers the keys and payloads through the sorted indices into the scratch buffers, and the host copies
+           them back to the bound buffers. Sorts without a payload only gather the keys.
+ */
+
+layout(set = 0, binding = 0) buffer sort64_key_array
+{
+    uvec2 Sort64KeyArray[];
+};
+
+layout(set = 0, binding = 1) buffer sort64_payload_array
+{
+    uint Sort64PayloadArray[];
+};
+
+layout(set = 0, binding = 2) buffer sort64_word_array
+{
+    uint Sort64WordArray[];
+};
+
+layout(set = 0, binding = 3) buffer sort64_index_array
+{
+    uint Sort64IndexArray[];
+};
+
+layout(set = 0, binding = 4) buffer sort64_scratch_key_array
+{
+    uvec2 Sort64ScratchKeyArray[];
+};
+
+layout(set = 0, binding = 5) buffer sort64_scratch_payload_array
+{
+    uint Sort64ScratchPayloadArray[];
+};
+
+layout(push_constant) uniform push_constants
+{
+    uint NumKeys;
+    uint HasPayload;
+} PushConstants;
+
+uint Sort64ThreadId()
+{
+    uint GroupId = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint Result = GroupId * 64 + uint(gl_LocalInvocationIndex);
+    return Result;
+}
+
+//=========================================================================================================================================
+// NOTE: Sort64 Low Word
+//=========================================================================================================================================
+
+#if SORT64_LOW_WORD
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint KeyId = Sort64ThreadId();
+    if (KeyId < PushConstants.NumKeys)
+    {
+        Sort64WordArray[KeyId] = Sort64KeyArray[KeyId].x;
+        Sort64IndexArray[KeyId] = KeyId;
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Sort64 High Word
+//=========================================================================================================================================
+
+#if SORT64_HIGH_WORD
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint KeyId = Sort64ThreadId();
+    if (KeyId < PushConstants.NumKeys)
+    {
+        Sort64WordArray[KeyId] = Sort64KeyArray[Sort64IndexArray[KeyId]].y;
+    }
+}
+
+#endif
+
+//=========================================================================================================================================
+// NOTE: Sort64 Permute
+//=========================================================================================================================================
+
+#if SORT64_PERMUTE
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    uint KeyId = Sort64ThreadId();
+    if (KeyId < PushConstants.NumKeys)
+    {
+        uint SrcKeyId = Sort64IndexArray[KeyId];
+        Sort64ScratchKeyArray[KeyId] = Sort64KeyArray[SrcKeyId];
+        if (PushConstants.HasPayload != 0)
+        {
+            Sort64ScratchPayloadArray[KeyId] = Sort64PayloadArray[SrcKeyId];
+        }
+    }
+}
+
+#endif
@@ -6,10 +6,25 @@
 
 /*
   NOTE: Implementation based on https://poniesandlight.co.uk/reflect/bitonic_merge_sort/
+
+        Runs the whole bitonic network in one dispatch with persistent threads. Groups spinning on other groups only terminates if the
+        groups they wait on are resident, so we never wait on a group that might not have started yet:
+
+        1) Occupancy discovery. Every group tries to join a poll when it starts. The first group to join keeps the poll open for a
+           bounded number of checks and then closes it, groups that show up after that exit right away. Every group that joined was
+           running while the poll was open, so they are all resident at the same time and stay resident until they finish.
+        2) The groups that joined loop over the passes in PassParams. Each pass is split into ArraySize / 2048 work items that the
+           groups stride over, and a global barrier between passes waits on the joined groups only.
+
+        The host launches more groups than can be resident on any GPU, capped by the work per pass, and the poll trims that down to
+        what the device actually runs at once.
  */
 
 #include "sort_shaders_atomic.h"
 
+shared uint SharedArrayValues[2048];
+shared uint SharedPayloadValues[2048];
+
 void GlobalCompareAndSwap(uint Index1, uint Index2)
 {
     if (SortArray[Index1] > SortArray[Index2])
@@ -17,241 +32,220 @@ void GlobalCompareAndSwap(uint Index1, uint Index2)
         uint Temp = SortArray[Index1];
         SortArray[Index1] = SortArray[Index2];
         SortArray[Index2] = Temp;
+
+        Temp = SortPayloadArray[Index1];
+        SortPayloadArray[Index1] = SortPayloadArray[Index2];
+        SortPayloadArray[Index2] = Temp;
     }
 }
 
-void IncrementDoneCounter()
+void SharedCheckAndSwapValues(uint Id0, uint Id1)
 {
-    if (gl_LocalInvocationID.x == 0)
+    if (SharedArrayValues[Id0] > SharedArrayValues[Id1])
     {
-        atomicAdd(AtomicBuffer.DoneCounterId, 1);
+        uint Temp = SharedArrayValues[Id0];
+        SharedArrayValues[Id0] = SharedArrayValues[Id1];
+        SharedArrayValues[Id1] = Temp;
+
+        Temp = SharedPayloadValues[Id0];
+        SharedPayloadValues[Id0] = SharedPayloadValues[Id1];
+        SharedPayloadValues[Id1] = Temp;
     }
 }
 
-shared uint SharedWorkGroupId;
-shared uint DoneCounterToWaitOn;
-
-shared uint SharedPassType;
-shared uint SharedPassId;
-shared uint SharedFlipSize;
-shared uint SharedN;
+void SharedLoad(uint GlobalThreadId, uint LocalThreadId)
+{
+    // NOTE: The previous work item of this group might still be reading shared memory
+    barrier();
 
-shared uint SharedArrayValues[2048];
+    SharedArrayValues[2*LocalThreadId + 0] = SortArray[2*GlobalThreadId + 0];
+    SharedArrayValues[2*LocalThreadId + 1] = SortArray[2*GlobalThreadId + 1];
+    SharedPayloadValues[2*LocalThreadId + 0] = SortPayloadArray[2*GlobalThreadId + 0];
+    SharedPayloadValues[2*LocalThreadId + 1] = SortPayloadArray[2*GlobalThreadId + 1];
+}
 
-layout(local_size_x = 1024, local_size_y = 1, local_size_z = 1) in;
-void main()
+void SharedStore(uint GlobalThreadId, uint LocalThreadId)
 {
-    if (gl_LocalInvocationID.x == 0)
-    {
-        SharedWorkGroupId = atomicAdd(AtomicBuffer.WorkCountId, 1);
-        uint NumGroupsPerPass = uint(ceil(float(SortUniforms.ArraySize) / 2048.0f));
+    SortArray[2*GlobalThreadId + 0] = SharedArrayValues[2*LocalThreadId + 0];
+    SortArray[2*GlobalThreadId + 1] = SharedArrayValues[2*LocalThreadId + 1];
+    SortPayloadArray[2*GlobalThreadId + 0] = SharedPayloadValues[2*LocalThreadId + 0];
+    SortPayloadArray[2*GlobalThreadId + 1] = SharedPayloadValues[2*LocalThreadId + 1];
+}
 
-        // NOTE: Local FD
-#if 0
-        uint CurrWorkGroupId = 0;
-        SharedPassType = PassType_None;
+void GlobalBarrier(uint NumArrivals)
+{
+    // NOTE: Make this group's writes visible before it arrives, and everyone else's before it leaves
+    memoryBarrierBuffer();
+    barrier();
 
-        CurrWorkGroupId += NumGroupsPerPass;
-        if (SharedWorkGroupId < CurrWorkGroupId)
+    if (gl_LocalInvocationIndex == 0)
+    {
+        atomicAdd(AtomicBuffer.BarrierCounter, 1);
+        while (atomicAdd(AtomicBuffer.BarrierCounter, 0) < NumArrivals)
         {
-            SharedPassType = PassType_LocalFd;
         }
+    }
+
+    barrier();
+    memoryBarrierBuffer();
+}
 
-        // NOTE: General Pass
-        for (uint FlipSize = 2048, PassId = 11;
-             FlipSize < SortUniforms.ArraySize && SharedPassType == PassType_None;
-             PassId += 1, FlipSize *= 2)
+shared uint SharedParticipantId;
+shared uint SharedNumParticipants;
+
+layout(local_size_x = 1024, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+    // NOTE: Occupancy discovery
+    if (gl_LocalInvocationIndex == 0)
+    {
+        uint ParticipantId = NOT_PARTICIPATING;
+        uint PollState = atomicAdd(AtomicBuffer.PollState, 0);
+        while ((PollState & POLL_CLOSED_BIT) == 0)
         {
-            CurrWorkGroupId += NumGroupsPerPass;
-            if (SharedWorkGroupId < CurrWorkGroupId)
+            uint PrevPollState = atomicCompSwap(AtomicBuffer.PollState, PollState, PollState + 1);
+            if (PrevPollState == PollState)
             {
-                SharedPassType = PassType_GlobalFlip;
-                SharedFlipSize = FlipSize;
-                SharedPassId = PassId;
+                ParticipantId = PollState;
                 break;
             }
+            PollState = PrevPollState;
+        }
 
-            for (uint N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
+        if (ParticipantId == 0)
+        {
+            // NOTE: Give the groups that are already running a chance to join, we stop early once every launched group did
+            for (uint SpinId = 0; SpinId < POLL_SPIN_COUNT; ++SpinId)
             {
-                if (N < 1024)
+                if (atomicAdd(AtomicBuffer.PollState, 0) >= SortUniforms.NumLaunchedGroups)
                 {
-                    CurrWorkGroupId += NumGroupsPerPass;
-                    if (SharedWorkGroupId < CurrWorkGroupId)
-                    {
-                        SharedPassType = PassType_LocalDisperse;
-                        SharedN = N;
-                        SharedPassId = NPassId;
-                        break;
-                    }
                     break;
                 }
-                else
-                {
-                    CurrWorkGroupId += NumGroupsPerPass;
-                    if (SharedWorkGroupId < CurrWorkGroupId)
-                    {
-                        SharedPassType = PassType_GlobalDisperse;
-                        SharedN = N;
-                        SharedPassId = NPassId;
-                        break;
-                    }
-                }
             }
+            atomicOr(AtomicBuffer.PollState, POLL_CLOSED_BIT);
         }
-#endif
-
-        uint ElementId = SharedWorkGroupId / NumGroupsPerPass;
-        SharedPassType = PassParams[ElementId].PassType;
-        SharedFlipSize = PassParams[ElementId].FlipSize;
-        SharedPassId = PassParams[ElementId].PassId;
-        SharedN = PassParams[ElementId].N;
-        
-        //DoneCounterToWaitOn = CurrWorkGroupId - NumGroupsPerPass;
-        DoneCounterToWaitOn = ElementId * NumGroupsPerPass;
+
+        if (ParticipantId != NOT_PARTICIPATING)
+        {
+            // NOTE: Group 0 joined before us and is resident, so it will close the poll
+            do
+            {
+                PollState = atomicAdd(AtomicBuffer.PollState, 0);
+            } while ((PollState & POLL_CLOSED_BIT) == 0);
+
+            SharedNumParticipants = PollState & ~POLL_CLOSED_BIT;
+        }
+        SharedParticipantId = ParticipantId;
     }
 
-    //barrier();
-    memoryBarrierShared();
-
-    // TODO: For passes that are global, we can make them finish executing independently by having each 32/64 threads write atomically
-    // after they finish so we don't need memory barriers in that case. Idk if that is super helpful since I guess our wait time is more on
-    // the entire pass to finish, not some threads but might be worth a try
-    
-#if 1
-    // NOTE: Wait for prev pass to finish
-    // TODO: We can choose a more accurate counter to wait on
-    while (atomicAdd(AtomicBuffer.DoneCounterId, 0) < DoneCounterToWaitOn)
+    barrier();
+
+    uint ParticipantId = SharedParticipantId;
+    if (ParticipantId == NOT_PARTICIPATING)
     {
+        return;
     }
-    
-    uint GlobalThreadId = (SharedWorkGroupId - DoneCounterToWaitOn) * 1024 + uint(gl_LocalInvocationID.x);
-    switch (SharedPassType)
+    uint NumParticipants = SharedNumParticipants;
+
+    // NOTE: The sort module only runs us on powers of 2 of at least 2048 keys, so every work item fills a whole group
+    uint NumItemsPerPass = SortUniforms.ArraySize / 2048;
+    uint LocalThreadId = uint(gl_LocalInvocationIndex);
+    for (uint PassIndex = 0; PassIndex < SortUniforms.NumPasses; ++PassIndex)
     {
-        case PassType_LocalFd:
+        uint PassType = PassParams[PassIndex].PassType;
+        uint FlipSize = PassParams[PassIndex].FlipSize;
+        uint PassId = PassParams[PassIndex].PassId;
+        uint PassN = PassParams[PassIndex].N;
+
+        for (uint ItemId = ParticipantId; ItemId < NumItemsPerPass; ItemId += NumParticipants)
         {
-            if (GlobalThreadId < SortUniforms.ArraySize / 2)
+            uint GlobalThreadId = ItemId * 1024 + LocalThreadId;
+            switch (PassType)
             {
-                uint LocalThreadId = uint(gl_LocalInvocationIndex);
-                SharedArrayValues[2*LocalThreadId + 0] = SortArray[2*GlobalThreadId + 0];
-                SharedArrayValues[2*LocalThreadId + 1] = SortArray[2*GlobalThreadId + 1];
-
-                uint MinArraySize = min(SortUniforms.ArraySize, 2048);
-        
-                for (uint FlipSize = 1, PassId = 0; FlipSize < MinArraySize; PassId += 1, FlipSize *= 2)
+                case PassType_LocalFd:
                 {
-                    barrier();
+                    SharedLoad(GlobalThreadId, LocalThreadId);
 
-                    // NOTE: Do Flip
+                    for (uint LocalFlipSize = 1, LocalPassId = 0; LocalFlipSize < 2048; LocalPassId += 1, LocalFlipSize *= 2)
                     {
-                        uint LowerHeightBits = FlipSize - 1;
-                        uint FlipId1 = 2*FlipSize * (LocalThreadId >> PassId) + (LocalThreadId & LowerHeightBits);
-                        uint FlipId2 = FlipId1 + 2*FlipSize - 2 * (LocalThreadId & LowerHeightBits) - 1;
+                        barrier();
 
-                        if (SharedArrayValues[FlipId1] > SharedArrayValues[FlipId2])
+                        // NOTE: Do Flip
                         {
-                            uint Temp = SharedArrayValues[FlipId1];
-                            SharedArrayValues[FlipId1] = SharedArrayValues[FlipId2];
-                            SharedArrayValues[FlipId2] = Temp;
+                            uint LowerHeightBits = LocalFlipSize - 1;
+                            uint FlipId1 = 2*LocalFlipSize * (LocalThreadId >> LocalPassId) + (LocalThreadId & LowerHeightBits);
+                            uint FlipId2 = FlipId1 + 2*LocalFlipSize - 2 * (LocalThreadId & LowerHeightBits) - 1;
+
+                            SharedCheckAndSwapValues(FlipId1, FlipId2);
+                        }
+
+                        barrier();
+
+                        // NOTE: Do Disperse
+                        for (uint N = LocalFlipSize / 2, NPassId = LocalPassId - 1; N > 0; NPassId -= 1, N = N / 2)
+                        {
+                            uint DoubleHeight = N * 2;
+                            uint LowerBits = N - 1;
+                            uint DisperseId1 = DoubleHeight * ((LocalThreadId & (~LowerBits)) >> NPassId) + (LocalThreadId & LowerBits);
+                            uint DisperseId2 = DisperseId1 + N;
+
+                            SharedCheckAndSwapValues(DisperseId1, DisperseId2);
+
+                            barrier();
                         }
                     }
-        
+
+                    SharedStore(GlobalThreadId, LocalThreadId);
+                } break;
+
+                case PassType_GlobalFlip:
+                {
+                    uint DoubleFlip = 2*FlipSize;
+                    uint LowerHeightBits = FlipSize - 1;
+                    uint FlipId1 = DoubleFlip * (GlobalThreadId >> PassId) + (GlobalThreadId & LowerHeightBits);
+                    uint FlipId2 = FlipId1 + DoubleFlip - 2 * (GlobalThreadId & LowerHeightBits) - 1;
+
+                    GlobalCompareAndSwap(FlipId1, FlipId2);
+                } break;
+
+                case PassType_LocalDisperse:
+                {
+                    SharedLoad(GlobalThreadId, LocalThreadId);
+
                     barrier();
 
                     // NOTE: Do Disperse
-                    for (uint N = FlipSize / 2, NPassId = PassId - 1; N > 0; NPassId -= 1, N = N / 2)
+                    for (uint N = 1024, NPassId = 10; N > 0; NPassId -= 1, N = N / 2)
                     {
                         uint DoubleHeight = N * 2;
                         uint LowerBits = N - 1;
                         uint DisperseId1 = DoubleHeight * ((LocalThreadId & (~LowerBits)) >> NPassId) + (LocalThreadId & LowerBits);
                         uint DisperseId2 = DisperseId1 + N;
-            
-                        if (SharedArrayValues[DisperseId1] > SharedArrayValues[DisperseId2])
-                        {
-                            uint Temp = SharedArrayValues[DisperseId1];
-                            SharedArrayValues[DisperseId1] = SharedArrayValues[DisperseId2];
-                            SharedArrayValues[DisperseId2] = Temp;
-                        }
+
+                        SharedCheckAndSwapValues(DisperseId1, DisperseId2);
 
                         barrier();
                     }
-                }
-
-                SortArray[2*GlobalThreadId + 0] = SharedArrayValues[2*LocalThreadId + 0];
-                SortArray[2*GlobalThreadId + 1] = SharedArrayValues[2*LocalThreadId + 1];
 
-                //memoryBarrier();
-                IncrementDoneCounter();
-            }
-
-        } break;
-
-        case PassType_GlobalFlip:
-        {
-            if (GlobalThreadId < SortUniforms.ArraySize / 2)
-            {
-                uint DoubleFlip = 2*SharedFlipSize;
-                uint LowerHeightBits = SharedFlipSize - 1;
-                uint FlipId1 = DoubleFlip * (GlobalThreadId >> SharedPassId) + (GlobalThreadId & LowerHeightBits);
-                uint FlipId2 = FlipId1 + DoubleFlip - 2 * (GlobalThreadId & LowerHeightBits) - 1;
-        
-                GlobalCompareAndSwap(FlipId1, FlipId2);
-                
-                //memoryBarrier();
-                IncrementDoneCounter();
-            }
-        } break;
+                    SharedStore(GlobalThreadId, LocalThreadId);
+                } break;
 
-        case PassType_LocalDisperse:
-        {
-            if (GlobalThreadId < SortUniforms.ArraySize / 2)
-            {
-                uint LocalThreadId = uint(gl_LocalInvocationIndex);
-                SharedArrayValues[2*LocalThreadId + 0] = SortArray[2*GlobalThreadId + 0];
-                SharedArrayValues[2*LocalThreadId + 1] = SortArray[2*GlobalThreadId + 1];
-
-                barrier();
-
-                // NOTE: Do Disperse
-                for (uint N = 1024, NPassId = 10; N > 0; NPassId -= 1, N = N / 2)
+                case PassType_GlobalDisperse:
                 {
-                    uint DoubleHeight = N * 2;
-                    uint LowerBits = N - 1;
-                    uint DisperseId1 = DoubleHeight * ((LocalThreadId & (~LowerBits)) >> NPassId) + (LocalThreadId & LowerBits);
-                    uint DisperseId2 = DisperseId1 + N;
-            
-                    if (SharedArrayValues[DisperseId1] > SharedArrayValues[DisperseId2])
-                    {
-                        uint Temp = SharedArrayValues[DisperseId1];
-                        SharedArrayValues[DisperseId1] = SharedArrayValues[DisperseId2];
-                        SharedArrayValues[DisperseId2] = Temp;
-                    }
+                    uint DoubleHeight = PassN * 2;
+                    uint LowerBits = PassN - 1;
+                    uint DisperseId1 = DoubleHeight * ((GlobalThreadId & (~LowerBits)) >> PassId) + (GlobalThreadId & LowerBits);
+                    uint DisperseId2 = DisperseId1 + PassN;
 
-                    barrier();
-                }
-        
-                SortArray[2*GlobalThreadId + 0] = SharedArrayValues[2*LocalThreadId + 0];
-                SortArray[2*GlobalThreadId + 1] = SharedArrayValues[2*LocalThreadId + 1];
-
-                //memoryBarrier();
-                IncrementDoneCounter();
+                    GlobalCompareAndSwap(DisperseId1, DisperseId2);
+                } break;
             }
-        } break;
+        }
 
-        case PassType_GlobalDisperse:
+        // NOTE: Wait for every joined group to finish this pass before anyone starts the next
+        if (PassIndex + 1 < SortUniforms.NumPasses)
         {
-            if (GlobalThreadId < SortUniforms.ArraySize / 2)
-            {
-                uint DoubleHeight = SharedN * 2;
-                uint LowerBits = SharedN - 1;
-                uint DisperseId1 = DoubleHeight * ((GlobalThreadId & (~LowerBits)) >> SharedPassId) + (GlobalThreadId & LowerBits);
-                uint DisperseId2 = DisperseId1 + SharedN;
-
-                GlobalCompareAndSwap(DisperseId1, DisperseId2);
-
-                //memoryBarrier();
-                IncrementDoneCounter();
-            }
-        } break;
+            GlobalBarrier((PassIndex + 1) * NumParticipants);
+        }
     }
-#endif
 }
@@ -2,6 +2,8 @@
 layout(set = 0, binding = 0) uniform sort_uniforms
 {
     uint ArraySize;
+    uint NumPasses;
+    uint NumLaunchedGroups;
 } SortUniforms;
 
 layout(set = 0, binding = 1) coherent buffer sort_array
@@ -9,12 +11,18 @@ layout(set = 0, binding = 1) coherent buffer sort_array
     uint SortArray[];
 };
 
-layout(set = 0, binding = 2) buffer atomic_buffer
+// NOTE: PollState holds the number of groups that joined the sort, the top bit gets set once the poll closes
+layout(set = 0, binding = 2) coherent buffer atomic_buffer
 {
-    uint WorkCountId;
-    uint DoneCounterId;
+    uint PollState;
+    uint BarrierCounter;
 } AtomicBuffer;
 
+#define POLL_CLOSED_BIT 0x80000000
+#define NOT_PARTICIPATING 0xFFFFFFFF
+// NOTE: How many times the first group checks the poll before closing it, bounded so it never waits on another group
+#define POLL_SPIN_COUNT 4096
+
 #define PassType_None 0
 #define PassType_LocalFd 1
 #define PassType_GlobalFlip 2
@@ -33,3 +41,8 @@ layout(set = 0, binding = 3) buffer pass_params_buffer
 {
     pass_params PassParams[];
 };
+
+layout(set = 0, binding = 4) coherent buffer sort_payload_array
+{
+    uint SortPayloadArray[];
+};